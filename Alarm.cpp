@@ -0,0 +1,351 @@
+/***************
+* NTP Clock
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "Alarm.h"
+#include "Log.h"
+
+
+/***************************************
+* tAlarms constructor
+*
+*/
+
+tAlarms::tAlarms()
+{
+  uint8_t i;
+
+  _pLocalTime = NULL;
+  _u8HeapSize = 0;
+  _u8State    = ALARM_STATE_IDLE;
+  _u8Ringing  = 0;
+  _tRingStart = 0;
+
+  for (i=0; i<ALARM_MAX; i++)  memset(&_Alarms[i], 0, sizeof(_Alarms[i]));
+  for (i=0; i<=ALARM_MAX; i++) {
+    _tNext[i]     = 0;
+    _u8HeapPos[i] = ALARM_NOT_QUEUED;
+  }
+}
+
+
+/***************************************
+* tAlarms::SetTimeZone
+*
+*/
+
+void tAlarms::SetTimeZone(tLocalTime *pLocalTime, time_t tUtc)
+{
+  uint8_t i;
+
+  _pLocalTime = pLocalTime;
+
+  for (i=0; i<ALARM_MAX; i++) {
+    _Remove(i);
+    if (_Alarms[i].bEnabled)  _Push(i, _Next(i, tUtc));
+  }
+}
+
+
+/***************************************
+* tAlarms::Set
+*
+* RETURNS:
+*   false if the alarm or time is out of range, or there's no time zone yet
+*/
+
+bool tAlarms::Set(uint8_t u8Alarm, uint8_t u8Hour, uint8_t u8Minute, uint8_t u8Days, time_t tUtc)
+{
+  tAlarm *pAlarm;
+
+  if (u8Alarm >= ALARM_MAX  ||  u8Hour > 23  ||  u8Minute > 59  ||  _pLocalTime == NULL)  return false;
+
+  Clear(u8Alarm);
+
+  pAlarm = &_Alarms[u8Alarm];
+  pAlarm->bEnabled = true;
+  pAlarm->u8Hour   = u8Hour;
+  pAlarm->u8Minute = u8Minute;
+  pAlarm->u8Days   = u8Days & ALARM_DAYS_DAILY;
+
+  _Push(u8Alarm, _Next(u8Alarm, tUtc));
+  LOG(LOG_INFO, LOG_MSG_ALARM_SET, u8Alarm, _tNext[u8Alarm]);
+  return true;
+}
+
+
+/***************************************
+* tAlarms::Clear
+*
+* Also stops it if it's ringing or snoozed
+*/
+
+void tAlarms::Clear(uint8_t u8Alarm)
+{
+  if (u8Alarm >= ALARM_MAX)  return;
+
+  if (_u8State != ALARM_STATE_IDLE  &&  _u8Ringing == u8Alarm)  Dismiss();
+
+  _Remove(u8Alarm);
+  _Alarms[u8Alarm].bEnabled = false;
+}
+
+
+/***************************************
+* tAlarms::NextTime
+*
+*/
+
+time_t tAlarms::NextTime(uint8_t u8Alarm) const
+{
+  if (u8Alarm >= ALARM_MAX  ||  _u8HeapPos[u8Alarm] == ALARM_NOT_QUEUED)  return 0;
+
+  return _tNext[u8Alarm];
+}
+
+
+/***************************************
+* tAlarms::AnyEnabled
+*
+*/
+
+bool tAlarms::AnyEnabled() const
+{
+  uint8_t i;
+
+  for (i=0; i<ALARM_MAX; i++) {
+    if (_Alarms[i].bEnabled)  return true;
+  }
+  return false;
+}
+
+
+/***************************************
+* tAlarms::Service
+*
+* Takes everything that's due off the top of the heap.  An alarm that repeats goes
+* back in for its next time; one that doesn't is turned off, unless it was skipped.
+*
+* RETURNS:
+*   true if an alarm started ringing
+*/
+
+bool tAlarms::Service(time_t tUtc)
+{
+  uint8_t u8Entry;
+  bool    bLate;
+  bool    bStarted = false;
+
+  if (_u8State == ALARM_STATE_RINGING  &&  tUtc - _tRingStart >= ALARM_RING_SECONDS)  Dismiss();
+
+  while (_u8HeapSize > 0  &&  _tNext[_u8Heap[0]] <= tUtc) {
+    u8Entry = _u8Heap[0];
+    bLate   = tUtc - _tNext[u8Entry] > ALARM_MAX_LATE_SECONDS;
+    _Remove(u8Entry);
+
+    if (u8Entry == ALARM_SNOOZE) {
+      _u8State = ALARM_STATE_IDLE;
+      if (!bLate) {
+        _u8State    = ALARM_STATE_RINGING;
+        _tRingStart = tUtc;
+        bStarted    = true;
+      }
+      continue;
+    }
+
+    if (bLate  ||  _Alarms[u8Entry].u8Days != ALARM_DAYS_ONCE)  _Push(u8Entry, _Next(u8Entry, tUtc));
+    else                                                        _Alarms[u8Entry].bEnabled = false;
+
+    if (bLate)  continue;
+
+    // A new alarm takes over from one that's ringing or snoozed
+    _Remove(ALARM_SNOOZE);
+    _u8State    = ALARM_STATE_RINGING;
+    _u8Ringing  = u8Entry;
+    _tRingStart = tUtc;
+    bStarted    = true;
+  }
+
+  if (bStarted)  LOG(LOG_INFO, LOG_MSG_ALARM_RING, _u8Ringing);
+  return bStarted;
+}
+
+
+/***************************************
+* tAlarms::Snooze
+*
+*/
+
+void tAlarms::Snooze(time_t tUtc)
+{
+  if (_u8State != ALARM_STATE_RINGING)  return;
+
+  _u8State = ALARM_STATE_SNOOZED;
+  _Push(ALARM_SNOOZE, tUtc + ALARM_SNOOZE_SECONDS);
+  LOG(LOG_INFO, LOG_MSG_ALARM_SNOOZE, _u8Ringing, _tNext[ALARM_SNOOZE]);
+}
+
+
+/***************************************
+* tAlarms::Dismiss
+*
+*/
+
+void tAlarms::Dismiss()
+{
+  if (_u8State == ALARM_STATE_IDLE)  return;
+
+  _Remove(ALARM_SNOOZE);
+  _u8State = ALARM_STATE_IDLE;
+  LOG(LOG_INFO, LOG_MSG_ALARM_OFF, _u8Ringing);
+}
+
+
+/***************************************
+* tAlarms::_Next
+*
+* Tries today and each of the next 7 days, in local time, for the first day the
+* alarm is on whose time is still to come.  An alarm that goes off once is on
+* every day.
+*
+* RETURNS:
+*   The UTC time, after tUtc
+*/
+
+time_t tAlarms::_Next(uint8_t u8Alarm, time_t tUtc)
+{
+  const tAlarm *pAlarm = &_Alarms[u8Alarm];
+  uint8_t       u8Days = pAlarm->u8Days != ALARM_DAYS_ONCE ? pAlarm->u8Days : ALARM_DAYS_DAILY;
+  time_t        tDay, tNext;
+  uint8_t       i;
+
+  tDay = _pLocalTime->UtcToLocal(tUtc);
+  tDay = tDay - tDay % SECS_PER_DAY;
+
+  for (i=0; i<=7; i++, tDay += SECS_PER_DAY) {
+    if (!(u8Days & (1 << (weekday(tDay) - 1))))  continue;
+
+    tNext = _pLocalTime->LocalToUtc(tDay + pAlarm->u8Hour * SECS_PER_HOUR + pAlarm->u8Minute * SECS_PER_MIN);
+    if (tNext > tUtc)  return tNext;
+  }
+
+  // Can't happen: a week on is always later
+  return tUtc + SECS_PER_DAY;
+}
+
+
+/***************************************
+* tAlarms::PrintReport
+*
+* One line per alarm: its time and days, and when it next goes off
+*/
+
+void tAlarms::PrintReport(Print &Out)
+{
+  static const char sDays[] = "SMTWTFS";
+  char              sLine[60], sDayList[8];
+  tmElements_t      Tm;
+  uint8_t           i, d;
+
+  for (i=0; i<ALARM_MAX; i++) {
+    const tAlarm &Alarm = _Alarms[i];
+
+    if (!Alarm.bEnabled) {
+      snprintf(sLine, sizeof(sLine), "%u: off", i);
+      Out.println(sLine);
+      continue;
+    }
+
+    for (d=0; d<7; d++)  sDayList[d] = (Alarm.u8Days & (1 << d)) ? sDays[d] : '-';
+    sDayList[7] = '\0';
+
+    breakTime(_pLocalTime->UtcToLocal(_tNext[i]), Tm);
+    snprintf(sLine, sizeof(sLine), "%u: %02u:%02u %s, next %04u-%02u-%02u %02u:%02u%s", i,
+             Alarm.u8Hour, Alarm.u8Minute, Alarm.u8Days != ALARM_DAYS_ONCE ? sDayList : "once",
+             tmYearToCalendar(Tm.Year), Tm.Month, Tm.Day, Tm.Hour, Tm.Minute,
+             _u8State != ALARM_STATE_IDLE  &&  _u8Ringing == i ?
+               (_u8State == ALARM_STATE_RINGING ? ", ringing" : ", snoozed") : "");
+    Out.println(sLine);
+  }
+}
+
+
+/***************************************
+* Heap helpers
+*
+* The same binary min-heap as tScheduler's, on the times the entries go off.
+* _Remove() takes an entry rather than a position, and does nothing if it isn't
+* queued.
+*/
+
+bool tAlarms::_Before(uint8_t u8EntryA, uint8_t u8EntryB) const
+{
+  return _tNext[u8EntryA] < _tNext[u8EntryB];
+}
+
+void tAlarms::_Swap(uint8_t u8PosA, uint8_t u8PosB)
+{
+  uint8_t u8Entry = _u8Heap[u8PosA];
+
+  _u8Heap[u8PosA] = _u8Heap[u8PosB];
+  _u8Heap[u8PosB] = u8Entry;
+  _u8HeapPos[_u8Heap[u8PosA]] = u8PosA;
+  _u8HeapPos[_u8Heap[u8PosB]] = u8PosB;
+}
+
+void tAlarms::_SiftUp(uint8_t u8Pos)
+{
+  uint8_t u8Parent;
+
+  while (u8Pos > 0) {
+    u8Parent = (u8Pos - 1) / 2;
+    if (!_Before(_u8Heap[u8Pos], _u8Heap[u8Parent]))  break;
+    _Swap(u8Pos, u8Parent);
+    u8Pos = u8Parent;
+  }
+}
+
+void tAlarms::_SiftDown(uint8_t u8Pos)
+{
+  uint8_t u8Child, u8Smallest;
+
+  for (;;) {
+    u8Smallest = u8Pos;
+    u8Child    = 2 * u8Pos + 1;
+    if (u8Child   < _u8HeapSize  &&  _Before(_u8Heap[u8Child],   _u8Heap[u8Smallest]))  u8Smallest = u8Child;
+    if (u8Child+1 < _u8HeapSize  &&  _Before(_u8Heap[u8Child+1], _u8Heap[u8Smallest]))  u8Smallest = u8Child+1;
+    if (u8Smallest == u8Pos)  break;
+    _Swap(u8Pos, u8Smallest);
+    u8Pos = u8Smallest;
+  }
+}
+
+void tAlarms::_Push(uint8_t u8Entry, time_t tTime)
+{
+  _Remove(u8Entry);
+
+  _tNext[u8Entry]       = tTime;
+  _u8Heap[_u8HeapSize]  = u8Entry;
+  _u8HeapPos[u8Entry]   = _u8HeapSize;
+  _SiftUp(_u8HeapSize++);
+}
+
+void tAlarms::_Remove(uint8_t u8Entry)
+{
+  uint8_t u8Pos = _u8HeapPos[u8Entry];
+  uint8_t u8Moved;
+
+  if (u8Pos == ALARM_NOT_QUEUED)  return;
+
+  // Move the last entry into the hole, then let it find its level
+  u8Moved = _u8Heap[--_u8HeapSize];
+  if (u8Pos != _u8HeapSize) {
+    _Swap(u8Pos, _u8HeapSize);
+    _SiftUp(u8Pos);
+    _SiftDown(_u8HeapPos[u8Moved]);
+  }
+  _u8HeapPos[u8Entry] = ALARM_NOT_QUEUED;
+}
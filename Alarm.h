@@ -0,0 +1,117 @@
+/***************
+* NTP Clock
+*
+* tAlarms keeps the clock's alarms.  Each goes off at an hour and minute of local
+* time, once or on a set of days of the week (every day, weekdays, or any mix).
+*
+* When an alarm is set, or has just gone off, the UTC instant it next goes off is
+* worked out from the time zone's rules for that day, so DST changes in between
+* are taken care of up front.  The instants are kept in a min-heap, so each second
+* Service() only has to look at the earliest.  A time that's skipped when the
+* clocks go forward goes off when it would have without the change (2:30 at 3:30);
+* one that happens twice when they go back goes off once.
+*
+* An alarm that goes off rings until it's snoozed, dismissed or ALARM_RING_SECONDS
+* have gone by.  Snoozing puts it back in the heap ALARM_SNOOZE_SECONDS on, as one
+* more entry.  What "ringing" means is up to the caller: State() says.
+*
+* If the time steps forward past an alarm by more than ALARM_MAX_LATE_SECONDS
+* (such as the first NTP sync, from 1970), it's skipped rather than rung late.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef ALARM_H
+#define ALARM_H
+
+#include <Arduino.h>
+#include <TimeLib.h>
+#include "LocalTime.h"
+
+#define ALARM_MAX               (4)
+#define ALARM_SNOOZE            (ALARM_MAX)     // The heap entry for a snooze
+#define ALARM_NOT_QUEUED        (0xFF)
+
+#define ALARM_SNOOZE_SECONDS    (540)
+#define ALARM_RING_SECONDS      (600)
+#define ALARM_MAX_LATE_SECONDS  (120)
+
+// Days of the week as a bit mask, bit 0 = Sunday.  An alarm with no days goes off
+// once, and then turns itself off.
+#define ALARM_DAYS_ONCE         (0x00)
+#define ALARM_DAYS_DAILY        (0x7F)
+#define ALARM_DAYS_WEEKDAYS     (0x3E)
+#define ALARM_DAYS_WEEKENDS     (0x41)
+
+struct tAlarm {
+  bool    bEnabled;
+  uint8_t u8Hour;
+  uint8_t u8Minute;
+  uint8_t u8Days;
+};
+
+typedef enum {
+  ALARM_STATE_IDLE,
+  ALARM_STATE_RINGING,
+  ALARM_STATE_SNOOZED
+} ALARM_STATE;
+
+
+class tAlarms {
+public:
+  tAlarms();
+
+  // Alarms go off in this time zone.  Changing it works them all out again.
+  void SetTimeZone(tLocalTime *pLocalTime, time_t tUtc);
+
+  // u8Days is a mask of ALARM_DAYS_ bits.  Returns false for a bad alarm or time.
+  bool Set(uint8_t u8Alarm, uint8_t u8Hour, uint8_t u8Minute, uint8_t u8Days, time_t tUtc);
+  void Clear(uint8_t u8Alarm);
+
+  const tAlarm &Alarm(uint8_t u8Alarm) const { return _Alarms[u8Alarm]; }
+
+  // When it next goes off, in UTC, or 0 if it's off
+  time_t NextTime(uint8_t u8Alarm) const;
+
+  // Call once a second.  Returns true when an alarm starts ringing.
+  bool Service(time_t tUtc);
+
+  // Both do nothing unless an alarm is ringing (or, for Dismiss(), snoozed)
+  void Snooze(time_t tUtc);
+  void Dismiss();
+
+  ALARM_STATE State()   const { return (ALARM_STATE) _u8State; }
+  uint8_t     Ringing() const { return _u8Ringing; }   // Which one, while not idle
+  bool        AnyEnabled() const;
+
+  void PrintReport(Print &Out);
+
+protected:
+  time_t _Next(uint8_t u8Alarm, time_t tUtc);
+
+  bool _Before(uint8_t u8EntryA, uint8_t u8EntryB) const;
+  void _Swap(uint8_t u8PosA, uint8_t u8PosB);
+  void _SiftUp(uint8_t u8Pos);
+  void _SiftDown(uint8_t u8Pos);
+  void _Push(uint8_t u8Entry, time_t tTime);
+  void _Remove(uint8_t u8Entry);
+
+  tLocalTime *_pLocalTime;
+  tAlarm      _Alarms[ALARM_MAX];
+
+  // The heap holds alarm numbers (and ALARM_SNOOZE), earliest first.  _u8HeapPos[]
+  // is where each sits in it, or ALARM_NOT_QUEUED.
+  time_t  _tNext[ALARM_MAX+1];
+  uint8_t _u8Heap[ALARM_MAX+1];
+  uint8_t _u8HeapPos[ALARM_MAX+1];
+  uint8_t _u8HeapSize;
+
+  uint8_t _u8State;
+  uint8_t _u8Ringing;
+  time_t  _tRingStart;
+};
+
+
+#endif   /* ALARM_H */
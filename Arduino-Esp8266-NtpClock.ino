@@ -9,6 +9,7 @@
 #include "ssid.h"
 #include "WiFiConnection.h"
 #include "Ntp.h"
+#include "Timebase.h"
 
 #include <SPI.h>
 
@@ -16,6 +17,22 @@
 #include "LocalTime.h"
 #include "Max6954.h"
 #include "ClockDisplay.h"
+#include "SoftMux.h"
+#include "Fader.h"
+#include "AutoBrightness.h"
+#include "TextRenderer.h"
+#include "Scheduler.h"
+#include "PowerManager.h"
+#include "Log.h"
+#include "Probe.h"
+#include "Metrics.h"
+#include "SpiTrace.h"
+#include "Max6954Model.h"
+#include "VirtualDisplay.h"
+#include "Alarm.h"
+#include "Settings.h"
+#include "Bench.h"
+#include "TimeCheck.h"
 
 extern "C" {
   // This define makes the microsecond timer call os_timer_arm_us visible
@@ -42,16 +59,94 @@ extern "C" {
 
 #define NTP_REFRESH_INTERVAL_SECONDS (300)
 
-static int ModuleLedPin =  2;
-static int NodeLedPin   = 16;
+// Define this on boards that multiplex the panel from the ESP8266 through a shift
+// register, rather than through the MAX6954 or the GAL.  Those boards have no
+// MAX6954, so it's left alone and its pins are free for the soft mux.
+//#define CLOCK_USE_SOFT_MUX
+
+#define SOFTMUX_DATA_GPIO     (13)
+#define SOFTMUX_CLOCK_GPIO    (14)
+#define SOFTMUX_LATCH_GPIO    (15)
+#define SOFTMUX_CATHODE0_GPIO (12)
+#define SOFTMUX_CATHODE1_GPIO (5)
+static const uint8_t SoftMuxCathodePins[] = { SOFTMUX_CATHODE0_GPIO, SOFTMUX_CATHODE1_GPIO };
+
+#define MODULE_LED_GPIO       (2)
+#define NODE_LED_GPIO         (16)
+
+// The LEDs are still driven with the soft mux in use
+#define SOFTMUX_USES_GPIO(p)  ((p) == SOFTMUX_DATA_GPIO  ||  (p) == SOFTMUX_CLOCK_GPIO  ||  (p) == SOFTMUX_LATCH_GPIO  || \
+                               (p) == SOFTMUX_CATHODE0_GPIO  ||  (p) == SOFTMUX_CATHODE1_GPIO)
+#if defined(CLOCK_USE_SOFT_MUX)  &&  (SOFTMUX_USES_GPIO(MODULE_LED_GPIO)  ||  SOFTMUX_USES_GPIO(NODE_LED_GPIO))
+#error "The soft mux pins overlap the LED pins"
+#endif
+
+// Which panel is fitted.  See DisplayGeometry.h for the ones we know about.
+#define CLOCK_GEOMETRY     DisplayGeometryLiteOn637
+
+// Define this to trace the MAX6954 bus and print what the panel should be showing
+// to the serial port every second.  Handy when the board isn't in front of you.
+//#define CLOCK_MIRROR_DISPLAY
+
+// How hard to save power.  See PowerManager.h.  With the radio off between syncs,
+// it is brought up this many seconds before each NTP query is due.
+#define CLOCK_POWER_MODE              POWER_MODE_AWAKE
+#define CLOCK_RADIO_OFF_BETWEEN_SYNCS false
+#define CLOCK_RADIO_LEAD_SECONDS      (5)
+
+// Log as binary frames (decode with tools/logdecode.py) rather than text
+#define CLOCK_LOG_BINARY              false
+
+// Metrics are served over HTTP on this port, and pushed as UDP datagrams to the
+// collector every CLOCK_METRICS_PUSH_SECONDS.  A collector address of 0.0.0.0 turns
+// the push off.  It's an address rather than a name so that there's no DNS lookup
+// to wait on.
+#define CLOCK_METRICS_PORT            (80)
+#define CLOCK_METRICS_PUSH_PORT       (8125)
+#define CLOCK_METRICS_PUSH_SECONDS    (60)
+static const IPAddress MetricsPushIp(0, 0, 0, 0);
+
+// Leap seconds are shown as 23:59:60 if this is 0.  Otherwise they're smeared over
+// this many seconds around midnight (86400 is noon to noon), and never shown.
+#define CLOCK_LEAP_SMEAR_SECONDS      (0)
+
+// How the display shows that the time can't be fully trusted (see NTP_SYNC_STATE):
+// the colon blinks in holdover, and before the first sync or once stale, the
+// brightness is held down to this level too
+#define CLOCK_DOUBTFUL_LEVEL          (2)
+
+// How long the dim-swap-brighten takes when the displayed digits change
+#define CLOCK_CROSSFADE_MS (400)
+
+static int ModuleLedPin = MODULE_LED_GPIO;
+static int NodeLedPin   = NODE_LED_GPIO;
 static unsigned int localPort = 2390;           // local port to listen for UDP packets
 
-// Note - the tNtp class demands that this be constant for the life of the app
-static const char ntpServerName[] = "us.pool.ntp.org";
-//static const char ntpServerName[] = "time.nist.gov";
-//static const char ntpServerName[] = "time-a.timefreq.bldrdoc.gov";
-//static const char ntpServerName[] = "time-b.timefreq.bldrdoc.gov";
-//static const char ntpServerName[] = "time-c.timefreq.bldrdoc.gov";
+// Note - the tNtp class keeps a pointer to this, so it has to stay put.  The
+// settings store can replace it (see "set ntp").
+static char ntpServerName[SETTINGS_MAX_LEN+1] = "us.pool.ntp.org";
+//static char ntpServerName[SETTINGS_MAX_LEN+1] = "time.nist.gov";
+//static char ntpServerName[SETTINGS_MAX_LEN+1] = "time-a.timefreq.bldrdoc.gov";
+//static char ntpServerName[SETTINGS_MAX_LEN+1] = "time-b.timefreq.bldrdoc.gov";
+//static char ntpServerName[SETTINGS_MAX_LEN+1] = "time-c.timefreq.bldrdoc.gov";
+
+// Full range by day, nothing above 3/16 between 10 PM and 6 AM: minimum, maximum,
+// night start hour, night end hour and night maximum.  The settings store can
+// replace it (see "set bright").
+static uint8_t Brightness[5] = { 0, 12, 22, 6, 3 };
+
+// What's kept in the settings store (see Settings.h).  Anything never set keeps
+// the value compiled in here.  Add new ones at the end, so stored ones keep their
+// meaning.
+typedef enum {
+  SETTING_TIME_ZONE,
+  SETTING_BRIGHTNESS,
+  SETTING_NTP_SERVER,
+  SETTING_WIFI_SSID,        // A network tried along with the ones in ssid.h
+  SETTING_WIFI_PASSWORD,
+  SETTING_ALARM_0,          // A tAlarm each, ALARM_MAX of them
+  SETTING_END = SETTING_ALARM_0 + ALARM_MAX
+} SETTING;
 
 
 /*****************************************
@@ -59,11 +154,45 @@ static const char ntpServerName[] = "us.pool.ntp.org";
 * 
 */
 
+// The networks to try.  See ssid.h.  The first is from the settings store, and is
+// skipped while its SSID is empty.
+static char StoredSsid[33];
+static char StoredPassword[SETTINGS_MAX_LEN+1];
+static const tWiFiCredential WiFiNetworks[] = {
+  { StoredSsid, StoredPassword },
+  { NTP_SSID,  NTP_PASSWD  },
+#ifdef NTP_SSID2
+  { NTP_SSID2, NTP_PASSWD2 },
+#endif
+#ifdef NTP_SSID3
+  { NTP_SSID3, NTP_PASSWD3 },
+#endif
+};
+
 tMax6954        LedDriver;
-tClockDisplay   Display(LedDriver);
-tWiFiConnection WiFiConnection(NTP_SSID, NTP_PASSWD, ModuleLedPin);
-tNtp            NtpServer(ntpServerName, localPort, NTP_REFRESH_INTERVAL_SECONDS);
+tClockDisplay   Display(LedDriver, CLOCK_GEOMETRY);
+tIntensityFader Fader(LedDriver);
+tAutoBrightness AutoBrightness(LedDriver, CLOCK_GEOMETRY.u8ScanLimit);
+tTextRenderer   Text(Display);
+#ifdef CLOCK_USE_SOFT_MUX
+tSoftMux        SoftMux;
+#endif
+#ifdef CLOCK_MIRROR_DISPLAY
+tSpiTrace       SpiTrace;
+tMax6954Model   LedModel;
+tVirtualDisplay Mirror(CLOCK_GEOMETRY, LedModel);
+#endif
+tWiFiConnection WiFiConnection(WiFiNetworks, sizeof(WiFiNetworks) / sizeof(WiFiNetworks[0]), ModuleLedPin);
+tTimebase       Timebase;
+tNtp            NtpServer(Timebase, ntpServerName, localPort, NTP_REFRESH_INTERVAL_SECONDS);
 tTimeZoneSet    TimeZoneSet;
+tScheduler      Scheduler;
+tPowerManager   PowerManager;
+tMetrics        Metrics(NtpServer, Timebase, Scheduler, WiFiConnection, CLOCK_METRICS_PORT);
+tAlarms         Alarms;
+tSettingsStore  Settings;
+tBench          Bench(Display, LedDriver, NtpServer);
+tTimeCheck      TimeCheck;
 os_timer_t      MyTimer;
 int             iLastVal      = LOW;
   
@@ -79,13 +208,785 @@ void ICACHE_RAM_ATTR timerCallback(void *pArg) {
   } 
 } // End of timerCallback
 
+
+/*****************************************
+* ShowPendingDigits() - Fader callback that swaps in new digits
+*
+* Runs at the bottom of a cross-fade, while the digits are dim.  pArg points at
+* the Display.NumDigits() characters to show.
+*/
+
+void ShowPendingDigits(void *pArg)
+{
+  memcpy(Display.Digit, pArg, Display.NumDigits());
+  Display.Update();
+}
+
+  
+/*****************************************
+* Tasks
+*
+* Everything the loop does is a task on Scheduler, so the CPU only wakes up when
+* something is due.  The periods are how often each one needs looking at.
+*/
+
+#define TASK_KEYS_MS        (20)       // While a key is down, for release and long press
+#define TASK_KEYS_IDLE_MS   (1000)     // Backstop only: the key IRQ wakes the task
+#define TASK_WIFI_MS        (250)
+#define TASK_WIFI_CONNECT_MS (20)      // While connecting, so we're quick to notice
+#define TASK_NTP_MS         (1000)
+#define TASK_NTP_REPLY_MS   (20)       // Replies come back within a few tens of ms
+#define TASK_BRIGHTNESS_MS  (250)
+#define TASK_ANIMATE_MS     (10)       // Fades and text look smooth at this rate
+#define TASK_SCRUB_MS       (60000UL)
+#define TASK_STATS_MS       (600000UL)
+#define TASK_LOG_MS         (10)       // About what the UART FIFO holds at 115200 baud
+#define TASK_LOG_IDLE_MS    (250)
+#define TASK_COMMAND_MS     (50)
+#define TASK_METRICS_MS     (20)       // While a scrape is being served
+#define TASK_METRICS_IDLE_MS (100)
+#define TASK_TIMECHECK_MS   (10)       // While a check runs, half the time is its
+#define TASK_TIMECHECK_US   (5000)
+
+// Longest command line accepted on the serial port
+#define COMMAND_MAX_LEN     (100)
+
+// How closely the second task polls for TimeLib's second to roll over
+#define SECOND_POLL_MS      (10)
+
+static int iTimeZone = 3;    // See tTimeZoneSet::tTimeZoneSet in LocalTime.cpp
+static int TaskSecond;
+static int TaskAnimate;
+static int TaskKeys;
+static int TaskNtp;
+static int TaskLog;
+static int TaskMetrics;
+static int TaskWiFi;
+static int TaskTimeCheck;
+
+
+/*****************************************
+* StartAnimation() - Wakes the animation task after starting a fade or text
+*/
+
+void StartAnimation()
+{
+  Scheduler.Reschedule(TaskAnimate, 0);
+}
+
+
+/*****************************************
+* SaveAlarm() - Puts an alarm in the settings store
+*/
+
+void SaveAlarm(uint8_t u8Alarm)
+{
+  Settings.Set(SETTING_ALARM_0 + u8Alarm, &Alarms.Alarm(u8Alarm), sizeof(tAlarm));
+}
+
+
+/*****************************************
+* FormatTime() - The digits and AM/PM for a local time
+*
+* During an inserted leap second, tNowLocal is 23:59:59 over again, and
+* bLeapSecond makes it :60.  pDigits gets HHMMSS, with the seconds for panels that
+* have them.  TimeCheck checks this too, so it's all the display's time comes from.
+*/
+
+void FormatTime(time_t tNowLocal, bool bLeapSecond, char *pDigits, bool &bPm)
+{
+  int iThisSecond, iMinute, iHour24, iHour12;
+
+  iThisSecond = bLeapSecond ? 60 : second(tNowLocal);
+  iMinute     = minute(tNowLocal);
+  iHour24     = hour(tNowLocal);
+
+  iHour12 = iHour24 >  12 ? iHour24-12 :
+            iHour24 ==  0 ? 12 :
+            iHour24;              
+
+  bPm = iHour24 >= 12;
+
+  pDigits[0] = iHour12 > 9 ? '1' : ' ';
+  pDigits[1] = '0' + iHour12 % 10;
+  pDigits[2] = '0' + iMinute / 10;
+  pDigits[3] = '0' + iMinute % 10;
+  pDigits[4] = '0' + iThisSecond / 10;
+  pDigits[5] = '0' + iThisSecond % 10;
+}
+
+
+/*****************************************
+* ShowTime() - Puts a new second on the display
+*/
+
+void ShowTime(time_t tNow, bool bLeapSecond)
+{
+  //static char               c = '0';
+  //static CLOCK_ANNUNCIATOR ca = CLOCK_ANNUNCIATOR_AM;
+  static time_t tNowLocal;
+  static int    iThisSecond;
+  static bool   bColon    = false;
+  static bool   bPm;
+  static char   NewDigits[CLOCK_MAX_DIGITS];
+  uint16_t      u16Changed = 0;
+  uint8_t       i;
+
+  tNowLocal   = TimeZoneSet.TimeZone(iTimeZone)->UtcToLocal(tNow);
+
+  iThisSecond = bLeapSecond ? 60 : second(tNowLocal);
+  if (iThisSecond == 0)   bColon = true;
+
+  FormatTime(tNowLocal, bLeapSecond, NewDigits, bPm);
+
+  Display.Annunciator[CLOCK_ANNUNCIATOR_AM] = !bPm;
+  Display.Annunciator[CLOCK_ANNUNCIATOR_PM] = bPm;
+
+  LOG(LOG_INFO, LOG_MSG_TIME, hour(tNowLocal), minute(tNowLocal), iThisSecond);
+
+  //Serial.println(c);
+  
+  //Display.Digit[0] = c;
+  //Display.Digit[1] = c;
+  //Display.Digit[2] = c;
+  //Display.Digit[3] = c;
+
+  // if (++c > 'Z')  c = '0';
+
+  //Display.Annunciator[ca] = false;
+  //ca = (CLOCK_ANNUNCIATOR) ( ((int)ca) + 1);
+  //if (ca >= CLOCK_NUM_ANNUNCIATORS)   ca = CLOCK_ANNUNCIATOR_AM;
+  //Display.Annunciator[ca]   = true;
   
+  // Once the time is doubtful the chip blinks the colon (see NtpTask()).  Toggling it
+  // as well would beat against the blink, so it's held on and the blink sets the pace.
+  Display.Annunciator[CLOCK_ANNUNCIATOR_COLON]  = bColon  ||  Display.Blink[CLOCK_ANNUNCIATOR_COLON];
+  Display.Annunciator[CLOCK_ANNUNCIATOR_COLON2] = bColon  ||  Display.Blink[CLOCK_ANNUNCIATOR_COLON2];
+
+  // The alarm light is on while any alarm is set, and blinks while one rings
+  Display.Annunciator[CLOCK_ANNUNCIATOR_ALARM] = Alarms.AnyEnabled()  ||  Alarms.State() != ALARM_STATE_IDLE;
+  Display.Blink[CLOCK_ANNUNCIATOR_ALARM]       = Alarms.State() == ALARM_STATE_RINGING;
+
+  // Cross-fade when the digits change.  Otherwise it's just the colon and
+  // annunciators, and those can change right away.  Text has the display to
+  // itself until it's done.
+  if (Text.IsActive()) {
+    memcpy(Display.Digit, NewDigits, Display.NumDigits());
+  }
+  else {
+    if (memcmp(NewDigits, Display.Digit, Display.NumDigits()) != 0  &&  !Fader.IsActive()) {
+      // Only the digits that change dip
+      for (i=0; i<Display.NumDigits(); i++) {
+        if (NewDigits[i] != Display.Digit[i])  u16Changed |= Display.DigitMaxMask(i);
+      }
+      Fader.Dip(u16Changed, CLOCK_CROSSFADE_MS, ShowPendingDigits, NewDigits, millis());
+      StartAnimation();
+    }
+    Display.Update();
+  }
+
+#ifdef CLOCK_MIRROR_DISPLAY
+  Mirror.PrintAscii(Serial);
+#endif
+
+
+
+  //Serial.print  ("Config Reg = 0x");
+  //Serial.println(LedDriver.ReadRegister(4), HEX);
+  //Serial.print  ("Brightness Reg = ");
+  //Serial.println(LedDriver.ReadRegister(2));
+
+  // Keep rewriting config
+  //LedDriver.WriteConfig(MAX6954_CFG_SHUTDOWN_MODE);
+
+  //Serial.print("Writing Digit 9 = 0x");
+  //Serial.println(bit,HEX);
+  //LedDriver.WriteDigit(9, MAX6954_REG_PLANE0 | MAX6954_REG_PLANE1, bit);
+  //if (bit & 0x80) bit = 1;
+  //else            bit = bit << 1;
+
+  bColon = !bColon;
+}
+
+
+/*****************************************
+* SecondTask() - Updates the display each time the second changes
+*
+* The time only comes in whole seconds, so we find the edge by polling.  Once we've
+* seen it, we sleep until just before the next one is due and poll up to it, which
+* keeps the display within SECOND_POLL_MS of the true second without polling all
+* the time.  A leap second has the same time as the one before, so it's an edge too.
+*/
+
+void SecondTask(void *pArg)
+{
+  static time_t tLastSecond = 0;
+  static bool   bLastLeap   = false;
+  time_t        tNow        = NtpServer.GetUtcTime();
+  bool          bLeap       = Timebase.InLeapSecond();
+
+  if (tNow == tLastSecond  &&  bLeap == bLastLeap) {
+    Scheduler.Reschedule(TaskSecond, SECOND_POLL_MS);
+    return;
+  }
+
+  tLastSecond = tNow;
+  bLastLeap   = bLeap;
+  Scheduler.Reschedule(TaskSecond, 1000 - 2*SECOND_POLL_MS);
+  if (Alarms.Service(tNow))  SaveAlarm(Alarms.Ringing());     // One that went off once is off now
+  ShowTime(tNow, bLeap);
+}
+
+
+/*****************************************
+* KeysTask() - Turns key presses into actions
+*
+* While an alarm is ringing, a press snoozes it, and a long press (or a press
+* while it's snoozed) turns it off.
+*/
+
+void KeysTask(void *pArg)
+{
+  tKeyEvent KeyEvent;
+
+  // This is cheap unless a key is actually down
+  LedDriver.ServiceKeys(millis());
+  while (LedDriver.GetKeyEvent(KeyEvent)) {
+    LOG(LOG_INFO, LOG_MSG_KEY_PRESS + KeyEvent.u8Type, KeyEvent.u8Key);
+
+    if (Alarms.State() != ALARM_STATE_IDLE) {
+      if (KeyEvent.u8Type == KEY_EVENT_LONG_PRESS  ||
+          (KeyEvent.u8Type == KEY_EVENT_PRESS  &&  Alarms.State() == ALARM_STATE_SNOOZED)) {
+        Alarms.Dismiss();
+      }
+      else if (KeyEvent.u8Type == KEY_EVENT_PRESS) {
+        Alarms.Snooze(now());
+      }
+      continue;
+    }
+
+    // A long press on any key shows which zone we're in
+    if (KeyEvent.u8Type == KEY_EVENT_LONG_PRESS) {
+      Text.SetText(TimeZoneSet.Name(iTimeZone), TEXT_MODE_SCROLL);
+      Text.Start(millis());
+      StartAnimation();
+    }
+  }
+
+  Scheduler.Reschedule(TaskKeys, LedDriver.KeysActive() ? TASK_KEYS_MS : TASK_KEYS_IDLE_MS);
+}
+
+
+/*****************************************
+* WiFiTask() - Keeps the station connected
+*
+* Connecting, reconnecting and backing off all happen in here, a step at a time,
+* so the display keeps ticking from TimeLib's clock while the network is down.
+* The first time we get on, we scroll our IP address.
+*/
+
+void WiFiTask(void *pArg)
+{
+  static bool bShownIp = false;
+
+  WiFiConnection.SetEnabled(PowerManager.RadioOn(), millis());
+  WiFiConnection.Service(millis());
+  Scheduler.Reschedule(TaskWiFi, WiFiConnection.State() == WIFI_STATE_CONNECTING ? TASK_WIFI_CONNECT_MS : TASK_WIFI_MS);
+
+  if (!WiFiConnection.IsConnected()  ||  bShownIp)  return;
+
+  // Say hello with our IP address
+  IPAddress ip = WiFi.localIP();
+  char      sIp[20];
+  sprintf(sIp, "IP %d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3]);
+  Text.SetText(sIp, TEXT_MODE_SCROLL);
+  Text.Start(millis());
+  StartAnimation();
+  bShownIp = true;
+}
+
+
+/*****************************************
+* NtpTask() - Picks up NTP replies and sends queries when they're due
+*
+* Also tells the power manager when the network is wanted, and polls quickly while
+* a reply is outstanding, since the time is taken from when we read it.  A reply
+* that doesn't come within NTP_REPLY_TIMEOUT_MS is given up on, and going offline
+* gives it up too, so a lost packet doesn't keep us polling (and the radio up).  Running
+* every second, it's also what keeps the timebase's count of micros() wraps.
+*
+* When the sync state changes, the colon and brightness are set to match.  The
+* colon goes out with the next second's update, and blinks by itself after that.
+*/
+
+void NtpTask(void *pArg)
+{
+  static time_t  tLastSync  = 0;
+  static int     iLastState = -1;     // So the first state gets shown
+  NTP_SYNC_STATE State;
+  bool           bNeeded;
+  bool           bDoubtful;
+
+  Timebase.Service();
+
+  bNeeded = NtpServer.AwaitingResponse()  ||  NtpServer.SecondsUntilQuery() <= CLOCK_RADIO_LEAD_SECONDS;
+  NtpServer.SetOnline(PowerManager.Service(bNeeded, millis())  &&  WiFiConnection.IsConnected());
+  NtpServer.GetUtcTime();
+
+  // Report how far we'd drifted since the last sync
+  if (NtpServer.LastSyncTime() != tLastSync) {
+    if (tLastSync != 0) {
+      LOG(LOG_INFO, LOG_MSG_NTP_STEP, NtpServer.LastStepSeconds(), NtpServer.LastSyncTime() - tLastSync);
+    }
+    tLastSync = NtpServer.LastSyncTime();
+  }
+
+  State = NtpServer.SyncState();
+  if ((int) State != iLastState) {
+    LOG(LOG_INFO, LOG_MSG_SYNC_STATE, State, Timebase.ErrorMs());
+    bDoubtful = State == NTP_SYNC_UNSYNCED  ||  State == NTP_SYNC_STALE;
+
+    Display.Blink[CLOCK_ANNUNCIATOR_COLON]  = State != NTP_SYNC_SYNCED;
+    Display.Blink[CLOCK_ANNUNCIATOR_COLON2] = State != NTP_SYNC_SYNCED;
+    AutoBrightness.SetCap(bDoubtful ? CLOCK_DOUBTFUL_LEVEL : AUTOBRIGHT_NUM_LEVELS - 1);
+    iLastState = State;
+  }
+
+  Scheduler.Reschedule(TaskNtp, NtpServer.AwaitingResponse() ? TASK_NTP_REPLY_MS : TASK_NTP_MS);
+}
+
+
+/*****************************************
+* BrightnessTask() - Follows the ambient light and the night schedule
+*/
+
+void BrightnessTask(void *pArg)
+{
+  time_t tNowLocal = TimeZoneSet.TimeZone(iTimeZone)->UtcToLocal(now());
+
+  int    iMa10;
+
+  if (AutoBrightness.Service(millis(), tNowLocal)) {
+    iMa10 = AutoBrightness.EstimatedCurrentMa10(Display.NumLitSegments());
+    LOG(LOG_INFO, LOG_MSG_BRIGHTNESS, AutoBrightness.Level(), iMa10 / 10, iMa10 % 10);
+  }
+}
+
+
+/*****************************************
+* AnimateTask() - Steps fades and text frames
+*
+* A one-shot task: it keeps rescheduling itself while something is moving, and
+* StartAnimation() wakes it when something new starts.  When text finishes, the
+* time goes back up straight away rather than at the next second.
+*/
+
+void AnimateTask(void *pArg)
+{
+  bool bWasText   = Text.IsActive();
+  bool bAnimating = Text.Service(millis());
+
+  if (bWasText  &&  !bAnimating)  Display.Update();
+
+  if (Fader.Service(millis()) || bAnimating)  Scheduler.Reschedule(TaskAnimate, TASK_ANIMATE_MS);
+}
+
+
+/*****************************************
+* ScrubTask() - Rewrites every display register
+*
+* We normally only send registers that changed, so a register upset by noise would
+* stay wrong.  Once a minute, send them all.
+*/
+
+void ScrubTask(void *pArg)
+{
+  if (Text.IsActive() || Fader.IsActive())  return;
+
+  Display.Invalidate();
+  Display.Update();
+}
+
+
+/*****************************************
+* LogTask() - Feeds queued log records to the serial port
+*/
+
+void LogTask(void *pArg)
+{
+  Scheduler.Reschedule(TaskLog, Log.Drain(Serial) ? TASK_LOG_MS : TASK_LOG_IDLE_MS);
+}
+
+
+/*****************************************
+* MetricsTask() - Serves metrics scrapes and sends the periodic push
+*/
+
+void MetricsTask(void *pArg)
+{
+  Scheduler.Reschedule(TaskMetrics, Metrics.Service(millis()) ? TASK_METRICS_MS : TASK_METRICS_IDLE_MS);
+}
+
+
+/*****************************************
+* StatsTask() - Logs how long the tasks take and how late they run
+*
+* Only the worst cases, as log records, so this costs the loop nothing.  The
+* "stats" command prints the whole table, with the task names.
+*/
+
+void StatsTask(void *pArg)
+{
+  uint16_t u16Ma10 = PowerManager.EstimatedCurrentMa10(millis());
+  uint8_t  i;
+
+  for (i=0; i<Scheduler.NumTasks(); i++) {
+    const tTaskStats &Stats = Scheduler.Stats(i);
+
+    LOG(LOG_INFO, LOG_MSG_TASK_STATS, i, Stats.u32MaxUs, Stats.u32MaxLateMs);
+  }
+  LOG(LOG_INFO, LOG_MSG_POWER, u16Ma10 / 10, u16Ma10 % 10, PowerManager.RadioWakes());
+}
+
+
+/*****************************************
+* TimeCheckTask() - Runs a slice of the time check, and reports when it's done
+*/
+
+void TimeCheckTask(void *pArg)
+{
+  if (!TimeCheck.IsActive())  return;      // The one run every task gets at startup
+
+  if (TimeCheck.Service(TASK_TIMECHECK_US)) {
+    Scheduler.Reschedule(TaskTimeCheck, TASK_TIMECHECK_MS);
+    return;
+  }
+
+  TimeCheck.PrintReport(Serial);
+}
+
+
+/*****************************************
+* RunTimeCheckCommand() - Starts the time check, or reports on it
+*
+*   timecheck [<days>]   fast-forwards from noon UTC on the last day of last year
+*                        (so both new years, UTC and local, are in it) for that
+*                        many days, 366 if not given, in the current time zone
+*/
+
+void RunTimeCheckCommand(const char *sCommand)
+{
+  unsigned     uDays = 366;
+  tmElements_t Tm;
+
+  if (TimeCheck.IsActive()) {
+    TimeCheck.PrintReport(Serial);
+    return;
+  }
+
+  if (sCommand[9] != '\0'  &&  (sscanf(sCommand, "timecheck %u", &uDays) != 1  ||  uDays == 0  ||  uDays > 3660)) {
+    Serial.println(F("timecheck [<days>], up to 3660"));
+    return;
+  }
+
+  memset(&Tm, 0, sizeof(Tm));
+  Tm.Year  = CalendarYrToTm(year(now()));
+  Tm.Month = 1;
+  Tm.Day   = 1;
+
+  TimeCheck.Start(TimeZoneSet.TimeZone(iTimeZone), FormatTime, makeTime(Tm) - 12 * SECS_PER_HOUR, uDays * SECS_PER_DAY);
+  Scheduler.Reschedule(TaskTimeCheck, 0);
+  Serial.println(F("Time check started; \"timecheck\" for progress"));
+}
+
+
+/*****************************************
+* RunAlarmCommand() - Lists or sets the alarms
+*
+*   alarm                         lists them
+*   alarm <n> <hh:mm> [<days>]    sets one, where days is once (the default),
+*                                 daily, weekdays, weekends, or letters from
+*                                 SMTWTFS with - for the days it's off
+*   alarm <n> off                 turns one off
+*/
+
+void RunAlarmCommand(const char *sCommand)
+{
+  static const char   *sDayNames[]  = { "once", "daily", "weekdays", "weekends" };
+  static const uint8_t u8DayMasks[] = { ALARM_DAYS_ONCE, ALARM_DAYS_DAILY, ALARM_DAYS_WEEKDAYS, ALARM_DAYS_WEEKENDS };
+  static const char    sLetters[]   = "SMTWTFS";
+  unsigned int uAlarm = ALARM_MAX, uHour, uMinute;
+  char         sWhat[10] = "", sDays[10] = "once";
+  uint8_t      u8Days = 0xFF;
+  uint8_t      i;
+
+  if (sCommand[5] == '\0') {
+    Alarms.PrintReport(Serial);
+    return;
+  }
+
+  sscanf(sCommand, "alarm %u %9s %9s", &uAlarm, sWhat, sDays);
+  if (uAlarm < ALARM_MAX  &&  strcmp(sWhat, "off") == 0) {
+    Alarms.Clear(uAlarm);
+    SaveAlarm(uAlarm);
+    return;
+  }
+
+  for (i=0; i<sizeof(u8DayMasks); i++) {
+    if (strcmp(sDays, sDayNames[i]) == 0)  u8Days = u8DayMasks[i];
+  }
+  if (u8Days == 0xFF  &&  strlen(sDays) == 7) {
+    for (u8Days=0, i=0; i<7  &&  u8Days != 0xFF; i++) {
+      if      (sDays[i] == sLetters[i])  u8Days |= 1 << i;
+      else if (sDays[i] != '-')          u8Days  = 0xFF;
+    }
+  }
+
+  if (uAlarm >= ALARM_MAX  ||  u8Days == 0xFF  ||  sscanf(sWhat, "%u:%u", &uHour, &uMinute) != 2  ||
+      uHour > 23  ||  uMinute > 59  ||  !Alarms.Set(uAlarm, uHour, uMinute, u8Days, now())) {
+    Serial.println(F("Usage: alarm [<n> <hh:mm> [once|daily|weekdays|weekends|SMTWTFS] | <n> off]"));
+    return;
+  }
+  SaveAlarm(uAlarm);
+}
+
+
+/*****************************************
+* ApplyBrightness() - Hands the Brightness[] settings to AutoBrightness
+*/
+
+void ApplyBrightness()
+{
+  AutoBrightness.SetRange(Brightness[0], Brightness[1]);
+  AutoBrightness.SetNightSchedule(Brightness[2], Brightness[3], Brightness[4]);
+}
+
+
+/*****************************************
+* BrightnessValid() - Checks a set of Brightness[] values before they're used
+*
+* The levels are 0 to AUTOBRIGHT_NUM_LEVELS-1 with min <= night max <= max, and
+* the hours 0-23.  Takes unsigned ints so nothing has been cut down to a byte yet.
+*/
+
+bool BrightnessValid(const unsigned int *puValues)
+{
+  unsigned int uMin = puValues[0], uMax = puValues[1], uNightMax = puValues[4];
+
+  return uMax < AUTOBRIGHT_NUM_LEVELS  &&  uMin <= uMax  &&
+         uNightMax >= uMin  &&  uNightMax <= uMax  &&
+         puValues[2] < 24  &&  puValues[3] < 24;
+}
+
+
+/*****************************************
+* LoadSettings() - Replaces the compiled-in settings with any that were stored
+*
+* The alarms were stored before they went off, so they're all worked out again
+* from now.  Before the first sync that's 1970, and they're put right when the
+* time steps.
+*/
+
+void LoadSettings()
+{
+  tAlarm       Alarm;
+  uint8_t      u8Zone, u8Bright[sizeof(Brightness)], i;
+  unsigned int uBright[sizeof(Brightness)];
+  int          iLen;
+
+  if (Settings.Get(SETTING_TIME_ZONE, &u8Zone, sizeof(u8Zone)) == sizeof(u8Zone)  &&  u8Zone < TimeZoneSet.GetNumItems())  iTimeZone = u8Zone;
+
+  // A short or out-of-range record (from an older build, say) leaves the defaults
+  if (Settings.Get(SETTING_BRIGHTNESS, u8Bright, sizeof(u8Bright)) == sizeof(u8Bright)) {
+    for (i=0; i<sizeof(u8Bright); i++)  uBright[i] = u8Bright[i];
+    if (BrightnessValid(uBright))  memcpy(Brightness, u8Bright, sizeof(Brightness));
+  }
+
+  if ((iLen = Settings.Get(SETTING_NTP_SERVER, ntpServerName, SETTINGS_MAX_LEN)) > 0)  ntpServerName[iLen] = '\0';
+  if ((iLen = Settings.Get(SETTING_WIFI_SSID,  StoredSsid,    sizeof(StoredSsid) - 1)) > 0) {
+    StoredSsid[min(iLen, (int) sizeof(StoredSsid) - 1)] = '\0';
+    iLen = Settings.Get(SETTING_WIFI_PASSWORD, StoredPassword, SETTINGS_MAX_LEN);
+    StoredPassword[max(iLen, 0)] = '\0';
+  }
+
+  Alarms.SetTimeZone(TimeZoneSet.TimeZone(iTimeZone), now());
+  for (i=0; i<ALARM_MAX; i++) {
+    if (Settings.Get(SETTING_ALARM_0 + i, &Alarm, sizeof(Alarm)) == sizeof(Alarm)  &&  Alarm.bEnabled) {
+      Alarms.Set(i, Alarm.u8Hour, Alarm.u8Minute, Alarm.u8Days, now());
+    }
+  }
+}
+
+
+/*****************************************
+* RunSetCommand() - Changes a setting and saves it
+*
+*   set                           shows the store
+*   set zone <n>                  0-3, see tTimeZoneSet::tTimeZoneSet
+*   set bright <min> <max> <night start> <night end> <night max>
+*   set ntp <server>              used from the next query on
+*   set wifi <ssid> <password>    tried from the next connect on.  "set wifi -"
+*                                 forgets it.  The SSID can't have spaces.
+*/
+
+void RunSetCommand(const char *sCommand)
+{
+  unsigned int uValues[5];
+  char         sSsid[sizeof(StoredSsid)], sPassword[sizeof(StoredPassword)];
+  uint8_t      u8Zone, i;
+  bool         bOk = false;
+
+  if (sCommand[3] == '\0') {
+    Settings.PrintReport(Serial);
+    return;
+  }
+
+  if (sscanf(sCommand, "set zone %u", &uValues[0]) == 1  &&  uValues[0] < (unsigned) TimeZoneSet.GetNumItems()) {
+    u8Zone    = uValues[0];
+    iTimeZone = u8Zone;
+    Alarms.SetTimeZone(TimeZoneSet.TimeZone(iTimeZone), now());
+    bOk = Settings.Set(SETTING_TIME_ZONE, &u8Zone, sizeof(u8Zone));
+  }
+  else if (sscanf(sCommand, "set bright %u %u %u %u %u", &uValues[0], &uValues[1], &uValues[2], &uValues[3], &uValues[4]) == 5) {
+    if (!BrightnessValid(uValues)) {
+      Serial.println(F("Levels are 0-15 with min <= night max <= max; hours are 0-23"));
+      return;
+    }
+    for (i=0; i<5; i++)  Brightness[i] = uValues[i];
+    ApplyBrightness();
+    bOk = Settings.Set(SETTING_BRIGHTNESS, Brightness, sizeof(Brightness));
+  }
+  else if (strncmp(sCommand, "set ntp ", 8) == 0  &&  strlen(&sCommand[8]) <= SETTINGS_MAX_LEN) {
+    strcpy(ntpServerName, &sCommand[8]);
+    bOk = Settings.Set(SETTING_NTP_SERVER, ntpServerName, strlen(ntpServerName));
+  }
+  else if (strcmp(sCommand, "set wifi -") == 0) {
+    StoredSsid[0] = StoredPassword[0] = '\0';
+    bOk = Settings.Remove(SETTING_WIFI_SSID)  &&  Settings.Remove(SETTING_WIFI_PASSWORD);
+  }
+  else if (sscanf(sCommand, "set wifi %32s %64s", sSsid, sPassword) == 2) {
+    strcpy(StoredSsid,     sSsid);
+    strcpy(StoredPassword, sPassword);
+    bOk = Settings.Set(SETTING_WIFI_SSID,     StoredSsid,     strlen(StoredSsid))  &&
+          Settings.Set(SETTING_WIFI_PASSWORD, StoredPassword, strlen(StoredPassword));
+  }
+  else {
+    Serial.println(F("Usage: set [zone <n> | bright <min> <max> <night start> <night end> <night max> |"));
+    Serial.println(F("            ntp <server> | wifi <ssid> <password> | wifi -]"));
+    return;
+  }
+
+  // The change is in effect either way; this is about whether it'll survive a reboot
+  if (!bOk)  Serial.println(F("Couldn't save it"));
+}
+
+
+/*****************************************
+* RunCommand() - Carries out one line typed at the serial port
+*
+* The replies are printed straight to Serial, so they can hold up the loop for as
+* long as they take to send.  Nothing here is needed in normal running.
+*/
+
+void RunCommand(const char *sCommand)
+{
+  if (strcmp(sCommand, "stats") == 0) {
+    Scheduler.PrintStats(Serial);
+    PowerManager.PrintReport(Serial, millis());
+  }
+  else if (strcmp(sCommand, "probes") == 0) {
+#ifdef PROBES_ENABLED
+    Probes.PrintReport(Serial, true);
+#else
+    Serial.println(F("Probes aren't compiled in.  See PROBES_ENABLED in Probe.h."));
+#endif
+  }
+  else if (strcmp(sCommand, "probes reset") == 0) {
+#ifdef PROBES_ENABLED
+    Probes.Reset();
+#endif
+  }
+  else if (strcmp(sCommand, "wifi") == 0) {
+    WiFiConnection.PrintReport(Serial);
+  }
+  else if (strcmp(sCommand, "leap") == 0  ||  strcmp(sCommand, "leap -") == 0) {
+    // Inserts (or with "-", deletes) a second at the end of this minute.  The next
+    // NTP reply after it puts the time right again.
+    if (Timebase.SimulateLeap(sCommand[4] ? TIMEBASE_LEAP_DELETE : TIMEBASE_LEAP_INSERT)) {
+      LOG(LOG_INFO, LOG_MSG_LEAP_TEST, Timebase.LeapTime());
+    }
+    else {
+      Serial.println(F("The time isn't set yet"));
+    }
+  }
+  else if (strcmp(sCommand, "bench") == 0  ||  strcmp(sCommand, "bench json") == 0) {
+    Bench.Run(Serial, TimeZoneSet.TimeZone(iTimeZone), sCommand[5] != '\0');
+  }
+  else if (strncmp(sCommand, "timecheck", 9) == 0) {
+    RunTimeCheckCommand(sCommand);
+  }
+  else if (strncmp(sCommand, "alarm", 5) == 0) {
+    RunAlarmCommand(sCommand);
+  }
+  else if (strncmp(sCommand, "set", 3) == 0) {
+    RunSetCommand(sCommand);
+  }
+  else {
+    Serial.println(F("Commands: stats, probes, probes reset, bench, bench json, timecheck, wifi, leap, leap -, alarm, set"));
+  }
+}
+
+
+/*****************************************
+* CommandTask() - Collects serial input into lines and runs them
+*/
+
+void CommandTask(void *pArg)
+{
+  static char    sLine[COMMAND_MAX_LEN+1];
+  static uint8_t u8Len = 0;
+  int            c;
+
+  while ((c = Serial.read()) >= 0) {
+    if (c == '\r'  ||  c == '\n') {
+      if (u8Len == 0)  continue;
+      sLine[u8Len] = '\0';
+      u8Len = 0;
+      RunCommand(sLine);
+    }
+    else if (u8Len < COMMAND_MAX_LEN) {
+      sLine[u8Len++] = c;
+    }
+  }
+}
+
+
+/*****************************************
+* AddClockTask() - Adds a task to the scheduler, and says so if it doesn't fit
+*
+* A task that didn't fit gets SCHED_NO_TASK, which Reschedule() ignores, so the
+* rest of the clock still runs.
+*/
+
+int AddClockTask(const char *sName, tTaskFn pfnTask, uint32_t ulPeriodMs, uint32_t ulFirstDelayMs)
+{
+  int iTask = Scheduler.AddTask(sName, pfnTask, NULL, ulPeriodMs, ulFirstDelayMs);
+
+  if (iTask == SCHED_NO_TASK) {
+    Serial.print(F("No room in the scheduler for task "));
+    Serial.println(sName);
+    LOG(LOG_ERROR, LOG_MSG_SCHED_FULL, Scheduler.NumTasks());
+  }
+
+  return iTask;
+}
+
+
 /*****************************************
 * setup() - Initialization code for the Arduino app
 *
-* The job of this routine is to connect to the router.  It will not exit
-* and proceed to the body of the application until a connection (and an IP
-* address assignment) is complete.
+* Sets up the hardware and the tasks and starts connecting to the router.  The
+* connection is finished by WiFiTask, so we don't wait for it here.
 */
 
 void setup() 
@@ -94,16 +995,18 @@ void setup()
   while (!Serial) { }
 
   Serial.println(F("\n\nHello from NtpClock"));
+
+  Log.SetBinary(CLOCK_LOG_BINARY);
+  LOG(LOG_INFO, LOG_MSG_BOOT);
  
   pinMode(NodeLedPin, OUTPUT);
 
-  // Disable watchdog during the Wifi Init
-  // See https://techtutorialsx.com/2017/01/21/esp8266-watchdog-functions/
-  ESP.wdtDisable();
-    // Connect to the router.  0 means to try forever
-    WiFiConnection.ConnectToRouter(0);
-    // WiFi.mode(WIFI_OFF);
-  ESP.wdtEnable(1000);
+  // Before anything that uses a setting
+  Settings.Begin();
+  LoadSettings();
+
+  WiFiConnection.Begin(millis());
+  Timebase.SetSmear(CLOCK_LEAP_SMEAR_SECONDS);
 
   //PrintAllSevenSegmentDigits();
   os_timer_disarm(&MyTimer);
@@ -118,106 +1021,67 @@ void setup()
   // than I request.
   // system_timer_reinit();
 
-  // Init with 2 digit pairs
-  LedDriver.Init(2);
-}
+#ifdef CLOCK_USE_SOFT_MUX
+  SoftMux.ConfigureShiftRegister(SOFTMUX_DATA_GPIO, SOFTMUX_CLOCK_GPIO, SOFTMUX_LATCH_GPIO);
+  SoftMux.ConfigureCathodes(SoftMuxCathodePins, sizeof(SoftMuxCathodePins), true);
+  SoftMux.Begin();
+  Display.SetSoftMux(&SoftMux);
+#endif
 
+#ifdef CLOCK_MIRROR_DISPLAY
+  SpiTrace.AttachModel(&LedModel);
+  LedDriver.SetSpiTrace(&SpiTrace);
+#endif
 
-/*****************************************
-* loop() - Runtime code for the Arduino app
-* 
-* The loop function runs over and over again forever
-*/
+  PowerManager.SetMode(CLOCK_POWER_MODE);
+  PowerManager.SetRadioOffBetweenSyncs(CLOCK_RADIO_OFF_BETWEEN_SYNCS, millis());
 
-void loop()
-{
-  //static char               c = '0';
-  //static CLOCK_ANNUNCIATOR ca = CLOCK_ANNUNCIATOR_AM;
-  static char cAmPm;
-  
-  static time_t tNow, tNowLocal;
-  static int    iLastSecondPrinted = -1;
-  static int    iThisSecond;
-  static char   sTimeStr[30];
-  static bool   bColon    = false;
-  static int    iTimeZone = 3;    // See tTimeZoneSet::tTimeZoneSet in LocalTime.cpp
-  static int    iHour24, iHour12;
-  static int    iBrightness = 1;
- 
-  tNow        = NtpServer.GetUtcTime();
-  tNowLocal   = TimeZoneSet.TimeZone(iTimeZone)->UtcToLocal(tNow);
+#ifndef CLOCK_USE_SOFT_MUX
+  // Scan as many digit pairs as the panel has cathodes
+  LedDriver.Init(CLOCK_GEOMETRY.u8ScanLimit, CLOCK_GEOMETRY.u8DigitType);
 
-  iThisSecond = second(tNowLocal);
-  if (iThisSecond == 0)   bColon = true;
+  // The set/alarm buttons are on the KEY_A return line
+  LedDriver.EnableKeyScan(1);
 
-  
-  if (iThisSecond != iLastSecondPrinted) {
-    iLastSecondPrinted = iThisSecond;
-    iHour24 = hour(tNowLocal);
-
-    if (iHour24 < 12) {
-      Display.Annunciator[CLOCK_ANNUNCIATOR_AM] = true;
-      Display.Annunciator[CLOCK_ANNUNCIATOR_PM] = false;
-      cAmPm = 'A';
-    }
-    else {
-      Display.Annunciator[CLOCK_ANNUNCIATOR_AM] = false;
-      Display.Annunciator[CLOCK_ANNUNCIATOR_PM] = true;
-      cAmPm = 'P';
-    }
-  
-    iHour12 = iHour24 >  12 ? iHour24-12 :
-              iHour24 ==  0 ? 12 :
-              iHour24;              
-    
-    sprintf(sTimeStr, "%02d:%02d:%02d %cM %s", iHour12, minute(tNowLocal), iThisSecond, 
-                      cAmPm, TimeZoneSet.TimeZone(iTimeZone)->CurTimeZoneShortName());
-    Serial.println(sTimeStr);
-
-    
-    Display.Digit[0] = iHour12 > 9 ? '1' : ' ';
-    Display.Digit[1] = sTimeStr[1];
-    Display.Digit[2] = sTimeStr[3];
-    Display.Digit[3] = sTimeStr[4];
-
-    //Serial.println(c);
-    
-    //Display.Digit[0] = c;
-    //Display.Digit[1] = c;
-    //Display.Digit[2] = c;
-    //Display.Digit[3] = c;
-
-    // if (++c > 'Z')  c = '0';
-
-    //Display.Annunciator[ca] = false;
-    //ca = (CLOCK_ANNUNCIATOR) ( ((int)ca) + 1);
-    //if (ca >= CLOCK_NUM_ANNUNCIATORS)   ca = CLOCK_ANNUNCIATOR_AM;
-    //Display.Annunciator[ca]   = true;
-    
-    Display.Annunciator[CLOCK_ANNUNCIATOR_COLON] = bColon;
-    
-    Display.Update();
+  // Lets the colon blink when the time is doubtful.  Nothing blinks until it's
+  // written differently into the two planes.
+  LedDriver.SetBlink(true);
+#endif
 
-    if (++iBrightness > 11) iBrightness = 1;
-    //LedDriver.SetBrightness(iBrightness);
+  ApplyBrightness();
 
+  Metrics.Begin();
+  if (MetricsPushIp.isSet()) {
+    Metrics.SetPush(MetricsPushIp, CLOCK_METRICS_PUSH_PORT, CLOCK_METRICS_PUSH_SECONDS * 1000UL);
+  }
 
+  TaskSecond    = AddClockTask("second",     SecondTask,     0,                    0);
+  TaskAnimate   = AddClockTask("animate",    AnimateTask,    0,                    0);
+  TaskKeys      = AddClockTask("keys",       KeysTask,       TASK_KEYS_MS,         0);
+  TaskNtp       = AddClockTask("ntp",        NtpTask,        TASK_NTP_MS,          0);
+  TaskLog       = AddClockTask("log",        LogTask,        TASK_LOG_MS,          0);
+  TaskMetrics   = AddClockTask("metrics",    MetricsTask,    TASK_METRICS_IDLE_MS, 0);
+  TaskWiFi      = AddClockTask("wifi",       WiFiTask,       TASK_WIFI_CONNECT_MS, 0);
+  TaskTimeCheck = AddClockTask("timecheck",  TimeCheckTask,  0,                    0);
+  AddClockTask("brightness", BrightnessTask, TASK_BRIGHTNESS_MS,   0);
+  AddClockTask("scrub",      ScrubTask,      TASK_SCRUB_MS,        TASK_SCRUB_MS);
+  AddClockTask("stats",      StatsTask,      TASK_STATS_MS,        TASK_STATS_MS);
+  AddClockTask("command",    CommandTask,    TASK_COMMAND_MS,      0);
+}
 
-    //Serial.print  ("Config Reg = 0x");
-    //Serial.println(LedDriver.ReadRegister(4), HEX);
-    //Serial.print  ("Brightness Reg = ");
-    //Serial.println(LedDriver.ReadRegister(2));
 
-    // Keep rewriting config
-    //LedDriver.WriteConfig(MAX6954_CFG_SHUTDOWN_MODE);
+/*****************************************
+* loop() - Runtime code for the Arduino app
+* 
+* The loop function runs over and over again forever.  All it does is run whatever
+* tasks are due and then sleep until the next one is.
+*/
 
-    //Serial.print("Writing Digit 9 = 0x");
-    //Serial.println(bit,HEX);
-    //LedDriver.WriteDigit(9, MAX6954_REG_PLANE0 | MAX6954_REG_PLANE1, bit);
-    //if (bit & 0x80) bit = 1;
-    //else            bit = bit << 1;
+void loop()
+{
+  // A key press shouldn't wait for the keys task's next turn
+  if (LedDriver.KeyIrqPending())  Scheduler.Reschedule(TaskKeys, 0);
 
-    bColon = !bColon;
-  }
-  delay(100);
+  Scheduler.Run();
+  Scheduler.Idle();
 }
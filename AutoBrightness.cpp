@@ -0,0 +1,166 @@
+/***************
+* NTP Clock
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "AutoBrightness.h"
+
+
+/***************************************
+* tAutoBrightness constructor
+*
+* INPUTS:
+*   Max                - the LED driver whose global intensity we control
+*   u8NumScannedDigits - how many digits (cathodes) the driver multiplexes.  Only
+*                        used for the current estimate.
+*/
+
+tAutoBrightness::tAutoBrightness(tMax6954 &Max, uint8_t u8NumScannedDigits) :
+  _Max(Max),
+  _u8NumScannedDigits(u8NumScannedDigits)
+{
+  _u8MinLevel      = 0;
+  _u8MaxLevel      = AUTOBRIGHT_NUM_LEVELS - 1;
+  _iNightStartHour = 0;
+  _iNightEndHour   = 0;
+  _u8NightMaxLevel = AUTOBRIGHT_NUM_LEVELS - 1;
+  _u8CapLevel      = AUTOBRIGHT_NUM_LEVELS - 1;
+
+  _bPrimed         = false;
+  _u32Filtered     = 0;
+  _u8AmbientLevel  = 0;
+  _u8Level         = 0;
+  _ulLastSampleMs  = 0;
+}
+
+
+/***************************************
+* tAutoBrightness::SetRange, SetNightSchedule
+*
+*/
+
+void tAutoBrightness::SetRange(uint8_t u8MinLevel, uint8_t u8MaxLevel)
+{
+  _u8MinLevel = u8MinLevel;
+  _u8MaxLevel = u8MaxLevel < AUTOBRIGHT_NUM_LEVELS ? u8MaxLevel : AUTOBRIGHT_NUM_LEVELS - 1;
+}
+
+void tAutoBrightness::SetNightSchedule(int iNightStartHour, int iNightEndHour, uint8_t u8NightMaxLevel)
+{
+  _iNightStartHour = iNightStartHour;
+  _iNightEndHour   = iNightEndHour;
+  _u8NightMaxLevel = u8NightMaxLevel;
+}
+
+
+/***************************************
+* tAutoBrightness::Service
+*
+* Samples the light sensor (no more often than AUTOBRIGHT_SAMPLE_MS), works out the
+* level we want, and writes it to the LED driver if it differs from what's there.
+*
+* INPUTS:
+*   ulNowMs   - the current millis()
+*   tNowLocal - the current local time, for the night schedule
+* RETURNS:
+*   true if the global intensity register was written
+*/
+
+bool tAutoBrightness::Service(uint32_t ulNowMs, time_t tNowLocal)
+{
+  uint16_t u16Reading;
+  uint8_t  u8Level;
+
+  if (_bPrimed  &&  ulNowMs - _ulLastSampleMs < AUTOBRIGHT_SAMPLE_MS)  return false;
+  _ulLastSampleMs = ulNowMs;
+
+  u16Reading = analogRead(AUTOBRIGHT_ADC_PIN);
+
+  // Start the filter at the first reading rather than ramping up from zero
+  if (!_bPrimed) {
+    _u32Filtered    = (uint32_t) u16Reading << AUTOBRIGHT_FILTER_SHIFT;
+    _u8AmbientLevel = u16Reading * AUTOBRIGHT_NUM_LEVELS / AUTOBRIGHT_ADC_RANGE;
+    _bPrimed        = true;
+  }
+  else {
+    _u32Filtered = _u32Filtered - (_u32Filtered >> AUTOBRIGHT_FILTER_SHIFT) + u16Reading;
+  }
+
+  u8Level = _AmbientLevel(FilteredReading());
+
+  if (u8Level < _u8MinLevel)  u8Level = _u8MinLevel;
+  if (u8Level > _u8MaxLevel)  u8Level = _u8MaxLevel;
+  if (_IsNight(tNowLocal)  &&  u8Level > _u8NightMaxLevel)  u8Level = _u8NightMaxLevel;
+  if (u8Level > _u8CapLevel)  u8Level = _u8CapLevel;
+
+  _u8Level = u8Level;
+  if (u8Level == _Max.GetBrightness())  return false;
+
+  _Max.SetBrightness(u8Level);
+  return true;
+}
+
+
+/***************************************
+* tAutoBrightness::_AmbientLevel
+*
+* The ADC range is split into AUTOBRIGHT_NUM_LEVELS equal bands.  We only move to a
+* new band once the reading is AUTOBRIGHT_HYSTERESIS counts past the edge of the
+* current one.
+*/
+
+uint8_t tAutoBrightness::_AmbientLevel(uint16_t u16Reading)
+{
+  const uint16_t u16Band = AUTOBRIGHT_ADC_RANGE / AUTOBRIGHT_NUM_LEVELS;
+  int iLo = _u8AmbientLevel * u16Band - AUTOBRIGHT_HYSTERESIS;
+  int iHi = (_u8AmbientLevel + 1) * u16Band + AUTOBRIGHT_HYSTERESIS;
+
+  if ((int) u16Reading < iLo  ||  (int) u16Reading >= iHi) {
+    _u8AmbientLevel = u16Reading / u16Band;
+    if (_u8AmbientLevel >= AUTOBRIGHT_NUM_LEVELS)  _u8AmbientLevel = AUTOBRIGHT_NUM_LEVELS - 1;
+  }
+
+  return _u8AmbientLevel;
+}
+
+
+/***************************************
+* tAutoBrightness::_IsNight
+*
+* The window may wrap midnight, e.g. 22 to 6.
+*/
+
+bool tAutoBrightness::_IsNight(time_t tNowLocal) const
+{
+  int iHour = hour(tNowLocal);
+
+  if (_iNightStartHour == _iNightEndHour)  return false;
+
+  if (_iNightStartHour < _iNightEndHour)
+    return iHour >= _iNightStartHour  &&  iHour < _iNightEndHour;
+  else
+    return iHour >= _iNightStartHour  ||  iHour < _iNightEndHour;
+}
+
+
+/***************************************
+* tAutoBrightness::EstimatedCurrentMa10
+*
+* Each lit segment draws the peak segment current for (level+1)/16 of the time its
+* cathode is being scanned, and each cathode is scanned 1/N of the time.
+*
+* RETURNS:
+*   Average LED current in tenths of a mA
+*/
+
+uint32_t tAutoBrightness::EstimatedCurrentMa10(int iLitSegments) const
+{
+  uint32_t u32Level = _Max.GetBrightness();
+
+  if (_u8NumScannedDigits == 0)  return 0;
+
+  return (uint32_t) iLitSegments * AUTOBRIGHT_PEAK_SEGMENT_MA10 * (u32Level + 1) /
+         (AUTOBRIGHT_NUM_LEVELS * _u8NumScannedDigits);
+}
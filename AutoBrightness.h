@@ -0,0 +1,93 @@
+/***************
+* NTP Clock
+*
+* tAutoBrightness sets the MAX6954 global intensity from a light sensor on the
+* ESP8266 ADC, capped by a night-time schedule in local time.  Besides being easier
+* on the eyes at night, running the LEDs no brighter than needed is the biggest
+* power saving available on this clock.
+*
+* The ADC reading is low-pass filtered, and the level only changes once the reading
+* has moved clearly past the edge of the current level's band, so a lamp flickering
+* near a boundary doesn't cause the display to hunt.  The intensity register is only
+* written when the level actually changes.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef AUTO_BRIGHTNESS_H
+#define AUTO_BRIGHTNESS_H
+
+#include <Arduino.h>
+#include <TimeLib.h>
+#include "Max6954.h"
+
+// The photo-transistor divider is on the ESP8266's only analog input
+#define AUTOBRIGHT_ADC_PIN          (A0)
+#define AUTOBRIGHT_ADC_RANGE        (1024)
+
+// Reading the ADC too often upsets the WiFi, so we don't sample faster than this
+#define AUTOBRIGHT_SAMPLE_MS        (250)
+
+// Filter is y += (x - y) / 2^SHIFT.  At 4 samples a second this is a ~2 second
+// time constant.
+#define AUTOBRIGHT_FILTER_SHIFT     (3)
+
+// How far (in ADC counts) past the edge of a band we must go before changing level
+#define AUTOBRIGHT_HYSTERESIS       (24)
+
+#define AUTOBRIGHT_NUM_LEVELS       (16)
+
+// Per the comment in tMax6954::Init, RSET = 100K gives 22.4 mA peak segment current.
+// Expressed in tenths of a mA.
+#define AUTOBRIGHT_PEAK_SEGMENT_MA10 (224)
+
+
+class tAutoBrightness {
+public:
+  tAutoBrightness(tMax6954 &Max, uint8_t u8NumScannedDigits);
+
+  // Limits for the output level, 0-15
+  void SetRange(uint8_t u8MinLevel, uint8_t u8MaxLevel);
+
+  // Between iNightStartHour and iNightEndHour (local, 0-23) the level is capped at
+  // u8NightMaxLevel.  Set the two hours equal to disable the schedule.
+  void SetNightSchedule(int iNightStartHour, int iNightEndHour, uint8_t u8NightMaxLevel);
+
+  // A further cap for the owner's own reasons, e.g. to dim a clock whose time can't
+  // be trusted.  AUTOBRIGHT_NUM_LEVELS - 1 lifts it.  Takes effect at the next sample.
+  void SetCap(uint8_t u8CapLevel) { _u8CapLevel = u8CapLevel; }
+
+  // Call from the loop.  Returns true if the brightness was changed.
+  bool Service(uint32_t ulNowMs, time_t tNowLocal);
+
+  uint8_t  Level()         const { return _u8Level; }
+  uint16_t FilteredReading() const { return _u32Filtered >> AUTOBRIGHT_FILTER_SHIFT; }
+
+  // Estimated average LED current, in tenths of a mA, with iLitSegments lit
+  uint32_t EstimatedCurrentMa10(int iLitSegments) const;
+
+protected:
+  uint8_t _AmbientLevel(uint16_t u16Reading);
+  bool    _IsNight(time_t tNowLocal) const;
+
+  tMax6954     &_Max;
+  uint8_t       _u8NumScannedDigits;
+
+  uint8_t       _u8MinLevel;
+  uint8_t       _u8MaxLevel;
+  int           _iNightStartHour;
+  int           _iNightEndHour;
+  uint8_t       _u8NightMaxLevel;
+  uint8_t       _u8CapLevel;
+
+  bool          _bPrimed;
+  uint32_t      _u32Filtered;      // Scaled up by 2^AUTOBRIGHT_FILTER_SHIFT
+  uint8_t       _u8AmbientLevel;
+  uint8_t       _u8Level;
+  uint32_t      _ulLastSampleMs;
+};
+
+
+#endif   /* AUTO_BRIGHTNESS_H */
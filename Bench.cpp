@@ -0,0 +1,283 @@
+/***************
+* NTP Clock
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "Bench.h"
+#include "Font.h"
+
+
+/***************************************
+* tBench constructor
+*
+*/
+
+tBench::tBench(tClockDisplay &Display, tMax6954 &Max, tNtp &Ntp) :
+  _Display(Display),
+  _Max(Max),
+  _Ntp(Ntp)
+{
+  _sCounterName = NULL;
+  _pfnCounter   = NULL;
+  _u32Sink      = 0;
+}
+
+
+/***************************************
+* tBench::Run
+*
+* The watchdog gets a look in between benchmarks, not during them
+*/
+
+void tBench::Run(Print &Out, tLocalTime *pLocalTime, bool bJson)
+{
+  tBenchResult Result;
+
+  if (bJson) {
+    Out.print(F("{\"cpu_mhz\":"));
+    Out.print(ESP.getCpuFreqMHz());
+    Out.print(F(",\"runs\":"));
+    Out.print(BENCH_RUNS);
+    Out.print(F(",\"results\":["));
+  }
+  else {
+    Out.print(F("name,runs,min_cycles,avg_cycles,max_cycles,cpu_mhz"));
+    if (_pfnCounter != NULL) {
+      Out.print(',');
+      Out.print(_sCounterName);
+    }
+    Out.println();
+  }
+
+  _Font(Result, FONT_7_SEGMENT);             _Print(Out, "Font.Glyph7",         Result, bJson, true);   yield();
+  _Font(Result, FONT_16_SEGMENT);            _Print(Out, "Font.Glyph16",        Result, bJson, false);  yield();
+  _Render(Result);                           _Print(Out, "Display.Render",      Result, bJson, false);  yield();
+  _Update(Result, false);                    _Print(Out, "Display.Update",      Result, bJson, false);  yield();
+  _Update(Result, true);                     _Print(Out, "Display.UpdateFull",  Result, bJson, false);  yield();
+  _UtcToLocal(Result, pLocalTime);           _Print(Out, "UtcToLocal",          Result, bJson, false);  yield();
+  _NtpParse(Result);                         _Print(Out, "Ntp.ParseReply",      Result, bJson, false);  yield();
+  _SpiWrite(Result);                         _Print(Out, "Spi.Write16",         Result, bJson, false);  yield();
+
+  if (bJson)  Out.println(F("]}"));
+}
+
+
+/***************************************
+* tBench::_Font
+*
+* Every character in the font, over and over
+*/
+
+void tBench::_Font(tBenchResult &Result, uint8_t u8FontType)
+{
+  uint32_t u32Start, u32Sum = 0;
+  uint16_t i;
+  char     c;
+
+  _Reset(Result);
+  for (i=0; i<BENCH_RUNS; i++) {
+    c = FONT_FIRST_CHAR + i % FONT_NUM_GLYPHS;
+
+    u32Start = ESP.getCycleCount();
+    u32Sum  += u8FontType == FONT_7_SEGMENT ? FontGlyph7(c) : FontGlyph(u8FontType, c);
+    _Record(Result, ESP.getCycleCount() - u32Start);
+  }
+  _u32Sink = u32Sum;
+}
+
+
+/***************************************
+* tBench::_Render
+*
+* What's on the display now, into a scratch image
+*/
+
+void tBench::_Render(tBenchResult &Result)
+{
+  uint8_t  u8Regs[GEOM_MAX_REGS];
+  uint32_t u32Start;
+  uint16_t i;
+
+  _Reset(Result);
+  for (i=0; i<BENCH_RUNS; i++) {
+    u32Start = ESP.getCycleCount();
+    _Display.Render(_Display.Digit, _Display.Annunciator, u8Regs);
+    _Record(Result, ESP.getCycleCount() - u32Start);
+  }
+  _u32Sink = u8Regs[0];
+}
+
+
+/***************************************
+* tBench::_Update
+*
+* With bFull, every register is sent each time, as after Invalidate().  Without,
+* nothing has changed, so it's the cost of finding that out.
+*/
+
+void tBench::_Update(tBenchResult &Result, bool bFull)
+{
+  uint32_t u32Start;
+  uint16_t i;
+
+  _Reset(Result);
+  for (i=0; i<BENCH_RUNS; i++) {
+    if (bFull)  _Display.Invalidate();
+
+    u32Start = ESP.getCycleCount();
+    _Display.Update();
+    _Record(Result, ESP.getCycleCount() - u32Start);
+  }
+}
+
+
+/***************************************
+* tBench::_UtcToLocal
+*
+* Nine hours apart, so the runs span a year and a bit, both sides of both DST
+* changes and a change of year
+*/
+
+void tBench::_UtcToLocal(tBenchResult &Result, tLocalTime *pLocalTime)
+{
+  time_t   tUtc = now();
+  uint32_t u32Start, u32Sum = 0;
+  uint16_t i;
+
+  _Reset(Result);
+  for (i=0; i<BENCH_RUNS; i++, tUtc += 9 * SECS_PER_HOUR) {
+    u32Start = ESP.getCycleCount();
+    u32Sum  += pLocalTime->UtcToLocal(tUtc);
+    _Record(Result, ESP.getCycleCount() - u32Start);
+  }
+  _u32Sink = u32Sum;
+}
+
+
+/***************************************
+* tBench::_NtpParse
+*
+* Checks a reply to the outstanding request, from a stratum 2 server, and reads
+* its two timestamps: the part of taking a reply that doesn't touch the network or
+* the timebase
+*/
+
+void tBench::_NtpParse(tBenchResult &Result)
+{
+  uint8_t  u8SavedPacket[NTP_PACKET_SIZE];
+  bool     bSavedAwaiting = _Ntp._bAwaitingResponse;
+  uint32_t u32Start, u32Sum = 0;
+  uint16_t i;
+
+  memcpy(u8SavedPacket, _Ntp._PacketBuffer, NTP_PACKET_SIZE);
+
+  memset(_Ntp._PacketBuffer, 0, NTP_PACKET_SIZE);
+  _Ntp._PacketBuffer[0] = (4 << 3) | 4;     // Version 4, server
+  _Ntp._PacketBuffer[1] = 2;
+  memcpy(&_Ntp._PacketBuffer[24], _Ntp._u8SentStamp, sizeof(_Ntp._u8SentStamp));
+  _Ntp._WriteTimestampMs(32, ((int64_t) now() + NTP_SEVENTY_YEARS) * 1000 + 123);
+  _Ntp._WriteTimestampMs(40, ((int64_t) now() + NTP_SEVENTY_YEARS) * 1000 + 124);
+  _Ntp._bAwaitingResponse = true;
+
+  _Reset(Result);
+  for (i=0; i<BENCH_RUNS; i++) {
+    u32Start = ESP.getCycleCount();
+    if (_Ntp._CheckResponse())  u32Sum += (uint32_t) (_Ntp._ReadTimestampMs(40) - _Ntp._ReadTimestampMs(32));
+    _Record(Result, ESP.getCycleCount() - u32Start);
+  }
+  _u32Sink = u32Sum;
+
+  _Ntp._bAwaitingResponse = bSavedAwaiting;
+  memcpy(_Ntp._PacketBuffer, u8SavedPacket, NTP_PACKET_SIZE);
+}
+
+
+/***************************************
+* tBench::_SpiWrite
+*
+* One 16-bit write, to the no-op register
+*/
+
+void tBench::_SpiWrite(tBenchResult &Result)
+{
+  uint32_t u32Start;
+  uint16_t i;
+
+  _Reset(Result);
+  for (i=0; i<BENCH_RUNS; i++) {
+    u32Start = ESP.getCycleCount();
+    _Max.NoOp();
+    _Record(Result, ESP.getCycleCount() - u32Start);
+  }
+}
+
+
+/***************************************
+* tBench::_Reset
+*
+*/
+
+void tBench::_Reset(tBenchResult &Result)
+{
+  Result.u32Runs         = 0;
+  Result.u64TotalCycles  = 0;
+  Result.u32MinCycles    = 0xFFFFFFFF;
+  Result.u32MaxCycles    = 0;
+  Result.u32CounterStart = _pfnCounter != NULL ? _pfnCounter() : 0;
+}
+
+
+/***************************************
+* tBench::_Record
+*
+*/
+
+void tBench::_Record(tBenchResult &Result, uint32_t u32Cycles)
+{
+  Result.u32Runs++;
+  Result.u64TotalCycles += u32Cycles;
+  if (u32Cycles < Result.u32MinCycles)  Result.u32MinCycles = u32Cycles;
+  if (u32Cycles > Result.u32MaxCycles)  Result.u32MaxCycles = u32Cycles;
+}
+
+
+/***************************************
+* tBench::_Print
+*
+* One CSV line, or one entry in the JSON results array (bFirst leaves off the
+* comma before it).  Printing doesn't move the counter, so it still covers just
+* the runs.
+*/
+
+void tBench::_Print(Print &Out, const char *sName, const tBenchResult &Result, bool bJson, bool bFirst)
+{
+  char          sLine[120];
+  unsigned long ulAvg   = Result.u32Runs ? (unsigned long) (Result.u64TotalCycles / Result.u32Runs) : 0;
+  unsigned long ulCount = 0;
+
+  if (_pfnCounter != NULL  &&  Result.u32Runs != 0)
+    ulCount = (unsigned long) ((_pfnCounter() - Result.u32CounterStart) / Result.u32Runs);
+
+  if (bJson) {
+    snprintf(sLine, sizeof(sLine), "%s{\"name\":\"%s\",\"min_cycles\":%lu,\"avg_cycles\":%lu,\"max_cycles\":%lu",
+             bFirst ? "" : ",", sName, (unsigned long) Result.u32MinCycles, ulAvg, (unsigned long) Result.u32MaxCycles);
+    Out.print(sLine);
+    if (_pfnCounter != NULL) {
+      snprintf(sLine, sizeof(sLine), ",\"%s\":%lu", _sCounterName, ulCount);
+      Out.print(sLine);
+    }
+    Out.print('}');
+  }
+  else {
+    snprintf(sLine, sizeof(sLine), "%s,%lu,%lu,%lu,%lu,%u", sName, (unsigned long) Result.u32Runs,
+             (unsigned long) Result.u32MinCycles, ulAvg, (unsigned long) Result.u32MaxCycles, ESP.getCpuFreqMHz());
+    Out.print(sLine);
+    if (_pfnCounter != NULL) {
+      Out.print(',');
+      Out.print(ulCount);
+    }
+    Out.println();
+  }
+}
@@ -0,0 +1,87 @@
+/***************
+* NTP Clock
+*
+* tBench times the clock's hot paths on the device, so a change that slows one
+* down shows up as a number rather than a feeling.  Each benchmark runs its code
+* BENCH_RUNS times back to back, timing every run with the CPU's cycle counter
+* (ESP.getCycleCount(), 80 or 160 per microsecond), and reports the min, average
+* and max.  The min is the one to compare between builds: the average and max
+* take in whatever interrupts landed during the runs.
+*
+* The results come out as CSV (a header line, then one line per benchmark) or as
+* one JSON object, so a script on the serial port can keep them and compare.
+*
+* The display benchmarks rewrite what's already on the display, and the SPI one
+* sends the chip no-ops, so nothing visible changes.  The NTP one parses a made-up
+* reply in tNtp's own packet buffer, putting back what was there after.  All of it
+* holds up the loop for as long as it takes (some tens of milliseconds).
+*
+* Unlike the probes (Probe.h), which watch the real calls as they happen, this
+* runs the code on demand with the same inputs every time.
+*
+* SetCounter() adds a column: something else counted per run, such as the pin
+* writes the host build's pin shim sees (test/BenchHost.cpp).  Cycles on the host
+* only compare with other host runs; the counts should match the device's exactly.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <Arduino.h>
+#include "ClockDisplay.h"
+#include "LocalTime.h"
+#include "Ntp.h"
+
+#define BENCH_RUNS  (1000)
+
+struct tBenchResult {
+  uint32_t u32Runs;
+  uint64_t u64TotalCycles;
+  uint32_t u32MinCycles;
+  uint32_t u32MaxCycles;
+  uint32_t u32CounterStart;
+};
+
+// A running total, read before and after each benchmark
+typedef uint32_t (*tBenchCounter)();
+
+
+class tBench {
+public:
+  tBench(tClockDisplay &Display, tMax6954 &Max, tNtp &Ntp);
+
+  // Runs them all and prints the results.  UtcToLocal() is timed in pLocalTime.
+  void Run(Print &Out, tLocalTime *pLocalTime, bool bJson = false);
+
+  // Reports pfnCounter's increase per run as sName.  NULL for none.
+  void SetCounter(const char *sName, tBenchCounter pfnCounter) { _sCounterName = sName; _pfnCounter = pfnCounter; }
+
+protected:
+  void _Font(tBenchResult &Result, uint8_t u8FontType);
+  void _Render(tBenchResult &Result);
+  void _Update(tBenchResult &Result, bool bFull);
+  void _UtcToLocal(tBenchResult &Result, tLocalTime *pLocalTime);
+  void _NtpParse(tBenchResult &Result);
+  void _SpiWrite(tBenchResult &Result);
+
+  void _Reset(tBenchResult &Result);
+  void _Record(tBenchResult &Result, uint32_t u32Cycles);
+  void _Print(Print &Out, const char *sName, const tBenchResult &Result, bool bJson, bool bFirst);
+
+  tClockDisplay &_Display;
+  tMax6954      &_Max;
+  tNtp          &_Ntp;
+
+  const char    *_sCounterName;
+  tBenchCounter  _pfnCounter;
+
+  // The benchmarks' results end up here, so the compiler can't drop the work
+  volatile uint32_t _u32Sink;
+};
+
+
+#endif   /* BENCH_H */
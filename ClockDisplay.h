@@ -4,7 +4,12 @@
 * The ClockDisplay class has the job of taking a request to display a digit and turning
 * it into calls into the MAX6954 library to turn segments on and off.
 *
-* See the comments at the top of the .cpp file for details on the mapping involved.
+* Which segment is wired where comes from a tDisplayGeometry; see DisplayGeometry.h.
+*
+* Annunciators can blink.  The chip does that itself, alternating between its two
+* planes while global blink is enabled (tMax6954::SetBlink), so a blinking
+* annunciator is written lit in plane P0 and dark in P1, once, and costs no bus
+* traffic after.  The software multiplexer has no planes, so there they're steady.
 *
 * Brad Hines
 * Feb 2020
@@ -17,52 +22,82 @@
 
 
 #include "Max6954.h"
+#include "DisplayGeometry.h"
 
+class tSoftMux;
 
-#define CLOCK_NUM_DIGITS (4)
-#define DIGIT_NUM_SEGMENTS (7)
 
-// How many digits this corresponds to on the MAX6954.  It's the same, but conceptually
-// it's a different quantity, so we track it differently.
-#define MAX6954_NUM_DIGITS (4)
+// The most digits any geometry can have.  How many the current panel really has
+// is NumDigits().
+#define CLOCK_MAX_DIGITS (GEOM_MAX_DIGITS)
 
-// These are indices into the AnnunciatorToOutputNum array
+// These are indices into a geometry's pAnnunciators array.  A panel that lacks one
+// maps it to GEOM_NONE.
 typedef enum {
   CLOCK_ANNUNCIATOR_AM, 
   CLOCK_ANNUNCIATOR_PM, 
   CLOCK_ANNUNCIATOR_ALARM,
   CLOCK_ANNUNCIATOR_COLON,
+  CLOCK_ANNUNCIATOR_COLON2,      // Between minutes and seconds, on panels that show them
   CLOCK_NUM_ANNUNCIATORS
 } CLOCK_ANNUNCIATOR;
 
 
 class tClockDisplay {
 public:
-  tClockDisplay(tMax6954 &Max);
+  tClockDisplay(tMax6954 &Max, const tDisplayGeometry &Geometry = DisplayGeometryLiteOn637);
 
-  // These can be poked from outside.  When done poking, call UpdateDisplay()
-  char Digit[4];   // This should be an ASCII value, not a number
+  // These can be poked from outside.  When done poking, call Update()
+  char Digit[CLOCK_MAX_DIGITS];   // This should be an ASCII value, not a number
   bool Annunciator[CLOCK_NUM_ANNUNCIATORS];
+  bool Blink[CLOCK_NUM_ANNUNCIATORS];       // Only matters while the annunciator is on
 
   void Update();
 
-protected:
-  void _LightUpSegment(int ClockDigit, int Segment);
-  void _LightUpAnnunciator(int iAnnunciator);
-  void _TurnOnMaxSegment(uint8_t OutputNum, uint8_t CathodeNum);;
+  // The two halves of Update(), for callers that want to precompute frames.
+  // Render() builds the MAX6954 register values for the given digits and
+  // annunciators into pu8Regs (GEOM_MAX_REGS bytes) without touching the bus.
+  // pDigits has NumDigits() characters.  WriteImage() sends them, skipping
+  // registers that already hold the value.  The Blink flags as of the last
+  // Update() apply.
+  void Render(const char *pDigits, const bool *pAnnunciators, uint8_t *pu8Regs) const;
+  void WriteImage(const uint8_t *pu8Regs);
 
-  tMax6954 &_Max;
+  // Forget what we think the chip holds, so the next write sends everything
+  void Invalidate() { _bWrittenValid = false; }
+
+  // How many segments (including annunciators) the last Update() lit
+  int  NumLitSegments() const;
+
+  const tDisplayGeometry &Geometry() const { return _Geometry; }
+  uint8_t NumDigits() const { return _Geometry.u8NumDigits; }
 
-  // The segment maps we'll be outputting.  Making them a member just keeps from having to pass them around
-  uint8_t _MaxDigits[MAX6954_NUM_DIGITS];  
+  // The MAX6954 digits this panel uses, as a bit mask with bit n = digit n and the
+  // "a" digits numbered 8-15.  This is the form tIntensityFader wants.
+  uint16_t MaxDigitMask() const;
 
-  static const uint8_t _MaxDigitNumFromOutputNum[];
-  static const uint8_t _MaxBitValueFromOutputNum[];
+  // The same, for just the MAX6954 digits clock digit u8Digit has segments on.  On
+  // panels where digits share a cathode, that takes in their neighbours too.
+  uint16_t DigitMaxMask(uint8_t u8Digit) const;
 
-  static const uint8_t _ClockDigitToOutputNum[CLOCK_NUM_DIGITS][DIGIT_NUM_SEGMENTS];
-  static const uint8_t _ClockDigitToCathodeNum[CLOCK_NUM_DIGITS][DIGIT_NUM_SEGMENTS];
-  static const uint8_t _AnnunciatorToOutputNum[CLOCK_NUM_ANNUNCIATORS];
-  static const uint8_t _AnnunciatorToCathodeNum[CLOCK_NUM_ANNUNCIATORS];
+  // On boards without the MAX6954, send the segment patterns to a software
+  // multiplexer instead.  Pass NULL to go back to the MAX6954.
+  void SetSoftMux(tSoftMux *pSoftMux) { _pSoftMux = pSoftMux; }
+
+protected:
+  void _RenderBlink(const bool *pBlink);
+
+  const tDisplayGeometry &_Geometry;
+  tMax6954 &_Max;
+  tSoftMux *_pSoftMux;
+
+  // The segment maps from the last Update(), the segments that blink (are dark in
+  // plane P1), and what we last sent to the chip
+  uint8_t _MaxDigits[GEOM_MAX_REGS];  
+  uint8_t _BlinkMask[GEOM_MAX_REGS];
+  uint8_t _WrittenDigits[GEOM_MAX_REGS];
+  uint8_t _WrittenBlink[GEOM_MAX_REGS];
+  bool    _bWrittenValid;
 };
 
 #endif   /* CLOCK_DISPLAY_H */
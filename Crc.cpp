@@ -0,0 +1,28 @@
+/***************
+* NTP Clock
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "Crc.h"
+
+
+/*****************************************
+* Crc32
+*
+*/
+
+uint32_t Crc32(const void *pData, size_t Len, uint32_t u32Crc)
+{
+  const uint8_t *pu8Data = (const uint8_t *) pData;
+  uint8_t        i;
+
+  u32Crc = ~u32Crc;
+  while (Len--) {
+    u32Crc ^= *pu8Data++;
+    for (i=0; i<8; i++)  u32Crc = (u32Crc >> 1) ^ (0xEDB88320UL & -(u32Crc & 1));
+  }
+
+  return ~u32Crc;
+}
@@ -0,0 +1,21 @@
+/***************
+* NTP Clock
+*
+* CRC-32 (the Ethernet/zip one: reflected, polynomial 0xEDB88320), for checking
+* data kept in RTC memory and flash.  It's done a bit at a time rather than from a
+* table, since nothing checksummed here is big or hot, and it saves 1 KB.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef CRC_H
+#define CRC_H
+
+#include <Arduino.h>
+
+// Pass the previous result as u32Crc to continue a CRC across several buffers
+uint32_t Crc32(const void *pData, size_t Len, uint32_t u32Crc = 0);
+
+#endif   /* CRC_H */
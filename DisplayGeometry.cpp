@@ -0,0 +1,185 @@
+/***************
+* NTP Clock
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "DisplayGeometry.h"
+#include "ClockDisplay.h"
+#include "Font.h"
+
+
+/*********************************************
+* LiteOn 637C1P-12
+*/
+
+/*
+* The particular clock we are making consists of four digits, but they are organized into two
+* common-cathode groups, with each cathode wired to segments across all four digits.
+*
+* The way we deal with this is to tell the MAX6954 that we have two 16-segment "digits", or more
+* specifically, that we have two "7-segment digit pairs", with each pair comprising segments a-g
+* and a decimal point.
+*
+* This bit of fiction means that there is some translation required between our clock's actual 
+* segment ID's and the names that they end up having as far as tha MAX6954 is concerned.
+*
+*
+* Now, for the MAX6954, we'll be illuminating segments attached to outputs O5-O18.  Referring 
+* to Table 4 of the datasheet, we see that these correspond to the following segments for each
+* "digit pair":
+*    O5  O6  O7   O8  O9  O10 O11 O12 O13 O14 O15 O16 O17 O18
+*    1c  1d  1dp  1e  1f  1g  2a  2b  2c  2d  2e  2f  2g  2dp
+*
+* Next, referring to Table 10 of the datasheet, we see that each of these segments has a bit
+* value in the corresponding Digit Register.
+*    D7 D6 D5 D4 D3 D2 D1 D0
+*    dp  a  b  c  d  e  f  g
+*
+* Given this, for each of the O(n) outputs, we can assign a Digit Number and a Bit Value
+*
+*   Output           O5  O6  O7   O8  O9  O10 O11 O12 O13 O14 O15 O16 O17 O18
+*   Digit             1   1   1    1   1   1   2   2   2   2   2   2   2   2
+*   Max segment       c   d  dp    e   f   g   a   b   c   d   e   f   g  dp
+*   Bit Value (hex)  10  08  80   04  02  01  40  20  10  08  04  02  01  80
+*
+* This pattern repeats twice, once for each of our pairs of digits.
+*
+* The bit values are GeomMaxBitFromOutput in DisplayGeometry.h, and GEOM_SEG works out which
+* digit register each output lands in.
+*
+* Our cathode 1 is the MAX6954's CC0 and cathode 2 is CC1, so the four image registers are
+* digits 0 and 0a (cathode 1) and digits 1 and 1a (cathode 2).  They are listed in the order the
+* original code wrote them.
+*
+* Note that digit 0 only has segments b and c.
+*/
+
+
+static constexpr tImageReg LiteOnRegs[] = {
+  { 0 }, { 1 }, { 8 }, { 9 }
+};
+
+#define LITEON_SEG(Cc, Output)  GEOM_SEG(LiteOnRegs, Cc, Output)
+
+static constexpr tSegmentLoc LiteOnDigits[][GEOM_SEGS_PER_DIGIT] = {
+  //          a                  b                  c                  d                  e                  f                  g             dp
+  { GEOM_NONE,         LITEON_SEG(1,  7), LITEON_SEG(1,  6), GEOM_NONE,         GEOM_NONE,         GEOM_NONE,         GEOM_NONE,         GEOM_NONE },
+  { LITEON_SEG(1, 10), LITEON_SEG(1,  5), LITEON_SEG(1,  9), LITEON_SEG(0,  9), LITEON_SEG(0,  6), LITEON_SEG(0, 10), LITEON_SEG(0,  5), GEOM_NONE },
+  { LITEON_SEG(0, 11), LITEON_SEG(0, 12), LITEON_SEG(0, 13), LITEON_SEG(1, 13), LITEON_SEG(1, 14), LITEON_SEG(1, 11), LITEON_SEG(1, 12), GEOM_NONE },
+  { LITEON_SEG(1, 17), LITEON_SEG(1, 15), LITEON_SEG(1, 16), LITEON_SEG(0, 16), LITEON_SEG(0, 14), LITEON_SEG(0, 17), LITEON_SEG(0, 15), GEOM_NONE }
+};
+
+// Indexed by CLOCK_ANNUNCIATOR
+static constexpr tSegmentLoc LiteOnAnnunciators[CLOCK_NUM_ANNUNCIATORS] = {
+  LITEON_SEG(1,  8),   // AM
+  LITEON_SEG(0,  7),   // PM
+  LITEON_SEG(0,  8),   // Alarm
+  LITEON_SEG(0, 18),   // Colon
+  GEOM_NONE            // No second colon
+};
+
+const tDisplayGeometry DisplayGeometryLiteOn637 = {
+  "LiteOn 637C1P-12",
+  2,                          // Scan limit: two cathodes
+  GEOM_NUM_OF(LiteOnDigits),
+  CLOCK_NUM_ANNUNCIATORS,
+  GEOM_NUM_OF(LiteOnRegs),
+  LiteOnRegs,
+  LiteOnDigits,
+  LiteOnAnnunciators,
+  FONT_7_SEGMENT,
+  MAX6954_DIGIT_TYPE_16_AND_16
+};
+
+
+/*********************************************
+* Six-digit HH:MM:SS panel
+*
+* Each digit has its own cathode, CC0 through CC5, with segments a-g on O11-O17 and the
+* decimal point on O18.  Those are the "2a" through "2dp" outputs of Table 4, so each
+* digit's segments all land in its "a" register with the usual a-g bit order.
+*
+* The annunciators are single LEDs on O5 of various cathodes.
+*/
+
+static constexpr tImageReg SixDigitRegs[] = {
+  { 8 }, { 9 }, { 10 }, { 11 }, { 12 }, { 13 },
+  { 0 }, { 1 }, { 3  }, { 4  }, { 5  }
+};
+
+#define SIX_DIGIT(Cc) {                                                        \
+  GEOM_SEG(SixDigitRegs, Cc, 11), GEOM_SEG(SixDigitRegs, Cc, 12),       \
+  GEOM_SEG(SixDigitRegs, Cc, 13), GEOM_SEG(SixDigitRegs, Cc, 14),       \
+  GEOM_SEG(SixDigitRegs, Cc, 15), GEOM_SEG(SixDigitRegs, Cc, 16),       \
+  GEOM_SEG(SixDigitRegs, Cc, 17), GEOM_SEG(SixDigitRegs, Cc, 18) }
+
+static constexpr tSegmentLoc SixDigitDigits[][GEOM_SEGS_PER_DIGIT] = {
+  SIX_DIGIT(0), SIX_DIGIT(1), SIX_DIGIT(2), SIX_DIGIT(3), SIX_DIGIT(4), SIX_DIGIT(5)
+};
+
+static constexpr tSegmentLoc SixDigitAnnunciators[CLOCK_NUM_ANNUNCIATORS] = {
+  GEOM_SEG(SixDigitRegs, 4, 5),   // AM
+  GEOM_SEG(SixDigitRegs, 5, 5),   // PM
+  GEOM_SEG(SixDigitRegs, 0, 5),   // Alarm
+  GEOM_SEG(SixDigitRegs, 1, 5),   // Colon between HH and MM
+  GEOM_SEG(SixDigitRegs, 3, 5)    // Colon between MM and SS
+};
+
+const tDisplayGeometry DisplayGeometrySixDigit = {
+  "Six digit HH:MM:SS",
+  6,
+  GEOM_NUM_OF(SixDigitDigits),
+  CLOCK_NUM_ANNUNCIATORS,
+  GEOM_NUM_OF(SixDigitRegs),
+  SixDigitRegs,
+  SixDigitDigits,
+  SixDigitAnnunciators,
+  FONT_7_SEGMENT,
+  MAX6954_DIGIT_TYPE_16_AND_16
+};
+
+
+/*********************************************
+* Six-digit 14-segment HH:MM:SS panel
+*
+* Each digit has its own cathode, CC0 through CC5, with the chip in 14-segment mode so
+* the font's 14-segment glyphs go straight through GEOM_DIGIT_14SEG.  The annunciators
+* are on the one bit of each digit na register that a 14-segment digit leaves over
+* (D7), on the same cathodes as the 7-segment panel.
+*/
+
+static constexpr tImageReg SixDigit14Regs[] = {
+  { 0 }, { 8  }, { 1 }, { 9  }, { 2 }, { 10 },
+  { 3 }, { 11 }, { 4 }, { 12 }, { 5 }, { 13 }
+};
+
+#define SIX_DIGIT14_ANN(Cc)  { GeomFindReg(SixDigit14Regs, GEOM_NUM_OF(SixDigit14Regs), (Cc) + 8), 0x80 }
+
+static constexpr tSegmentLoc SixDigit14Digits[][GEOM_SEGS_PER_DIGIT] = {
+  GEOM_DIGIT_14SEG(SixDigit14Regs, 0), GEOM_DIGIT_14SEG(SixDigit14Regs, 1),
+  GEOM_DIGIT_14SEG(SixDigit14Regs, 2), GEOM_DIGIT_14SEG(SixDigit14Regs, 3),
+  GEOM_DIGIT_14SEG(SixDigit14Regs, 4), GEOM_DIGIT_14SEG(SixDigit14Regs, 5)
+};
+
+static constexpr tSegmentLoc SixDigit14Annunciators[CLOCK_NUM_ANNUNCIATORS] = {
+  SIX_DIGIT14_ANN(4),   // AM
+  SIX_DIGIT14_ANN(5),   // PM
+  SIX_DIGIT14_ANN(0),   // Alarm
+  SIX_DIGIT14_ANN(1),   // Colon between HH and MM
+  SIX_DIGIT14_ANN(3)    // Colon between MM and SS
+};
+
+const tDisplayGeometry DisplayGeometrySixDigit14 = {
+  "Six digit 14-segment HH:MM:SS",
+  6,
+  GEOM_NUM_OF(SixDigit14Digits),
+  CLOCK_NUM_ANNUNCIATORS,
+  GEOM_NUM_OF(SixDigit14Regs),
+  SixDigit14Regs,
+  SixDigit14Digits,
+  SixDigit14Annunciators,
+  FONT_14_SEGMENT,
+  MAX6954_DIGIT_TYPE_14_AND_14
+};
@@ -0,0 +1,167 @@
+/***************
+* NTP Clock
+*
+* A tDisplayGeometry describes how a particular LED panel is wired to its
+* MAX6954: for each clock digit segment and each annunciator, which MAX6954 digit
+* register and which bit lights it.
+*
+* Geometries are written declaratively, in the terms you read off the schematic:
+* "segment b of digit 0 is on common cathode CC1, output O7".  The GEOM_SEG macro
+* turns that into a register index and bit mask at compile time, so the tables that
+* end up in the binary are the flat lookups tClockDisplay uses to render a frame.
+*
+* To add a panel, declare its image registers, then its digit and annunciator tables
+* with GEOM_SEG and GEOM_NONE (or GEOM_DIGIT_14SEG / GEOM_DIGIT_16SEG for alphanumeric
+* digits), and wrap them in a tDisplayGeometry with the font and MAX6954 digit type.  See
+* DisplayGeometry.cpp for the panels we ship.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef DISPLAY_GEOMETRY_H
+#define DISPLAY_GEOMETRY_H
+
+#include <Arduino.h>
+
+#define GEOM_MAX_DIGITS         (8)
+#define GEOM_MAX_REGS           (16)
+#define GEOM_SEGS_PER_DIGIT     (16)   // In the font's bit order (Font.h): a-g then dp for 7-segment
+
+#define GEOM_NO_REG             (0xFF)
+
+
+// Where one segment lives: a byte of the register image and a bit in it.  A mask of
+// 0 means the panel doesn't have that segment.
+struct tSegmentLoc {
+  uint8_t u8Reg;
+  uint8_t u8Mask;
+};
+
+// One byte of the register image: which digit register (0-7, or 8-15 for 0a-7a)
+// it gets written to
+struct tImageReg {
+  uint8_t u8MaxDigit;
+};
+
+struct tDisplayGeometry {
+  const char        *sName;
+  uint8_t            u8ScanLimit;        // Digits to scan, for tMax6954::Init()
+  uint8_t            u8NumDigits;
+  uint8_t            u8NumAnnunciators;
+  uint8_t            u8NumRegs;
+  const tImageReg   *pRegs;
+  const tSegmentLoc (*pDigitSegs)[GEOM_SEGS_PER_DIGIT];
+  const tSegmentLoc *pAnnunciators;
+  uint8_t            u8FontType;         // FONT_TYPE the digits are drawn in
+  uint8_t            u8DigitType;        // MAX6954_DIGIT_TYPE_* for every digit pair
+};
+
+
+/*********************************************
+* Compile-time helpers for the MAX6954 in 16-segment (digit pair) mode
+*
+* Per Table 4 of the datasheet, outputs O5-O10 of common cathode CCn land in digit n's
+* register and O11-O18 in digit na's register.  Per Table 10, each output has a fixed
+* bit within that register.
+*/
+
+constexpr uint8_t GeomMaxBitFromOutput[19] =
+   { 0,0,0,0,0,  0x10,0x08,0x80,0x04,0x02,0x01,   0x40,0x20,0x10,0x08,0x04,0x02,0x01,0x80 };
+
+constexpr uint8_t GeomMax16SegDigit(uint8_t u8Cc, uint8_t u8Output)
+{
+  return u8Output <= 10 ? u8Cc : u8Cc + 8;
+}
+
+constexpr uint8_t GeomMax16SegBit(uint8_t u8Output)
+{
+  return u8Output < 19 ? GeomMaxBitFromOutput[u8Output] : 0;
+}
+
+// Index of a digit in a register list, or GEOM_NO_REG
+constexpr uint8_t GeomFindReg(const tImageReg *pRegs, uint8_t u8NumRegs, uint8_t u8MaxDigit,
+                              uint8_t i = 0)
+{
+  return i >= u8NumRegs ? GEOM_NO_REG :
+         pRegs[i].u8MaxDigit == u8MaxDigit ? i :
+         GeomFindReg(pRegs, u8NumRegs, u8MaxDigit, i + 1);
+}
+
+#define GEOM_NUM_OF(a)  (sizeof(a) / sizeof((a)[0]))
+
+// A segment on output Output of common cathode Cc.  Regs is the panel's tImageReg
+// array, which must list that digit.
+#define GEOM_SEG(Regs, Cc, Output) \
+  { GeomFindReg(Regs, GEOM_NUM_OF(Regs), GeomMax16SegDigit(Cc, Output)), GeomMax16SegBit(Output) }
+
+#define GEOM_NONE  { 0, 0 }
+
+
+/*********************************************
+* Compile-time helpers for the MAX6954 with 14- and 16-segment digit types
+*
+* With Digit Type set to 14 or 16 segments, one cathode CCn drives one whole digit,
+* and its segments are spread over the digit n and digit na registers (Tables 11 and
+* 12 of the datasheet):
+*
+*             D7   D6   D5   D4   D3   D2   D1   D0
+*   14-seg n  DP   A    B    C    D    E    F    G1
+*   14-seg na  -   G2   H    J    K    L    M    N
+*   16-seg n  A1   A2   B    C    D2   D1   E    F
+*   16-seg na G1   G2   H    J    K    L    M    N
+*
+* The font stays in its own bit order (Font.h); these tables give, for each font bit,
+* which of the two registers (0 for n, 1 for na) and which bit it lands on, so a
+* panel's digit row is just GEOM_DIGIT_14SEG() or GEOM_DIGIT_16SEG().
+*/
+
+constexpr uint8_t GeomMax14SegNa[16]   = { 0,0,0,0,0,0,0,1,    1,1,1,1,1,1,0,0 };
+constexpr uint8_t GeomMax14SegMask[16] =
+   { 0x40,0x20,0x10,0x08,0x04,0x02,0x01,0x40,   0x20,0x10,0x08,0x04,0x02,0x01,0x80,0x00 };
+
+constexpr uint8_t GeomMax16SegNa[16]   = { 0,0,0,0,0,0,0,0,    1,1,1,1,1,1,1,1 };
+constexpr uint8_t GeomMax16SegMask[16] =
+   { 0x80,0x40,0x20,0x10,0x08,0x04,0x02,0x01,   0x80,0x40,0x20,0x10,0x08,0x04,0x02,0x01 };
+
+// Font bit FontBit of a 14-segment digit on common cathode Cc
+#define GEOM_SEG14(Regs, Cc, FontBit) \
+  { GeomFindReg(Regs, GEOM_NUM_OF(Regs), (Cc) + 8 * GeomMax14SegNa[FontBit]), GeomMax14SegMask[FontBit] }
+
+#define GEOM_SEG16(Regs, Cc, FontBit) \
+  { GeomFindReg(Regs, GEOM_NUM_OF(Regs), (Cc) + 8 * GeomMax16SegNa[FontBit]), GeomMax16SegMask[FontBit] }
+
+// A whole digit row, for a pDigitSegs table
+#define GEOM_DIGIT_14SEG(Regs, Cc) {                                                  \
+  GEOM_SEG14(Regs, Cc,  0), GEOM_SEG14(Regs, Cc,  1), GEOM_SEG14(Regs, Cc,  2), \
+  GEOM_SEG14(Regs, Cc,  3), GEOM_SEG14(Regs, Cc,  4), GEOM_SEG14(Regs, Cc,  5), \
+  GEOM_SEG14(Regs, Cc,  6), GEOM_SEG14(Regs, Cc,  7), GEOM_SEG14(Regs, Cc,  8), \
+  GEOM_SEG14(Regs, Cc,  9), GEOM_SEG14(Regs, Cc, 10), GEOM_SEG14(Regs, Cc, 11), \
+  GEOM_SEG14(Regs, Cc, 12), GEOM_SEG14(Regs, Cc, 13), GEOM_SEG14(Regs, Cc, 14), \
+  GEOM_NONE }
+
+#define GEOM_DIGIT_16SEG(Regs, Cc) {                                                  \
+  GEOM_SEG16(Regs, Cc,  0), GEOM_SEG16(Regs, Cc,  1), GEOM_SEG16(Regs, Cc,  2), \
+  GEOM_SEG16(Regs, Cc,  3), GEOM_SEG16(Regs, Cc,  4), GEOM_SEG16(Regs, Cc,  5), \
+  GEOM_SEG16(Regs, Cc,  6), GEOM_SEG16(Regs, Cc,  7), GEOM_SEG16(Regs, Cc,  8), \
+  GEOM_SEG16(Regs, Cc,  9), GEOM_SEG16(Regs, Cc, 10), GEOM_SEG16(Regs, Cc, 11), \
+  GEOM_SEG16(Regs, Cc, 12), GEOM_SEG16(Regs, Cc, 13), GEOM_SEG16(Regs, Cc, 14), \
+  GEOM_SEG16(Regs, Cc, 15) }
+
+
+/*********************************************
+* The panels we know about
+*/
+
+// The LiteOn 637C1P-12 in the original bedside clock: "1 88:88" on two cathodes
+extern const tDisplayGeometry DisplayGeometryLiteOn637;
+
+// Six plain 7-segment digits (HH:MM:SS), one per cathode, with two colons
+extern const tDisplayGeometry DisplayGeometrySixDigit;
+
+// Six 14-segment digits (HH:MM:SS), one per cathode, with two colons
+extern const tDisplayGeometry DisplayGeometrySixDigit14;
+
+
+#endif   /* DISPLAY_GEOMETRY_H */
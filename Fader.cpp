@@ -0,0 +1,223 @@
+/***************
+* NTP Clock
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "Fader.h"
+
+
+/*
+* Perceptual level to linear duty, gamma 2.2, sampled every 16 levels.  Entry n is
+* 255 * (16n/256)^2.2; we interpolate between entries.
+*/
+
+const uint8_t tIntensityFader::_GammaTable[17] PROGMEM =
+  { 0, 1, 3, 6, 12, 20, 29, 41, 55, 72, 91, 112, 135, 161, 190, 221, 255 };
+
+
+/***************************************
+* tIntensityFader constructor
+*
+* All digits start at full level, with the chip in global-intensity mode.
+*/
+
+tIntensityFader::tIntensityFader(tMax6954 &Max) :
+  _Max(Max)
+{
+  uint8_t i;
+
+  for (i=0; i<FADER_NUM_DIGITS; i++) {
+    _u8StartLevel[i]  = FADER_LEVEL_FULL;
+    _u8TargetLevel[i] = FADER_LEVEL_FULL;
+    _ulStartMs[i]     = 0;
+    _u16DurationMs[i] = 0;
+  }
+
+  for (i=0; i<FADER_NUM_INTENSITY_REGS; i++)  _u8IntensityRegs[i] = 0;
+
+  _u16FadingMask = 0;
+  _pfnAtBottom   = NULL;
+  _pAtBottomArg  = NULL;
+  _u16DipMask    = 0;
+  _u16DipHalfMs  = 0;
+  _bIndividual   = false;
+}
+
+
+/***************************************
+* tIntensityFader::Gamma
+*
+* INPUTS:
+*   u8Level - perceptual level, 0-255
+* RETURNS:
+*   linear duty, 0-255
+*/
+
+uint8_t tIntensityFader::Gamma(uint8_t u8Level)
+{
+  uint8_t u8Idx  = u8Level >> 4;
+  uint8_t u8Frac = u8Level & 0x0F;
+  uint8_t u8Lo, u8Hi;
+
+  if (u8Level == FADER_LEVEL_FULL)  return 255;
+
+  u8Lo = pgm_read_byte(&_GammaTable[u8Idx]);
+  u8Hi = pgm_read_byte(&_GammaTable[u8Idx + 1]);
+
+  return u8Lo + (((uint16_t) (u8Hi - u8Lo) * u8Frac) >> 4);
+}
+
+
+/***************************************
+* tIntensityFader::FadeTo
+*
+* Starts a fade from wherever each digit is now.  A duration of 0 jumps straight
+* to the new level on the next Service().
+*/
+
+void tIntensityFader::FadeTo(uint16_t u16DigitMask, uint8_t u8Level, uint16_t u16DurationMs,
+                             uint32_t ulNowMs)
+{
+  uint8_t i;
+
+  for (i=0; i<FADER_NUM_DIGITS; i++) {
+    if (!(u16DigitMask & (1 << i)))  continue;
+
+    _u8StartLevel[i]  = _CurrentLevel(i, ulNowMs);
+    _u8TargetLevel[i] = u8Level;
+    _ulStartMs[i]     = ulNowMs;
+    _u16DurationMs[i] = u16DurationMs;
+  }
+  _u16FadingMask |= u16DigitMask;
+
+  // Load the registers before switching modes, so the digits don't flash
+  if (!_bIndividual) {
+    _WriteIntensities(ulNowMs, true);
+    _Max.SetIndividualIntensities(true);
+    _bIndividual = true;
+  }
+}
+
+
+/***************************************
+* tIntensityFader::Dip
+*
+* Fades the digits down over half the duration, calls pfnAtBottom (which would
+* typically call tClockDisplay::Update() with the new digits), then fades back up.
+*
+* Note that intensity code 0 is still 1/16 duty on this part, so the bottom of the
+* dip is dim rather than dark.
+*/
+
+void tIntensityFader::Dip(uint16_t u16DigitMask, uint16_t u16DurationMs, tFaderCallback pfnAtBottom,
+                          void *pArg, uint32_t ulNowMs)
+{
+  _pfnAtBottom  = pfnAtBottom;
+  _pAtBottomArg = pArg;
+  _u16DipMask   = u16DigitMask;
+  _u16DipHalfMs = u16DurationMs / 2;
+
+  FadeTo(u16DigitMask, FADER_LEVEL_OFF, _u16DipHalfMs, ulNowMs);
+}
+
+
+/***************************************
+* tIntensityFader::Service
+*
+* Advances all fades to ulNowMs and writes whatever intensity registers changed.
+*
+* RETURNS:
+*   true while there is more fading to do
+*/
+
+bool tIntensityFader::Service(uint32_t ulNowMs)
+{
+  uint8_t i;
+
+  if (!_bIndividual)  return false;
+
+  _WriteIntensities(ulNowMs);
+
+  for (i=0; i<FADER_NUM_DIGITS; i++) {
+    if ((_u16FadingMask & (1 << i))  &&  ulNowMs - _ulStartMs[i] >= _u16DurationMs[i]) {
+      _u8StartLevel[i] = _u8TargetLevel[i];
+      _u16FadingMask  &= ~(1 << i);
+    }
+  }
+
+  // Bottom of a dip: swap contents and head back up
+  if (_pfnAtBottom != NULL  &&  (_u16FadingMask & _u16DipMask) == 0) {
+    tFaderCallback pfn = _pfnAtBottom;
+    _pfnAtBottom = NULL;
+    pfn(_pAtBottomArg);
+    FadeTo(_u16DipMask, FADER_LEVEL_FULL, _u16DipHalfMs, ulNowMs);
+  }
+
+  if (IsActive())  return true;
+
+  // All done.  If everything is back at full, hand control back to the global register.
+  for (i=0; i<FADER_NUM_DIGITS; i++) {
+    if (_u8TargetLevel[i] != FADER_LEVEL_FULL)  return false;
+  }
+  _Max.SetIndividualIntensities(false);
+  _bIndividual = false;
+
+  return false;
+}
+
+
+/***************************************
+* tIntensityFader::_CurrentLevel
+*
+* Linear interpolation of the perceptual level of one digit
+*/
+
+uint8_t tIntensityFader::_CurrentLevel(uint8_t u8Digit, uint32_t ulNowMs) const
+{
+  unsigned long ulElapsed;
+  int           iDelta;
+
+  if (!(_u16FadingMask & (1 << u8Digit)))  return _u8TargetLevel[u8Digit];
+
+  ulElapsed = ulNowMs - _ulStartMs[u8Digit];
+  if (ulElapsed >= _u16DurationMs[u8Digit])  return _u8TargetLevel[u8Digit];
+
+  iDelta = (int) _u8TargetLevel[u8Digit] - (int) _u8StartLevel[u8Digit];
+  return _u8StartLevel[u8Digit] + (int) (iDelta * (long) ulElapsed / _u16DurationMs[u8Digit]);
+}
+
+
+/***************************************
+* tIntensityFader::_WriteIntensities
+*
+* Intensity register n (address 0x10 + n) holds digit 2n in its low nibble and
+* digit 2n+1 in its high nibble; this works out for both the 10..76 and the
+* 10a..76a blocks given our numbering of the "a" digits.
+*
+* The 4-bit code has the same meaning as the global register, so a digit at full
+* level gets exactly the global brightness.
+*
+* bForce writes every register whether or not we think it changed.
+*/
+
+void tIntensityFader::_WriteIntensities(uint32_t ulNowMs, bool bForce)
+{
+  uint8_t  i, u8Value;
+  uint16_t u16Global = _Max.GetBrightness();
+  uint8_t  u8Nibble[2];
+
+  if (u16Global > 15)  u16Global = 15;
+
+  for (i=0; i<FADER_NUM_INTENSITY_REGS; i++) {
+    u8Nibble[0] = (Gamma(_CurrentLevel(2*i,   ulNowMs)) * u16Global + 127) / 255;
+    u8Nibble[1] = (Gamma(_CurrentLevel(2*i+1, ulNowMs)) * u16Global + 127) / 255;
+    u8Value     = u8Nibble[1] << 4 | u8Nibble[0];
+
+    if (bForce  ||  u8Value != _u8IntensityRegs[i]) {
+      _Max.WriteCmd(MAX6954_REG_Intensity10 + i, u8Value);
+      _u8IntensityRegs[i] = u8Value;
+    }
+  }
+}
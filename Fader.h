@@ -0,0 +1,89 @@
+/***************
+* NTP Clock
+*
+* The tIntensityFader class does smooth brightness transitions using the MAX6954's
+* per-digit intensity registers (Intensity10 through Intensity76a).
+*
+* Levels are given on a perceptual 0-255 scale and run through a gamma curve, so a
+* linear ramp in level looks like a linear ramp to the eye.  The result is scaled to
+* the chip's current global brightness, so a fade never goes brighter than the rest
+* of the display.
+*
+* Each step recomputes the 4-bit intensity of every managed digit and writes only the
+* intensity registers whose contents actually changed.  Since there are only 16
+* intensity codes, a full-range fade costs at most 16 writes per register however
+* often Service() is called.
+*
+* When nothing is fading and every digit is back at full level, the chip is put back
+* into global-intensity mode so that SetBrightness() works as usual.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef FADER_H
+#define FADER_H
+
+#include <Arduino.h>
+#include "Max6954.h"
+
+// The chip has 16 digits: 0-7 and 0a-7a.  We number the "a" digits 8-15, which is
+// also how tMax6954::WriteDigit numbers them.
+#define FADER_NUM_DIGITS         (16)
+#define FADER_NUM_INTENSITY_REGS (8)
+
+#define FADER_LEVEL_OFF  (0)
+#define FADER_LEVEL_FULL (255)
+
+// Called at the bottom of a Dip(), while the digits are at their dimmest
+typedef void (*tFaderCallback)(void *pArg);
+
+
+class tIntensityFader {
+public:
+  tIntensityFader(tMax6954 &Max);
+
+  // Fade the digits in u16DigitMask (bit n = digit n) to u8Level over u16DurationMs
+  void FadeTo(uint16_t u16DigitMask, uint8_t u8Level, uint16_t u16DurationMs, uint32_t ulNowMs);
+
+  // Fade the digits down, call pfnAtBottom, then fade them back up.  Used to
+  // cross-fade a change of digit contents.
+  void Dip(uint16_t u16DigitMask, uint16_t u16DurationMs, tFaderCallback pfnAtBottom, void *pArg,
+           uint32_t ulNowMs);
+
+  // Call often while IsActive().  Returns IsActive().
+  bool Service(uint32_t ulNowMs);
+  bool IsActive() const { return _u16FadingMask != 0 || _pfnAtBottom != NULL; }
+
+  static uint8_t Gamma(uint8_t u8Level);
+
+protected:
+  uint8_t _CurrentLevel(uint8_t u8Digit, uint32_t ulNowMs) const;
+  void    _WriteIntensities(uint32_t ulNowMs, bool bForce = false);
+
+  tMax6954 &_Max;
+
+  // Per-digit fade: from StartLevel at StartMs to TargetLevel at StartMs + DurationMs
+  uint8_t       _u8StartLevel [FADER_NUM_DIGITS];
+  uint8_t       _u8TargetLevel[FADER_NUM_DIGITS];
+  uint32_t      _ulStartMs    [FADER_NUM_DIGITS];
+  uint16_t      _u16DurationMs[FADER_NUM_DIGITS];
+  uint16_t      _u16FadingMask;
+
+  // Pending Dip() state
+  tFaderCallback _pfnAtBottom;
+  void          *_pAtBottomArg;
+  uint16_t       _u16DipMask;
+  uint16_t       _u16DipHalfMs;
+
+  // What we last wrote to each intensity register, and whether we are in
+  // individual-intensity mode at all
+  uint8_t _u8IntensityRegs[FADER_NUM_INTENSITY_REGS];
+  bool    _bIndividual;
+
+  static const uint8_t _GammaTable[17] PROGMEM;
+};
+
+
+#endif   /* FADER_H */
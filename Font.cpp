@@ -0,0 +1,103 @@
+/***************
+* NTP Clock
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "Font.h"
+
+
+// These start at ASCII 32 (space).  See Font.h for the bit assignments.
+
+const uint8_t Font7Segment[FONT_NUM_GLYPHS] PROGMEM = {
+  0x00, 0x86, 0x22, 0x76, 0x6D, 0x24, 0x5E, 0x02,   // sp ! " # $ % & '
+  0x39, 0x0F, 0x63, 0x70, 0x04, 0x40, 0x80, 0x52,   // ( ) * + , - . /
+  0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07,   // 0 1 2 3 4 5 6 7
+  0x7F, 0x6F, 0x08, 0x08, 0x18, 0x48, 0x0C, 0x53,   // 8 9 : ; < = > ?
+  0x7D, 0x77, 0x7C, 0x58, 0x5E, 0x79, 0x71, 0x6F,   // @ A B C D E F G
+  0x74, 0x04, 0x0E, 0x70, 0x38, 0x37, 0x54, 0x5C,   // H I J K L M N O
+  0x73, 0x67, 0x50, 0x6D, 0x78, 0x1C, 0x0C, 0x36,   // P Q R S T U V W
+  0x76, 0x6E, 0x5B, 0x39, 0x64, 0x0F, 0x23, 0x08,   // X Y Z [ \ ] ^ _
+  0x20, 0x77, 0x7C, 0x58, 0x5E, 0x79, 0x71, 0x6F,   // ` a b c d e f g
+  0x74, 0x04, 0x0E, 0x70, 0x38, 0x37, 0x54, 0x5C,   // h i j k l m n o
+  0x73, 0x67, 0x50, 0x6D, 0x78, 0x1C, 0x0C, 0x36,   // p q r s t u v w
+  0x76, 0x6E, 0x5B, 0x79, 0x30, 0x4F, 0x01          // x y z { | } ~
+};
+
+const uint16_t Font14Segment[FONT_NUM_GLYPHS] PROGMEM = {
+  0x0000, 0x4006, 0x0220, 0x12CE, 0x12ED, 0x2424, 0x0D59, 0x0200,   // sp ! " # $ % & '
+  0x0C00, 0x2100, 0x3FC0, 0x12C0, 0x2000, 0x00C0, 0x4000, 0x2400,   // ( ) * + , - . /
+  0x243F, 0x0406, 0x00DB, 0x008F, 0x00E6, 0x00ED, 0x00FD, 0x0007,   // 0 1 2 3 4 5 6 7
+  0x00FF, 0x00EF, 0x1200, 0x2200, 0x0C00, 0x00C8, 0x2100, 0x1083,   // 8 9 : ; < = > ?
+  0x02BB, 0x00F7, 0x128F, 0x0039, 0x120F, 0x0079, 0x0071, 0x00BD,   // @ A B C D E F G
+  0x00F6, 0x1209, 0x001E, 0x0C70, 0x0038, 0x0536, 0x0936, 0x003F,   // H I J K L M N O
+  0x00F3, 0x083F, 0x08F3, 0x00ED, 0x1201, 0x003E, 0x2430, 0x2836,   // P Q R S T U V W
+  0x2D00, 0x1500, 0x2409, 0x0039, 0x0900, 0x000F, 0x2800, 0x0008,   // X Y Z [ \ ] ^ _
+  0x0100, 0x00F7, 0x128F, 0x0039, 0x120F, 0x0079, 0x0071, 0x00BD,   // ` a b c d e f g
+  0x00F6, 0x1209, 0x001E, 0x0C70, 0x0038, 0x0536, 0x0936, 0x003F,   // h i j k l m n o
+  0x00F3, 0x083F, 0x08F3, 0x00ED, 0x1201, 0x003E, 0x2430, 0x2836,   // p q r s t u v w
+  0x2D00, 0x1500, 0x2409, 0x0C49, 0x1200, 0x2189, 0x05C0          // x y z { | } ~
+};
+
+const uint16_t Font16Segment[FONT_NUM_GLYPHS] PROGMEM = {
+  0x0000, 0x000C, 0x0880, 0x4B3C, 0x4BBB, 0x9088, 0x3573, 0x0800,   // sp ! " # $ % & '
+  0x3000, 0x8400, 0xFF00, 0x4B00, 0x8000, 0x0300, 0x0000, 0x9000,   // ( ) * + , - . /
+  0x90FF, 0x100C, 0x0377, 0x023F, 0x038C, 0x03BB, 0x03FB, 0x000F,   // 0 1 2 3 4 5 6 7
+  0x03FF, 0x03BF, 0x4800, 0x8800, 0x3000, 0x0330, 0x8400, 0x4207,   // 8 9 : ; < = > ?
+  0x0AF7, 0x03CF, 0x4A3F, 0x00F3, 0x483F, 0x01F3, 0x01C3, 0x02FB,   // @ A B C D E F G
+  0x03CC, 0x4833, 0x007C, 0x31C0, 0x00F0, 0x14CC, 0x24CC, 0x00FF,   // H I J K L M N O
+  0x03C7, 0x20FF, 0x23C7, 0x03BB, 0x4803, 0x00FC, 0x90C0, 0xA0CC,   // P Q R S T U V W
+  0xB400, 0x5400, 0x9033, 0x00F3, 0x2400, 0x003F, 0xA000, 0x0030,   // X Y Z [ \ ] ^ _
+  0x0400, 0x03CF, 0x4A3F, 0x00F3, 0x483F, 0x01F3, 0x01C3, 0x02FB,   // ` a b c d e f g
+  0x03CC, 0x4833, 0x007C, 0x31C0, 0x00F0, 0x14CC, 0x24CC, 0x00FF,   // h i j k l m n o
+  0x03C7, 0x20FF, 0x23C7, 0x03BB, 0x4803, 0x00FC, 0x90C0, 0xA0CC,   // p q r s t u v w
+  0xB400, 0x5400, 0x9033, 0x3133, 0x4800, 0x8633, 0x1700          // x y z { | } ~
+};
+
+
+/***************************************
+* FontGlyph
+*
+* INPUTS:
+*   u8FontType - one of FONT_TYPE
+*   cAscii     - the character to look up
+* RETURNS:
+*   The segment pattern in the bit order given in Font.h, or the fallback glyph
+*   for that font if cAscii is not printable ASCII
+*/
+
+uint16_t FontGlyph(uint8_t u8FontType, char cAscii)
+{
+  uint8_t u8Idx = (uint8_t) cAscii - FONT_FIRST_CHAR;
+
+  switch (u8FontType) {
+    case FONT_14_SEGMENT:
+      if (u8Idx >= FONT_NUM_GLYPHS)  return FONT_FALLBACK_14;
+      return pgm_read_word(&Font14Segment[u8Idx]);
+
+    case FONT_16_SEGMENT:
+      if (u8Idx >= FONT_NUM_GLYPHS)  return FONT_FALLBACK_16;
+      return pgm_read_word(&Font16Segment[u8Idx]);
+
+    default:
+      return FontGlyph7(cAscii);
+  }
+}
+
+
+/***************************************
+* FontNumSegments
+*
+* RETURNS:
+*   How many bits of a glyph are meaningful for the font, counting DP
+*/
+
+uint8_t FontNumSegments(uint8_t u8FontType)
+{
+  switch (u8FontType) {
+    case FONT_14_SEGMENT:  return 15;
+    case FONT_16_SEGMENT:  return 16;
+    default:               return 8;
+  }
+}
@@ -0,0 +1,91 @@
+/***************
+* NTP Clock
+*
+* Segment fonts for every printable ASCII character (32-126), for 7-, 14- and
+* 16-segment digits.  The tables live in PROGMEM, one byte per glyph for 7-segment
+* and two bytes per glyph for 14/16-segment, and lookup is a single indexed read.
+*
+* Anything outside 32-126 comes back as the fallback glyph (three horizontal bars),
+* so callers never have to deal with a missing character.
+*
+* Bit assignments.  For 7-segment, bits 0-6 are segments a-g in the order
+* tClockDisplay indexes them:
+*
+*       A                A               A1   A2
+*     F   B          F H J K B        F H  J  K B
+*       G              G1 G2             G1  G2
+*     E   C          E N M L C        E N  M  L C
+*       D   .            D   DP          D1   D2
+*
+*   7-segment:   bit 0-7   = A B C D E F G DP
+*   14-segment:  bit 0-14  = A B C D E F G1 G2 H J K L M N DP
+*   16-segment:  bit 0-15  = A1 A2 B C D2 D1 E F G1 G2 H J K L M N  (no DP)
+*
+* These are the font's own orders, not the MAX6954's: the panel's geometry maps each
+* bit onto a register bit (GEOM_DIGIT_14SEG / GEOM_DIGIT_16SEG in DisplayGeometry.h
+* for the chip's 14/16-segment digit types).
+*
+* Lower case letters use the upper case glyphs.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef FONT_H
+#define FONT_H
+
+#include <Arduino.h>
+
+#define FONT_FIRST_CHAR  (32)
+#define FONT_LAST_CHAR   (126)
+#define FONT_NUM_GLYPHS  (FONT_LAST_CHAR - FONT_FIRST_CHAR + 1)
+
+typedef enum {
+  FONT_7_SEGMENT,
+  FONT_14_SEGMENT,
+  FONT_16_SEGMENT
+} FONT_TYPE;
+
+// 7-segment bits
+#define SEG7_A    (0x01)
+#define SEG7_B    (0x02)
+#define SEG7_C    (0x04)
+#define SEG7_D    (0x08)
+#define SEG7_E    (0x10)
+#define SEG7_F    (0x20)
+#define SEG7_G    (0x40)
+#define SEG7_DP   (0x80)
+
+// Shown for characters we don't have
+#define FONT_FALLBACK_7   (SEG7_A | SEG7_D | SEG7_G)
+#define FONT_FALLBACK_14  (0x00C9)   // A D G1 G2
+#define FONT_FALLBACK_16  (0x0333)   // A1 A2 D2 D1 G1 G2
+
+
+extern const uint8_t  Font7Segment [FONT_NUM_GLYPHS] PROGMEM;
+extern const uint16_t Font14Segment[FONT_NUM_GLYPHS] PROGMEM;
+extern const uint16_t Font16Segment[FONT_NUM_GLYPHS] PROGMEM;
+
+
+/***************************************
+* FontGlyph7
+*
+* RETURNS:
+*   The 7-segment pattern for cAscii, or FONT_FALLBACK_7
+*/
+
+inline uint8_t FontGlyph7(char cAscii)
+{
+  uint8_t u8Idx = (uint8_t) cAscii - FONT_FIRST_CHAR;
+
+  if (u8Idx >= FONT_NUM_GLYPHS)  return FONT_FALLBACK_7;
+  return pgm_read_byte(&Font7Segment[u8Idx]);
+}
+
+
+uint16_t FontGlyph(uint8_t u8FontType, char cAscii);
+uint8_t  FontNumSegments(uint8_t u8FontType);
+
+
+#endif   /* FONT_H */
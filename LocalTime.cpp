@@ -6,6 +6,7 @@
 */
 
 #include "LocalTime.h"
+#include "Probe.h"
 
 /*****************************************
 * tLocalTime Static members
@@ -48,6 +49,7 @@ time_t tLocalTime::UtcToLocal(time_t tUtcTime)
   time_t tCurLocalTime;
 
   TimeChangeRule *pTcr;
+  PROBE_SCOPE(PROBE_UTC_TO_LOCAL);
 
   tCurLocalTime = _tz.toLocal(tUtcTime, &pTcr);
 
@@ -60,6 +62,22 @@ time_t tLocalTime::UtcToLocal(time_t tUtcTime)
 }
 
 
+/*****************************************
+* tLocalTime::LocalToUtc
+* 
+* Timezone's toUTC() puts a skipped local time on the wrong side of the change,
+* which shows up as not coming back to the same local time.  Moving it by however
+* far it's off puts it after the change.
+*/
+
+time_t tLocalTime::LocalToUtc(time_t tLocalTime)
+{
+  time_t tUtcTime = _tz.toUTC(tLocalTime);
+
+  return tUtcTime + (tLocalTime - _tz.toLocal(tUtcTime));
+}
+
+
 
 /*****************************************
 * tTimeZoneSet::tTimeZoneSet
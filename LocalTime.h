@@ -9,9 +9,6 @@
 #ifndef INC_LOCALTIME_H
 #define INC_LOCALTIME_H
 
-#include <ESP8266WiFi.h>
-#include <WiFiUdp.h>
-
 #include <TimeLib.h>
 #include <Timezone.h>
 
@@ -21,6 +18,11 @@ friend class tTimeZoneSet;
   tLocalTime(TimeChangeRule DaylightTimeRule, TimeChangeRule StandardTimeRule);
 
   time_t UtcToLocal(time_t tUtcTime);
+
+  // A local time that's skipped when the clocks go forward comes out as the moment
+  // it would have been without the change.  One that happens twice when they go
+  // back comes out as one of the two.
+  time_t LocalToUtc(time_t tLocalTime);
   const char *CurTimeZoneShortName() { return _sTzAbbrev; }
 
 protected:
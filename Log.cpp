@@ -0,0 +1,182 @@
+/***************
+* NTP Clock
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "Log.h"
+
+
+// The catalog's formats, in flash
+#define LOG_MSG(Id, Format)  static const char _sFormat_##Id[] PROGMEM = Format;
+LOG_MESSAGES
+#undef LOG_MSG
+
+#define LOG_MSG(Id, Format)  _sFormat_##Id,
+static const char * const _Formats[LOG_NUM_MESSAGES] PROGMEM = {
+  LOG_MESSAGES
+};
+#undef LOG_MSG
+
+static const char _LevelLetters[LOG_NUM_LEVELS] = { 'D', 'I', 'W', 'E' };
+
+tLog Log;
+
+
+/***************************************
+* tLog constructor
+*
+*/
+
+tLog::tLog()
+{
+  _u8Head          = 0;
+  _u8Count         = 0;
+  _u8MinLevel      = LOG_INFO;
+  _bBinary         = false;
+  _u32Dropped      = 0;
+  _u32TotalDropped = 0;
+  _u8OutLen        = 0;
+  _u8OutPos        = 0;
+}
+
+
+/***************************************
+* tLog::Write
+*
+* INPUTS:
+*   u8Level  - one of LOG_LEVEL
+*   u16MsgId - one of LOG_MSG_ID
+*   lArg0-2  - the format's arguments, if it has any
+*/
+
+void ICACHE_RAM_ATTR tLog::Write(uint8_t u8Level, uint16_t u16MsgId, int32_t lArg0, int32_t lArg1, int32_t lArg2)
+{
+  tLogRecord *pRecord;
+  uint32_t    u32SavedPs;
+
+  if (u8Level < _u8MinLevel)  return;
+
+  // Save and restore the interrupt level rather than just enabling afterwards, so
+  // this works from inside an ISR too
+  u32SavedPs = xt_rsil(15);
+  if (_u8Count >= LOG_RING_SIZE) {
+    _u32Dropped++;
+    _u32TotalDropped++;
+    xt_wsr_ps(u32SavedPs);
+    return;
+  }
+
+  pRecord = &_Ring[(_u8Head + _u8Count) % LOG_RING_SIZE];
+  _u8Count++;
+
+  pRecord->u32TimeMs = millis();
+  pRecord->u16MsgId  = u16MsgId;
+  pRecord->u8Level   = u8Level;
+  pRecord->lArgs[0]  = lArg0;
+  pRecord->lArgs[1]  = lArg1;
+  pRecord->lArgs[2]  = lArg2;
+  xt_wsr_ps(u32SavedPs);
+}
+
+
+/***************************************
+* tLog::Drain
+*
+* The core's HardwareSerial drives the UART; we don't own its interrupt.  What we
+* can do is ask how much room the transmit FIFO has and never write more than that,
+* which gives the same result: the UART empties the FIFO in the background and we
+* never wait.  Call it often enough to keep the FIFO from running dry, e.g. every
+* 10 ms at 115200 baud.
+*/
+
+bool tLog::Drain(HardwareSerial &Out)
+{
+  tLogRecord Record;
+  int        iRoom;
+  uint32_t   u32SavedPs;
+
+  for (;;) {
+    // Finish the record in progress
+    if (_u8OutPos < _u8OutLen) {
+      iRoom = Out.availableForWrite();
+      if (iRoom <= 0)  return true;
+      if (iRoom > _u8OutLen - _u8OutPos)  iRoom = _u8OutLen - _u8OutPos;
+
+      Out.write(&_u8Out[_u8OutPos], iRoom);
+      _u8OutPos += iRoom;
+      if (_u8OutPos < _u8OutLen)  return true;
+    }
+
+    // Say if we've lost any, as soon as there's room to
+    if (_u32Dropped != 0  &&  _u8Count < LOG_RING_SIZE) {
+      uint32_t u32Dropped = _u32Dropped;
+      _u32Dropped = 0;
+      Write(LOG_WARN, LOG_MSG_DROPPED, u32Dropped);
+    }
+
+    if (_u8Count == 0)  return false;
+
+    u32SavedPs = xt_rsil(15);
+    Record     = _Ring[_u8Head];
+    _u8Head    = (_u8Head + 1) % LOG_RING_SIZE;
+    _u8Count--;
+    xt_wsr_ps(u32SavedPs);
+
+    _Format(Record);
+  }
+}
+
+
+/***************************************
+* tLog::_Format
+*
+* Turns a record into the bytes to send, as a text line or a binary frame.
+*/
+
+void tLog::_Format(const tLogRecord &Record)
+{
+  uint8_t  u8Sum = 0;
+  uint8_t  i, j;
+  int      iLen;
+
+  _u8OutPos = 0;
+
+  if (_bBinary) {
+    i = 0;
+    _u8Out[i++] = LOG_FRAME_SYNC0;
+    _u8Out[i++] = LOG_FRAME_SYNC1;
+    for (j=0; j<4; j++)  _u8Out[i++] = Record.u32TimeMs >> (8*j);
+    _u8Out[i++] = Record.u16MsgId;
+    _u8Out[i++] = Record.u16MsgId >> 8;
+    _u8Out[i++] = Record.u8Level;
+    for (j=0; j<LOG_MAX_ARGS*4; j++)  _u8Out[i++] = (uint32_t) Record.lArgs[j/4] >> (8*(j%4));
+    for (j=2; j<i; j++)  u8Sum += _u8Out[j];
+    _u8Out[i++] = u8Sum;
+
+    _u8OutLen = i;
+    return;
+  }
+
+  iLen = snprintf((char *) _u8Out, LOG_MAX_LINE, "%lu.%03lu %c ",
+                  (unsigned long) Record.u32TimeMs / 1000, (unsigned long) Record.u32TimeMs % 1000,
+                  Record.u8Level < LOG_NUM_LEVELS ? _LevelLetters[Record.u8Level] : '?');
+
+  if (Record.u16MsgId < LOG_NUM_MESSAGES) {
+    iLen += snprintf_P((char *) _u8Out + iLen, LOG_MAX_LINE - iLen,
+                       (PGM_P) pgm_read_ptr(&_Formats[Record.u16MsgId]),
+                       (long) Record.lArgs[0], (long) Record.lArgs[1], (long) Record.lArgs[2]);
+  }
+  else {
+    iLen += snprintf((char *) _u8Out + iLen, LOG_MAX_LINE - iLen, "message %u %ld %ld %ld",
+                     Record.u16MsgId, (long) Record.lArgs[0], (long) Record.lArgs[1], (long) Record.lArgs[2]);
+  }
+
+  // Leave room for the line ending even if the text was cut short
+  if (iLen > LOG_MAX_LINE - 2)  iLen = LOG_MAX_LINE - 2;
+  _u8Out[iLen++] = '\r';
+  _u8Out[iLen++] = '\n';
+
+  _u8OutLen = iLen;
+}
@@ -0,0 +1,107 @@
+/***************
+* NTP Clock
+*
+* tLog is a logger that never blocks.  A log call stores a small fixed-size binary
+* record (time, level, message ID, up to three integers) in a RAM ring buffer and
+* returns; no formatting happens on the hot path.  Drain() later feeds the records
+* to the serial port, only ever writing as many bytes as the UART's transmit FIFO
+* has room for, so it never waits on the baud rate either.
+*
+* Records go out either as text (formatted on the device, for the serial monitor)
+* or as binary frames, which are smaller and are turned back into text on the host
+* by tools/logdecode.py.  A binary frame is
+*
+*   0xA5 0x5A | time ms (4) | message ID (2) | level (1) | args (3 x 4) | checksum (1)
+*
+* with multi-byte fields little-endian and the checksum the low byte of the sum of
+* the 19 bytes between the sync bytes and it.
+*
+* When the ring is full, new records are dropped (so the ones leading up to the
+* flood survive) and a LOG_MSG_DROPPED record reports how many once there's room.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef LOG_H
+#define LOG_H
+
+#include <Arduino.h>
+#include "LogMessages.h"
+
+#define LOG_RING_SIZE      (64)     // Records
+#define LOG_MAX_ARGS       (3)
+#define LOG_MAX_LINE       (96)     // Longest formatted line, text mode
+
+#define LOG_FRAME_SYNC0    (0xA5)
+#define LOG_FRAME_SYNC1    (0x5A)
+#define LOG_FRAME_SIZE     (22)
+
+typedef enum {
+  LOG_DEBUG,
+  LOG_INFO,
+  LOG_WARN,
+  LOG_ERROR,
+  LOG_NUM_LEVELS
+} LOG_LEVEL;
+
+#define LOG_MSG(Id, Format)  Id,
+typedef enum {
+  LOG_MESSAGES
+  LOG_NUM_MESSAGES
+} LOG_MSG_ID;
+#undef LOG_MSG
+
+struct tLogRecord {
+  uint32_t u32TimeMs;
+  uint16_t u16MsgId;
+  uint8_t  u8Level;
+  int32_t  lArgs[LOG_MAX_ARGS];
+};
+
+
+class tLog {
+public:
+  tLog();
+
+  // Records below u8Level are thrown away at the call site's cost of one compare
+  void    SetLevel(uint8_t u8Level) { _u8MinLevel = u8Level; }
+  uint8_t Level() const { return _u8MinLevel; }
+
+  void SetBinary(bool bBinary) { _bBinary = bBinary; }
+
+  // Queues a record.  Safe from interrupts.
+  void Write(uint8_t u8Level, uint16_t u16MsgId, int32_t lArg0 = 0, int32_t lArg1 = 0, int32_t lArg2 = 0);
+
+  // Sends what the UART can take right now.  Returns true if more is waiting.
+  bool Drain(HardwareSerial &Out);
+
+  bool     Pending() const { return _u8Count > 0  ||  _u8OutPos < _u8OutLen; }
+  uint32_t Dropped() const { return _u32TotalDropped; }
+
+protected:
+  void _Format(const tLogRecord &Record);
+
+  tLogRecord _Ring[LOG_RING_SIZE];
+  uint8_t    _u8Head;
+  uint8_t    _u8Count;
+  uint8_t    _u8MinLevel;
+  bool       _bBinary;
+
+  // Dropped since the last LOG_MSG_DROPPED, and ever
+  uint32_t   _u32Dropped;
+  uint32_t   _u32TotalDropped;
+
+  // The record being sent, as text or as a frame, and how far we've got
+  uint8_t    _u8Out[LOG_MAX_LINE];
+  uint8_t    _u8OutLen;
+  uint8_t    _u8OutPos;
+};
+
+extern tLog Log;
+
+#define LOG(eLevel, ...)  do { if ((eLevel) >= Log.Level())  Log.Write((eLevel), __VA_ARGS__); } while (0)
+
+
+#endif   /* LOG_H */
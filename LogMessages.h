@@ -0,0 +1,53 @@
+/***************
+* NTP Clock
+*
+* The log message catalog.  Each entry is a message ID and its printf format.  Only
+* the ID and up to LOG_MAX_ARGS integer arguments go into a log record; the format is
+* applied when the record is printed, either on the device in text mode or by
+* tools/logdecode.py, which reads this file to get the same table.
+*
+* Arguments are always printed as long, so use %ld (with any width or flags) and
+* nothing else.  Add new messages at the end, so old captures still decode.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef LOG_MESSAGES_H
+#define LOG_MESSAGES_H
+
+#define LOG_MESSAGES \
+  LOG_MSG(LOG_MSG_BOOT,               "Boot") \
+  LOG_MSG(LOG_MSG_DROPPED,            "%ld log records dropped") \
+  LOG_MSG(LOG_MSG_TIME,               "%2ld:%02ld:%02ld") \
+  LOG_MSG(LOG_MSG_KEY_PRESS,          "Key %ld pressed") \
+  LOG_MSG(LOG_MSG_KEY_RELEASE,        "Key %ld released") \
+  LOG_MSG(LOG_MSG_KEY_LONG_PRESS,     "Key %ld long press") \
+  LOG_MSG(LOG_MSG_BRIGHTNESS,         "Brightness %ld, est. LED current %ld.%ld mA") \
+  LOG_MSG(LOG_MSG_NTP_PACKET,         "NTP packet received") \
+  LOG_MSG(LOG_MSG_NTP_STEP,           "NTP step %ld s after %ld s") \
+  LOG_MSG(LOG_MSG_WIFI_CONNECTED,     "WiFi connected, channel %ld, RSSI %ld dBm") \
+  LOG_MSG(LOG_MSG_WIFI_LOST,          "WiFi lost, status %ld") \
+  LOG_MSG(LOG_MSG_WIFI_FAILED,        "WiFi connect failed, status %ld, retrying in %ld ms") \
+  LOG_MSG(LOG_MSG_WIFI_CONNECT_TIME,  "WiFi connect took %ld ms, cached %ld") \
+  LOG_MSG(LOG_MSG_WIFI_CACHE_MISS,    "WiFi cached connect failed, status %ld, scanning") \
+  LOG_MSG(LOG_MSG_WIFI_SCAN,          "WiFi scan found %ld access points, best of ours %ld dBm") \
+  LOG_MSG(LOG_MSG_WIFI_TRYING,        "WiFi trying network %ld, RSSI %ld dBm") \
+  LOG_MSG(LOG_MSG_WIFI_FAILOVER,      "WiFi signal weak (%ld dBm), moving from network %ld to %ld") \
+  LOG_MSG(LOG_MSG_ALARM_SET,          "Alarm %ld set, next at %ld") \
+  LOG_MSG(LOG_MSG_ALARM_RING,         "Alarm %ld ringing") \
+  LOG_MSG(LOG_MSG_ALARM_SNOOZE,       "Alarm %ld snoozed until %ld") \
+  LOG_MSG(LOG_MSG_ALARM_OFF,          "Alarm %ld off") \
+  LOG_MSG(LOG_MSG_SETTINGS_LOADED,    "Settings loaded, %ld keys in %ld bytes") \
+  LOG_MSG(LOG_MSG_SETTINGS_DAMAGED,   "Settings damaged at offset %ld, compacting") \
+  LOG_MSG(LOG_MSG_SETTINGS_COMPACTED, "Settings compacted, generation %ld, %ld bytes") \
+  LOG_MSG(LOG_MSG_SETTINGS_NO_ROOM,   "No flash for settings; choose a flash size with a filesystem") \
+  LOG_MSG(LOG_MSG_NTP_LEAP,           "NTP leap second announcement now %ld") \
+  LOG_MSG(LOG_MSG_LEAP_TEST,          "Simulated leap second at %ld") \
+  LOG_MSG(LOG_MSG_SYNC_STATE,         "Sync state %ld, error %ld ms") \
+  LOG_MSG(LOG_MSG_SCHED_FULL,         "Scheduler full at %ld tasks") \
+  LOG_MSG(LOG_MSG_TASK_STATS,         "Task %ld worst run %ld us, worst lateness %ld ms") \
+  LOG_MSG(LOG_MSG_POWER,              "Power est. %ld.%ld mA avg, %ld radio wakes")
+
+#endif   /* LOG_MESSAGES_H */
@@ -8,6 +8,10 @@
 #include "Max6954.h"
 
 #include <SPI.h>
+#include <coredecls.h>
+
+
+volatile bool tMax6954::_bKeyIrq = false;
 
 
 /***************************************
@@ -20,6 +24,13 @@
 tMax6954::tMax6954()
 {
   _u8ConfigRegisterValue = 0;
+  _u8GlobalIntensity     = 0;
+  _pSpiTrace             = NULL;
+  _bStarted              = false;
+  _u8NumKeyLines         = 0;
+  _u32KeysHeld           = 0;
+  _u32LongPressSent      = 0;
+  _ulLastKeyPollMs       = 0;
 }
 
 
@@ -35,6 +46,8 @@ tMax6954::tMax6954()
 void tMax6954::_SetupSPI() 
 {
   MySpi = tMaximBitBangSpi(MAX_SCLK_GPIO, MAX_SDIN_GPIO, MAX_SDOUT_GPIO, MAX_CS_GPIO);
+  MySpi.SetTrace(_pSpiTrace);
+  _bStarted = true;
   
   #if 0
   pinMode(MAX_CS_GPIO, OUTPUT);
@@ -57,10 +70,11 @@ void tMax6954::_SetupSPI()
 * tMax6954::Init 
 *
 * INPUTS:
-*   
+*   NumDigits - for the scan limit
+*   DigitType - MAX6954_DIGIT_TYPE_*, for every digit pair (the geometry's u8DigitType)
 */
 
-void tMax6954::Init(uint8_t NumDigits)
+void tMax6954::Init(uint8_t NumDigits, uint8_t DigitType)
 {
   int i;
   uint8_t bright;
@@ -89,10 +103,10 @@ void tMax6954::Init(uint8_t NumDigits)
   Serial.println(F("Set Scan Limit to 2 digits\n"));
   SetScanLimit(NumDigits);
 
-  // Configure for two 16-segment unencoded digits, aka two 7-segment digit pairs, aka
-  // four 7-segment monocolor digits.
-  SetDigitTypes(MAX6954_DIGIT_TYPE_16_AND_16, MAX6954_DIGIT_TYPE_16_AND_16,
-                MAX6954_DIGIT_TYPE_16_AND_16, MAX6954_DIGIT_TYPE_16_AND_16);
+  // The same digit type for every pair.  16_AND_16 treats each pair as two 7-segment
+  // digits (the LiteOn is two of those pairs, aka four 7-segment monocolor digits);
+  // 14_AND_14 is for panels of 14-segment digits.
+  SetDigitTypes(DigitType, DigitType, DigitType, DigitType);
   SetDecodeMode(0); // No decoding for all 8 digit pairs
   
   // The recommended value of RSET (56K) also sets the peak current to 40mA, which makes the
@@ -119,6 +133,10 @@ void tMax6954::WriteCmd(uint8_t Register, uint8_t Data)
   uint16_t cmd = Register;
   cmd          = cmd << 8 | Data;
 
+  // On a board without the chip, Init() is never called and its pins may be in
+  // use for something else
+  if (!_bStarted)  return;
+
   MySpi.Write16(cmd);
   #if 0
   digitalWrite(MAX_CS_GPIO, LOW);
@@ -146,6 +164,8 @@ void tMax6954::WriteCmd(uint8_t Register, uint8_t Data)
 */
 uint8_t tMax6954::ReadRegister(uint8_t Register)
 {
+  if (!_bStarted)  return 0;
+
   return MySpi.ReadReg(Register);
 
   #if 0
@@ -221,6 +241,43 @@ void tMax6954::WriteConfig(uint8_t u8Flags)
 void tMax6954::SetBrightness(uint8_t uiBrightness)
 {
   WriteCmd(MAX6954_REG_GlobalIntensity, uiBrightness);
+  _u8GlobalIntensity = uiBrightness;
+}
+
+
+/***************************************
+* tMax6954::SetIndividualIntensities
+*
+* Switches between the global intensity register and the per-digit Intensity10..76a
+* registers, leaving the other configuration bits as they were.
+*/
+
+void tMax6954::SetIndividualIntensities(bool bEnable)
+{
+  uint8_t u8Flags = _u8ConfigRegisterValue & ~MAX6954_CFG_GLOBAL_CLEAR_DIGIT_DATA;
+
+  if (bEnable)  u8Flags |=  MAX6954_CFG_USE_INDIVIDUAL_INTENSITIES;
+  else          u8Flags &= ~MAX6954_CFG_USE_INDIVIDUAL_INTENSITIES;
+
+  if (u8Flags != _u8ConfigRegisterValue)  WriteConfig(u8Flags);
+}
+
+
+/***************************************
+* tMax6954::SetBlink
+*
+* Leaves the other configuration bits as they were
+*/
+
+void tMax6954::SetBlink(bool bEnable, bool bFast)
+{
+  uint8_t u8Flags = _u8ConfigRegisterValue & ~(MAX6954_CFG_GLOBAL_CLEAR_DIGIT_DATA |
+                                               MAX6954_CFG_GLOBALBLINK_ENABLE | MAX6954_CFG_BLINKRATE_FAST);
+
+  if (bEnable)  u8Flags |= MAX6954_CFG_GLOBALBLINK_ENABLE;
+  if (bFast)    u8Flags |= MAX6954_CFG_BLINKRATE_FAST;
+
+  if (u8Flags != _u8ConfigRegisterValue)  WriteConfig(u8Flags);
 }
 
 
@@ -322,3 +379,174 @@ void tMax6954::WriteDigit(uint8_t u8Digit, uint8_t u8Planes, uint8_t u8Value)
   
   WriteCmd(RegNum, u8Value);
 }
+
+
+/***************************************
+* tMax6954::SetSpiTrace
+*
+* Attaches a bus recorder (see SpiTrace.h).  We hang on to the pointer because
+* _SetupSPI() replaces the SPI object.
+*
+* INPUTS:
+*   pTrace - the recorder, or NULL to stop recording
+*/
+
+void tMax6954::SetSpiTrace(tSpiTrace *pTrace)
+{
+  _pSpiTrace = pTrace;
+  MySpi.SetTrace(pTrace);
+}
+
+
+/***************************************
+* tMax6954::EnableKeyScan
+*
+* Turns on the chip's key scanner and hooks its IRQ output.  The IRQ line is open
+* drain and active low, so we pull it up and interrupt on the falling edge.
+*
+* INPUTS:
+*   u8NumKeyLines - how many of KEY_A..KEY_D have switches on them (1-4)
+*   iIrqPin       - the ESP8266 GPIO wired to IRQ
+*/
+
+void tMax6954::EnableKeyScan(uint8_t u8NumKeyLines, int iIrqPin)
+{
+  if (u8NumKeyLines > MAX6954_MAX_KEY_LINES)  u8NumKeyLines = MAX6954_MAX_KEY_LINES;
+  _u8NumKeyLines = u8NumKeyLines;
+
+  WriteCmd(MAX6954_REG_PortConfiguration, u8NumKeyLines << MAX6954_PORTCFG_KEYSCAN_SHIFT);
+
+  // Reading the debounce registers clears anything left over from before
+  _ReadKeyRegisters(MAX6954_REG_KEY_A_MSK_Deb);
+
+  pinMode(iIrqPin, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(iIrqPin), _KeyIrqIsr, FALLING);
+}
+
+
+/***************************************
+* tMax6954::_KeyIrqIsr
+*
+* Runs from RAM, and only notes that the chip has something for us.  The bus work
+* happens in ServiceKeys().  esp_schedule() posts to the loop task, so a delay()
+* the loop is sleeping in returns now rather than at its deadline.
+*/
+
+void ICACHE_RAM_ATTR tMax6954::_KeyIrqIsr()
+{
+  _bKeyIrq = true;
+  esp_schedule();
+}
+
+
+/***************************************
+* tMax6954::ServiceKeys
+*
+* Turns the chip's key state into press, release and long-press events.
+*
+* The debounce registers latch new presses and raise IRQ, so new presses cost us
+* nothing until they happen.  The chip does not interrupt on release, though, so
+* while any key is held we poll the Pressed registers every MAX6954_KEY_POLL_MS.
+*
+* INPUTS:
+*   ulNowMs - the current millis()
+*/
+
+void tMax6954::ServiceKeys(uint32_t ulNowMs)
+{
+  uint32_t u32New, u32Down, u32Released;
+  uint8_t  i;
+
+  if (_u8NumKeyLines == 0)  return;
+
+  if (_bKeyIrq) {
+    _bKeyIrq = false;
+    u32New   = _ReadKeyRegisters(MAX6954_REG_KEY_A_MSK_Deb) & ~_u32KeysHeld;
+
+    for (i=0; i<MAX6954_MAX_KEYS; i++) {
+      if (u32New & (1UL << i)) {
+        _ulKeyDownMs[i] = ulNowMs;
+        _KeyEvents.Push(i, KEY_EVENT_PRESS);
+      }
+    }
+    _u32KeysHeld    |= u32New;
+    _ulLastKeyPollMs = ulNowMs;
+  }
+
+  if (_u32KeysHeld == 0)  return;
+  if (ulNowMs - _ulLastKeyPollMs < MAX6954_KEY_POLL_MS)  return;
+  _ulLastKeyPollMs = ulNowMs;
+
+  u32Down     = _ReadKeyRegisters(MAX6954_REG_KEY_A_Pressed);
+  u32Released = _u32KeysHeld & ~u32Down;
+
+  for (i=0; i<MAX6954_MAX_KEYS; i++) {
+    if (!(_u32KeysHeld & (1UL << i)))  continue;
+
+    if (u32Released & (1UL << i)) {
+      _KeyEvents.Push(i, KEY_EVENT_RELEASE);
+    }
+    else if (!(_u32LongPressSent & (1UL << i))  &&
+             ulNowMs - _ulKeyDownMs[i] >= MAX6954_KEY_LONG_PRESS_MS) {
+      _KeyEvents.Push(i, KEY_EVENT_LONG_PRESS);
+      _u32LongPressSent |= 1UL << i;
+    }
+  }
+
+  _u32KeysHeld      &= ~u32Released;
+  _u32LongPressSent &= ~u32Released;
+}
+
+
+/***************************************
+* tMax6954::_ReadKeyRegisters
+*
+* Reads the active key lines starting at u8FirstReg (either the debounce or the
+* pressed block) and packs them into one mask, KEY_A in the low byte.
+*/
+
+uint32_t tMax6954::_ReadKeyRegisters(uint8_t u8FirstReg)
+{
+  uint32_t u32Keys = 0;
+  uint8_t  i;
+
+  for (i=0; i<_u8NumKeyLines; i++)
+    u32Keys |= (uint32_t) ReadRegister(u8FirstReg + i) << (i * MAX6954_KEYS_PER_LINE);
+
+  return u32Keys;
+}
+
+
+/***************************************
+* tKeyEventQueue::Push, Pop
+*
+* RETURNS:
+*   Push - false if the queue was full and the event was dropped
+*   Pop  - false if there was nothing to pop
+*/
+
+bool tKeyEventQueue::Push(uint8_t u8Key, uint8_t u8Type)
+{
+  tKeyEvent *pEvent;
+
+  if (_u8Count >= MAX6954_KEY_QUEUE_SIZE) {
+    _u32Dropped++;
+    return false;
+  }
+
+  pEvent         = &_Events[(_u8Head + _u8Count) % MAX6954_KEY_QUEUE_SIZE];
+  pEvent->u8Key  = u8Key;
+  pEvent->u8Type = u8Type;
+  _u8Count++;
+  return true;
+}
+
+bool tKeyEventQueue::Pop(tKeyEvent &Event)
+{
+  if (_u8Count == 0)  return false;
+
+  Event   = _Events[_u8Head];
+  _u8Head = (_u8Head + 1) % MAX6954_KEY_QUEUE_SIZE;
+  _u8Count--;
+  return true;
+}
@@ -21,6 +21,9 @@
 // D7 == GPIO13 is our MOSI
 #define MAX_SDOUT_GPIO (13)
 
+// D2 == GPIO4 is wired to the MAX6954's open-drain key IRQ output
+#define MAX_IRQ_GPIO   (4)
+
 #include <Arduino.h>
 #include "MaximBitBangSpi.h"
 
@@ -133,13 +136,61 @@
 #define MAX6954_DIGIT_TYPE_16_AND_14  (0x10)
 #define MAX6954_DIGIT_TYPE_14_AND_14  (0x11)
 
+// Port Configuration register.  The top three bits give the number of key-scan
+// return lines (KEY_A through KEY_D) in use; 0 disables key scanning.  When scanning
+// is enabled the chip raises IRQ (active low) whenever a debounced key press is
+// waiting in the KEY_x_MSK_Deb registers, and reading those registers clears it.
+#define MAX6954_PORTCFG_KEYSCAN_SHIFT (5)
+#define MAX6954_MAX_KEY_LINES         (4)
+#define MAX6954_KEYS_PER_LINE         (8)
+#define MAX6954_MAX_KEYS              (MAX6954_MAX_KEY_LINES * MAX6954_KEYS_PER_LINE)
+
+
+/*********************************************
+* Keyscan events
+*/
+
+// How often we poll the Pressed registers, but only while some key is held down.
+// With nothing held, the IRQ line does all the work and we don't touch the bus.
+#define MAX6954_KEY_POLL_MS        (20)
+#define MAX6954_KEY_LONG_PRESS_MS  (1000)
+#define MAX6954_KEY_QUEUE_SIZE     (8)
+
+typedef enum {
+  KEY_EVENT_PRESS,
+  KEY_EVENT_RELEASE,
+  KEY_EVENT_LONG_PRESS
+} KEY_EVENT_TYPE;
+
+struct tKeyEvent {
+  uint8_t u8Key;    // 0-31: line (A=0..D=3) * 8 + scan bit
+  uint8_t u8Type;   // One of KEY_EVENT_TYPE
+};
+
+// A fixed-size ring of key events.  If the app falls behind, new events are dropped
+// (and counted) rather than overwriting ones not yet seen.
+class tKeyEventQueue {
+public:
+  tKeyEventQueue() : _u8Head(0), _u8Count(0), _u32Dropped(0) {}
+
+  bool Push(uint8_t u8Key, uint8_t u8Type);
+  bool Pop(tKeyEvent &Event);
+  uint32_t Dropped() const { return _u32Dropped; }
+
+protected:
+  tKeyEvent _Events[MAX6954_KEY_QUEUE_SIZE];
+  uint8_t   _u8Head;
+  uint8_t   _u8Count;
+  uint32_t  _u32Dropped;
+};
+
 
 // Define a bitfield structure to hold the segment patterns for each digit
 class tMax6954 {
 public:
   tMax6954();
   void _SetupSPI();
-  void Init(uint8_t NumDigits);
+  void Init(uint8_t NumDigits, uint8_t DigitType = MAX6954_DIGIT_TYPE_16_AND_16);
 
   void WriteCmd(uint8_t Register, uint8_t Data);
   uint8_t ReadRegister(uint8_t Register);
@@ -149,13 +200,51 @@ public:
 
   void NoOp();
   void SetBrightness(uint8_t uiBrightness);
+  uint8_t GetBrightness() const { return _u8GlobalIntensity; }
+  void SetIndividualIntensities(bool bEnable);
+
+  // While enabled, the chip alternates between showing plane P0 and plane P1, about
+  // once a second (or four times as fast with bFast).  Digits written the same in
+  // both planes don't blink.
+  void SetBlink(bool bEnable, bool bFast = false);
   void SetDecodeMode(uint8_t uiDecodeFlags);
   void SetDigitTypes(uint8_t DigitTypes76, uint8_t DigitTypes54,
                      uint8_t DigitTypes32, uint8_t DigitTypes10);
   void WriteDigit(uint8_t u8Digit, uint8_t u8Planes, uint8_t u8Value);
 
+  // Records all bus traffic into pTrace.  May be called before or after Init().
+  void SetSpiTrace(tSpiTrace *pTrace);
+
+  // Keyscan.  Call ServiceKeys() from the loop; it is nearly free when no key is down.
+  void EnableKeyScan(uint8_t u8NumKeyLines, int iIrqPin = MAX_IRQ_GPIO);
+  void ServiceKeys(uint32_t ulNowMs);
+  bool GetKeyEvent(tKeyEvent &Event) { return _KeyEvents.Pop(Event); }
+
+  // True while a key is down or a press hasn't been picked up yet, i.e. while
+  // ServiceKeys() needs calling often
+  bool KeysActive() const { return _bKeyIrq || _u32KeysHeld != 0; }
+
+  // Set by the IRQ until ServiceKeys() picks it up.  The IRQ also ends the loop's
+  // delay(), so the loop can look at this straight away.
+  bool KeyIrqPending() const { return _bKeyIrq; }
+
 protected:
+  static void _KeyIrqIsr();
+  uint32_t _ReadKeyRegisters(uint8_t u8FirstReg);
+
   uint8_t _u8ConfigRegisterValue;
+  uint8_t _u8GlobalIntensity;
+  tSpiTrace *_pSpiTrace;
+  bool       _bStarted;        // Init() has set up the bus; until then writes go nowhere
+
+  uint8_t        _u8NumKeyLines;
+  uint32_t       _u32KeysHeld;
+  uint32_t       _u32LongPressSent;
+  uint32_t       _ulKeyDownMs[MAX6954_MAX_KEYS];
+  uint32_t       _ulLastKeyPollMs;
+  tKeyEventQueue _KeyEvents;
+
+  static volatile bool _bKeyIrq;
 
   tMaximBitBangSpi MySpi;
 };
@@ -0,0 +1,114 @@
+/***************
+* NTP Clock
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "Max6954Model.h"
+#include "Max6954.h"
+
+
+/***************************************
+* tMax6954Model constructor
+*
+*/
+
+tMax6954Model::tMax6954Model()
+{
+  Reset();
+}
+
+
+/***************************************
+* tMax6954Model::Reset
+*
+* Puts the register file into its power-up state.  Per the datasheet the part
+* powers up in shutdown with everything zeroed, so that's what we model.
+*/
+
+void tMax6954Model::Reset()
+{
+  memset(_u8Regs,         0, sizeof(_u8Regs));
+  memset(_u32WriteCounts, 0, sizeof(_u32WriteCounts));
+
+  _bReadPending      = false;
+  _u8PendingRead     = 0;
+  _u32ReadMismatches = 0;
+}
+
+
+/***************************************
+* tMax6954Model::Apply
+*
+* Applies one bus transaction.  D15 set means a read, in which case the register's
+* contents come out of DOUT during the following transaction.  Incomplete
+* transactions are ignored, just as the real device ignores them.
+*/
+
+void tMax6954Model::Apply(const tSpiTransaction &Transaction)
+{
+  uint8_t u8Reg  = (Transaction.u16Command >> 8) & 0x7F;
+  uint8_t u8Data =  Transaction.u16Command & 0xFF;
+
+  // If the previous transaction was a read, this one carried the answer.  Check it
+  // against what we think the register holds.
+  if (_bReadPending) {
+    if ((Transaction.u16Response & 0xFF) != _u8PendingRead)  _u32ReadMismatches++;
+    _bReadPending = false;
+  }
+
+  if (Transaction.u8NumBits != 16)  return;
+
+  if (Transaction.u16Command & 0x8000) {
+    _bReadPending  = true;
+    _u8PendingRead = _u8Regs[u8Reg];
+    return;
+  }
+
+  _WriteRegister(u8Reg, u8Data);
+}
+
+
+/***************************************
+* tMax6954Model::_WriteRegister
+*
+*/
+
+void tMax6954Model::_WriteRegister(uint8_t u8Reg, uint8_t u8Data)
+{
+  uint8_t i;
+
+  _u32WriteCounts[u8Reg]++;
+  _u8Regs[u8Reg] = u8Data;
+
+  // Writes to the 0x60 block go to both planes at once
+  if (u8Reg >= MAX6954_REG_Digit0_PlanesP0P1 && u8Reg <= MAX6954_REG_Digit7a_PlanesP0P1) {
+    _u8Regs[u8Reg - MAX6954_REG_Digit0_PlanesP0P1 + MAX6954_REG_Digit0_PlaneP0] = u8Data;
+    _u8Regs[u8Reg - MAX6954_REG_Digit0_PlanesP0P1 + MAX6954_REG_Digit0_PlaneP1] = u8Data;
+  }
+
+  // The global clear bit wipes both planes of every digit
+  if (u8Reg == MAX6954_REG_Configuration  &&  (u8Data & MAX6954_CFG_GLOBAL_CLEAR_DIGIT_DATA)) {
+    for (i=0; i<16; i++) {
+      _u8Regs[MAX6954_REG_Digit0_PlaneP0    + i] = 0;
+      _u8Regs[MAX6954_REG_Digit0_PlaneP1    + i] = 0;
+      _u8Regs[MAX6954_REG_Digit0_PlanesP0P1 + i] = 0;
+    }
+  }
+}
+
+
+/***************************************
+* tMax6954Model::DigitPlane
+*
+* INPUTS:
+*   u8Digit - 0-7 for digits 0-7, 8-15 for digits 0a-7a
+*   u8Plane - 0 or 1
+*/
+
+uint8_t tMax6954Model::DigitPlane(uint8_t u8Digit, uint8_t u8Plane) const
+{
+  uint8_t u8Base = (u8Plane == 0) ? MAX6954_REG_Digit0_PlaneP0 : MAX6954_REG_Digit0_PlaneP1;
+  return _u8Regs[u8Base + (u8Digit & 0x0F)];
+}
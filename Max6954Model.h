@@ -0,0 +1,55 @@
+/***************
+* NTP Clock
+*
+* tMax6954Model is a simulated MAX6954 register file.  Feed it the transactions decoded
+* by a tSpiTrace and it tracks what the real chip's registers should contain, so that
+* the expected state of the display can be checked without the physical board.
+*
+* Only the behavior we rely on is modeled: plain register writes, the combined
+* "both planes" digit addresses, the global-clear bit of the configuration register,
+* and the two-transaction read protocol.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef MAX6954_MODEL_H
+#define MAX6954_MODEL_H
+
+#include <Arduino.h>
+#include "SpiTrace.h"
+
+#define MAX6954_MODEL_NUM_REGISTERS (128)
+
+
+class tMax6954Model {
+public:
+  tMax6954Model();
+
+  void Reset();
+  void Apply(const tSpiTransaction &Transaction);
+
+  uint8_t  Register(uint8_t u8Reg) const { return _u8Regs[u8Reg & 0x7F]; }
+  uint32_t WriteCount(uint8_t u8Reg) const { return _u32WriteCounts[u8Reg & 0x7F]; }
+
+  // Digit data, 0-15 where 8-15 are the "a" digits, for plane 0 or 1
+  uint8_t  DigitPlane(uint8_t u8Digit, uint8_t u8Plane) const;
+
+  // What the device would clock out of DOUT during the next transaction
+  uint8_t  PendingReadValue() const { return _u8PendingRead; }
+  uint32_t ReadMismatches()   const { return _u32ReadMismatches; }
+
+protected:
+  void _WriteRegister(uint8_t u8Reg, uint8_t u8Data);
+
+  uint8_t  _u8Regs[MAX6954_MODEL_NUM_REGISTERS];
+  uint32_t _u32WriteCounts[MAX6954_MODEL_NUM_REGISTERS];
+
+  bool     _bReadPending;
+  uint8_t  _u8PendingRead;
+  uint32_t _u32ReadMismatches;
+};
+
+
+#endif   /* MAX6954_MODEL_H */
@@ -6,6 +6,7 @@
 */
 
 #include "MaximBitBangSpi.h"
+#include "Probe.h"
 
 
 
@@ -20,7 +21,8 @@ tMaximBitBangSpi::tMaximBitBangSpi(int ClkPin, int DinPin, int DoPin, int CsPin)
   _ClkPin(ClkPin),
   _DinPin(DinPin),
   _DoPin (DoPin ),
-  _CsPin (CsPin )
+  _CsPin (CsPin ),
+  _pTrace(NULL)
 {
   pinMode(ClkPin, OUTPUT);
   pinMode(CsPin,  OUTPUT);
@@ -56,13 +58,14 @@ uint16_t tMaximBitBangSpi::Write16(uint16_t x)
   int i;
   uint8_t BitIn;
   uint16_t response = 0;
+  PROBE_SCOPE(PROBE_SPI_WRITE16);
 
   // CLK should already be low, but just in case it's not:
-  digitalWrite(_ClkPin, LOW);
+  _PinWrite(_ClkPin, SPI_SIGNAL_CLK, LOW);
   MAXIM_LOGIC_DELAY;
 
   // Take CS low
-  digitalWrite(_CsPin, LOW);
+  _PinWrite(_CsPin, SPI_SIGNAL_CS, LOW);
   MAXIM_LOGIC_DELAY;
 
   // Clock out bits 15..1
@@ -72,17 +75,17 @@ uint16_t tMaximBitBangSpi::Write16(uint16_t x)
 
     // If this was the last bit, take CS high before returning CLK to low
     if (i == 0) {
-        digitalWrite(_CsPin, HIGH);
+        _PinWrite(_CsPin, SPI_SIGNAL_CS, HIGH);
         MAXIM_LOGIC_DELAY;
     }
 
-    digitalWrite(_ClkPin, LOW);
+    _PinWrite(_ClkPin, SPI_SIGNAL_CLK, LOW);
     MAXIM_LOGIC_DELAY;
   }
 
   // Take the clock pin high again, so that we can take it low to start a new cycle
   MAXIM_LOGIC_DELAY;
-  digitalWrite(_ClkPin, HIGH);
+  _PinWrite(_ClkPin, SPI_SIGNAL_CLK, HIGH);
 
   MAXIM_LOGIC_DELAY;
   
@@ -105,13 +108,13 @@ uint8_t tMaximBitBangSpi::_ClockOutBit(uint8_t bit)
 {
   uint8_t BitIn;
 
-  digitalWrite(_DoPin, bit);
+  _PinWrite(_DoPin, SPI_SIGNAL_DIN, bit);
   MAXIM_LOGIC_DELAY;
 
-  digitalWrite(_ClkPin, HIGH);
+  _PinWrite(_ClkPin, SPI_SIGNAL_CLK, HIGH);
   MAXIM_LOGIC_DELAY;
 
-  BitIn = digitalRead(_DinPin);
+  BitIn = _PinRead(_DinPin, SPI_SIGNAL_DOUT);
 
   return BitIn;
 }
@@ -146,3 +149,24 @@ uint8_t tMaximBitBangSpi::ReadReg(uint8_t reg)
 
   return response & 0xff;
 }
+
+
+/***************************************
+* tMaximBitBangSpi::_PinWrite, _PinRead
+*
+* All bus pin traffic goes through here so that an attached tSpiTrace sees it.
+* Signal is one of SPI_SIGNAL, naming the pin from the MAX6954's point of view.
+*/
+
+void tMaximBitBangSpi::_PinWrite(int Pin, uint8_t Signal, uint8_t Level)
+{
+  digitalWrite(Pin, Level);
+  if (_pTrace != NULL)  _pTrace->RecordEdge(Signal, Level);
+}
+
+uint8_t tMaximBitBangSpi::_PinRead(int Pin, uint8_t Signal)
+{
+  uint8_t Level = digitalRead(Pin);
+  if (_pTrace != NULL)  _pTrace->RecordEdge(Signal, Level);
+  return Level;
+}
@@ -12,24 +12,32 @@
 #define MAX_CS_GPIO (5)
 
 #include <Arduino.h>
+#include "SpiTrace.h"
 
 #define MAXIM_LOGIC_DELAY delayMicroseconds(1)
 
 
 class tMaximBitBangSpi {
 public:
-  tMaximBitBangSpi() {}
+  tMaximBitBangSpi() : _pTrace(NULL) {}
   tMaximBitBangSpi(int ClkPin, int DinPin, int DoPin, int CsPin);
   uint16_t Write16(uint16_t x);
   uint8_t ReadReg(uint8_t reg);
 
+  // Attach a recorder that sees every edge we drive.  Pass NULL to detach.
+  void SetTrace(tSpiTrace *pTrace) { _pTrace = pTrace; }
+
 protected:
   uint8_t _ClockOutBit(uint8_t bit);
+  void    _PinWrite(int Pin, uint8_t Signal, uint8_t Level);
+  uint8_t _PinRead (int Pin, uint8_t Signal);
 
   int _ClkPin;
   int _DinPin;
   int _DoPin;
   int _CsPin;
+
+  tSpiTrace *_pTrace;
 };
 
 
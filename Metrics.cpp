@@ -0,0 +1,312 @@
+/***************
+* NTP Clock
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "Metrics.h"
+#include "Log.h"
+
+
+/***************************************
+* tMetrics constructor
+*
+*/
+
+tMetrics::tMetrics(tNtp &Ntp, tTimebase &Timebase, const tScheduler &Scheduler, const tWiFiConnection &WiFiConnection,
+                   uint16_t u16HttpPort) :
+  _Ntp(Ntp),
+  _Timebase(Timebase),
+  _Scheduler(Scheduler),
+  _WiFiConnection(WiFiConnection),
+  _Server(u16HttpPort)
+{
+  _u8State         = METRICS_IDLE;
+  _ulClientMs      = 0;
+  _u8RequestLen    = 0;
+  _bInRequestLine  = true;
+  _bLineEmpty      = true;
+  _u16PushPort     = 0;
+  _u32PushPeriodMs = 0;
+  _ulLastPushMs    = 0;
+  _u16OutLen       = 0;
+  _u16OutPos       = 0;
+}
+
+
+/***************************************
+* tMetrics::Begin
+*
+*/
+
+void tMetrics::Begin()
+{
+  _Server.begin();
+}
+
+
+/***************************************
+* tMetrics::SetPush
+*
+*/
+
+void tMetrics::SetPush(IPAddress Ip, uint16_t u16Port, uint32_t u32PeriodMs)
+{
+  _PushIp          = Ip;
+  _u16PushPort     = u16Port;
+  _u32PushPeriodMs = u32PeriodMs;
+  _ulLastPushMs    = millis();
+}
+
+
+/***************************************
+* tMetrics::Service
+*
+* INPUTS:
+*   ulNowMs - the current millis()
+* RETURNS:
+*   true if a client is being served
+*/
+
+bool tMetrics::Service(uint32_t ulNowMs)
+{
+  switch (_u8State) {
+    case METRICS_IDLE:     _Accept(ulNowMs);  break;
+    case METRICS_READING:  _Read(ulNowMs);    break;
+    case METRICS_SENDING:  _Send();           break;
+  }
+
+  if (_u8State != METRICS_IDLE  &&  ulNowMs - _ulClientMs > METRICS_CLIENT_TIMEOUT_MS)  _Close();
+
+  // The push shares the reply buffer, so it waits for any scrape to finish
+  if (_u32PushPeriodMs != 0  &&  _u8State == METRICS_IDLE  &&
+      ulNowMs - _ulLastPushMs >= _u32PushPeriodMs) {
+    _ulLastPushMs = ulNowMs;
+    _Push();
+  }
+
+  return _u8State != METRICS_IDLE;
+}
+
+
+/***************************************
+* tMetrics::_Accept
+*
+*/
+
+void tMetrics::_Accept(uint32_t ulNowMs)
+{
+  _Client = _Server.available();
+  if (!_Client)  return;
+
+  // Don't let write() wait for the data to be acknowledged
+  _Client.setNoDelay(true);
+  _Client.setSync(false);
+
+  _u8State        = METRICS_READING;
+  _ulClientMs     = ulNowMs;
+  _u8RequestLen   = 0;
+  _bInRequestLine = true;
+  _bLineEmpty     = true;
+}
+
+
+/***************************************
+* tMetrics::_Read
+*
+* Takes whatever the client has sent so far, keeping the start of the request
+* line and throwing away the headers.  The blank line after the headers ends the
+* request, and then the reply is rendered.
+*/
+
+void tMetrics::_Read(uint32_t ulNowMs)
+{
+  static const char sOk[]       = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                                  "Connection: close\r\n\r\n";
+  static const char sNotFound[] = "HTTP/1.0 404 Not Found\r\nConnection: close\r\n\r\n";
+  int c;
+
+  while ((c = _Client.read()) >= 0) {
+    if (c == '\r')  continue;
+
+    if (c != '\n') {
+      if (_bInRequestLine  &&  _u8RequestLen < METRICS_REQUEST_MAX - 1)  _sRequest[_u8RequestLen++] = c;
+      _bLineEmpty = false;
+      continue;
+    }
+
+    if (!_bLineEmpty  ||  _bInRequestLine) {
+      _bInRequestLine = false;
+      _bLineEmpty     = true;
+      continue;
+    }
+
+    // End of the headers
+    _sRequest[_u8RequestLen] = '\0';
+    _u16OutPos = 0;
+    if (strncmp(_sRequest, "GET /metrics ", 13) == 0  ||  strncmp(_sRequest, "GET / ", 6) == 0) {
+      _u16OutLen = strlcpy(_sOut, sOk, sizeof(_sOut));
+      _Render();
+    }
+    else {
+      _u16OutLen = strlcpy(_sOut, sNotFound, sizeof(_sOut));
+    }
+
+    _u8State    = METRICS_SENDING;
+    _ulClientMs = ulNowMs;
+    _Send();
+    return;
+  }
+
+  if (!_Client.connected())  _Close();
+}
+
+
+/***************************************
+* tMetrics::_Send
+*
+* Writes no more than the TCP send buffer has room for, so write() never has to
+* wait for the client to acknowledge anything
+*/
+
+void tMetrics::_Send()
+{
+  int iRoom = _Client.availableForWrite();
+
+  if (!_Client.connected()) {
+    _Close();
+    return;
+  }
+
+  if (iRoom > _u16OutLen - _u16OutPos)  iRoom = _u16OutLen - _u16OutPos;
+  if (iRoom > 0) {
+    _Client.write((const uint8_t *) &_sOut[_u16OutPos], iRoom);
+    _u16OutPos += iRoom;
+  }
+
+  if (_u16OutPos >= _u16OutLen)  _Close();
+}
+
+
+/***************************************
+* tMetrics::_Close
+*
+* The stack sends whatever is still queued after the close, so there's no need to
+* wait for it here
+*/
+
+void tMetrics::_Close()
+{
+  _Client.stop(1);
+  _u8State = METRICS_IDLE;
+}
+
+
+/***************************************
+* tMetrics::_Push
+*
+*/
+
+void tMetrics::_Push()
+{
+  if (!_WiFiConnection.IsConnected())  return;
+
+  _u16OutLen = 0;
+  _Render();
+
+  _Udp.beginPacket(_PushIp, _u16PushPort);
+  _Udp.write((const uint8_t *) _sOut, _u16OutLen);
+  _Udp.endPacket();
+}
+
+
+/***************************************
+* tMetrics::_Render
+*
+* Appends every metric to _sOut
+*/
+
+void tMetrics::_Render()
+{
+  const tNtpStats &NtpStats = _Ntp.Stats();
+  uint32_t         u32Runs = 0, u32LateMs = 0, u32MaxLateMs = 0;
+  uint8_t          i;
+
+  _Add("clock_uptime_seconds",             millis() / 1000);
+
+  _Add("clock_ntp_offset_ms",              NtpStats.lOffsetMs);
+  _Add("clock_ntp_delay_ms",               NtpStats.lDelayMs);
+  _Add("clock_ntp_jitter_ms",              NtpStats.lJitterMs);
+  _Add("clock_ntp_sync_age_seconds",       _Ntp.LastSyncTime() ? (long) (now() - _Ntp.LastSyncTime()) : -1);
+  _Add("clock_ntp_requests_total",         NtpStats.u32Sent);
+  _Add("clock_ntp_replies_total",          NtpStats.u32Received);
+  _Add("clock_ntp_rejected_total",         NtpStats.u32Rejected);
+  _Add("clock_ntp_lost_total",             NtpStats.u32Lost);
+
+  _Add("clock_sync_state",                 _Ntp.SyncState());
+  _Add("clock_time_error_ms",              _Timebase.IsSet() ? (long) _Timebase.ErrorMs() : -1);
+  _Add("clock_time_holdover_seconds",      _Timebase.HoldoverMs() / 1000);
+  _Add("clock_freq_correction_ppb",        _Timebase.FreqPpb());
+
+  _Add("clock_wifi_connected",             _WiFiConnection.IsConnected());
+  _Add("clock_wifi_rssi_dbm",              _WiFiConnection.IsConnected() ? WiFi.RSSI() : 0);
+  _Add("clock_wifi_reconnects_total",      _WiFiConnection.Reconnects());
+  _Add("clock_wifi_drops_total",           _WiFiConnection.Drops());
+  _Add("clock_wifi_connect_ms",            _WiFiConnection.LastConnectMs());
+  _Add("clock_wifi_connect_cached",        _WiFiConnection.LastConnectCached());
+  _Add("clock_wifi_network",               _WiFiConnection.Network());
+  _Add("clock_wifi_failovers_total",       _WiFiConnection.Failovers());
+
+  _Add("clock_heap_free_bytes",            ESP.getFreeHeap());
+  _Add("clock_heap_max_block_bytes",       ESP.getMaxFreeBlockSize());
+  _Add("clock_heap_fragmentation_percent", ESP.getHeapFragmentation());
+
+  _Add("clock_log_dropped_total",          Log.Dropped());
+
+  for (i=0; i<_Scheduler.NumTasks(); i++) {
+    const tTaskStats &Stats = _Scheduler.Stats(i);
+
+    _AddTask("clock_task_late_avg_ms", i, Stats.u32Runs ? Stats.u32TotalLateMs / Stats.u32Runs : 0);
+    _AddTask("clock_task_late_max_ms", i, Stats.u32MaxLateMs);
+
+    u32Runs   += Stats.u32Runs;
+    u32LateMs += Stats.u32TotalLateMs;
+    if (Stats.u32MaxLateMs > u32MaxLateMs)  u32MaxLateMs = Stats.u32MaxLateMs;
+  }
+  _Add("clock_loop_late_avg_ms",           u32Runs ? u32LateMs / u32Runs : 0);
+  _Add("clock_loop_late_max_ms",           u32MaxLateMs);
+}
+
+
+/***************************************
+* tMetrics::_Add
+*
+*/
+
+void tMetrics::_Add(const char *sName, long lValue)
+{
+  int iLen;
+
+  if (_u16OutLen >= sizeof(_sOut))  return;
+
+  iLen = snprintf(&_sOut[_u16OutLen], sizeof(_sOut) - _u16OutLen, "%s %ld\n", sName, lValue);
+
+  // A line that didn't fit is left off, whole
+  if (iLen > 0  &&  _u16OutLen + iLen < (int) sizeof(_sOut))  _u16OutLen += iLen;
+  else                                                         _sOut[_u16OutLen] = '\0';
+}
+
+
+/***************************************
+* tMetrics::_AddTask
+*
+*/
+
+void tMetrics::_AddTask(const char *sName, uint8_t u8Task, long lValue)
+{
+  char sLabelled[64];
+
+  snprintf(sLabelled, sizeof(sLabelled), "%s{task=\"%s\"}", sName, _Scheduler.TaskName(u8Task));
+  _Add(sLabelled, lValue);
+}
@@ -0,0 +1,102 @@
+/***************
+* NTP Clock
+*
+* tMetrics publishes the clock's health for fleet monitoring: NTP offset, delay,
+* jitter, sync age and packet counts, the sync state, the timebase's frequency
+* correction and error estimate, WiFi signal and reconnects, how late the
+* scheduler's tasks run, and the heap.  The format is the Prometheus text format,
+* one "name value" line per metric, e.g.
+*
+*   clock_ntp_offset_ms 3
+*   clock_task_late_max_ms{task="second"} 1
+*
+* It is served over HTTP (GET /metrics, or just /) and, if a collector address is
+* set, also sent to it as a UDP datagram every so often.
+*
+* Nothing here waits on the network.  Service() moves a scrape along one step at a
+* time: read what the client has sent so far, then write only as much of the reply
+* as the TCP send buffer has room for.  The reply is rendered into a buffer once,
+* when the request is complete, so a slow client costs memory, not time.  One
+* client is served at a time; others wait in the listen backlog.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <ESP8266WiFi.h>
+#include <WiFiUdp.h>
+#include "Ntp.h"
+#include "Timebase.h"
+#include "Scheduler.h"
+#include "WiFiConnection.h"
+
+#define METRICS_BUF_SIZE           (3072)    // Room for SCHED_MAX_TASKS tasks
+#define METRICS_REQUEST_MAX        (40)      // Bytes of the request line we keep
+#define METRICS_CLIENT_TIMEOUT_MS  (2000)
+
+typedef enum {
+  METRICS_IDLE,
+  METRICS_READING,
+  METRICS_SENDING
+} METRICS_STATE;
+
+
+class tMetrics {
+public:
+  tMetrics(tNtp &Ntp, tTimebase &Timebase, const tScheduler &Scheduler, const tWiFiConnection &WiFiConnection,
+           uint16_t u16HttpPort);
+
+  // Starts listening.  The server binds to any address, so WiFi needn't be up yet.
+  void Begin();
+
+  // Sends the metrics to Ip:u16Port every u32PeriodMs.  A period of 0 stops it.
+  void SetPush(IPAddress Ip, uint16_t u16Port, uint32_t u32PeriodMs);
+
+  // Returns true while a client is being served, so the caller can poll faster
+  bool Service(uint32_t ulNowMs);
+
+protected:
+  void _Accept(uint32_t ulNowMs);
+  void _Read(uint32_t ulNowMs);
+  void _Send();
+  void _Close();
+  void _Push();
+
+  void _Render();
+  void _Add(const char *sName, long lValue);
+  void _AddTask(const char *sName, uint8_t u8Task, long lValue);
+
+  tNtp             &_Ntp;
+  tTimebase        &_Timebase;
+  const tScheduler &_Scheduler;
+  const tWiFiConnection &_WiFiConnection;
+
+  WiFiServer     _Server;
+  WiFiClient     _Client;
+  uint8_t        _u8State;
+  uint32_t       _ulClientMs;
+
+  // The request line, and whether the header line being read is empty so far
+  char           _sRequest[METRICS_REQUEST_MAX];
+  uint8_t        _u8RequestLen;
+  bool           _bInRequestLine;
+  bool           _bLineEmpty;
+
+  WiFiUDP        _Udp;
+  IPAddress      _PushIp;
+  uint16_t       _u16PushPort;
+  uint32_t       _u32PushPeriodMs;
+  uint32_t       _ulLastPushMs;
+
+  // The reply being sent, and how much of it has gone
+  char           _sOut[METRICS_BUF_SIZE];
+  uint16_t       _u16OutLen;
+  uint16_t       _u16OutPos;
+};
+
+
+#endif   /* METRICS_H */
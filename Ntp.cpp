@@ -6,6 +6,8 @@
 */
 
 #include "Ntp.h"
+#include "Log.h"
+#include "Probe.h"
 
 
 
@@ -14,14 +16,26 @@
 * 
 */
 
-tNtp::tNtp(const char *sTimeServerHostNameOrIp, unsigned int uiLocalPort,
+tNtp::tNtp(tTimebase &Timebase, const char *sTimeServerHostNameOrIp, unsigned int uiLocalPort,
            time_t tQueryIntervalInSeconds) :
+  _Timebase(Timebase),
   _tQueryIntervalInSeconds(tQueryIntervalInSeconds),
   _sTimeServerHostNameOrIp(sTimeServerHostNameOrIp)
 {
   _Udp.begin(uiLocalPort);
 
-  _tNextQueryTime = 0;
+  _tNextQueryTime    = 0;
+  _tCurTimeUtc       = 0;
+  _bOnline           = true;
+  _bAwaitingResponse = false;
+  _lLastStepSeconds  = 0;
+  _tLastSyncTime     = 0;
+  _i64SentNtpMs      = 0;
+  _u64SentUs         = 0;
+  _u32JitterSqMs     = 0;
+  _u8LastLi          = NTP_LI_NONE;
+  memset(_u8SentStamp, 0, sizeof(_u8SentStamp));
+  memset(&_Stats, 0, sizeof(_Stats));
 }
 
 
@@ -33,22 +47,88 @@ tNtp::tNtp(const char *sTimeServerHostNameOrIp, unsigned int uiLocalPort,
 
 time_t tNtp::GetUtcTime()
 {
+  PROBE_SCOPE(PROBE_NTP_GET_UTC);
+
+  if (!_bOnline) {
+    _tCurTimeUtc = _Now();
+    return _tCurTimeUtc;
+  }
+
   // If a new packet has been received, take note of it
   _GetResponse();
 
+  if (_bAwaitingResponse  &&  _Timebase.MonotonicUs() - _u64SentUs > NTP_REPLY_TIMEOUT_MS * 1000ULL) {
+    _bAwaitingResponse = false;
+    _Stats.u32Lost++;
+  }
+
   if (_tCurTimeUtc >= _tNextQueryTime) {
     // Don't blast packets if we don't hear back.  Wait at least
     // this many seconds before sending another one.
     _tNextQueryTime = _tCurTimeUtc + NTP_MIN_QUERY_INTERVAL_SECONDS; 
     _SendRequest();
+    _bAwaitingResponse = true;
   }
 
-  // Ask TimeLib for the time
-  _tCurTimeUtc = now();
+  _tCurTimeUtc = _Now();
   return _tCurTimeUtc;
 }
 
 
+/*****************************************
+* tNtp::SetOnline
+* 
+* A request still outstanding when we go offline won't be answered
+*/
+
+void tNtp::SetOnline(bool bOnline)
+{
+  if (!bOnline  &&  _bAwaitingResponse) {
+    _bAwaitingResponse = false;
+    _Stats.u32Lost++;
+  }
+  _bOnline = bOnline;
+}
+
+
+/*****************************************
+* tNtp::_Now
+* 
+* The timebase's time once it's set, since it knows about leap seconds and is
+* frequency corrected; TimeLib's before.  TimeLib is kept in step with it, for
+* everything else that calls now(); setting it from here, just after the second
+* has turned over, also lines its seconds up with the real ones.
+*/
+
+time_t tNtp::_Now()
+{
+  time_t tNow;
+
+  if (!_Timebase.IsSet())  return now();
+
+  tNow = (time_t) (_Timebase.UtcMs() / 1000);
+  if (tNow != now())  setTime(tNow);
+  return tNow;
+}
+
+
+/*****************************************
+* tNtp::SyncState
+* 
+*/
+
+NTP_SYNC_STATE tNtp::SyncState()
+{
+  if (!_Timebase.IsSet())                        return NTP_SYNC_UNSYNCED;
+  if (_Timebase.ErrorMs() > NTP_STALE_ERROR_MS)  return NTP_SYNC_STALE;
+
+  if (_Timebase.HoldoverMs() / 1000 > (uint32_t) _tQueryIntervalInSeconds * NTP_HOLDOVER_QUERIES) {
+    return NTP_SYNC_HOLDOVER;
+  }
+  return NTP_SYNC_SYNCED;
+}
+
+
 /*****************************************
 * tNtp::SendRequest
 * 
@@ -71,12 +151,20 @@ void tNtp::_SendRequest()
   _PacketBuffer[14]  = 49;
   _PacketBuffer[15]  = 52;
 
+  // T1.  The server sends it back as the originate timestamp, which both gives us
+  // the round trip and tells us the reply is to this request.
+  _i64SentNtpMs = _LocalNtpMs();
+  _u64SentUs    = _Timebase.MonotonicUs();
+  _WriteTimestampMs(40, _i64SentNtpMs);
+  memcpy(_u8SentStamp, &_PacketBuffer[40], sizeof(_u8SentStamp));
+
   /*** Send the NTP request ***/
   //_Udp.beginPacket(_IpAddress, 123); //NTP requests are to port 123
   _Udp.beginPacket(_sTimeServerHostNameOrIp, 123); //NTP requests are to port 123
   
   _Udp.write(_PacketBuffer, NTP_PACKET_SIZE);
   _Udp.endPacket();
+  _Stats.u32Sent++;
 }
 
 
@@ -85,42 +173,85 @@ void tNtp::_SendRequest()
 * 
 * Check for and process any incoming NTP packets
 *
+* With T1 when we sent the request, T2 when the server got it, T3 when the server
+* replied and T4 when the reply got here, the round trip is (T4-T1) - (T3-T2) and
+* our clock is behind by ((T2-T1) + (T3-T4)) / 2.  T1 and T4 come from the
+* timebase, which between syncs is the server time at the last sync carried
+* forward by its frequency-corrected clock, so the offset is how far that has
+* wandered since then.  The timebase is synced to T4 plus the offset, to within
+* half the round trip (we can't tell which way the delay was).
+*
 * RETURNS:
 *   true if a NTP packet has been received
 *   false if not
 * SIDE EFFECTS:
-* 
+*   Sets TimeLib's clock and updates the stats
 */
 
 bool tNtp::_GetResponse() 
 {
+  int64_t  i64T2, i64T3, i64T4, i64ServerNowMs;
+  long     lOffsetMs, lDelayMs, lChangeMs;
+  uint32_t u32RoundTripMs, u32ErrorMs;
+  int8_t   i8Leap;
+  uint8_t  u8Li;
+
   if (_Udp.parsePacket()) {
-    Serial.println(F("packet received"));
+    LOG(LOG_DEBUG, LOG_MSG_NTP_PACKET);
     // We've received a packet, read the data from it
-    _Udp.read(_PacketBuffer, NTP_PACKET_SIZE); // read the packet into the buffer
+    i64T4          = _LocalNtpMs();
+    u32RoundTripMs = (_Timebase.MonotonicUs() - _u64SentUs) / 1000;
+    if (_Udp.read(_PacketBuffer, NTP_PACKET_SIZE) < NTP_PACKET_SIZE  ||  !_CheckResponse()) {
+      _Stats.u32Rejected++;
+      return false;
+    }
 
-    //the timestamp starts at byte 40 of the received packet and is four bytes,
-    // or two words, long. First, esxtract the two words:
+    i64T2 = _ReadTimestampMs(32);
+    i64T3 = _ReadTimestampMs(40);
 
-    unsigned long highWord = word(_PacketBuffer[40], _PacketBuffer[41]);
-    unsigned long lowWord  = word(_PacketBuffer[42], _PacketBuffer[43]);
-    
-    // combine the four bytes (two words) into a long integer
-    // this is NTP time (seconds since Jan 1 1900):
-    unsigned long secsSince1900 = highWord << 16 | lowWord;
-    //Serial.print(F("Seconds since Jan 1 1900 = "));
-    //Serial.println(secsSince1900);
-
-    // now convert NTP time into everyday time:
-    //Serial.print(F("Unix time = "));
-    // Unix time starts on Jan 1 1970. In seconds, that's 2208988800:
-    const unsigned long seventyYears = 2208988800UL;
-    // subtract seventy years:
-    unsigned long epoch = secsSince1900 - seventyYears;
-    // print Unix time:
-    //Serial.println(epoch);
-
-    // Inform the Time library
+    lDelayMs  = (long) ((i64T4 - _i64SentNtpMs) - (i64T3 - i64T2));
+    lOffsetMs = (long) (((i64T2 - _i64SentNtpMs) + (i64T3 - i64T4)) / 2);
+
+    // Before the first sync, T1 and T4 were only whole seconds, so the stats start
+    // with the second reply, and the jitter with the third
+    if (_tLastSyncTime != 0) {
+      if (_Stats.u32Received >= 2) {
+        lChangeMs = lOffsetMs - _Stats.lOffsetMs;
+        if (lChangeMs < 0)                   lChangeMs = -lChangeMs;
+        if (lChangeMs > NTP_MAX_JITTER_MS)   lChangeMs = NTP_MAX_JITTER_MS;
+        _u32JitterSqMs  += ((int32_t) (lChangeMs * lChangeMs) - (int32_t) _u32JitterSqMs) / 4;
+        _Stats.lJitterMs = (long) sqrt((double) _u32JitterSqMs);
+      }
+      _Stats.lOffsetMs = lOffsetMs;
+      _Stats.lDelayMs  = lDelayMs;
+    }
+    _Stats.u32Received++;
+
+    // Carry the server's time forward from here.  That's T3 plus the trip back,
+    // taken as half the round trip less the server's turnaround.  The round trip
+    // comes from the monotonic clock, which unlike T1 and T4 is good to the
+    // millisecond even before the first sync, so this is right to within half the
+    // network delay from the very first reply.
+    i64ServerNowMs = (i64T2 + i64T3 + u32RoundTripMs) / 2;
+    u32ErrorMs     = max((long) u32RoundTripMs - (long) (i64T3 - i64T2), 0L) / 2;
+
+    // The leap indicator is the top two bits
+    u8Li   = _PacketBuffer[0] >> 6;
+    i8Leap = u8Li == NTP_LI_INSERT ? TIMEBASE_LEAP_INSERT :
+             u8Li == NTP_LI_DELETE ? TIMEBASE_LEAP_DELETE :
+                                     TIMEBASE_LEAP_NONE;
+    if (u8Li != _u8LastLi)  LOG(LOG_INFO, LOG_MSG_NTP_LEAP, i8Leap);
+    _u8LastLi = u8Li;
+
+    _Timebase.Sync(i64ServerNowMs - (int64_t) NTP_SEVENTY_YEARS * 1000, u32ErrorMs, i8Leap);
+
+    // now convert NTP time into everyday time.  Unix time starts on Jan 1 1970.
+    unsigned long epoch = (unsigned long) (i64ServerNowMs / 1000) - NTP_SEVENTY_YEARS;
+
+    // Note how far off we were, then inform the Time library
+    _lLastStepSeconds  = (long) (epoch - now());
+    _tLastSyncTime     = epoch;
+    _bAwaitingResponse = false;
     setTime(epoch);
 
     // And advance the "next query time".  
@@ -131,3 +262,78 @@ bool tNtp::_GetResponse()
   
   return false;
 }
+
+
+/*****************************************
+* tNtp::_CheckResponse
+* 
+* RETURNS:
+*   true if the packet in _PacketBuffer is a server reply (mode 4) from a
+*   synchronized server (stratum 1-15, and no alarm in the leap indicator) to our
+*   outstanding request
+*/
+
+bool tNtp::_CheckResponse()
+{
+  if ((_PacketBuffer[0] & 0x07) != 4)                          return false;
+  if ((_PacketBuffer[0] >> 6) == NTP_LI_ALARM)                 return false;
+  if (_PacketBuffer[1] == 0  ||  _PacketBuffer[1] > 15)         return false;
+  if (!_bAwaitingResponse)                                      return false;
+  if (memcmp(&_PacketBuffer[24], _u8SentStamp, sizeof(_u8SentStamp)) != 0)  return false;
+
+  return true;
+}
+
+
+/*****************************************
+* tNtp::_LocalNtpMs
+* 
+* Before the first sync, all we have is TimeLib's seconds.
+*/
+
+int64_t tNtp::_LocalNtpMs() const
+{
+  if (!_Timebase.IsSet())  return ((int64_t) now() + NTP_SEVENTY_YEARS) * 1000;
+
+  return _Timebase.UtcMs() + (int64_t) NTP_SEVENTY_YEARS * 1000;
+}
+
+
+/*****************************************
+* tNtp::_ReadTimestampMs
+* 
+* Reads the 64-bit NTP timestamp (32 bits of seconds since 1900, 32 bits of
+* fraction) at u8Offset in _PacketBuffer
+*/
+
+int64_t tNtp::_ReadTimestampMs(uint8_t u8Offset) const
+{
+  uint32_t u32Seconds  = 0;
+  uint32_t u32Fraction = 0;
+  uint8_t  i;
+
+  for (i=0; i<4; i++) {
+    u32Seconds  = (u32Seconds  << 8) | _PacketBuffer[u8Offset + i];
+    u32Fraction = (u32Fraction << 8) | _PacketBuffer[u8Offset + 4 + i];
+  }
+
+  return (int64_t) u32Seconds * 1000 + (((uint64_t) u32Fraction * 1000) >> 32);
+}
+
+
+/*****************************************
+* tNtp::_WriteTimestampMs
+* 
+*/
+
+void tNtp::_WriteTimestampMs(uint8_t u8Offset, int64_t i64Ms)
+{
+  uint32_t u32Seconds  = i64Ms / 1000;
+  uint32_t u32Fraction = (((uint64_t) (i64Ms % 1000)) << 32) / 1000;
+  uint8_t  i;
+
+  for (i=0; i<4; i++) {
+    _PacketBuffer[u8Offset + i]     = u32Seconds  >> (24 - 8*i);
+    _PacketBuffer[u8Offset + 4 + i] = u32Fraction >> (24 - 8*i);
+  }
+}
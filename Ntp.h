@@ -9,32 +9,117 @@
 #ifndef INC_NTP_H
 #define INC_NTP_H
 
-#include <ESP8266WiFi.h>
 #include <WiFiUdp.h>
 
 #include <TimeLib.h>
+#include "Timebase.h"
 
 
 #define NTP_MIN_QUERY_INTERVAL_SECONDS (10)
 
+// A reply that hasn't come in this long after the request won't; the request is
+// counted as lost and we stop watching for it
+#define NTP_REPLY_TIMEOUT_MS (2000)
+
+// How much to trust the time.  Holdover is once NTP_HOLDOVER_QUERIES queries in a
+// row have gone unanswered; stale is once the timebase's error estimate says the
+// seconds shown may be wrong, however recently we synced.
+#define NTP_HOLDOVER_QUERIES (2)
+#define NTP_STALE_ERROR_MS   (500)
+
+typedef enum {
+  NTP_SYNC_UNSYNCED,        // Never had a reply
+  NTP_SYNC_SYNCED,
+  NTP_SYNC_HOLDOVER,
+  NTP_SYNC_STALE
+} NTP_SYNC_STATE;
+
 // NTP time stamp is in the first 48 bytes of the message
 #define NTP_PACKET_SIZE (48)
 
+// The leap indicator, in the top two bits of the first byte: a second is to be
+// added or taken away at the end of the month, or the server isn't synchronized
+#define NTP_LI_NONE   (0)
+#define NTP_LI_INSERT (1)
+#define NTP_LI_DELETE (2)
+#define NTP_LI_ALARM  (3)
+
+// Unix time starts on Jan 1 1970. In seconds since NTP's epoch (Jan 1 1900), that's
+#define NTP_SEVENTY_YEARS (2208988800UL)
+
+// A change in offset bigger than this is a step, not jitter, and only counts this much
+#define NTP_MAX_JITTER_MS (10000L)
+
+// Sync health, for the metrics.  The offset is how far our clock was off when the
+// last reply came in (positive if we were slow) and the delay is the round trip,
+// both worked out from the four NTP timestamps to the millisecond.  The jitter is
+// the RMS change in offset from one sync to the next.
+struct tNtpStats {
+  uint32_t u32Sent;
+  uint32_t u32Received;    // Good replies
+  uint32_t u32Rejected;    // Replies that were malformed, unsynchronized or not ours
+  uint32_t u32Lost;        // Requests that never got a reply
+  long     lOffsetMs;
+  long     lDelayMs;
+  long     lJitterMs;
+};
+
 class tNtp {
 public:
-  //tNtp(IPAddress &IpAddress, unsigned int uiLocalPort);
-  tNtp(const char *sTimeServerHostNameOrIp, unsigned int uiLocalPort,
+friend class tBench;        // Times the reply parsing on a made-up packet
+  // Each reply syncs Timebase, which also keeps our time between replies
+  //tNtp(tTimebase &Timebase, IPAddress &IpAddress, unsigned int uiLocalPort);
+  tNtp(tTimebase &Timebase, const char *sTimeServerHostNameOrIp, unsigned int uiLocalPort,
        time_t tQueryIntervalInSeconds = 300);
 
   time_t GetUtcTime();
 
+  // While offline (e.g. the radio is powered down) GetUtcTime() neither sends nor
+  // listens, it just returns the time
+  void   SetOnline(bool bOnline);
+
+  // For deciding when the network has to be up
+  long   SecondsUntilQuery() const { return (long) (_tNextQueryTime - now()); }
+  bool   AwaitingResponse()  const { return _bAwaitingResponse; }
+
+  // How far TimeLib's clock had drifted when the last reply came in, in seconds
+  // (positive if we were slow), and when that was.  0 if we've never synced.
+  long   LastStepSeconds() const { return _lLastStepSeconds; }
+  time_t LastSyncTime()    const { return _tLastSyncTime; }
+
+  const tNtpStats &Stats() const { return _Stats; }
+
+  NTP_SYNC_STATE SyncState();
+
 protected:
   void _SendRequest();
   bool _GetResponse();
+  bool _CheckResponse();
+  time_t _Now();
 
+  // Our clock in milliseconds since 1900, from the timebase once it's set
+  int64_t  _LocalNtpMs() const;
+  int64_t  _ReadTimestampMs(uint8_t u8Offset) const;
+  void     _WriteTimestampMs(uint8_t u8Offset, int64_t i64Ms);
+
+  tTimebase   &_Timebase;
   time_t       _tQueryIntervalInSeconds;
   time_t       _tNextQueryTime;
   time_t       _tCurTimeUtc;
+  bool         _bOnline;
+  bool         _bAwaitingResponse;
+  long         _lLastStepSeconds;
+  time_t       _tLastSyncTime;
+
+  // T1, the time we sent the outstanding request, and the same by the monotonic clock
+  int64_t      _i64SentNtpMs;
+  uint64_t     _u64SentUs;
+  uint8_t      _u8SentStamp[8];
+
+  uint8_t      _u8LastLi;     // The leap indicator in the last reply
+
+  tNtpStats    _Stats;
+  uint32_t     _u32JitterSqMs;
 
   const char  *_sTimeServerHostNameOrIp;
   WiFiUDP      _Udp;  // A UDP instance to let us send and receive packets over UDP
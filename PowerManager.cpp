@@ -0,0 +1,248 @@
+/***************
+* NTP Clock
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "PowerManager.h"
+
+
+// Typical ESP8266 supply current in each state, in tenths of a mA.  The sleep
+// figures are the datasheet's (modem sleep 15 mA, light sleep 0.9 mA) plus an
+// allowance for waking at each DTIM beacon to stay associated.
+static const uint16_t _StateCurrentMa10[POWER_NUM_STATES] = {
+  700,    // POWER_STATE_AWAKE
+  180,    // POWER_STATE_MODEM_SLEEP
+   40,    // POWER_STATE_LIGHT_SLEEP
+  150     // POWER_STATE_RADIO_OFF: CPU idling in delay(), modem off
+};
+
+static const char * const _StateNames[POWER_NUM_STATES] = {
+  "awake", "modem sleep", "light sleep", "radio off"
+};
+
+
+/***************************************
+* tPowerManager constructor
+*
+*/
+
+tPowerManager::tPowerManager()
+{
+  _u8Mode                = POWER_MODE_AWAKE;
+  _bRadioOffBetweenSyncs = false;
+  _u8Radio               = RADIO_ON;
+  _ulRadioChangeMs       = 0;
+  _ulRetryAfterMs        = 0;
+
+  ResetStats(0);
+}
+
+
+/***************************************
+* tPowerManager::SetMode
+*
+*/
+
+void tPowerManager::SetMode(POWER_MODE eMode)
+{
+  static const WiFiSleepType_t SleepTypes[POWER_NUM_MODES] = {
+    WIFI_NONE_SLEEP, WIFI_MODEM_SLEEP, WIFI_LIGHT_SLEEP
+  };
+
+  if (eMode >= POWER_NUM_MODES)  return;
+
+  _Account(millis());
+  _u8Mode = eMode;
+  WiFi.setSleepMode(SleepTypes[eMode]);
+}
+
+
+/***************************************
+* tPowerManager::SetRadioOffBetweenSyncs
+*
+*/
+
+void tPowerManager::SetRadioOffBetweenSyncs(bool bOff, uint32_t ulNowMs)
+{
+  _Account(ulNowMs);
+  _bRadioOffBetweenSyncs = bOff;
+
+  // tWiFiConnection reconnects the station once RadioOn() says it may
+  if (!bOff  &&  _u8Radio != RADIO_ON) {
+    WiFi.forceSleepWake();
+    _u8Radio         = RADIO_ON;
+    _ulRadioChangeMs = ulNowMs;
+  }
+}
+
+
+/***************************************
+* tPowerManager::Service
+*
+* With the radio kept off between syncs, this runs a small state machine:
+* off -> waking (until the station reconnects) -> on (until the network isn't
+* needed any more) -> off.  A wake that doesn't connect in time, or an exchange
+* that drags on, turns the radio off and holds it off for POWER_RADIO_RETRY_MS so a
+* dead network can't keep it on.
+*
+* INPUTS:
+*   bNetworkNeeded - true if something wants the network
+*   ulNowMs        - the current millis()
+* RETURNS:
+*   true if the station is connected and the radio is up
+*/
+
+bool tPowerManager::Service(bool bNetworkNeeded, uint32_t ulNowMs)
+{
+  _Account(ulNowMs);
+
+  if (!_bRadioOffBetweenSyncs)  return WiFi.isConnected();
+
+  switch (_u8Radio) {
+    case RADIO_OFF:
+      if (bNetworkNeeded  &&  (int32_t) (ulNowMs - _ulRetryAfterMs) >= 0) {
+        WiFi.forceSleepWake();
+        _u8Radio         = RADIO_WAKING;
+        _ulRadioChangeMs = ulNowMs;
+        _u32RadioWakes++;
+      }
+      break;
+
+    case RADIO_WAKING:
+      if (WiFi.isConnected()) {
+        _u8Radio         = RADIO_ON;
+        _ulRadioChangeMs = ulNowMs;
+      }
+      else if (ulNowMs - _ulRadioChangeMs > POWER_RADIO_CONNECT_TIMEOUT_MS) {
+        _u32FailedWakes++;
+        _RadioOff(ulNowMs);
+        _ulRetryAfterMs = ulNowMs + POWER_RADIO_RETRY_MS;
+      }
+      break;
+
+    case RADIO_ON:
+    default:
+      if (!bNetworkNeeded) {
+        _RadioOff(ulNowMs);
+      }
+      else if (ulNowMs - _ulRadioChangeMs > POWER_RADIO_MAX_ON_MS) {
+        _RadioOff(ulNowMs);
+        _ulRetryAfterMs = ulNowMs + POWER_RADIO_RETRY_MS;
+      }
+      break;
+  }
+
+  return _u8Radio == RADIO_ON  &&  WiFi.isConnected();
+}
+
+
+/***************************************
+* tPowerManager::_RadioOff
+*
+*/
+
+void tPowerManager::_RadioOff(uint32_t ulNowMs)
+{
+  WiFi.forceSleepBegin();
+  _u8Radio         = RADIO_OFF;
+  _ulRadioChangeMs = ulNowMs;
+}
+
+
+/***************************************
+* tPowerManager::_State
+*
+*/
+
+POWER_STATE tPowerManager::_State() const
+{
+  if (_u8Radio == RADIO_OFF)  return POWER_STATE_RADIO_OFF;
+
+  switch (_u8Mode) {
+    case POWER_MODE_MODEM_SLEEP:  return POWER_STATE_MODEM_SLEEP;
+    case POWER_MODE_LIGHT_SLEEP:  return POWER_STATE_LIGHT_SLEEP;
+    default:                      return POWER_STATE_AWAKE;
+  }
+}
+
+
+/***************************************
+* tPowerManager::_Account
+*
+* Charges the time since the last call to whatever state we've been in.  Called
+* before anything that changes state.
+*/
+
+void tPowerManager::_Account(uint32_t ulNowMs)
+{
+  _u32MsInState[_State()] += ulNowMs - _ulLastAccountMs;
+  _ulLastAccountMs         = ulNowMs;
+}
+
+
+/***************************************
+* tPowerManager::EstimatedCurrentMa10
+*
+*/
+
+uint16_t tPowerManager::EstimatedCurrentMa10(uint32_t ulNowMs)
+{
+  uint64_t u64Charge = 0;
+  uint32_t u32TotalMs = 0;
+  uint8_t  i;
+
+  _Account(ulNowMs);
+
+  for (i=0; i<POWER_NUM_STATES; i++) {
+    u64Charge  += (uint64_t) _u32MsInState[i] * _StateCurrentMa10[i];
+    u32TotalMs += _u32MsInState[i];
+  }
+
+  return u32TotalMs ? u64Charge / u32TotalMs : _StateCurrentMa10[_State()];
+}
+
+
+/***************************************
+* tPowerManager::PrintReport
+*
+*/
+
+void tPowerManager::PrintReport(Print &Out, uint32_t ulNowMs)
+{
+  uint16_t u16Ma10 = EstimatedCurrentMa10(ulNowMs);
+  uint8_t  i;
+
+  Out.print(F("Power: est. "));
+  Out.print(u16Ma10 / 10.0, 1);
+  Out.print(F(" mA avg;"));
+  for (i=0; i<POWER_NUM_STATES; i++) {
+    if (_u32MsInState[i] == 0)  continue;
+    Out.print(' ');
+    Out.print(_StateNames[i]);
+    Out.print(' ');
+    Out.print(_u32MsInState[i] / 1000);
+    Out.print('s');
+  }
+  Out.print(F("; radio wakes "));
+  Out.print(_u32RadioWakes);
+  Out.print(F(", failed "));
+  Out.println(_u32FailedWakes);
+}
+
+
+/***************************************
+* tPowerManager::ResetStats
+*
+*/
+
+void tPowerManager::ResetStats(uint32_t ulNowMs)
+{
+  uint8_t i;
+
+  for (i=0; i<POWER_NUM_STATES; i++)  _u32MsInState[i] = 0;
+  _ulLastAccountMs = ulNowMs;
+  _u32RadioWakes   = 0;
+  _u32FailedWakes  = 0;
+}
@@ -0,0 +1,105 @@
+/***************
+* NTP Clock
+*
+* tPowerManager decides how much of the ESP8266 is awake.  The MAX6954 refreshes the
+* display on its own, so between second ticks the ESP8266 has nothing to do, and it
+* only needs the network for an NTP exchange every few minutes.
+*
+* The mode sets the WiFi sleep type, which governs what the SDK does while we sit in
+* delay() between scheduler deadlines:
+*
+*   POWER_MODE_AWAKE        - radio always listening (how the clock used to run)
+*   POWER_MODE_MODEM_SLEEP  - stays associated, radio off between DTIM beacons
+*   POWER_MODE_LIGHT_SLEEP  - as modem sleep, and the CPU is suspended too, woken
+*                             by the next timer, i.e. the next scheduler deadline
+*                             (tScheduler::Idle() is one delay() all the way to it)
+*
+* On top of any mode, SetRadioOffBetweenSyncs() powers the radio down completely
+* and only brings it back (and lets the station reconnect) when Service() is told
+* the network is needed.
+*
+* We can't measure supply current from the chip, so the report is an estimate: the
+* time spent in each state times a typical current for that state.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+
+typedef enum {
+  POWER_MODE_AWAKE,
+  POWER_MODE_MODEM_SLEEP,
+  POWER_MODE_LIGHT_SLEEP,
+  POWER_NUM_MODES
+} POWER_MODE;
+
+// Where the time goes, for the current estimate
+typedef enum {
+  POWER_STATE_AWAKE,
+  POWER_STATE_MODEM_SLEEP,
+  POWER_STATE_LIGHT_SLEEP,
+  POWER_STATE_RADIO_OFF,
+  POWER_NUM_STATES
+} POWER_STATE;
+
+// Longest we'll wait for the station to reconnect after waking the radio, and the
+// longest we'll keep it up for one exchange, before giving up and trying later
+#define POWER_RADIO_CONNECT_TIMEOUT_MS  (15000)
+#define POWER_RADIO_MAX_ON_MS           (30000)
+#define POWER_RADIO_RETRY_MS            (60000)
+
+
+class tPowerManager {
+public:
+  tPowerManager();
+
+  void       SetMode(POWER_MODE eMode);
+  POWER_MODE Mode() const { return (POWER_MODE) _u8Mode; }
+
+  void SetRadioOffBetweenSyncs(bool bOff, uint32_t ulNowMs);
+
+  // Call regularly.  bNetworkNeeded says whether anything wants the network now or
+  // shortly.  Returns true if it is usable.
+  bool Service(bool bNetworkNeeded, uint32_t ulNowMs);
+
+  // False while the radio is powered down, when nobody should try to connect
+  bool RadioOn() const { return _u8Radio != RADIO_OFF; }
+
+  // Average over the time since ResetStats(), in tenths of a mA, ESP8266 only
+  uint16_t EstimatedCurrentMa10(uint32_t ulNowMs);
+  uint32_t RadioWakes() const { return _u32RadioWakes; }
+
+  void PrintReport(Print &Out, uint32_t ulNowMs);
+  void ResetStats(uint32_t ulNowMs);
+
+protected:
+  typedef enum {
+    RADIO_ON,
+    RADIO_WAKING,
+    RADIO_OFF
+  } RADIO;
+
+  void        _Account(uint32_t ulNowMs);
+  POWER_STATE _State() const;
+  void        _RadioOff(uint32_t ulNowMs);
+
+  uint8_t       _u8Mode;
+  bool          _bRadioOffBetweenSyncs;
+  uint8_t       _u8Radio;
+  uint32_t      _ulRadioChangeMs;
+  uint32_t      _ulRetryAfterMs;
+
+  uint32_t      _ulLastAccountMs;
+  uint32_t      _u32MsInState[POWER_NUM_STATES];
+  uint32_t      _u32RadioWakes;
+  uint32_t      _u32FailedWakes;
+};
+
+
+#endif   /* POWER_MANAGER_H */
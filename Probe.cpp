@@ -0,0 +1,123 @@
+/***************
+* NTP Clock
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "Probe.h"
+
+#ifdef PROBES_ENABLED
+
+#define PROBE(Id, Name)  Name,
+static const char * const _ProbeNames[PROBE_NUM_PROBES] = {
+  PROBES
+};
+#undef PROBE
+
+tProbes Probes;
+
+
+/***************************************
+* tProbes constructor
+*
+*/
+
+tProbes::tProbes()
+{
+  Reset();
+}
+
+
+/***************************************
+* tProbes::Reset
+*
+*/
+
+void tProbes::Reset()
+{
+  uint8_t i;
+
+  memset(_Stats, 0, sizeof(_Stats));
+  for (i=0; i<PROBE_NUM_PROBES; i++)  _Stats[i].u32MinCycles = 0xFFFFFFFF;
+}
+
+
+/***************************************
+* tProbes::Percentile
+*
+* Walks the histogram to the bucket holding the run that u8Percent of all runs
+* are no slower than.  The bucket's top is clamped to the slowest run actually
+* seen, so a probe with a single bucket reports its true max.
+*
+* RETURNS:
+*   Cycles, or 0 if the probe hasn't run
+*/
+
+uint32_t tProbes::Percentile(uint8_t u8Probe, uint8_t u8Percent) const
+{
+  const tProbeStats &Stats = _Stats[u8Probe];
+  uint32_t           u32Rank;
+  uint32_t           u32Seen = 0;
+  uint32_t           u32Top;
+  uint8_t            i;
+
+  if (Stats.u32Count == 0)  return 0;
+
+  u32Rank = ((uint64_t) Stats.u32Count * u8Percent + 99) / 100;
+  if (u32Rank == 0)  u32Rank = 1;
+
+  for (i=0; i<PROBE_NUM_BUCKETS; i++) {
+    u32Seen += Stats.u32Buckets[i];
+    if (u32Seen >= u32Rank)  break;
+  }
+
+  u32Top = i >= 31 ? 0xFFFFFFFF : (2UL << i) - 1;
+  if (u32Top > Stats.u32MaxCycles)  u32Top = Stats.u32MaxCycles;
+  if (u32Top < Stats.u32MinCycles)  u32Top = Stats.u32MinCycles;
+  return u32Top;
+}
+
+
+/***************************************
+* tProbes::PrintReport
+*
+* All figures are in CPU cycles; the header says how many make a microsecond.
+*/
+
+void tProbes::PrintReport(Print &Out, bool bHistograms) const
+{
+  char    sLine[100];
+  uint8_t i, j;
+
+  Out.print(F("Probe cycles, "));
+  Out.print(ESP.getCpuFreqMHz());
+  Out.println(F(" per us"));
+  Out.println(F("Probe               Count      Min      Avg      p50      p90      p99      Max"));
+
+  for (i=0; i<PROBE_NUM_PROBES; i++) {
+    const tProbeStats &Stats = _Stats[i];
+
+    snprintf(sLine, sizeof(sLine), "%-16s %8lu %8lu %8lu %8lu %8lu %8lu %8lu",
+             _ProbeNames[i],
+             (unsigned long) Stats.u32Count,
+             (unsigned long) (Stats.u32Count ? Stats.u32MinCycles : 0),
+             (unsigned long) (Stats.u32Count ? Stats.u64TotalCycles / Stats.u32Count : 0),
+             (unsigned long) Percentile(i, 50),
+             (unsigned long) Percentile(i, 90),
+             (unsigned long) Percentile(i, 99),
+             (unsigned long) Stats.u32MaxCycles);
+    Out.println(sLine);
+
+    if (!bHistograms)  continue;
+
+    for (j=0; j<PROBE_NUM_BUCKETS; j++) {
+      if (Stats.u32Buckets[j] == 0)  continue;
+      snprintf(sLine, sizeof(sLine), "  %10lu+ %8lu",
+               (unsigned long) (1UL << j), (unsigned long) Stats.u32Buckets[j]);
+      Out.println(sLine);
+    }
+  }
+}
+
+#endif   /* PROBES_ENABLED */
@@ -0,0 +1,110 @@
+/***************
+* NTP Clock
+*
+* Timing probes for the hot paths.  A probe counts CPU cycles (ESP.getCycleCount(),
+* 80 or 160 per microsecond) from where PROBE_SCOPE() appears to the end of the
+* enclosing block, and files the result in a log2 histogram: bucket n counts the
+* runs that took 2^n to 2^(n+1)-1 cycles.  Each probe also keeps its count, total,
+* min and max, and the percentiles are read off the histogram, so they're only
+* good to a factor of two, but cost nothing to keep.
+*
+* Recording is a handful of instructions (the bucket is found with the CPU's
+* count-leading-zeros instruction).  Without PROBES_ENABLED the macro is empty and
+* none of this is compiled in.  The probes aren't interrupt safe, so don't put one
+* in an ISR or in anything called from one.
+*
+* Add probes to the PROBES list below.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef PROBE_H
+#define PROBE_H
+
+#include <Arduino.h>
+
+// Uncomment to compile the probes in.  This has to be here rather than in the
+// sketch, since every file with a probe in it needs to see it.
+//#define PROBES_ENABLED
+
+#define PROBES \
+  PROBE(PROBE_DISPLAY_UPDATE,  "Display.Update") \
+  PROBE(PROBE_SPI_WRITE16,     "Spi.Write16") \
+  PROBE(PROBE_UTC_TO_LOCAL,    "UtcToLocal") \
+  PROBE(PROBE_NTP_GET_UTC,     "Ntp.GetUtcTime")
+
+#define PROBE_NUM_BUCKETS  (32)
+
+#define PROBE(Id, Name)  Id,
+typedef enum {
+  PROBES
+  PROBE_NUM_PROBES
+} PROBE_ID;
+#undef PROBE
+
+
+#ifdef PROBES_ENABLED
+
+struct tProbeStats {
+  uint32_t u32Count;
+  uint64_t u64TotalCycles;
+  uint32_t u32MinCycles;
+  uint32_t u32MaxCycles;
+  uint32_t u32Buckets[PROBE_NUM_BUCKETS];
+};
+
+
+class tProbes {
+public:
+  tProbes();
+
+  void Record(uint8_t u8Probe, uint32_t u32Cycles)
+  {
+    tProbeStats &Stats = _Stats[u8Probe];
+
+    Stats.u32Count++;
+    Stats.u64TotalCycles += u32Cycles;
+    if (u32Cycles < Stats.u32MinCycles)  Stats.u32MinCycles = u32Cycles;
+    if (u32Cycles > Stats.u32MaxCycles)  Stats.u32MaxCycles = u32Cycles;
+    Stats.u32Buckets[u32Cycles ? 31 - __builtin_clz(u32Cycles) : 0]++;
+  }
+
+  const tProbeStats &Stats(uint8_t u8Probe) const { return _Stats[u8Probe]; }
+
+  // Upper bound of the bucket holding the u8Percent'th percentile run, in cycles
+  uint32_t Percentile(uint8_t u8Probe, uint8_t u8Percent) const;
+
+  // A table of every probe, and with bHistograms, their non-empty buckets
+  void PrintReport(Print &Out, bool bHistograms = false) const;
+  void Reset();
+
+protected:
+  tProbeStats _Stats[PROBE_NUM_PROBES];
+};
+
+extern tProbes Probes;
+
+
+// Times the rest of the enclosing block
+class tProbeScope {
+public:
+  tProbeScope(uint8_t u8Probe) : _u8Probe(u8Probe), _u32Start(ESP.getCycleCount()) { }
+  ~tProbeScope() { Probes.Record(_u8Probe, ESP.getCycleCount() - _u32Start); }
+
+protected:
+  uint8_t  _u8Probe;
+  uint32_t _u32Start;
+};
+
+#define PROBE_SCOPE(Id)  tProbeScope _ProbeScope(Id)
+
+#else
+
+#define PROBE_SCOPE(Id)
+
+#endif   /* PROBES_ENABLED */
+
+
+#endif   /* PROBE_H */
@@ -0,0 +1,283 @@
+/***************
+* NTP Clock
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "Scheduler.h"
+
+
+/***************************************
+* tScheduler constructor
+*
+*/
+
+tScheduler::tScheduler()
+{
+  _u8NumTasks   = 0;
+  _u8HeapSize   = 0;
+  _iRunning     = SCHED_NO_TASK;
+  _bRescheduled = false;
+}
+
+
+/***************************************
+* tScheduler::AddTask
+*
+* INPUTS:
+*   sName          - for PrintStats().  Must stay valid.
+*   pfnTask, pArg  - what to call
+*   ulPeriodMs     - time between runs, or 0 for one-shot
+*   ulFirstDelayMs - time until the first run
+* RETURNS:
+*   The task ID, or SCHED_NO_TASK
+*/
+
+int tScheduler::AddTask(const char *sName, tTaskFn pfnTask, void *pArg, uint32_t ulPeriodMs,
+                        uint32_t ulFirstDelayMs)
+{
+  tTask *pTask;
+
+  if (_u8NumTasks >= SCHED_MAX_TASKS)  return SCHED_NO_TASK;
+
+  pTask = &_Tasks[_u8NumTasks];
+  pTask->sName      = sName;
+  pTask->pfnTask    = pfnTask;
+  pTask->pArg       = pArg;
+  pTask->ulPeriodMs = ulPeriodMs;
+  pTask->ulDueMs    = millis() + ulFirstDelayMs;
+  memset(&pTask->Stats, 0, sizeof(pTask->Stats));
+
+  _u8HeapPos[_u8NumTasks] = SCHED_NOT_QUEUED;
+  _Push(_u8NumTasks);
+
+  return _u8NumTasks++;
+}
+
+
+/***************************************
+* tScheduler::Reschedule
+*
+*/
+
+void tScheduler::Reschedule(int iTask, uint32_t ulDelayMs)
+{
+  uint8_t u8Pos;
+
+  if (iTask < 0  ||  iTask >= _u8NumTasks)  return;
+
+  _Tasks[iTask].ulDueMs = millis() + ulDelayMs;
+
+  // A running task isn't in the heap.  Run() puts it back when it returns.
+  if (iTask == _iRunning) {
+    _bRescheduled = true;
+    return;
+  }
+
+  u8Pos = _u8HeapPos[iTask];
+  if (u8Pos == SCHED_NOT_QUEUED) {
+    _Push(iTask);
+  }
+  else {
+    _SiftUp(u8Pos);
+    _SiftDown(_u8HeapPos[iTask]);
+  }
+}
+
+
+/***************************************
+* tScheduler::Run
+*
+* Pops each due task off the heap, runs it and puts it back with its next deadline.
+* The count guard stops a task that reschedules itself for "now" from running more
+* than once per call.
+*/
+
+void tScheduler::Run()
+{
+  tTask        *pTask;
+  uint8_t       u8Task, u8Count;
+  uint32_t      ulNowMs;
+  uint32_t      u32LateMs, u32StartUs, u32Us;
+
+  for (u8Count=0; u8Count<_u8NumTasks  &&  _u8HeapSize>0; u8Count++) {
+    ulNowMs = millis();
+    u8Task  = _u8Heap[0];
+    pTask   = &_Tasks[u8Task];
+
+    if ((int32_t) (ulNowMs - pTask->ulDueMs) < 0)  break;
+
+    _Remove(0);
+    u32LateMs     = ulNowMs - pTask->ulDueMs;
+    _iRunning     = u8Task;
+    _bRescheduled = false;
+
+    u32StartUs = micros();
+    pTask->pfnTask(pTask->pArg);
+    u32Us      = micros() - u32StartUs;
+
+    _iRunning = SCHED_NO_TASK;
+
+    pTask->Stats.u32Runs++;
+    pTask->Stats.u32TotalUs     += u32Us;
+    pTask->Stats.u32TotalLateMs += u32LateMs;
+    if (u32Us     > pTask->Stats.u32MaxUs)      pTask->Stats.u32MaxUs     = u32Us;
+    if (u32LateMs > pTask->Stats.u32MaxLateMs)  pTask->Stats.u32MaxLateMs = u32LateMs;
+
+    if (!_bRescheduled) {
+      if (pTask->ulPeriodMs == 0)  continue;
+
+      pTask->ulDueMs += pTask->ulPeriodMs;
+      if ((int32_t) (millis() - pTask->ulDueMs) >= 0)  pTask->ulDueMs = millis() + pTask->ulPeriodMs;
+    }
+    _Push(u8Task);
+  }
+}
+
+
+/***************************************
+* tScheduler::MsUntilNext
+*
+*/
+
+uint32_t tScheduler::MsUntilNext() const
+{
+  long lMs;
+
+  if (_u8HeapSize == 0)  return SCHED_MAX_IDLE_MS;
+
+  lMs = (int32_t) (_Tasks[_u8Heap[0]].ulDueMs - millis());
+  return lMs > 0 ? lMs : 0;
+}
+
+
+/***************************************
+* tScheduler::Idle
+*
+*/
+
+void tScheduler::Idle()
+{
+  uint32_t u32Ms = MsUntilNext();
+
+  // Even with nothing to wait for, give the SDK a look in
+  if (u32Ms == 0) {
+    yield();
+    return;
+  }
+
+  delay(u32Ms);
+}
+
+
+/***************************************
+* tScheduler::PrintStats
+*
+* One line per task: runs, average and worst run time, average and worst lateness
+*/
+
+void tScheduler::PrintStats(Print &Out) const
+{
+  const tTaskStats *pStats;
+  uint8_t           i;
+
+  Out.println(F("Task         Runs   Avg us   Max us  Avg late  Max late"));
+  for (i=0; i<_u8NumTasks; i++) {
+    char sLine[80];
+
+    pStats = &_Tasks[i].Stats;
+    snprintf(sLine, sizeof(sLine), "%-10s %6lu %8lu %8lu %9lu %9lu",
+             _Tasks[i].sName,
+             (unsigned long) pStats->u32Runs,
+             (unsigned long) (pStats->u32Runs ? pStats->u32TotalUs / pStats->u32Runs : 0),
+             (unsigned long) pStats->u32MaxUs,
+             (unsigned long) (pStats->u32Runs ? pStats->u32TotalLateMs / pStats->u32Runs : 0),
+             (unsigned long) pStats->u32MaxLateMs);
+    Out.println(sLine);
+  }
+}
+
+
+/***************************************
+* tScheduler::ResetStats
+*
+*/
+
+void tScheduler::ResetStats()
+{
+  uint8_t i;
+
+  for (i=0; i<_u8NumTasks; i++)  memset(&_Tasks[i].Stats, 0, sizeof(_Tasks[i].Stats));
+}
+
+
+/***************************************
+* Heap helpers
+*
+* Standard binary min-heap on the tasks' deadlines, compared with wraparound-safe
+* subtraction so it keeps working when millis() rolls over.
+*/
+
+bool tScheduler::_Before(uint8_t u8TaskA, uint8_t u8TaskB) const
+{
+  return (int32_t) (_Tasks[u8TaskA].ulDueMs - _Tasks[u8TaskB].ulDueMs) < 0;
+}
+
+void tScheduler::_Swap(uint8_t u8PosA, uint8_t u8PosB)
+{
+  uint8_t u8Task = _u8Heap[u8PosA];
+
+  _u8Heap[u8PosA] = _u8Heap[u8PosB];
+  _u8Heap[u8PosB] = u8Task;
+  _u8HeapPos[_u8Heap[u8PosA]] = u8PosA;
+  _u8HeapPos[_u8Heap[u8PosB]] = u8PosB;
+}
+
+void tScheduler::_SiftUp(uint8_t u8Pos)
+{
+  uint8_t u8Parent;
+
+  while (u8Pos > 0) {
+    u8Parent = (u8Pos - 1) / 2;
+    if (!_Before(_u8Heap[u8Pos], _u8Heap[u8Parent]))  break;
+    _Swap(u8Pos, u8Parent);
+    u8Pos = u8Parent;
+  }
+}
+
+void tScheduler::_SiftDown(uint8_t u8Pos)
+{
+  uint8_t u8Child, u8Smallest;
+
+  for (;;) {
+    u8Smallest = u8Pos;
+    u8Child    = 2 * u8Pos + 1;
+    if (u8Child   < _u8HeapSize  &&  _Before(_u8Heap[u8Child],   _u8Heap[u8Smallest]))  u8Smallest = u8Child;
+    if (u8Child+1 < _u8HeapSize  &&  _Before(_u8Heap[u8Child+1], _u8Heap[u8Smallest]))  u8Smallest = u8Child+1;
+    if (u8Smallest == u8Pos)  break;
+    _Swap(u8Pos, u8Smallest);
+    u8Pos = u8Smallest;
+  }
+}
+
+void tScheduler::_Push(uint8_t u8Task)
+{
+  _u8Heap[_u8HeapSize]  = u8Task;
+  _u8HeapPos[u8Task]    = _u8HeapSize;
+  _SiftUp(_u8HeapSize++);
+}
+
+void tScheduler::_Remove(uint8_t u8Pos)
+{
+  uint8_t u8Task  = _u8Heap[u8Pos];
+  uint8_t u8Moved = _u8Heap[--_u8HeapSize];
+
+  // Move the last entry into the hole, then let it find its level
+  if (u8Pos != _u8HeapSize) {
+    _Swap(u8Pos, _u8HeapSize);
+    _SiftUp(u8Pos);
+    _SiftDown(_u8HeapPos[u8Moved]);
+  }
+  _u8HeapPos[u8Task] = SCHED_NOT_QUEUED;
+}
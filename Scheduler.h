@@ -0,0 +1,111 @@
+/***************
+* NTP Clock
+*
+* tScheduler is a small cooperative scheduler for the main loop.  Each task is a
+* function with a deadline; the deadlines are kept in a min-heap, so finding the next
+* thing to do is O(1) and rescheduling a task is O(log n).
+*
+* Run() calls every task that is due, then Idle() sleeps until the earliest deadline.
+* Idle() uses delay(), which on the ESP8266 arms an SDK timer and yields, so the CPU
+* sits in the SDK's idle loop (servicing WiFi) until the timer wakes it.  An
+* interrupt that wants the loop sooner calls esp_schedule(), which ends the delay
+* early, and the loop can then reschedule the task that handles it.
+*
+* A periodic task runs every ulPeriodMs, measured from its deadline rather than from
+* when it actually ran, so it doesn't drift.  If it falls more than a whole period
+* behind, the missed runs are dropped rather than run back to back.  A task may call
+* Reschedule() on itself to pick its own next deadline.
+*
+* For each task we keep how many times it ran, how long it took (in microseconds)
+* and how late it started (in milliseconds past its deadline).
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+
+#define SCHED_MAX_TASKS      (16)   // The clock uses 12; leave room for more
+
+// How long Idle() sleeps with no tasks at all.  With tasks, it sleeps right up to
+// the next deadline, however far off, so light sleep gets the whole interval.
+#define SCHED_MAX_IDLE_MS    (100)
+
+#define SCHED_NO_TASK        (-1)
+#define SCHED_NOT_QUEUED     (0xFF)
+
+typedef void (*tTaskFn)(void *pArg);
+
+struct tTaskStats {
+  uint32_t u32Runs;
+  uint32_t u32TotalUs;
+  uint32_t u32MaxUs;
+  uint32_t u32TotalLateMs;
+  uint32_t u32MaxLateMs;
+};
+
+
+class tScheduler {
+public:
+  tScheduler();
+
+  // Returns a task ID for Reschedule(), or SCHED_NO_TASK if the table is full.  A
+  // period of 0 makes a one-shot task, which sleeps after it runs until rescheduled.
+  int  AddTask(const char *sName, tTaskFn pfnTask, void *pArg, uint32_t ulPeriodMs,
+               uint32_t ulFirstDelayMs = 0);
+
+  // Sets the task's next deadline to ulDelayMs from now.  Works from inside the
+  // task itself, in which case it overrides the period for this once.
+  void Reschedule(int iTask, uint32_t ulDelayMs);
+
+  // Runs everything that is due.  Each task runs at most once per call.
+  void Run();
+
+  // Milliseconds until the next deadline, 0 if something is already due
+  uint32_t MsUntilNext() const;
+
+  // Sleeps until the next deadline, or until an interrupt calls esp_schedule()
+  void Idle();
+
+  uint8_t           NumTasks() const { return _u8NumTasks; }
+  const char       *TaskName(int iTask) const { return _Tasks[iTask].sName; }
+  const tTaskStats &Stats(int iTask) const { return _Tasks[iTask].Stats; }
+  void PrintStats(Print &Out) const;
+  void ResetStats();
+
+protected:
+  struct tTask {
+    const char    *sName;
+    tTaskFn        pfnTask;
+    void          *pArg;
+    uint32_t       ulPeriodMs;
+    uint32_t       ulDueMs;
+    tTaskStats     Stats;
+  };
+
+  bool _Before(uint8_t u8TaskA, uint8_t u8TaskB) const;
+  void _Swap(uint8_t u8PosA, uint8_t u8PosB);
+  void _SiftUp(uint8_t u8Pos);
+  void _SiftDown(uint8_t u8Pos);
+  void _Push(uint8_t u8Task);
+  void _Remove(uint8_t u8Pos);
+
+  tTask   _Tasks[SCHED_MAX_TASKS];
+  uint8_t _u8NumTasks;
+
+  // The heap holds task numbers, earliest deadline first.  _u8HeapPos[] is where
+  // each task currently sits in it, or SCHED_NOT_QUEUED.
+  uint8_t _u8Heap[SCHED_MAX_TASKS];
+  uint8_t _u8HeapPos[SCHED_MAX_TASKS];
+  uint8_t _u8HeapSize;
+
+  int     _iRunning;
+  bool    _bRescheduled;
+};
+
+
+#endif   /* SCHEDULER_H */
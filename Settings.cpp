@@ -0,0 +1,331 @@
+/***************
+* NTP Clock
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "Settings.h"
+#include "Crc.h"
+#include "Log.h"
+
+// The filesystem area, from the linker script.  These are addresses in the
+// memory-mapped flash, which starts at SETTINGS_FLASH_MAPPED.
+extern "C" uint32_t _FS_start;
+extern "C" uint32_t _FS_end;
+
+#define SETTINGS_FLASH_MAPPED  (0x40200000UL)
+
+
+/***************************************
+* RecordSize
+*
+* A record's header and value, padded to a whole number of words
+*/
+
+static uint16_t RecordSize(uint8_t u8Len)
+{
+  return sizeof(tSettingsRecord) + ((u8Len + 3) & ~3);
+}
+
+
+/***************************************
+* tSettingsStore constructor
+*
+*/
+
+tSettingsStore::tSettingsStore()
+{
+  _bReady         = false;
+  _u32Base        = 0;
+  _u8Active       = 0;
+  _u32Generation  = 0;
+  _u16End         = sizeof(tSettingsHeader);
+  _u32Compactions = 0;
+  memset(_u16Offset, 0, sizeof(_u16Offset));
+}
+
+
+/***************************************
+* tSettingsStore::Begin
+*
+* The sector with the magic and the higher generation is the active one.  With
+* neither, this is a new store, and an empty one is written.
+*/
+
+bool tSettingsStore::Begin()
+{
+  tSettingsHeader Header[2];
+  bool            bValid[2];
+  uint8_t         i, u8Keys = 0;
+  uint32_t        u32FsStart = (uint32_t) (uintptr_t) &_FS_start;
+  uint32_t        u32FsEnd   = (uint32_t) (uintptr_t) &_FS_end;
+
+  if (u32FsEnd - u32FsStart < 2 * SETTINGS_SECTOR_SIZE) {
+    LOG(LOG_WARN, LOG_MSG_SETTINGS_NO_ROOM);
+    return false;
+  }
+  _u32Base = u32FsEnd - SETTINGS_FLASH_MAPPED - 2 * SETTINGS_SECTOR_SIZE;
+  _bReady  = true;
+
+  for (i=0; i<2; i++)  bValid[i] = _ReadHeader(i, Header[i]);
+
+  if (!bValid[0]  &&  !bValid[1]) {
+    _u8Active      = 1;
+    _u32Generation = 0;
+    if (!_Compact())  _bReady = false;
+    return _bReady;
+  }
+
+  _u8Active      = (!bValid[0]  ||  (bValid[1]  &&  (int32_t) (Header[1].u32Generation - Header[0].u32Generation) > 0)) ? 1 : 0;
+  _u32Generation = Header[_u8Active].u32Generation;
+
+  // Something cut short at the end: keep what's good, on a clean sector
+  if (!_Scan()) {
+    LOG(LOG_WARN, LOG_MSG_SETTINGS_DAMAGED, _u16End);
+    _Compact();
+  }
+
+  for (i=0; i<SETTINGS_MAX_KEYS; i++) {
+    if (_u16Offset[i] != SETTINGS_NO_RECORD)  u8Keys++;
+  }
+  LOG(LOG_INFO, LOG_MSG_SETTINGS_LOADED, u8Keys, _u16End);
+  return true;
+}
+
+
+/***************************************
+* tSettingsStore::Get
+*
+* RETURNS:
+*   The value's length, or -1 if it's never been set
+*/
+
+int tSettingsStore::Get(uint8_t u8Key, void *pData, uint8_t u8MaxLen)
+{
+  tSettingsRecord Record;
+  uint32_t        u32Data[SETTINGS_MAX_LEN / 4];
+
+  if (!_bReady  ||  u8Key >= SETTINGS_MAX_KEYS  ||  _u16Offset[u8Key] == SETTINGS_NO_RECORD)  return -1;
+  if (!_ReadRecord(_u16Offset[u8Key], Record, u32Data))  return -1;
+
+  memcpy(pData, u32Data, min(Record.u8Len, u8MaxLen));
+  return Record.u8Len;
+}
+
+
+/***************************************
+* tSettingsStore::Set
+*
+* Appends a record, compacting first if the sector's full.  A write that fails
+* part way leaves the rest of the sector unusable, so the next Set() compacts.
+*
+* RETURNS:
+*   false if the store isn't ready, the key or length is out of range, or the
+*   flash write failed
+*/
+
+bool tSettingsStore::Set(uint8_t u8Key, const void *pData, uint8_t u8Len)
+{
+  tSettingsRecord Record;
+  uint32_t        u32Data[SETTINGS_MAX_LEN / 4];
+
+  if (!_bReady  ||  u8Key >= SETTINGS_MAX_KEYS  ||  u8Len > SETTINGS_MAX_LEN)  return false;
+
+  // Already has this value?
+  if (_u16Offset[u8Key] == SETTINGS_NO_RECORD) {
+    if (u8Len == 0)  return true;
+  }
+  else if (_ReadRecord(_u16Offset[u8Key], Record, u32Data)  &&
+           Record.u8Len == u8Len  &&  memcmp(u32Data, pData, u8Len) == 0) {
+    return true;
+  }
+
+  if (_u16End + RecordSize(u8Len) > SETTINGS_SECTOR_SIZE) {
+    if (!_Compact()  ||  _u16End + RecordSize(u8Len) > SETTINGS_SECTOR_SIZE)  return false;
+  }
+
+  if (!_Write(_u8Active, _u16End, u8Key, pData, u8Len)) {
+    _u16End = SETTINGS_SECTOR_SIZE;
+    return false;
+  }
+
+  _u16Offset[u8Key] = u8Len ? _u16End : SETTINGS_NO_RECORD;
+  _u16End          += RecordSize(u8Len);
+  return true;
+}
+
+
+/***************************************
+* tSettingsStore::PrintReport
+*
+*/
+
+void tSettingsStore::PrintReport(Print &Out)
+{
+  char    sLine[128];
+  uint8_t i, u8Keys = 0;
+
+  if (!_bReady) {
+    Out.println(F("No settings store: the flash layout has no filesystem area"));
+    return;
+  }
+
+  for (i=0; i<SETTINGS_MAX_KEYS; i++) {
+    if (_u16Offset[i] != SETTINGS_NO_RECORD)  u8Keys++;
+  }
+
+  snprintf(sLine, sizeof(sLine), "Settings: sector %u at 0x%06lx, generation %lu, %u of %u bytes used, %u keys, %lu compactions",
+           _u8Active, (unsigned long) _SectorAddr(_u8Active), (unsigned long) _u32Generation,
+           _u16End, SETTINGS_SECTOR_SIZE, u8Keys, (unsigned long) _u32Compactions);
+  Out.println(sLine);
+}
+
+
+/***************************************
+* tSettingsStore::_ReadHeader
+*
+* RETURNS:
+*   true if the sector has the magic
+*/
+
+bool tSettingsStore::_ReadHeader(uint8_t u8Sector, tSettingsHeader &Header)
+{
+  return ESP.flashRead(_SectorAddr(u8Sector), (uint32_t *) &Header, sizeof(Header))  &&
+         Header.u32Magic == SETTINGS_MAGIC;
+}
+
+
+/***************************************
+* tSettingsStore::_Scan
+*
+* Reads the active sector's records in order up to the erased space after them,
+* keeping where each key's latest one is.  Stops at the first bad one, leaving
+* _u16End there.
+*
+* RETURNS:
+*   false if it stopped at a bad record
+*/
+
+bool tSettingsStore::_Scan()
+{
+  tSettingsRecord Record;
+  uint32_t        u32Data[SETTINGS_MAX_LEN / 4];
+
+  memset(_u16Offset, 0, sizeof(_u16Offset));
+  _u16End = sizeof(tSettingsHeader);
+
+  while (_u16End + sizeof(Record) <= SETTINGS_SECTOR_SIZE) {
+    if (!ESP.flashRead(_SectorAddr(_u8Active) + _u16End, (uint32_t *) &Record, sizeof(Record)))  return false;
+
+    if (Record.u8Key == 0xFF  &&  Record.u8Len == 0xFF  &&  Record.u16Mark == 0xFFFF  &&  Record.u32Crc == 0xFFFFFFFFUL) {
+      return true;
+    }
+
+    if (!_ReadRecord(_u16End, Record, u32Data))  return false;
+
+    _u16Offset[Record.u8Key] = Record.u8Len ? _u16End : SETTINGS_NO_RECORD;
+    _u16End += RecordSize(Record.u8Len);
+  }
+
+  return true;
+}
+
+
+/***************************************
+* tSettingsStore::_ReadRecord
+*
+* Reads a record in the active sector and checks it.  pu32Data needs room for
+* SETTINGS_MAX_LEN bytes.
+*
+* RETURNS:
+*   false if it's not a whole, good record
+*/
+
+bool tSettingsStore::_ReadRecord(uint16_t u16Offset, tSettingsRecord &Record, uint32_t *pu32Data)
+{
+  uint32_t u32Addr = _SectorAddr(_u8Active) + u16Offset;
+  uint16_t u16DataLen;
+
+  if (!ESP.flashRead(u32Addr, (uint32_t *) &Record, sizeof(Record)))  return false;
+
+  if (Record.u16Mark != SETTINGS_RECORD_MARK  ||  Record.u8Key >= SETTINGS_MAX_KEYS  ||
+      Record.u8Len > SETTINGS_MAX_LEN  ||  u16Offset + RecordSize(Record.u8Len) > SETTINGS_SECTOR_SIZE) {
+    return false;
+  }
+
+  u16DataLen = RecordSize(Record.u8Len) - sizeof(Record);
+  if (u16DataLen  &&  !ESP.flashRead(u32Addr + sizeof(Record), pu32Data, u16DataLen))  return false;
+
+  return Record.u32Crc == Crc32(pu32Data, Record.u8Len, Crc32(&Record, offsetof(tSettingsRecord, u32Crc)));
+}
+
+
+/***************************************
+* tSettingsStore::_Write
+*
+* Flash writes are whole words from a word-aligned buffer, so the record is put
+* together in one, padded with 0xFF (which leaves those bits erased)
+*/
+
+bool tSettingsStore::_Write(uint8_t u8Sector, uint16_t u16Offset, uint8_t u8Key, const void *pData, uint8_t u8Len)
+{
+  uint32_t         u32Buf[(sizeof(tSettingsRecord) + SETTINGS_MAX_LEN) / 4];
+  tSettingsRecord *pRecord = (tSettingsRecord *) u32Buf;
+
+  memset(u32Buf, 0xFF, sizeof(u32Buf));
+  pRecord->u8Key   = u8Key;
+  pRecord->u8Len   = u8Len;
+  pRecord->u16Mark = SETTINGS_RECORD_MARK;
+  if (u8Len)  memcpy(pRecord + 1, pData, u8Len);
+  pRecord->u32Crc  = Crc32(pRecord + 1, u8Len, Crc32(pRecord, offsetof(tSettingsRecord, u32Crc)));
+
+  return ESP.flashWrite(_SectorAddr(u8Sector) + u16Offset, u32Buf, RecordSize(u8Len));
+}
+
+
+/***************************************
+* tSettingsStore::_Compact
+*
+* Copies the latest value of each key to the other sector, then gives it its
+* header.  Until the header is written, the old sector is still the active one,
+* on disk and here.
+*
+* RETURNS:
+*   false if the flash erase or a write failed
+*/
+
+bool tSettingsStore::_Compact()
+{
+  uint8_t         u8New = 1 - _u8Active;
+  uint16_t        u16End = sizeof(tSettingsHeader);
+  uint16_t        u16NewOffset[SETTINGS_MAX_KEYS];
+  tSettingsRecord Record;
+  tSettingsHeader Header;
+  uint32_t        u32Data[SETTINGS_MAX_LEN / 4];
+  uint8_t         i;
+
+  if (!ESP.flashEraseSector(_SectorAddr(u8New) / SETTINGS_SECTOR_SIZE))  return false;
+
+  for (i=0; i<SETTINGS_MAX_KEYS; i++) {
+    u16NewOffset[i] = SETTINGS_NO_RECORD;
+    if (_u16Offset[i] == SETTINGS_NO_RECORD  ||  !_ReadRecord(_u16Offset[i], Record, u32Data))  continue;
+
+    if (!_Write(u8New, u16End, i, u32Data, Record.u8Len))  return false;
+    u16NewOffset[i] = u16End;
+    u16End         += RecordSize(Record.u8Len);
+  }
+
+  Header.u32Magic      = SETTINGS_MAGIC;
+  Header.u32Generation = _u32Generation + 1;
+  if (!ESP.flashWrite(_SectorAddr(u8New), (uint32_t *) &Header, sizeof(Header)))  return false;
+
+  _u8Active      = u8New;
+  _u32Generation = Header.u32Generation;
+  _u16End        = u16End;
+  memcpy(_u16Offset, u16NewOffset, sizeof(_u16Offset));
+  _u32Compactions++;
+
+  LOG(LOG_INFO, LOG_MSG_SETTINGS_COMPACTED, _u32Generation, _u16End);
+  return true;
+}
@@ -0,0 +1,108 @@
+/***************
+* NTP Clock
+*
+* tSettingsStore keeps small settings in flash, where they survive a reboot or a
+* power cut.  Each setting is a key (0 to SETTINGS_MAX_KEYS-1) and up to
+* SETTINGS_MAX_LEN bytes; what they mean is up to the caller.
+*
+* The store is a log: changing a setting appends a record, with a CRC, after the
+* last one, and the latest record for a key is its value.  So a change costs one
+* small write, with no erase, and the writes walk across the sector rather than
+* wearing out one spot.  Setting a value it already has writes nothing.
+*
+* It uses two flash sectors, at the end of the filesystem area.  When the active
+* sector is full, the latest value of each key is copied to the other, which then
+* becomes active: that's the only erase, and the sectors take turns.  The copy
+* gets its header (with a count one higher than the old one's) last, so a power
+* cut part way through leaves the old sector in charge and nothing lost.  A record
+* cut short by a power cut fails its CRC; it and anything after it are dropped,
+* and the rest are copied to the other sector the same way.
+*
+* Begin() reads the active sector once from start to end, noting where the latest
+* record for each key is.  Get() reads it from there.
+*
+* The filesystem area is set in the IDE's Tools > Flash Size menu.  It needs to be
+* at least two sectors (any size but "none"), and since the sketch doesn't use a
+* filesystem, its last two sectors are ours.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include <Arduino.h>
+
+#define SETTINGS_SECTOR_SIZE   (4096)
+#define SETTINGS_MAX_KEYS      (32)
+#define SETTINGS_MAX_LEN       (64)
+
+#define SETTINGS_MAGIC         (0x53455431UL)   // "SET1"
+#define SETTINGS_RECORD_MARK   (0x5352)
+#define SETTINGS_NO_RECORD     (0)              // In _u16Offset[]: never set
+
+// At the start of each sector.  A sector without the magic is blank or was being
+// written when the power went.
+struct tSettingsHeader {
+  uint32_t u32Magic;
+  uint32_t u32Generation;      // Goes up by one with each compaction
+};
+
+// Before each value, which is padded to 4 bytes.  The CRC covers the first word
+// and the value.
+struct tSettingsRecord {
+  uint8_t  u8Key;
+  uint8_t  u8Len;
+  uint16_t u16Mark;
+  uint32_t u32Crc;
+};
+
+
+class tSettingsStore {
+public:
+  tSettingsStore();
+
+  // Finds the active sector and reads it.  Returns false if there's no room in
+  // flash for the store, in which case Get() finds nothing and Set() fails.
+  bool Begin();
+
+  // Copies up to u8MaxLen bytes of the value into pData.  Returns the value's
+  // length, or -1 if it's never been set.
+  int  Get(uint8_t u8Key, void *pData, uint8_t u8MaxLen);
+
+  bool Set(uint8_t u8Key, const void *pData, uint8_t u8Len);
+
+  // A value of length 0 reads back as never set
+  bool Remove(uint8_t u8Key) { return Set(u8Key, NULL, 0); }
+
+  bool     IsReady()     const { return _bReady; }
+  uint16_t BytesUsed()   const { return _u16End; }
+  uint32_t Generation()  const { return _u32Generation; }
+  uint32_t Compactions() const { return _u32Compactions; }
+
+  // Where the store is, how full, and how many keys are set
+  void PrintReport(Print &Out);
+
+protected:
+  uint32_t _SectorAddr(uint8_t u8Sector) const { return _u32Base + u8Sector * SETTINGS_SECTOR_SIZE; }
+  bool     _ReadHeader(uint8_t u8Sector, tSettingsHeader &Header);
+  bool     _Scan();
+  bool     _ReadRecord(uint16_t u16Offset, tSettingsRecord &Record, uint32_t *pu32Data);
+  bool     _Write(uint8_t u8Sector, uint16_t u16Offset, uint8_t u8Key, const void *pData, uint8_t u8Len);
+  bool     _Compact();
+
+  bool     _bReady;
+  uint32_t _u32Base;           // Flash address of the first sector
+  uint8_t  _u8Active;
+  uint32_t _u32Generation;
+  uint16_t _u16End;            // Where the next record goes in the active sector
+  uint32_t _u32Compactions;
+
+  // Where each key's latest record is in the active sector
+  uint16_t _u16Offset[SETTINGS_MAX_KEYS];
+};
+
+
+#endif   /* SETTINGS_H */
@@ -0,0 +1,268 @@
+/***************
+* NTP Clock
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "SoftMux.h"
+
+
+tSoftMux *tSoftMux::_pActive = NULL;
+
+
+/***************************************
+* tSoftMux constructor
+*
+*/
+
+tSoftMux::tSoftMux()
+{
+  _bShiftRegister     = false;
+  _u8NumSegments      = 0;
+  _u32DataBit         = 0;
+  _u32ClockBit        = 0;
+  _u32LatchBit        = 0;
+  _u8NumPhases        = 0;
+  _bCathodeActiveHigh = true;
+  _u32AllCathodes     = 0;
+  _u8Front            = 0;
+  _bSwapPending       = false;
+  _u8Phase            = 0;
+  _u32Frames          = 0;
+
+  memset(_u16Next, 0, sizeof(_u16Next));
+  memset(_Frames,  0, sizeof(_Frames));
+}
+
+
+/***************************************
+* tSoftMux::ConfigureDirect
+*
+* INPUTS:
+*   pSegmentPins  - GPIO for each segment bit, 0-15
+*   u8NumSegments - how many entries in pSegmentPins
+* RETURNS:
+*   false if a pin can't be used
+*/
+
+bool tSoftMux::ConfigureDirect(const uint8_t *pSegmentPins, uint8_t u8NumSegments)
+{
+  uint8_t i;
+
+  if (u8NumSegments > SOFTMUX_MAX_SEGMENTS)  return false;
+
+  for (i=0; i<u8NumSegments; i++) {
+    if (pSegmentPins[i] > SOFTMUX_MAX_GPIO)  return false;
+    _u8SegmentPins[i] = pSegmentPins[i];
+    pinMode(pSegmentPins[i], OUTPUT);
+    digitalWrite(pSegmentPins[i], LOW);
+  }
+
+  _u8NumSegments  = u8NumSegments;
+  _bShiftRegister = false;
+  return true;
+}
+
+
+/***************************************
+* tSoftMux::ConfigureShiftRegister
+*
+*/
+
+bool tSoftMux::ConfigureShiftRegister(uint8_t u8DataPin, uint8_t u8ClockPin, uint8_t u8LatchPin)
+{
+  if (u8DataPin > SOFTMUX_MAX_GPIO || u8ClockPin > SOFTMUX_MAX_GPIO || u8LatchPin > SOFTMUX_MAX_GPIO)
+    return false;
+
+  pinMode(u8DataPin,  OUTPUT);
+  pinMode(u8ClockPin, OUTPUT);
+  pinMode(u8LatchPin, OUTPUT);
+  digitalWrite(u8ClockPin, LOW);
+  digitalWrite(u8LatchPin, LOW);
+
+  _u32DataBit     = 1UL << u8DataPin;
+  _u32ClockBit    = 1UL << u8ClockPin;
+  _u32LatchBit    = 1UL << u8LatchPin;
+  _u8NumSegments  = SOFTMUX_MAX_SEGMENTS;
+  _bShiftRegister = true;
+  return true;
+}
+
+
+/***************************************
+* tSoftMux::ConfigureCathodes
+*
+* INPUTS:
+*   pCathodePins - GPIO for each phase, 0-15
+*   u8NumPhases  - how many cathode groups
+*   bActiveHigh  - true if driving the pin high turns the group on (e.g. through an
+*                  NPN low-side switch), false if low does.
+*/
+
+bool tSoftMux::ConfigureCathodes(const uint8_t *pCathodePins, uint8_t u8NumPhases, bool bActiveHigh)
+{
+  uint8_t i;
+
+  if (u8NumPhases == 0  ||  u8NumPhases > SOFTMUX_MAX_PHASES)  return false;
+
+  _u32AllCathodes = 0;
+  for (i=0; i<u8NumPhases; i++) {
+    if (pCathodePins[i] > SOFTMUX_MAX_GPIO)  return false;
+    pinMode(pCathodePins[i], OUTPUT);
+    digitalWrite(pCathodePins[i], bActiveHigh ? LOW : HIGH);
+    _u32CathodeBit[i] = 1UL << pCathodePins[i];
+    _u32AllCathodes  |= _u32CathodeBit[i];
+  }
+
+  _u8NumPhases        = u8NumPhases;
+  _bCathodeActiveHigh = bActiveHigh;
+  return true;
+}
+
+
+/***************************************
+* tSoftMux::Begin
+*
+* Starts scanning.  Only one tSoftMux can run at a time, as there is only one timer1.
+*
+* INPUTS:
+*   u16RefreshHz - complete frames per second.  Each phase gets 1/(Hz * phases) s.
+*/
+
+bool tSoftMux::Begin(uint16_t u16RefreshHz)
+{
+  uint32_t u32TicksPerPhase;
+
+  if (_u8NumPhases == 0  ||  _u8NumSegments == 0  ||  u16RefreshHz == 0)  return false;
+
+  u32TicksPerPhase = SOFTMUX_TICKS_PER_US * (1000000UL / ((uint32_t) u16RefreshHz * _u8NumPhases));
+
+  _u8Phase = 0;
+  _pActive = this;
+
+  timer1_isr_init();
+  timer1_attachInterrupt(_TimerIsr);
+  timer1_enable(TIM_DIV16, TIM_EDGE, TIM_LOOP);
+  timer1_write(u32TicksPerPhase);
+  return true;
+}
+
+
+/***************************************
+* tSoftMux::End
+*
+* Stops scanning and blanks the display
+*/
+
+void tSoftMux::End()
+{
+  timer1_disable();
+  timer1_detachInterrupt();
+  _pActive = NULL;
+
+  if (_bCathodeActiveHigh)  GPOC = _u32AllCathodes;
+  else                      GPOS = _u32AllCathodes;
+}
+
+
+/***************************************
+* tSoftMux::SetPhaseSegments
+*
+* Stages the segment pattern for one phase.  Nothing is shown until Commit().
+*
+* INPUTS:
+*   u8Phase     - cathode group
+*   u16Segments - bit n lights segment n
+*/
+
+void tSoftMux::SetPhaseSegments(uint8_t u8Phase, uint16_t u16Segments)
+{
+  if (u8Phase < SOFTMUX_MAX_PHASES)  _u16Next[u8Phase] = u16Segments;
+}
+
+
+/***************************************
+* tSoftMux::Commit
+*
+* Turns the staged patterns into GPIO masks in the back buffer and asks the ISR to
+* swap buffers at the start of the next frame.
+*
+* If the previous Commit() hasn't been picked up yet we wait for it, which is at
+* most one frame.
+*/
+
+void tSoftMux::Commit()
+{
+  uint8_t  p, i;
+  tPhase  *pPhase;
+
+  while (_bSwapPending  &&  _pActive == this) { }
+
+  for (p=0; p<_u8NumPhases; p++) {
+    pPhase               = &_Frames[_u8Front ^ 1][p];
+    pPhase->u32SegSet    = 0;
+    pPhase->u32SegClr    = 0;
+    pPhase->u16ShiftWord = _u16Next[p];
+
+    if (_bShiftRegister)  continue;
+
+    for (i=0; i<_u8NumSegments; i++) {
+      if (_u16Next[p] & (1 << i))  pPhase->u32SegSet |= 1UL << _u8SegmentPins[i];
+      else                         pPhase->u32SegClr |= 1UL << _u8SegmentPins[i];
+    }
+  }
+
+  if (_pActive == this)  _bSwapPending = true;
+  else                   _u8Front ^= 1;
+}
+
+
+/***************************************
+* tSoftMux::_TimerIsr, _Isr
+*
+* Shows one phase.  The sequence is blank, set anodes, enable cathode, so there's
+* no ghosting of the previous phase's pattern.
+*/
+
+void ICACHE_RAM_ATTR tSoftMux::_TimerIsr()
+{
+  if (_pActive != NULL)  _pActive->_Isr();
+}
+
+void ICACHE_RAM_ATTR tSoftMux::_Isr()
+{
+  const tPhase &Phase = _Frames[_u8Front][_u8Phase];
+  int8_t i;
+
+  if (_bCathodeActiveHigh)  GPOC = _u32AllCathodes;
+  else                      GPOS = _u32AllCathodes;
+
+  if (_bShiftRegister) {
+    for (i=SOFTMUX_MAX_SEGMENTS-1; i>=0; i--) {
+      if (Phase.u16ShiftWord & (1 << i))  GPOS = _u32DataBit;
+      else                                GPOC = _u32DataBit;
+      GPOS = _u32ClockBit;
+      GPOC = _u32ClockBit;
+    }
+    GPOS = _u32LatchBit;
+    GPOC = _u32LatchBit;
+  }
+  else {
+    GPOS = Phase.u32SegSet;
+    GPOC = Phase.u32SegClr;
+  }
+
+  if (_bCathodeActiveHigh)  GPOS = _u32CathodeBit[_u8Phase];
+  else                      GPOC = _u32CathodeBit[_u8Phase];
+
+  if (++_u8Phase >= _u8NumPhases) {
+    _u8Phase = 0;
+    _u32Frames++;
+
+    if (_bSwapPending) {
+      _u8Front     ^= 1;
+      _bSwapPending = false;
+    }
+  }
+}
@@ -0,0 +1,103 @@
+/***************
+* NTP Clock
+*
+* tSoftMux multiplexes a common-cathode LED panel directly from the ESP8266, for
+* boards that leave out the GAL 22V10 (or MAX6954) that normally does this.
+*
+* Each cathode group is a "phase".  A timer1 interrupt steps through the phases at a
+* fixed rate: it turns all cathodes off, puts the phase's segment pattern on the anode
+* lines, then turns on that phase's cathode.
+*
+* Everything the ISR needs is precomputed in the loop as ready-to-write GPIO set/clear
+* masks, so the ISR does the same handful of register writes every time no matter
+* what is displayed.  That keeps its run time constant, which is what keeps the
+* brightness even and the refresh free of jitter.  New patterns are built in a back
+* buffer and swapped in at a phase boundary, so the ISR never shows a half-written
+* frame.
+*
+* The anodes can either be driven straight from GPIOs, or from a 74HC595-style shift
+* register (data, clock and latch on three GPIOs), which frees up pins at the cost of
+* a longer (but still constant length) ISR.
+*
+* Only GPIO 0-15 can be used, since GPIO16 isn't in the GPOS/GPOC registers.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef SOFT_MUX_H
+#define SOFT_MUX_H
+
+#include <Arduino.h>
+
+#define SOFTMUX_MAX_PHASES    (4)
+#define SOFTMUX_MAX_SEGMENTS  (16)
+#define SOFTMUX_MAX_GPIO      (15)
+
+// timer1 runs at 80 MHz / 16
+#define SOFTMUX_TICKS_PER_US  (5)
+
+#define SOFTMUX_DEFAULT_REFRESH_HZ (200)
+
+
+class tSoftMux {
+public:
+  tSoftMux();
+
+  // Anodes straight from GPIOs.  pSegmentPins[n] lights segment bit n.
+  bool ConfigureDirect(const uint8_t *pSegmentPins, uint8_t u8NumSegments);
+
+  // Anodes from a shift register.  Segment bit 15 is shifted out first.
+  bool ConfigureShiftRegister(uint8_t u8DataPin, uint8_t u8ClockPin, uint8_t u8LatchPin);
+
+  // pCathodePins[n] enables phase n
+  bool ConfigureCathodes(const uint8_t *pCathodePins, uint8_t u8NumPhases, bool bActiveHigh);
+
+  // Starts the timer.  u16RefreshHz is full frames (all phases) per second.
+  bool Begin(uint16_t u16RefreshHz = SOFTMUX_DEFAULT_REFRESH_HZ);
+  void End();
+
+  // Build up the next frame with SetPhaseSegments, then Commit() it
+  void SetPhaseSegments(uint8_t u8Phase, uint16_t u16Segments);
+  void Commit();
+
+  uint32_t FrameCount() const { return _u32Frames; }
+
+protected:
+  static void _TimerIsr();
+  void        _Isr();
+
+  // Precomputed GPIO writes for one phase
+  struct tPhase {
+    uint32_t u32SegSet;      // Direct mode: GPOS mask to light segments
+    uint32_t u32SegClr;      // Direct mode: GPOC mask to darken segments
+    uint16_t u16ShiftWord;   // Shift-register mode: the bits to shift out
+  };
+
+  bool     _bShiftRegister;
+  uint8_t  _u8SegmentPins[SOFTMUX_MAX_SEGMENTS];
+  uint8_t  _u8NumSegments;
+  uint32_t _u32DataBit, _u32ClockBit, _u32LatchBit;
+
+  uint8_t  _u8NumPhases;
+  bool     _bCathodeActiveHigh;
+  uint32_t _u32CathodeBit[SOFTMUX_MAX_PHASES];
+  uint32_t _u32AllCathodes;
+
+  // What SetPhaseSegments has staged for the next Commit()
+  uint16_t _u16Next[SOFTMUX_MAX_PHASES];
+
+  // Two frames.  The ISR shows _Frames[_u8Front]; the loop writes the other.
+  tPhase            _Frames[2][SOFTMUX_MAX_PHASES];
+  volatile uint8_t  _u8Front;
+  volatile bool     _bSwapPending;
+
+  volatile uint8_t  _u8Phase;
+  volatile uint32_t _u32Frames;
+
+  static tSoftMux *_pActive;
+};
+
+
+#endif   /* SOFT_MUX_H */
@@ -0,0 +1,201 @@
+/***************
+* NTP Clock
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "SpiTrace.h"
+#include "Max6954Model.h"
+
+
+/***************************************
+* tSpiTrace constructor
+*
+*/
+
+tSpiTrace::tSpiTrace() :
+  _pModel(NULL)
+{
+  Clear();
+}
+
+
+/***************************************
+* tSpiTrace::Clear
+*
+* Empties the edge and transaction logs, zeroes the statistics and resets the
+* decoder to the bus idle state (CS high, CLK low).
+*/
+
+void tSpiTrace::Clear()
+{
+  _u32EdgeCount              = 0;
+  _u32Transactions           = 0;
+  _u32ClockCycles            = 0;
+  _u32ProtocolErrors         = 0;
+  _u32FrameStartCycles       = 0;
+  _u32FrameStartTransactions = 0;
+
+  _u8ClkLevel = LOW;
+  _u8CsLevel  = HIGH;
+  _u8DinLevel = LOW;
+
+  _Current.u16Command  = 0;
+  _Current.u16Response = 0;
+  _Current.u8NumBits   = 0;
+}
+
+
+/***************************************
+* tSpiTrace::RecordEdge
+*
+* Logs the edge and runs it through the MAX6954 protocol decoder.  Per p. 7 of the
+* data sheet, the device samples DIN on the rising edge of CLK while CS is low, and
+* latches the 16 bits when CS goes high.
+*
+* Writes of a level that the line already has are recorded but are not edges as far
+* as the decoder is concerned.
+*
+* INPUTS:
+*   u8Signal - One of SPI_SIGNAL
+*   u8Level  - The new level of the line
+*/
+
+void tSpiTrace::RecordEdge(uint8_t u8Signal, uint8_t u8Level)
+{
+  tSpiEdge &Edge = _Edges[_u32EdgeCount % SPI_TRACE_MAX_EDGES];
+  Edge.u8Signal  = u8Signal;
+  Edge.u8Level   = u8Level;
+  _u32EdgeCount++;
+
+  switch (u8Signal) {
+    case SPI_SIGNAL_CS:
+      if (_u8CsLevel == HIGH && u8Level == LOW) {
+        _Current.u16Command  = 0;
+        _Current.u16Response = 0;
+        _Current.u8NumBits   = 0;
+      }
+      else if (_u8CsLevel == LOW && u8Level == HIGH) {
+        _EndTransaction();
+      }
+      _u8CsLevel = u8Level;
+      break;
+
+    case SPI_SIGNAL_CLK:
+      if (_u8ClkLevel == LOW && u8Level == HIGH) {
+        _u32ClockCycles++;
+        if (_u8CsLevel == LOW) {
+          _Current.u16Command = _Current.u16Command << 1 | _u8DinLevel;
+          _Current.u8NumBits++;
+        }
+      }
+      _u8ClkLevel = u8Level;
+      break;
+
+    case SPI_SIGNAL_DIN:
+      _u8DinLevel = u8Level;
+      break;
+
+    case SPI_SIGNAL_DOUT:
+      // The bit-banger samples DOUT right after each rising clock edge
+      if (_u8CsLevel == LOW)
+        _Current.u16Response = _Current.u16Response << 1 | (u8Level & 0x01);
+      break;
+  }
+}
+
+
+/***************************************
+* tSpiTrace::_EndTransaction
+*
+* CS has just gone high.  Log the transaction and hand it to the model, if any.
+*/
+
+void tSpiTrace::_EndTransaction()
+{
+  if (_Current.u8NumBits != 16)  _u32ProtocolErrors++;
+
+  _Transactions[_u32Transactions % SPI_TRACE_MAX_TRANSACTIONS] = _Current;
+  _u32Transactions++;
+
+  if (_pModel != NULL)  _pModel->Apply(_Current);
+}
+
+
+/***************************************
+* tSpiTrace::NumEdges, Edge
+*
+*/
+
+int tSpiTrace::NumEdges() const
+{
+  return _u32EdgeCount < SPI_TRACE_MAX_EDGES ? _u32EdgeCount : SPI_TRACE_MAX_EDGES;
+}
+
+tSpiEdge tSpiTrace::Edge(int iWhich) const
+{
+  uint32_t u32First = _u32EdgeCount - NumEdges();
+  return _Edges[(u32First + iWhich) % SPI_TRACE_MAX_EDGES];
+}
+
+
+/***************************************
+* tSpiTrace::NumTransactions, Transaction
+*
+*/
+
+int tSpiTrace::NumTransactions() const
+{
+  return _u32Transactions < SPI_TRACE_MAX_TRANSACTIONS ? _u32Transactions : SPI_TRACE_MAX_TRANSACTIONS;
+}
+
+const tSpiTransaction &tSpiTrace::Transaction(int iWhich) const
+{
+  uint32_t u32First = _u32Transactions - NumTransactions();
+  return _Transactions[(u32First + iWhich) % SPI_TRACE_MAX_TRANSACTIONS];
+}
+
+
+/***************************************
+* tSpiTrace::BeginFrame
+*
+* Snapshots the counters so that FrameClockCycles() and FrameTransactions() report
+* the bus cost of whatever happens next.
+*/
+
+void tSpiTrace::BeginFrame()
+{
+  _u32FrameStartCycles       = _u32ClockCycles;
+  _u32FrameStartTransactions = _u32Transactions;
+}
+
+
+/***************************************
+* tSpiTrace::PrintTransactions
+*
+* Dumps the transaction log, one line per transaction, e.g.
+*   W 0x20 = 0x7E
+*   R 0x02          -> 0x0A (on the following transaction)
+*/
+
+void tSpiTrace::PrintTransactions(Print &Out) const
+{
+  int i;
+
+  for (i=0; i<NumTransactions(); i++) {
+    const tSpiTransaction &T = Transaction(i);
+
+    Out.print((T.u16Command & 0x8000) ? F("R 0x") : F("W 0x"));
+    Out.print((T.u16Command >> 8) & 0x7F, HEX);
+    Out.print(F(" = 0x"));
+    Out.print(T.u16Command & 0xFF, HEX);
+    Out.print(F("  resp 0x"));
+    Out.print(T.u16Response, HEX);
+    if (T.u8NumBits != 16) {
+      Out.print(F("  BITS="));
+      Out.print(T.u8NumBits);
+    }
+    Out.println();
+  }
+}
@@ -0,0 +1,106 @@
+/***************
+* NTP Clock
+*
+* The SpiTrace classes give visibility into what actually goes out on the bus to the
+* MAX6954.  A tSpiTrace can be attached to a tMaximBitBangSpi, after which every
+* CLK, CS and DIN edge the bit-banger drives (and every DOUT bit it samples) is recorded.
+*
+* The edges are decoded on the fly into 16-bit MAX6954 transactions, which are kept in
+* a small log and optionally forwarded to a tMax6954Model (see Max6954Model.h) that
+* tracks what the chip's registers should now contain.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef SPI_TRACE_H
+#define SPI_TRACE_H
+
+#include <Arduino.h>
+
+// How many raw edges and decoded transactions we keep.  Both are ring buffers; once
+// full, the oldest entries are overwritten.
+#define SPI_TRACE_MAX_EDGES        (256)
+#define SPI_TRACE_MAX_TRANSACTIONS (64)
+
+class tMax6954Model;
+
+// The signals we record.  DIN and DOUT are named from the MAX6954's point of view, so
+// DIN is what we drive and DOUT is what we sample.
+typedef enum {
+  SPI_SIGNAL_CLK,
+  SPI_SIGNAL_CS,
+  SPI_SIGNAL_DIN,
+  SPI_SIGNAL_DOUT
+} SPI_SIGNAL;
+
+struct tSpiEdge {
+  uint8_t u8Signal;   // One of SPI_SIGNAL
+  uint8_t u8Level;    // 0 or 1
+};
+
+// One complete (or aborted) CS-low..CS-high frame on the bus
+struct tSpiTransaction {
+  uint16_t u16Command;    // The 16 bits we clocked into DIN, D15 first
+  uint16_t u16Response;   // The 16 bits the device clocked out of DOUT
+  uint8_t  u8NumBits;     // Should be 16.  Anything else is a protocol error.
+};
+
+
+class tSpiTrace {
+public:
+  tSpiTrace();
+
+  void Clear();
+  void AttachModel(tMax6954Model *pModel) { _pModel = pModel; }
+
+  // Called by tMaximBitBangSpi for every pin change it makes or samples
+  void RecordEdge(uint8_t u8Signal, uint8_t u8Level);
+
+  // Raw edge access.  Index 0 is the oldest edge still in the buffer.
+  int      NumEdges() const;
+  tSpiEdge Edge(int iWhich) const;
+
+  // Decoded transaction access.  Index 0 is the oldest transaction still in the buffer.
+  int                    NumTransactions() const;
+  const tSpiTransaction &Transaction(int iWhich) const;
+
+  // Bus statistics.  BeginFrame() marks the start of a display frame, after which the
+  // Frame* calls report the cost of everything since.
+  void     BeginFrame();
+  uint32_t FrameClockCycles()  const { return _u32ClockCycles  - _u32FrameStartCycles; }
+  uint32_t FrameTransactions() const { return _u32Transactions - _u32FrameStartTransactions; }
+  uint32_t TotalClockCycles()  const { return _u32ClockCycles;  }
+  uint32_t TotalTransactions() const { return _u32Transactions; }
+  uint32_t ProtocolErrors()    const { return _u32ProtocolErrors; }
+
+  void PrintTransactions(Print &Out) const;
+
+protected:
+  void _EndTransaction();
+
+  tMax6954Model *_pModel;
+
+  // Raw edge ring
+  tSpiEdge _Edges[SPI_TRACE_MAX_EDGES];
+  uint32_t _u32EdgeCount;
+
+  // Decoded transaction ring
+  tSpiTransaction _Transactions[SPI_TRACE_MAX_TRANSACTIONS];
+  uint32_t        _u32Transactions;
+
+  // Decoder state.  We track the current level of each line so that we can act on edges.
+  uint8_t         _u8ClkLevel;
+  uint8_t         _u8CsLevel;
+  uint8_t         _u8DinLevel;
+  tSpiTransaction _Current;
+
+  uint32_t _u32ClockCycles;
+  uint32_t _u32ProtocolErrors;
+  uint32_t _u32FrameStartCycles;
+  uint32_t _u32FrameStartTransactions;
+};
+
+
+#endif   /* SPI_TRACE_H */
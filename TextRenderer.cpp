@@ -0,0 +1,137 @@
+/***************
+* NTP Clock
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "TextRenderer.h"
+
+
+/***************************************
+* tTextRenderer constructor
+*
+*/
+
+tTextRenderer::tTextRenderer(tClockDisplay &Display) :
+  _Display(Display)
+{
+  _u8NumFrames     = 0;
+  _u16FrameMs      = TEXT_DEFAULT_FRAME_MS;
+  _u8Repeat        = 1;
+  _bActive         = false;
+  _ulStartMs       = 0;
+  _iLastFrameShown = -1;
+}
+
+
+/***************************************
+* tTextRenderer::SetText
+*
+* Renders every frame of the animation into register values.  Annunciators are
+* all off while text is showing.
+*
+* INPUTS:
+*   sText      - the string to show
+*   u8Mode     - one of TEXT_MODE
+*   u16FrameMs - how long each frame is shown
+*   u8Repeat   - how many passes, or 0 for forever
+*/
+
+void tTextRenderer::SetText(const char *sText, uint8_t u8Mode, uint16_t u16FrameMs, uint8_t u8Repeat)
+{
+  static const bool NoAnnunciators[CLOCK_NUM_ANNUNCIATORS] = { false };
+  char    Window[CLOCK_MAX_DIGITS] = { 0 };
+  int     iLen, iFrame, i, iPos;
+  int     iNumDigits = _Display.NumDigits();
+
+  iLen = strlen(sText);
+  if (iLen > TEXT_MAX_CHARS)  iLen = TEXT_MAX_CHARS;
+
+  _bActive    = false;
+  _u16FrameMs = u16FrameMs > 0 ? u16FrameMs : 1;
+  _u8Repeat   = u8Repeat;
+
+  switch (u8Mode) {
+    case TEXT_MODE_SCROLL:
+      // Frame 0 has the first character in the rightmost digit; the last frame has
+      // the last character in the leftmost digit.
+      _u8NumFrames = iLen + iNumDigits - 1;
+      for (iFrame=0; iFrame<_u8NumFrames; iFrame++) {
+        for (i=0; i<iNumDigits; i++) {
+          iPos      = iFrame - (iNumDigits - 1) + i;
+          Window[i] = (iPos >= 0 && iPos < iLen) ? sText[iPos] : ' ';
+        }
+        _Display.Render(Window, NoAnnunciators, _u8Frames[iFrame]);
+      }
+      break;
+
+    case TEXT_MODE_FLASH:
+    case TEXT_MODE_STATIC:
+    default:
+      for (i=0; i<iNumDigits; i++)  Window[i] = i < iLen ? sText[i] : ' ';
+      _Display.Render(Window, NoAnnunciators, _u8Frames[0]);
+      _u8NumFrames = 1;
+
+      if (u8Mode == TEXT_MODE_FLASH) {
+        for (i=0; i<iNumDigits; i++)  Window[i] = ' ';
+        _Display.Render(Window, NoAnnunciators, _u8Frames[1]);
+        _u8NumFrames = 2;
+      }
+      break;
+  }
+
+  if (_u8NumFrames == 0) {
+    for (i=0; i<iNumDigits; i++)  Window[i] = ' ';
+    _Display.Render(Window, NoAnnunciators, _u8Frames[0]);
+    _u8NumFrames = 1;
+  }
+}
+
+
+/***************************************
+* tTextRenderer::Start
+*
+*/
+
+void tTextRenderer::Start(uint32_t ulNowMs)
+{
+  _ulStartMs       = ulNowMs;
+  _iLastFrameShown = -1;
+  _bActive         = true;
+
+  Service(ulNowMs);
+}
+
+
+/***************************************
+* tTextRenderer::Service
+*
+* Shows whichever frame is due, if it isn't already showing.
+*
+* RETURNS:
+*   true while the animation is still running
+*/
+
+bool tTextRenderer::Service(uint32_t ulNowMs)
+{
+  unsigned long ulFrame;
+  int           iFrame;
+
+  if (!_bActive)  return false;
+
+  ulFrame = (ulNowMs - _ulStartMs) / _u16FrameMs;
+
+  if (_u8Repeat != 0  &&  ulFrame >= (unsigned long) _u8NumFrames * _u8Repeat) {
+    _bActive = false;
+    return false;
+  }
+
+  iFrame = ulFrame % _u8NumFrames;
+  if (iFrame != _iLastFrameShown) {
+    _Display.WriteImage(_u8Frames[iFrame]);
+    _iLastFrameShown = iFrame;
+  }
+
+  return true;
+}
@@ -0,0 +1,72 @@
+/***************
+* NTP Clock
+*
+* tTextRenderer shows arbitrary strings (time zone names, the IP address, error codes)
+* on the clock's digits, either scrolling them across or flashing them in place.
+*
+* All of the work happens in SetText(): every frame of the animation is rendered up
+* front into MAX6954 register values.  Service() then only has to decide whether a
+* frame is due and hand it to tClockDisplay::WriteImage(), which sends just the
+* registers that differ from the previous frame.  So each frame costs the same small,
+* bounded amount of time and bus traffic, however complicated the text.
+*
+* Frames are timed from the start of the animation rather than from the previous
+* frame, so a late Service() call doesn't push every later frame back.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef TEXT_RENDERER_H
+#define TEXT_RENDERER_H
+
+#include <Arduino.h>
+#include "ClockDisplay.h"
+
+#define TEXT_MAX_CHARS   (48)
+
+// A scroll needs one frame per character plus enough to scroll in and out
+#define TEXT_MAX_FRAMES  (TEXT_MAX_CHARS + CLOCK_MAX_DIGITS)
+
+#define TEXT_DEFAULT_FRAME_MS (250)
+
+typedef enum {
+  TEXT_MODE_STATIC,   // First NumDigits() characters, shown for one frame time
+  TEXT_MODE_SCROLL,   // Enters from the right and leaves to the left
+  TEXT_MODE_FLASH     // First NumDigits() characters, alternating with blank
+} TEXT_MODE;
+
+
+class tTextRenderer {
+public:
+  tTextRenderer(tClockDisplay &Display);
+
+  // Precomputes the frames.  Text longer than TEXT_MAX_CHARS is cut off.
+  // u8Repeat is how many times to run the animation; 0 repeats until Stop().
+  void SetText(const char *sText, uint8_t u8Mode, uint16_t u16FrameMs = TEXT_DEFAULT_FRAME_MS,
+               uint8_t u8Repeat = 1);
+
+  void Start(uint32_t ulNowMs);
+  void Stop() { _bActive = false; }
+  bool IsActive() const { return _bActive; }
+
+  // Call from the loop.  Returns IsActive().  When the animation ends, the display
+  // is left showing the last frame; the caller repaints it with Update().
+  bool Service(uint32_t ulNowMs);
+
+protected:
+  tClockDisplay &_Display;
+
+  uint8_t       _u8Frames[TEXT_MAX_FRAMES][GEOM_MAX_REGS];
+  uint8_t       _u8NumFrames;
+  uint16_t      _u16FrameMs;
+  uint8_t       _u8Repeat;
+
+  bool          _bActive;
+  uint32_t      _ulStartMs;
+  int           _iLastFrameShown;
+};
+
+
+#endif   /* TEXT_RENDERER_H */
@@ -0,0 +1,233 @@
+/***************
+* NTP Clock
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "TimeCheck.h"
+
+
+/***************************************
+* DaysFromCivil
+*
+* Days from 1 Jan 1970 to the given date, in the proleptic Gregorian calendar
+* (the era-based method, good for any year)
+*/
+
+static long DaysFromCivil(int iYear, unsigned uMonth, unsigned uDay)
+{
+  long     lEra;
+  unsigned uYearOfEra, uDayOfYear, uDayOfEra;
+
+  iYear     -= uMonth <= 2;
+  lEra       = (iYear >= 0 ? iYear : iYear - 399) / 400;
+  uYearOfEra = (unsigned) (iYear - lEra * 400);
+  uDayOfYear = (153 * (uMonth > 2 ? uMonth - 3 : uMonth + 9) + 2) / 5 + uDay - 1;
+  uDayOfEra  = uYearOfEra * 365 + uYearOfEra / 4 - uYearOfEra / 100 + uDayOfYear;
+
+  return lEra * 146097 + (long) uDayOfEra - 719468;
+}
+
+
+/***************************************
+* NthSunday
+*
+* The day (from 1 Jan 1970) of the n'th Sunday of the month.  1 Jan 1970 was a
+* Thursday.
+*/
+
+static long NthSunday(int iYear, unsigned uMonth, uint8_t n)
+{
+  long lFirst   = DaysFromCivil(iYear, uMonth, 1);
+  int  iWeekday = (int) ((lFirst + 4) % 7);          // 0 = Sunday
+
+  return lFirst + (7 - iWeekday) % 7 + 7 * (n - 1);
+}
+
+
+/***************************************
+* tTimeCheck constructor
+*
+*/
+
+tTimeCheck::tTimeCheck()
+{
+  _pLocalTime  = NULL;
+  _pfnFormat   = NULL;
+  _tStartUtc   = 0;
+  _tNextUtc    = 0;
+  _u32Left     = 0;
+  _u32Checked  = 0;
+  _u32Failures = 0;
+  _u32Changes  = 0;
+  _lLastOffset = 0;
+  _ulStartMs   = 0;
+  _ulElapsedMs = 0;
+  _tYearEndUtc = 0;
+}
+
+
+/***************************************
+* tTimeCheck::Start
+*
+*/
+
+void tTimeCheck::Start(tLocalTime *pLocalTime, tTimeFormatter pfnFormat, time_t tStartUtc, uint32_t u32Seconds)
+{
+  _pLocalTime  = pLocalTime;
+  _pfnFormat   = pfnFormat;
+  _tStartUtc   = tStartUtc;
+  _tNextUtc    = tStartUtc;
+  _u32Left     = u32Seconds;
+  _u32Checked  = 0;
+  _u32Failures = 0;
+  _u32Changes  = 0;
+  _lLastOffset = (long) (pLocalTime->UtcToLocal(tStartUtc) - tStartUtc);
+  _ulStartMs   = millis();
+  _ulElapsedMs = 0;
+
+  _StartYear(year(tStartUtc));
+}
+
+
+/***************************************
+* tTimeCheck::Service
+*
+* RETURNS:
+*   true while there's more to check
+*/
+
+bool tTimeCheck::Service(uint32_t u32BudgetUs)
+{
+  uint32_t u32StartUs = micros();
+  uint8_t  i;
+
+  while (_u32Left != 0) {
+    for (i=0; i<TIMECHECK_SLICE_SECONDS  &&  _u32Left != 0; i++, _u32Left--, _tNextUtc++) {
+      if (_tNextUtc >= _tYearEndUtc)  _StartYear(year(_tNextUtc));
+      _Check(_tNextUtc);
+    }
+
+    if (micros() - u32StartUs >= u32BudgetUs)  break;
+  }
+
+  _ulElapsedMs = millis() - _ulStartMs;
+  return _u32Left != 0;
+}
+
+
+/***************************************
+* tTimeCheck::_StartYear
+*
+* Works out the reference's DST changes for the UTC year.  US DST is all inside
+* the year, whichever US zone it is, so the local year and UTC year don't have to
+* agree.
+*/
+
+void tTimeCheck::_StartYear(int iYear)
+{
+  time_t tJanuary = (time_t) (DaysFromCivil(iYear, 1, 15) * SECS_PER_DAY + 12 * SECS_PER_HOUR);
+  time_t tJuly    = (time_t) (DaysFromCivil(iYear, 7, 15) * SECS_PER_DAY + 12 * SECS_PER_HOUR);
+
+  _lStdOffset   = (long) (_pLocalTime->UtcToLocal(tJanuary) - tJanuary);
+  _lDstOffset   = (long) (_pLocalTime->UtcToLocal(tJuly)    - tJuly);
+
+  // 2:00 local standard time, and 2:00 local daylight time
+  _tDstStartUtc = (time_t) (NthSunday(iYear, 3,  2) * SECS_PER_DAY + 2 * SECS_PER_HOUR - _lStdOffset);
+  _tDstEndUtc   = (time_t) (NthSunday(iYear, 11, 1) * SECS_PER_DAY + 2 * SECS_PER_HOUR - _lDstOffset);
+  _tYearEndUtc  = (time_t) (DaysFromCivil(iYear + 1, 1, 1) * SECS_PER_DAY);
+}
+
+
+/***************************************
+* tTimeCheck::_Check
+*
+* RETURNS:
+*   false if the clock would have shown the wrong thing
+*/
+
+bool tTimeCheck::_Check(time_t tUtc)
+{
+  char  sExpected[TIMECHECK_DIGITS], sGot[TIMECHECK_DIGITS];
+  bool  bExpectedPm, bGotPm;
+  long  lOffset, lSecondOfDay;
+  time_t tLocal;
+  int   iHour24, iHour12, iMinute, iSecond;
+
+  _u32Checked++;
+
+  // The reference
+  lOffset      = tUtc >= _tDstStartUtc  &&  tUtc < _tDstEndUtc ? _lDstOffset : _lStdOffset;
+  lSecondOfDay = (long) ((tUtc + lOffset) % SECS_PER_DAY);
+  iHour24      = lSecondOfDay / SECS_PER_HOUR;
+  iMinute      = lSecondOfDay / SECS_PER_MIN % 60;
+  iSecond      = lSecondOfDay % 60;
+  iHour12      = iHour24 % 12 == 0 ? 12 : iHour24 % 12;
+  bExpectedPm  = iHour24 >= 12;
+
+  sExpected[0] = iHour12 >= 10 ? '1' : ' ';
+  sExpected[1] = '0' + iHour12 % 10;
+  sExpected[2] = '0' + iMinute / 10;
+  sExpected[3] = '0' + iMinute % 10;
+  sExpected[4] = '0' + iSecond / 10;
+  sExpected[5] = '0' + iSecond % 10;
+
+  // The clock
+  tLocal  = _pLocalTime->UtcToLocal(tUtc);
+  _pfnFormat(tLocal, false, sGot, bGotPm);
+
+  if ((long) (tLocal - tUtc) != _lLastOffset) {
+    _lLastOffset = (long) (tLocal - tUtc);
+    _u32Changes++;
+  }
+
+  if (memcmp(sExpected, sGot, TIMECHECK_DIGITS) == 0  &&  bExpectedPm == bGotPm)  return true;
+
+  if (_u32Failures < TIMECHECK_MAX_FAILURES) {
+    tTimeCheckFailure &Failure = _Failures[_u32Failures];
+
+    Failure.tUtc        = tUtc;
+    Failure.bExpectedPm = bExpectedPm;
+    Failure.bGotPm      = bGotPm;
+    memcpy(Failure.sExpected, sExpected, TIMECHECK_DIGITS);
+    memcpy(Failure.sGot,      sGot,      TIMECHECK_DIGITS);
+    Failure.sExpected[TIMECHECK_DIGITS] = '\0';
+    Failure.sGot[TIMECHECK_DIGITS]      = '\0';
+  }
+  _u32Failures++;
+  return false;
+}
+
+
+/***************************************
+* tTimeCheck::PrintReport
+*
+* Times are UTC; the digits are as the display would have them
+*/
+
+void tTimeCheck::PrintReport(Print &Out)
+{
+  char         sLine[100];
+  tmElements_t Tm;
+  uint8_t      i;
+
+  breakTime(_tStartUtc, Tm);
+  snprintf(sLine, sizeof(sLine), "Time check from %04u-%02u-%02u %02u:%02u:%02u UTC: %lu seconds%s in %lu ms",
+           tmYearToCalendar(Tm.Year), Tm.Month, Tm.Day, Tm.Hour, Tm.Minute, Tm.Second,
+           (unsigned long) _u32Checked, _u32Left ? " so far" : "", (unsigned long) _ulElapsedMs);
+  Out.println(sLine);
+
+  snprintf(sLine, sizeof(sLine), "%lu offset changes, %lu wrong", (unsigned long) _u32Changes, (unsigned long) _u32Failures);
+  Out.println(sLine);
+
+  for (i=0; i<_u32Failures  &&  i<TIMECHECK_MAX_FAILURES; i++) {
+    const tTimeCheckFailure &Failure = _Failures[i];
+
+    breakTime(Failure.tUtc, Tm);
+    snprintf(sLine, sizeof(sLine), "  %04u-%02u-%02u %02u:%02u:%02u UTC: expected \"%s\" %s, got \"%s\" %s",
+             tmYearToCalendar(Tm.Year), Tm.Month, Tm.Day, Tm.Hour, Tm.Minute, Tm.Second,
+             Failure.sExpected, Failure.bExpectedPm ? "PM" : "AM", Failure.sGot, Failure.bGotPm ? "PM" : "AM");
+    Out.println(sLine);
+  }
+}
@@ -0,0 +1,93 @@
+/***************
+* NTP Clock
+*
+* tTimeCheck fast-forwards the clock through months of virtual time and checks,
+* for every second, that what it would show is right.  DST changes and the new
+* year only come round once or twice a year; this gets them in minutes.
+*
+* Each second is put through the time zone (tLocalTime::UtcToLocal) and the same
+* formatter ShowTime() uses, and the digits and AM/PM are compared with a
+* reference worked out independently: the US rules (DST from 2:00 standard time
+* on the second Sunday in March to 2:00 daylight time on the first Sunday in
+* November) applied with plain calendar arithmetic, without TimeLib or Timezone.
+* The zone's standard and daylight offsets are read off it once per year, in
+* January and July, so any of the zones in tTimeZoneSet can be checked.
+*
+* It runs in slices of Service(), so the clock keeps going while it does.  The
+* first few mismatches are kept for PrintReport(), along with how many there were
+* and how many times the offset changed (two a year, if all is well).
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef TIME_CHECK_H
+#define TIME_CHECK_H
+
+#include <Arduino.h>
+#include <TimeLib.h>
+#include "LocalTime.h"
+
+#define TIMECHECK_DIGITS        (6)    // HHMMSS, as ShowTime() fills them in
+#define TIMECHECK_MAX_FAILURES  (4)    // Kept for the report
+#define TIMECHECK_SLICE_SECONDS (64)   // Checked between looks at the clock
+
+// Turns a local time into the display's digits (TIMECHECK_DIGITS of them) and
+// whether it's PM
+typedef void (*tTimeFormatter)(time_t tLocal, bool bLeapSecond, char *pDigits, bool &bPm);
+
+struct tTimeCheckFailure {
+  time_t tUtc;
+  char   sExpected[TIMECHECK_DIGITS + 1];
+  char   sGot[TIMECHECK_DIGITS + 1];
+  bool   bExpectedPm;
+  bool   bGotPm;
+};
+
+
+class tTimeCheck {
+public:
+  tTimeCheck();
+
+  // Checks u32Seconds seconds starting at tStartUtc
+  void Start(tLocalTime *pLocalTime, tTimeFormatter pfnFormat, time_t tStartUtc, uint32_t u32Seconds);
+
+  // Checks seconds until u32BudgetUs have gone by.  Returns true while there are
+  // more to do.
+  bool Service(uint32_t u32BudgetUs);
+
+  bool     IsActive()     const { return _u32Left != 0; }
+  uint32_t Failures()     const { return _u32Failures; }
+
+  void PrintReport(Print &Out);
+
+protected:
+  void _StartYear(int iYear);
+  bool _Check(time_t tUtc);
+
+  tLocalTime    *_pLocalTime;
+  tTimeFormatter _pfnFormat;
+
+  time_t   _tStartUtc;
+  time_t   _tNextUtc;
+  uint32_t _u32Left;
+  uint32_t _u32Checked;
+  uint32_t _u32Failures;
+  uint32_t _u32Changes;
+  long     _lLastOffset;
+  uint32_t _ulStartMs;
+  uint32_t _ulElapsedMs;
+
+  // The reference's rules for the year _tNextUtc is in
+  time_t   _tYearEndUtc;
+  time_t   _tDstStartUtc;
+  time_t   _tDstEndUtc;
+  long     _lStdOffset;
+  long     _lDstOffset;
+
+  tTimeCheckFailure _Failures[TIMECHECK_MAX_FAILURES];
+};
+
+
+#endif   /* TIME_CHECK_H */
@@ -0,0 +1,292 @@
+/***************
+* NTP Clock
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "Timebase.h"
+
+
+/***************************************
+* tTimebase constructor
+*
+*/
+
+tTimebase::tTimebase()
+{
+  _u32LastMicros  = 0;
+  _u32MicrosWraps = 0;
+  _bSet           = false;
+  _u64RefUs       = 0;
+  _i64RefUtcMs    = 0;
+  _u32RefErrorMs  = 0;
+  _i32FreqPpb     = 0;
+  _bFreqKnown     = false;
+  _u32WanderPpb   = TIMEBASE_WANDER_UNKNOWN_PPB;
+  _i8Leap         = TIMEBASE_LEAP_NONE;
+  _i64LeapMs      = 0;
+  _bLeapSimulated = false;
+  _u32SmearMs     = 0;
+}
+
+
+/***************************************
+* tTimebase::MonotonicUs
+*
+* micros() is 32 bits.  Each time it comes back smaller than last time, it has
+* wrapped, and the wraps make up the top 32 bits.
+*/
+
+uint64_t tTimebase::MonotonicUs()
+{
+  uint32_t u32Micros = micros();
+
+  if (u32Micros < _u32LastMicros)  _u32MicrosWraps++;
+  _u32LastMicros = u32Micros;
+
+  return ((uint64_t) _u32MicrosWraps << 32) | u32Micros;
+}
+
+
+/***************************************
+* tTimebase::Sync
+*
+* Whatever the corrected clock is still off by, over the time since the last sync,
+* is the frequency error left.  The first measurement is taken whole; later ones
+* are averaged in a quarter at a time.  A measurement the two syncs' own errors
+* could account for on their own (syncs close together over a slow network) isn't
+* used.
+*
+* A server that has leapped is put back on the internal scale for this, and once
+* the leap (or smear) is over, the internal scale is dropped.
+*/
+
+void tTimebase::Sync(int64_t i64UtcMs, uint32_t u32ErrorMs, int8_t i8Leap)
+{
+  uint64_t u64NowUs      = MonotonicUs();
+  int64_t  i64InternalMs = i64UtcMs;
+  uint64_t u64ElapsedMs;
+  int64_t  i64ResidualMs;
+  int64_t  i64NoisePpb;
+  int32_t  i32ErrorPpb;
+
+  // During an inserted second the server is at 23:59:59 again, so whether it's the
+  // first or second time round is decided by which our own clock is nearer
+  if (_i8Leap != TIMEBASE_LEAP_NONE  &&  !_bLeapSimulated) {
+    if (i64UtcMs >= _i64LeapMs  ||
+        (_i8Leap == TIMEBASE_LEAP_INSERT  &&  i64UtcMs >= _i64LeapMs - 1000  &&  _InternalMs() > i64UtcMs + 500)) {
+      i64InternalMs += _i8Leap * 1000;
+    }
+  }
+
+  if (_bSet) {
+    u64ElapsedMs  = (u64NowUs - _u64RefUs) / 1000;
+    i64ResidualMs = i64InternalMs - (_i64RefUtcMs + _Corrected(u64NowUs - _u64RefUs) / 1000);
+    i64NoisePpb   = u64ElapsedMs ? ((int64_t) u32ErrorMs + _u32RefErrorMs) * 1000000000LL / (int64_t) u64ElapsedMs : 0;
+
+    if (u64ElapsedMs >= TIMEBASE_MIN_FREQ_MS  &&  i64NoisePpb <= TIMEBASE_MAX_FREQ_PPB) {
+      i32ErrorPpb = constrain(i64ResidualMs * 1000000000LL / (int64_t) u64ElapsedMs,
+                              -TIMEBASE_MAX_FREQ_PPB, TIMEBASE_MAX_FREQ_PPB);
+
+      _i32FreqPpb  += _bFreqKnown ? i32ErrorPpb / 4 : i32ErrorPpb;
+      _i32FreqPpb   = constrain(_i32FreqPpb, -TIMEBASE_MAX_FREQ_PPB, TIMEBASE_MAX_FREQ_PPB);
+      _bFreqKnown   = true;
+      _u32WanderPpb = constrain((uint32_t) abs(i32ErrorPpb), TIMEBASE_WANDER_MIN_PPB, TIMEBASE_WANDER_UNKNOWN_PPB);
+    }
+  }
+
+  _bSet          = true;
+  _u64RefUs      = u64NowUs;
+  _i64RefUtcMs   = i64InternalMs;
+  _u32RefErrorMs = u32ErrorMs;
+
+  if (_i8Leap != TIMEBASE_LEAP_NONE  &&  i64InternalMs >= _LeapEndMs()) {
+    _i64RefUtcMs = i64UtcMs;
+    _i8Leap      = TIMEBASE_LEAP_NONE;
+  }
+
+  if (_i8Leap == TIMEBASE_LEAP_NONE  ||  i64UtcMs < _i64LeapMs)  _Announced(i64UtcMs, i8Leap);
+}
+
+
+/***************************************
+* tTimebase::_Announced
+*
+* Schedules a leap for the coming midnight at the end of the month, or cancels one
+* that's no longer announced
+*/
+
+void tTimebase::_Announced(int64_t i64UtcMs, int8_t i8Leap)
+{
+  tmElements_t Tm;
+
+  if (_bLeapSimulated  &&  _i8Leap != TIMEBASE_LEAP_NONE)  return;
+
+  if (i8Leap == TIMEBASE_LEAP_NONE) {
+    _i8Leap = TIMEBASE_LEAP_NONE;
+    return;
+  }
+
+  breakTime((time_t) (i64UtcMs / 1000), Tm);
+  if (Tm.Day == 1)  return;
+
+  Tm.Day    = 1;
+  Tm.Hour   = 0;
+  Tm.Minute = 0;
+  Tm.Second = 0;
+  if (++Tm.Month > 12) {
+    Tm.Month = 1;
+    Tm.Year++;
+  }
+
+  _i8Leap         = i8Leap;
+  _i64LeapMs      = (int64_t) makeTime(Tm) * 1000;
+  _bLeapSimulated = false;
+}
+
+
+/***************************************
+* tTimebase::SimulateLeap
+*
+* RETURNS:
+*   false if we don't know the time yet
+*/
+
+bool tTimebase::SimulateLeap(int8_t i8Leap)
+{
+  if (!_bSet)  return false;
+
+  _i8Leap         = i8Leap;
+  _i64LeapMs      = (UtcMs() / 60000 + 1) * 60000;
+  _bLeapSimulated = true;
+  return true;
+}
+
+
+/***************************************
+* tTimebase::InLeapSecond
+*
+*/
+
+bool tTimebase::InLeapSecond()
+{
+  int64_t i64InternalMs;
+
+  if (_i8Leap != TIMEBASE_LEAP_INSERT  ||  _u32SmearMs != 0)  return false;
+
+  i64InternalMs = _InternalMs();
+  return i64InternalMs >= _i64LeapMs  &&  i64InternalMs < _i64LeapMs + 1000;
+}
+
+
+/***************************************
+* tTimebase::UtcMs
+*
+*/
+
+int64_t tTimebase::UtcMs()
+{
+  if (!_bSet)  return 0;
+
+  return _ToUtcMs(_InternalMs());
+}
+
+
+/***************************************
+* tTimebase::_InternalMs
+*
+* The time carried forward from the last sync, without any leap to come
+*/
+
+int64_t tTimebase::_InternalMs()
+{
+  return _i64RefUtcMs + _Corrected(MonotonicUs() - _u64RefUs) / 1000;
+}
+
+
+/***************************************
+* tTimebase::_ToUtcMs
+*
+* Takes a pending leap out of the internal time.  After an inserted second, UTC is
+* a second behind the internal time; after a deleted one, a second ahead.
+*/
+
+int64_t tTimebase::_ToUtcMs(int64_t i64InternalMs) const
+{
+  int64_t i64IntoSmearMs;
+
+  if (_i8Leap == TIMEBASE_LEAP_NONE)  return i64InternalMs;
+
+  if (_u32SmearMs != 0) {
+    i64IntoSmearMs = constrain(i64InternalMs - (_i64LeapMs - _u32SmearMs / 2), 0LL, (int64_t) _u32SmearMs);
+    return i64InternalMs - _i8Leap * 1000 * i64IntoSmearMs / _u32SmearMs;
+  }
+
+  // An inserted second is 23:59:59 over again; a deleted one never comes
+  if (_i8Leap == TIMEBASE_LEAP_INSERT)  return i64InternalMs < _i64LeapMs        ? i64InternalMs : i64InternalMs - 1000;
+  else                                  return i64InternalMs < _i64LeapMs - 1000 ? i64InternalMs : i64InternalMs + 1000;
+}
+
+
+/***************************************
+* tTimebase::_LeapEndMs
+*
+* When the leap is over, on the internal scale
+*/
+
+int64_t tTimebase::_LeapEndMs() const
+{
+  if (_u32SmearMs != 0)                 return _i64LeapMs + _u32SmearMs / 2;
+  if (_i8Leap == TIMEBASE_LEAP_INSERT)  return _i64LeapMs + 1000;
+  return _i64LeapMs - 1000;
+}
+
+
+/***************************************
+* tTimebase::ErrorMs
+*
+*/
+
+uint32_t tTimebase::ErrorMs()
+{
+  uint64_t u64ErrorMs;
+
+  if (!_bSet)  return TIMEBASE_ERROR_UNKNOWN;
+
+  u64ErrorMs = _u32RefErrorMs + (uint64_t) HoldoverMs() * (_bFreqKnown ? _u32WanderPpb : TIMEBASE_WANDER_UNKNOWN_PPB) / 1000000000ULL;
+  return u64ErrorMs < TIMEBASE_ERROR_UNKNOWN ? (uint32_t) u64ErrorMs : TIMEBASE_ERROR_UNKNOWN - 1;
+}
+
+
+/***************************************
+* tTimebase::HoldoverMs
+*
+*/
+
+uint32_t tTimebase::HoldoverMs()
+{
+  uint64_t u64HoldoverMs;
+
+  if (!_bSet)  return 0;
+
+  u64HoldoverMs = (MonotonicUs() - _u64RefUs) / 1000;
+  return u64HoldoverMs < 0xFFFFFFFFULL ? (uint32_t) u64HoldoverMs : 0xFFFFFFFFUL;
+}
+
+
+/***************************************
+* tTimebase::_Corrected
+*
+* Applies the frequency correction to a stretch of monotonic time.  The
+* correction is worked out per millisecond, so it can't overflow in any holdover
+* we'll ever see.
+*
+* RETURNS:
+*   Microseconds
+*/
+
+int64_t tTimebase::_Corrected(uint64_t u64ElapsedUs) const
+{
+  return (int64_t) u64ElapsedUs + (int64_t) (u64ElapsedUs / 1000) * _i32FreqPpb / 1000000;
+}
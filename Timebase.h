@@ -0,0 +1,139 @@
+/***************
+* NTP Clock
+*
+* tTimebase is the clock's millisecond time.  TimeLib's now() only has whole
+* seconds and knows nothing of how good they are; this has:
+*
+*   - Monotonic time, from micros() with its wraps (every 71.6 minutes) counted, so
+*     it never steps and is good for 584,000 years.
+*   - UTC, carried forward from the last NTP sync by the monotonic time, corrected
+*     for how fast or slow our crystal runs.  The correction is measured from one
+*     sync to the next: whatever the corrected clock was still off by, over the time
+*     between.  It's smoothed, since each offset has some network noise in it.
+*   - An error estimate: the sync's own uncertainty (half the round trip), plus
+*     however far the crystal may have wandered since.  That grows the longer we go
+*     without a sync (holdover), faster if the frequency hasn't been measured yet.
+*
+* UTC steps at each sync by whatever it was off; it is only monotonic in between.
+*
+* Leap seconds: NTP replies announce one (the leap indicator) for the end of the
+* month, and Sync() passes that on.  Internally the time runs on through the leap
+* without a break; UtcMs() takes it out.  Either:
+*
+*   - Step: an inserted second repeats 23:59:59, with InLeapSecond() true the
+*     second time round, so the display can show 23:59:60.  A deleted second goes
+*     straight from 23:59:58 to 00:00:00.
+*   - Smear: with SetSmear(), the second is spread evenly over that many seconds,
+*     centred on midnight (86400 gives Google's noon-to-noon smear).  There's no
+*     23:59:60, and the time never stops or jumps; it's up to 0.5 s off true UTC
+*     at midnight, which the error estimate doesn't count.
+*
+* Since the leap is taken out by the timebase, the frequency measurement doesn't
+* see it.  An announcement withdrawn before midnight cancels the leap.  Servers
+* that keep announcing for a while after the leap are ignored on the first day of
+* the month, so that doesn't schedule another one a month on.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include <Arduino.h>
+#include <TimeLib.h>
+
+// A crystal off by more than this is broken, or the offsets are junk
+#define TIMEBASE_MAX_FREQ_PPB        (500000L)
+
+// Syncs closer together than this are too noisy to measure the frequency over
+#define TIMEBASE_MIN_FREQ_MS         (60000UL)
+
+// How far the frequency may wander: before it's been measured (the crystal's
+// tolerance), and at least, after (temperature and aging)
+#define TIMEBASE_WANDER_UNKNOWN_PPB  (100000UL)
+#define TIMEBASE_WANDER_MIN_PPB      (5000UL)
+
+#define TIMEBASE_ERROR_UNKNOWN       (0xFFFFFFFFUL)
+
+#define TIMEBASE_LEAP_NONE           (0)
+#define TIMEBASE_LEAP_INSERT         (1)
+#define TIMEBASE_LEAP_DELETE         (-1)
+
+
+class tTimebase {
+public:
+  tTimebase();
+
+  // Call at least once every 71 minutes, so no wrap of micros() goes unseen.  Any
+  // of the calls below will do.
+  void     Service() { MonotonicUs(); }
+
+  uint64_t MonotonicUs();
+  uint64_t MonotonicMs() { return MonotonicUs() / 1000; }
+
+  // Sets UTC, and measures the frequency from the last sync.  u32ErrorMs is how
+  // far i64UtcMs might be off.  i8Leap is a TIMEBASE_LEAP_ announced for the end
+  // of the month.
+  void     Sync(int64_t i64UtcMs, uint32_t u32ErrorMs, int8_t i8Leap = TIMEBASE_LEAP_NONE);
+
+  bool     IsSet() const { return _bSet; }
+
+  // Milliseconds since 1970, or 0 if we've never synced
+  int64_t  UtcMs();
+
+  // How far UtcMs() might be off, or TIMEBASE_ERROR_UNKNOWN if we've never synced
+  uint32_t ErrorMs();
+
+  // How long since the last sync
+  uint32_t HoldoverMs();
+
+  // Parts per billion added to the monotonic rate; positive if our crystal is slow
+  int32_t  FreqPpb()   const { return _i32FreqPpb; }
+  bool     FreqKnown() const { return _bFreqKnown; }
+
+  // Spreads leap seconds over u32Seconds; 0 (the default) steps them
+  void     SetSmear(uint32_t u32Seconds) { _u32SmearMs = u32Seconds * 1000; }
+
+  // For testing: a leap at the end of the current minute, as if announced.  Once
+  // it's done, the next sync puts the time back, since the server didn't leap.
+  bool     SimulateLeap(int8_t i8Leap);
+
+  // The leap to come, if any (a TIMEBASE_LEAP_), and when, in Unix seconds
+  int8_t   LeapPending() const { return _i8Leap; }
+  time_t   LeapTime()    const { return (time_t) (_i64LeapMs / 1000); }
+
+  // True during an inserted second, when stepping
+  bool     InLeapSecond();
+
+protected:
+  int64_t  _Corrected(uint64_t u64ElapsedUs) const;
+  int64_t  _InternalMs();
+  int64_t  _ToUtcMs(int64_t i64InternalMs) const;
+  int64_t  _LeapEndMs() const;
+  void     _Announced(int64_t i64UtcMs, int8_t i8Leap);
+
+  uint32_t _u32LastMicros;
+  uint32_t _u32MicrosWraps;
+
+  // The last sync: monotonic and UTC time, and the UTC's uncertainty.  Until a
+  // leap is done, the UTC is on the internal scale, which doesn't have it.
+  bool     _bSet;
+  uint64_t _u64RefUs;
+  int64_t  _i64RefUtcMs;
+  uint32_t _u32RefErrorMs;
+
+  int32_t  _i32FreqPpb;
+  bool     _bFreqKnown;
+  uint32_t _u32WanderPpb;
+
+  // The leap to come: which way, and the midnight it's at
+  int8_t   _i8Leap;
+  int64_t  _i64LeapMs;
+  bool     _bLeapSimulated;
+  uint32_t _u32SmearMs;
+};
+
+
+#endif   /* TIMEBASE_H */
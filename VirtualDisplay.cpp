@@ -0,0 +1,214 @@
+/***************
+* NTP Clock
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "VirtualDisplay.h"
+#include "ClockDisplay.h"
+
+
+// Where each of segments a-g and dp sits within a PPM digit cell: x0, y0, x1, y1,
+// with the far corner exclusive.  The PPM draws 7-segment digits only.
+static const uint8_t _SegmentRects[8][4] PROGMEM = {
+  { 1,  0, 5,  1 },    // a
+  { 5,  1, 6,  5 },    // b
+  { 5,  6, 6, 10 },    // c
+  { 1, 10, 5, 11 },    // d
+  { 0,  6, 1, 10 },    // e
+  { 0,  1, 1,  5 },    // f
+  { 1,  5, 5,  6 },    // g
+  { 6, 10, 7, 11 }     // dp
+};
+
+// Indexed by CLOCK_ANNUNCIATOR
+static const char * const _AnnunciatorNames[CLOCK_NUM_ANNUNCIATORS] = {
+  "AM", "PM", "ALARM", "COLON", "COLON2"
+};
+
+
+/***************************************
+* tVirtualDisplay constructor
+*
+*/
+
+tVirtualDisplay::tVirtualDisplay(const tDisplayGeometry &Geometry, const tMax6954Model &Model) :
+  _Geometry(Geometry),
+  _Model(Model),
+  _u8Plane(0)
+{
+}
+
+
+/***************************************
+* tVirtualDisplay::Segment
+*
+* INPUTS:
+*   u8Digit   - 0 to the geometry's u8NumDigits-1
+*   u8Segment - 0-6 for a-g, 7 for dp (or a bit of the 14/16-segment font)
+*/
+
+VIRTUAL_SEG tVirtualDisplay::Segment(uint8_t u8Digit, uint8_t u8Segment) const
+{
+  if (u8Digit >= _Geometry.u8NumDigits  ||  u8Segment >= GEOM_SEGS_PER_DIGIT)  return VIRTUAL_SEG_ABSENT;
+
+  return _Lookup(_Geometry.pDigitSegs[u8Digit][u8Segment]);
+}
+
+
+/***************************************
+* tVirtualDisplay::Annunciator
+*
+*/
+
+VIRTUAL_SEG tVirtualDisplay::Annunciator(uint8_t u8Annunciator) const
+{
+  if (u8Annunciator >= _Geometry.u8NumAnnunciators)  return VIRTUAL_SEG_ABSENT;
+
+  return _Lookup(_Geometry.pAnnunciators[u8Annunciator]);
+}
+
+
+/***************************************
+* tVirtualDisplay::_Lookup
+*
+* Works out whether the chip is lighting the LED at Loc.  A chip in shutdown shows
+* nothing, and display test lights everything.
+*/
+
+VIRTUAL_SEG tVirtualDisplay::_Lookup(const tSegmentLoc &Loc) const
+{
+  const tImageReg *pReg;
+
+  if (Loc.u8Mask == 0  ||  Loc.u8Reg >= _Geometry.u8NumRegs)  return VIRTUAL_SEG_ABSENT;
+
+  pReg = &_Geometry.pRegs[Loc.u8Reg];
+
+  if (_Model.Register(MAX6954_REG_DisplayTest) & 0x01)  return VIRTUAL_SEG_ON;
+  if (!(_Model.Register(MAX6954_REG_Configuration) & MAX6954_CFG_SHUTDOWN_MODE))  return VIRTUAL_SEG_OFF;
+
+  return (_Model.DigitPlane(pReg->u8MaxDigit, _u8Plane) & Loc.u8Mask) ? VIRTUAL_SEG_ON : VIRTUAL_SEG_OFF;
+}
+
+
+/***************************************
+* tVirtualDisplay::PrintAscii
+*
+* For example, the LiteOn panel showing 12:34 PM prints
+*
+*        _   _
+*     |  _|  _| |_|
+*     | |_   _|   |
+*   AM. PM* ALARM. COLON*
+*
+* The colon shows up in the annunciator line rather than between the digits.
+*/
+
+void tVirtualDisplay::PrintAscii(Print &Out) const
+{
+  // Which segment, if any, goes in each of the four columns of the three rows
+  static const int8_t RowSegs[3][4] = {
+    { -1, 0, -1, -1 },     //  a
+    {  5, 6,  1, -1 },     // f g b
+    {  4, 3,  2,  7 }      // e d c dp
+  };
+  static const char RowChars[3][4] = {
+    { ' ', '_', ' ', ' ' },
+    { '|', '_', '|', ' ' },
+    { '|', '_', '|', '.' }
+  };
+  uint8_t d, r, c, a;
+  int8_t  iSeg;
+
+  for (r=0; r<3; r++) {
+    for (d=0; d<_Geometry.u8NumDigits; d++) {
+      for (c=0; c<4; c++) {
+        iSeg = RowSegs[r][c];
+        Out.print((iSeg >= 0  &&  Segment(d, iSeg) == VIRTUAL_SEG_ON) ? RowChars[r][c] : ' ');
+      }
+    }
+    Out.println();
+  }
+
+  for (a=0; a<CLOCK_NUM_ANNUNCIATORS; a++) {
+    if (Annunciator(a) == VIRTUAL_SEG_ABSENT)  continue;
+    Out.print(_AnnunciatorNames[a]);
+    Out.print(Annunciator(a) == VIRTUAL_SEG_ON ? "* " : ". ");
+  }
+  Out.println();
+}
+
+
+/***************************************
+* tVirtualDisplay::_Pixel
+*
+* INPUTS:
+*   x, y - cell coordinates in the unscaled image
+* RETURNS:
+*   VIRTUAL_SEG_ABSENT for background
+*/
+
+VIRTUAL_SEG tVirtualDisplay::_Pixel(int x, int y) const
+{
+  int     iDigit, iX, a;
+  uint8_t s;
+
+  // Annunciator row
+  if (y == VIRTUAL_PPM_DIGIT_HEIGHT) {
+    a = x / VIRTUAL_PPM_ANN_WIDTH;
+    if (x % VIRTUAL_PPM_ANN_WIDTH == VIRTUAL_PPM_ANN_WIDTH-1  ||  a >= CLOCK_NUM_ANNUNCIATORS)  return VIRTUAL_SEG_ABSENT;
+    return Annunciator(a);
+  }
+
+  iDigit = x / VIRTUAL_PPM_DIGIT_WIDTH;
+  iX     = x % VIRTUAL_PPM_DIGIT_WIDTH;
+  if (iDigit >= _Geometry.u8NumDigits)  return VIRTUAL_SEG_ABSENT;
+
+  for (s=0; s<GEOM_NUM_OF(_SegmentRects); s++) {
+    if (iX >= pgm_read_byte(&_SegmentRects[s][0])  &&  y >= pgm_read_byte(&_SegmentRects[s][1])  &&
+        iX <  pgm_read_byte(&_SegmentRects[s][2])  &&  y <  pgm_read_byte(&_SegmentRects[s][3])) {
+      return Segment(iDigit, s);
+    }
+  }
+
+  return VIRTUAL_SEG_ABSENT;
+}
+
+
+/***************************************
+* tVirtualDisplay::WritePpm
+*
+* The image is produced a row at a time, so there's no frame buffer to allocate.
+*/
+
+void tVirtualDisplay::WritePpm(Print &Out, uint8_t u8Scale) const
+{
+  static const uint8_t Colors[3][3] = {
+    {   0, 0, 0 },     // VIRTUAL_SEG_ABSENT
+    {  48, 0, 0 },     // VIRTUAL_SEG_OFF
+    { 255, 0, 0 }      // VIRTUAL_SEG_ON
+  };
+  int      iWidth, iHeight, x, y;
+  uint8_t  i;
+  const uint8_t *pColor;
+
+  if (u8Scale == 0)  u8Scale = 1;
+
+  iWidth  = _Geometry.u8NumDigits * VIRTUAL_PPM_DIGIT_WIDTH;
+  if (iWidth < CLOCK_NUM_ANNUNCIATORS * VIRTUAL_PPM_ANN_WIDTH)  iWidth = CLOCK_NUM_ANNUNCIATORS * VIRTUAL_PPM_ANN_WIDTH;
+  iHeight = VIRTUAL_PPM_HEIGHT;
+
+  Out.print("P6\n");
+  Out.print(iWidth * u8Scale);
+  Out.print(' ');
+  Out.print(iHeight * u8Scale);
+  Out.print("\n255\n");
+
+  for (y=0; y<iHeight*u8Scale; y++) {
+    for (x=0; x<iWidth*u8Scale; x++) {
+      pColor = Colors[_Pixel(x / u8Scale, y / u8Scale)];
+      for (i=0; i<3; i++)  Out.write(pColor[i]);
+    }
+  }
+}
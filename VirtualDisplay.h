@@ -0,0 +1,69 @@
+/***************
+* NTP Clock
+*
+* tVirtualDisplay shows what the panel would look like, given what a tMax6954Model
+* says the chip's registers hold.  It works backwards through a tDisplayGeometry:
+* for every digit segment and annunciator the geometry knows about, it looks up the
+* register and bit that drive it and checks whether that bit is set.
+*
+* Because the model is fed from the SPI trace, this exercises the whole path from
+* tClockDisplay::Update() down to the bits on the wire, with no LEDs involved.  The
+* result can be printed as ASCII art, or written as a binary PPM image for comparing
+* against a known-good picture.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef VIRTUAL_DISPLAY_H
+#define VIRTUAL_DISPLAY_H
+
+#include <Arduino.h>
+#include "Max6954Model.h"
+#include "DisplayGeometry.h"
+
+// State of one segment on the virtual panel
+typedef enum {
+  VIRTUAL_SEG_ABSENT,     // The geometry has no such segment
+  VIRTUAL_SEG_OFF,
+  VIRTUAL_SEG_ON
+} VIRTUAL_SEG;
+
+// PPM layout, in cells of u8Scale x u8Scale pixels.  Each digit is 7 x 11 cells with
+// a one cell gap, and the annunciators are 2 x 1 blocks in a row underneath.
+#define VIRTUAL_PPM_DIGIT_WIDTH   (8)
+#define VIRTUAL_PPM_DIGIT_HEIGHT  (12)
+#define VIRTUAL_PPM_ANN_WIDTH     (3)
+#define VIRTUAL_PPM_HEIGHT        (VIRTUAL_PPM_DIGIT_HEIGHT + 2)
+
+
+class tVirtualDisplay {
+public:
+  tVirtualDisplay(const tDisplayGeometry &Geometry, const tMax6954Model &Model);
+
+  // Which blink plane to show.  The chip alternates between the two when global
+  // blink is on; otherwise it shows plane 0.
+  void SetPlane(uint8_t u8Plane) { _u8Plane = u8Plane & 1; }
+
+  VIRTUAL_SEG Segment(uint8_t u8Digit, uint8_t u8Segment) const;
+  VIRTUAL_SEG Annunciator(uint8_t u8Annunciator) const;
+
+  // Three lines of digits in the usual " _ |_| |_|" style, then a line listing the
+  // annunciators the panel has, each followed by '*' if lit or '.' if not
+  void PrintAscii(Print &Out) const;
+
+  // A binary (P6) PPM image.  Lit segments are red, dark ones dim red.
+  void WritePpm(Print &Out, uint8_t u8Scale = 4) const;
+
+protected:
+  VIRTUAL_SEG _Lookup(const tSegmentLoc &Loc) const;
+  VIRTUAL_SEG _Pixel(int x, int y) const;
+
+  const tDisplayGeometry &_Geometry;
+  const tMax6954Model    &_Model;
+  uint8_t                 _u8Plane;
+};
+
+
+#endif   /* VIRTUAL_DISPLAY_H */
@@ -6,21 +6,24 @@
 */
 
 #include "WiFiConnection.h"
+#include "Log.h"
+#include "Crc.h"
 
 /***************************************
 * tWiFiConnection constructor
 *
 * INPUTS:
-*   sSsid     - a string containing the SSID of your router, e.g. "MyNetGearWiFi"
-*   sPassword - The password for your wifi as a string, e.g. "LotsOfGerbils"
-*   iLedPin   - which ESP8266 GPIO pin to use for connection status.  Recommend using
-*               2, which is the LED on the ESP8266 module itself.  If you specify 0, 
-*               no LED will be used, and you can use the LED pins for other things.
+*   pNetworks     - the SSIDs and passwords of the networks to use, in order of
+*                   preference when signal strengths are equal
+*   u8NumNetworks - how many
+*   iLedPin       - which ESP8266 GPIO pin to use for connection status.  Recommend using
+*                   2, which is the LED on the ESP8266 module itself.  If you specify 0, 
+*                   no LED will be used, and you can use the LED pins for other things.
 */
 
-tWiFiConnection::tWiFiConnection(const char *sSsid, const char *sPassword, int iLedPin) :
-  _sSsid(sSsid), 
-  _sPassword(sPassword), 
+tWiFiConnection::tWiFiConnection(const tWiFiCredential *pNetworks, uint8_t u8NumNetworks, int iLedPin) :
+  _pNetworks(pNetworks), 
+  _u8NumNetworks(min(u8NumNetworks, (uint8_t) WIFI_MAX_NETWORKS)), 
   _iLedPin(iLedPin)
 {
   // Init the display pin as an output
@@ -30,63 +33,532 @@ tWiFiConnection::tWiFiConnection(const char *sSsid, const char *sPassword, int i
     digitalWrite(_iLedPin, 1);
   }
 
-  _status = WL_IDLE_STATUS;
+  _status       = WL_IDLE_STATUS;
+  _u8State      = WIFI_STATE_DISABLED;
+  _bEnabled     = true;
+  _ulStateMs    = 0;
+  _u32BackoffMs = WIFI_BACKOFF_MIN_MS;
+  _u32WaitMs    = 0;
+  _u32Connects  = 0;
+  _u32Drops     = 0;
+  _u32Failovers = 0;
+
+  _u8NumCandidates = 0;
+  _u8Candidate     = 0;
+  _u8Network       = 0;
+  memset(_Quality, 0, sizeof(_Quality));
+
+  _i16RssiX16    = 0;
+  _ulWeakSinceMs = 0;
+  _ulScanStartMs = 0;
+  _bWeak         = false;
+  _bFailoverScan = false;
+
+  _bCacheValid        = false;
+  _bCachedAttempt     = false;
+  _u32LastConnectMs   = 0;
+  _bLastConnectCached = false;
 }
 
 
 /***************************************
-* tWiFiConnection::ConnectToRouter
-*
-* Forge a connection to the WiFi router
+* tWiFiConnection::Begin
 *
-* Will try connecting at 10-second intervals.
+* We do our own reconnecting, so the SDK's is turned off, and the credentials are
+* kept out of flash since they're compiled in anyway.
+*/
+
+void tWiFiConnection::Begin(uint32_t ulNowMs)
+{
+  if (GetStatus() == WL_NO_SHIELD  ||  _u8NumNetworks == 0) {
+    Serial.println(F("WiFi-capable hardware not present"));
+    _u8State = WIFI_STATE_NO_HARDWARE;
+    return;
+  }
+
+  WiFi.persistent(false);
+  WiFi.mode(WIFI_STA);
+  WiFi.setAutoReconnect(false);
+
+  _LoadCache();
+  if (_bEnabled)  _Start(ulNowMs);
+}
+
+
+/***************************************
+* tWiFiConnection::Service
 *
 * INPUTS:
-*   iNumTimesToTry - will try this many times before returning.  Set to 0 to
-*                    try forever.
+*   ulNowMs - the current millis()
 * RETURNS:
 *   true if connected to the router
-*   false if failed after iNumTimesToTry
-*  
 */
 
-bool tWiFiConnection::ConnectToRouter(int iNumTimesToTry)
-{ 
-  bool bKeepTrying = true;
+bool tWiFiConnection::Service(uint32_t ulNowMs)
+{
+  int iStatus = GetStatus();
+  int iFound;
 
-  _status = GetStatus();
-  if (_status == WL_NO_SHIELD) {
-    Serial.println(F("WiFi-capable hardware not present"));
-    return false;
-  }
+  switch (_u8State) {
+    case WIFI_STATE_SCANNING:
+      iFound = _ScanResult(ulNowMs);
+      if (iFound == WIFI_SCAN_RUNNING)  break;
 
-  while (bKeepTrying) {
+      LOG(LOG_INFO, LOG_MSG_WIFI_SCAN, iFound, _u8NumCandidates ? _Candidates[0].i8Rssi : WIFI_RSSI_UNSEEN);
+      _TryCandidate(0, ulNowMs);
+      break;
 
-    while (_status != WL_CONNECTED) {
-      Serial.print(F("Attempting to connect to SSID: "));
-      Serial.print(_sSsid);
-      // Connect to WPA/WPA2 network. Change this line if using open or WEP network:
-      WiFi.begin(_sSsid, _sPassword);
+    case WIFI_STATE_CONNECTING:
+      if (iStatus == WL_CONNECTED) {
+        _Connected(ulNowMs);
+      }
+      else if (iStatus == WL_CONNECT_FAILED  ||  iStatus == WL_NO_SSID_AVAIL  ||
+               ulNowMs - _ulStateMs > (_bCachedAttempt ? WIFI_FAST_TIMEOUT_MS : WIFI_CONNECT_TIMEOUT_MS)) {
+        _Failed(iStatus, ulNowMs);
+      }
+      break;
 
-      // wait 10 seconds for connection:
-      for (int iWait = 0; iWait < WIFI_SECONDS_BETWEEN_CONNECTION_TRIES; iWait++) {
-        Serial.print(F("."));
-        delay(1000);
-        if (GetStatus() == WL_CONNECTED) {
-          bKeepTrying = false;
-          break;
-        }
+    case WIFI_STATE_CONNECTED:
+      if (iStatus != WL_CONNECTED) {
+        _LeaveConnected(ulNowMs);
+        _u32Drops++;
+        _Quality[_u8Network].u32Drops++;
+        _Penalize(_u8Network);
+        LOG(LOG_WARN, LOG_MSG_WIFI_LOST, iStatus);
+        _Start(ulNowMs);
+      }
+      else {
+        _CheckSignal(ulNowMs);
       }
+      break;
+
+    case WIFI_STATE_BACKOFF:
+      if (ulNowMs - _ulStateMs >= _u32WaitMs)  _Start(ulNowMs);
+      break;
+
+    default:
+      break;
+  }
+
+  return _u8State == WIFI_STATE_CONNECTED;
+}
+
+
+/***************************************
+* tWiFiConnection::SetEnabled
+*
+* Disabling doesn't touch the radio; whoever turned it off has done that.
+*/
+
+void tWiFiConnection::SetEnabled(bool bEnabled, uint32_t ulNowMs)
+{
+  if (bEnabled == _bEnabled)  return;
+  _bEnabled = bEnabled;
+
+  if (_u8State == WIFI_STATE_NO_HARDWARE)  return;
+
+  if (bEnabled) {
+    _u32BackoffMs = WIFI_BACKOFF_MIN_MS;
+    _Start(ulNowMs);
+  }
+  else {
+    if (_u8State == WIFI_STATE_CONNECTED)  _LeaveConnected(ulNowMs);
+    if (_u8State == WIFI_STATE_SCANNING  ||  _bFailoverScan)  WiFi.scanDelete();
+    _bFailoverScan = false;
+
+    _u8State   = WIFI_STATE_DISABLED;
+    _ulStateMs = ulNowMs;
+  }
+}
+
+
+/***************************************
+* tWiFiConnection::_Start
+*
+* Starts connecting: straight from the cache if we have one, else by scanning
+*/
+
+void tWiFiConnection::_Start(uint32_t ulNowMs)
+{
+  if (!_bCacheValid) {
+    _StartScan(ulNowMs);
+    return;
+  }
+
+  _bCachedAttempt = true;
+  _u8Network      = _Cache.u8Network;
+  _u8NumCandidates = 0;
+
+  WiFi.config(IPAddress(_Cache.u32Ip), IPAddress(_Cache.u32Gateway),
+              IPAddress(_Cache.u32Subnet), IPAddress(_Cache.u32Dns));
+  WiFi.begin(_pNetworks[_u8Network].sSsid, _pNetworks[_u8Network].sPassword,
+             _Cache.u8Channel, _Cache.u8Bssid);
+
+  _u8State   = WIFI_STATE_CONNECTING;
+  _ulStateMs = ulNowMs;
+}
+
+
+/***************************************
+* tWiFiConnection::_StartScan
+*
+*/
+
+void tWiFiConnection::_StartScan(uint32_t ulNowMs)
+{
+  // Stop any attempt still going, so it doesn't fight the scan
+  WiFi.disconnect();
+  WiFi.scanNetworks(true);
+
+  _ulScanStartMs = ulNowMs;
+  _u8State       = WIFI_STATE_SCANNING;
+  _ulStateMs     = ulNowMs;
+}
+
+
+/***************************************
+* tWiFiConnection::_ScanResult
+*
+* Picks up the results of an asynchronous scan, if it's finished, and ranks our
+* networks by them.  A scan that fails or takes too long counts as having found
+* nothing, which still leaves every network to try, unseen.
+*
+* RETURNS:
+*   WIFI_SCAN_RUNNING, or how many access points were found
+*/
+
+int tWiFiConnection::_ScanResult(uint32_t ulNowMs)
+{
+  int iFound = WiFi.scanComplete();
+
+  if (iFound == WIFI_SCAN_RUNNING) {
+    if (ulNowMs - _ulScanStartMs < WIFI_SCAN_TIMEOUT_MS)  return WIFI_SCAN_RUNNING;
+    iFound = 0;
+  }
+  if (iFound < 0)  iFound = 0;
+
+  _RankCandidates(iFound);
+  WiFi.scanDelete();
+
+  return iFound;
+}
+
+
+/***************************************
+* tWiFiConnection::_RankCandidates
+*
+* Fills _Candidates[] with every network, each with the strongest access point
+* the scan saw for it, and sorts them best first
+*/
+
+void tWiFiConnection::_RankCandidates(int iFound)
+{
+  tCandidate *pCandidate;
+  tCandidate  Swap;
+  uint8_t     u8Net, j;
+  int         i, iRssi;
+
+  _u8NumCandidates = 0;
+  for (u8Net=0; u8Net<_u8NumNetworks; u8Net++) {
+    if (_pNetworks[u8Net].sSsid[0] == '\0')  continue;      // An unused slot
+
+    pCandidate = &_Candidates[_u8NumCandidates++];
+    pCandidate->u8Network = u8Net;
+    pCandidate->i8Rssi    = WIFI_RSSI_UNSEEN;
+    pCandidate->u8Channel = 0;
+
+    for (i=0; i<iFound; i++) {
+      if (strcmp(WiFi.SSID(i).c_str(), _pNetworks[u8Net].sSsid) != 0)  continue;
+
+      iRssi = WiFi.RSSI(i);
+      if (iRssi <= pCandidate->i8Rssi)  continue;
+
+      pCandidate->i8Rssi    = iRssi;
+      pCandidate->u8Channel = WiFi.channel(i);
+      memcpy(pCandidate->u8Bssid, WiFi.BSSID(i), sizeof(pCandidate->u8Bssid));
+    }
+  }
+
+  // Insertion sort; it's a handful of entries, and equal scores keep list order
+  for (u8Net=1; u8Net<_u8NumCandidates; u8Net++) {
+    for (j=u8Net; j>0  &&  _Score(j) > _Score(j-1); j--) {
+      Swap               = _Candidates[j];
+      _Candidates[j]     = _Candidates[j-1];
+      _Candidates[j-1]   = Swap;
+    }
+  }
+}
+
+
+/***************************************
+* tWiFiConnection::_Score
+*
+* Signal strength less the network's penalty.  Unseen networks go after every
+* seen one.
+*/
+
+int tWiFiConnection::_Score(uint8_t u8Candidate) const
+{
+  const tCandidate &Candidate = _Candidates[u8Candidate];
+  int               iScore    = Candidate.i8Rssi - _Quality[Candidate.u8Network].u8PenaltyDb;
+
+  if (Candidate.u8Channel == 0)  iScore -= 1000;
+  return iScore;
+}
+
+
+/***************************************
+* tWiFiConnection::_TryCandidate
+*
+*/
+
+void tWiFiConnection::_TryCandidate(uint8_t u8Candidate, uint32_t ulNowMs)
+{
+  const tCandidate      &Candidate = _Candidates[u8Candidate];
+  const tWiFiCredential &Network   = _pNetworks[Candidate.u8Network];
+
+  _u8Candidate    = u8Candidate;
+  _u8Network      = Candidate.u8Network;
+  _bCachedAttempt = false;
+
+  LOG(LOG_INFO, LOG_MSG_WIFI_TRYING, _u8Network, Candidate.i8Rssi);
+
+  // All zeros turns DHCP back on, in case the cache had set a static address.
+  // Connect to WPA/WPA2 network. Change this line if using open or WEP network:
+  WiFi.config(IPAddress(0u), IPAddress(0u), IPAddress(0u));
+  if (Candidate.u8Channel != 0)  WiFi.begin(Network.sSsid, Network.sPassword, Candidate.u8Channel, Candidate.u8Bssid);
+  else                           WiFi.begin(Network.sSsid, Network.sPassword);
+
+  _u8State   = WIFI_STATE_CONNECTING;
+  _ulStateMs = ulNowMs;
+}
+
 
-      PrintStatus();
+/***************************************
+* tWiFiConnection::_Failed
+*
+* An attempt didn't work.  Move on to the next thing to try.
+*/
+
+void tWiFiConnection::_Failed(int iStatus, uint32_t ulNowMs)
+{
+  if (_bCachedAttempt) {
+    // The router has moved, or our lease is no good.  Go the long way round.
+    LOG(LOG_WARN, LOG_MSG_WIFI_CACHE_MISS, iStatus);
+    _DropCache();
+    _StartScan(ulNowMs);
+    return;
+  }
+
+  _Quality[_u8Network].u32Failures++;
+  _Penalize(_u8Network);
+
+  if (_u8Candidate + 1 < _u8NumCandidates) {
+    _TryCandidate(_u8Candidate + 1, ulNowMs);
+    return;
+  }
+
+  _Backoff(ulNowMs);
+  LOG(LOG_WARN, LOG_MSG_WIFI_FAILED, iStatus, _u32WaitMs);
+}
+
+
+/***************************************
+* tWiFiConnection::_Backoff
+*
+* Gives up for now and picks how long to wait before scanning again: the
+* current backoff plus up to a quarter more at random.  The backoff doubles for
+* next time.
+*/
+
+void tWiFiConnection::_Backoff(uint32_t ulNowMs)
+{
+  WiFi.disconnect();
+
+  _u32WaitMs    = _u32BackoffMs + random(_u32BackoffMs / 4 + 1);
+  _u32BackoffMs = min(_u32BackoffMs * 2, (uint32_t) WIFI_BACKOFF_MAX_MS);
+
+  _u8State   = WIFI_STATE_BACKOFF;
+  _ulStateMs = ulNowMs;
+}
+
+
+/***************************************
+* tWiFiConnection::_Connected
+*
+*/
+
+void tWiFiConnection::_Connected(uint32_t ulNowMs)
+{
+  tWiFiQuality &Quality = _Quality[_u8Network];
+
+  _u32LastConnectMs   = ulNowMs - _ulStateMs;
+  _bLastConnectCached = _bCachedAttempt;
+  if (!_bCachedAttempt)  _SaveCache();
+
+  _u8State      = WIFI_STATE_CONNECTED;
+  _ulStateMs    = ulNowMs;
+  _u32BackoffMs = WIFI_BACKOFF_MIN_MS;
+  _u32Connects++;
+
+  Quality.u32Connects++;
+  Quality.u8PenaltyDb /= 2;
+
+  _i16RssiX16    = WiFi.RSSI() * 16;
+  _bWeak         = false;
+  _bFailoverScan = false;
+
+  LOG(LOG_INFO, LOG_MSG_WIFI_CONNECTED, WiFi.channel(), WiFi.RSSI());
+  LOG(LOG_INFO, LOG_MSG_WIFI_CONNECT_TIME, _u32LastConnectMs, _bCachedAttempt);
+}
+
+
+/***************************************
+* tWiFiConnection::_LeaveConnected
+*
+* Books the time and signal of the connection that's ending
+*/
+
+void tWiFiConnection::_LeaveConnected(uint32_t ulNowMs)
+{
+  tWiFiQuality &Quality = _Quality[_u8Network];
+
+  Quality.u32ConnectedSec += (ulNowMs - _ulStateMs) / 1000;
+  Quality.i8RssiAvg        = _i16RssiX16 / 16;
+  _ulStateMs               = ulNowMs;
+}
+
+
+/***************************************
+* tWiFiConnection::_CheckSignal
+*
+* Averages the signal, and if it's been weak for a while, looks for something
+* better: a background scan, then a move if the best network or access point
+* beats ours by WIFI_FAILOVER_MARGIN_DB.  Either way the weak timer starts over,
+* so we don't keep scanning.
+*/
+
+void tWiFiConnection::_CheckSignal(uint32_t ulNowMs)
+{
+  const tCandidate *pBest;
+  int               iFound;
+
+  if (_bFailoverScan) {
+    iFound = _ScanResult(ulNowMs);
+    if (iFound == WIFI_SCAN_RUNNING)  return;
+
+    _bFailoverScan = false;
+    _bWeak         = false;
+
+    pBest = &_Candidates[0];
+    if (pBest->u8Channel != 0  &&  pBest->i8Rssi >= _i16RssiX16 / 16 + WIFI_FAILOVER_MARGIN_DB  &&
+        memcmp(pBest->u8Bssid, WiFi.BSSID(), sizeof(pBest->u8Bssid)) != 0) {
+      LOG(LOG_WARN, LOG_MSG_WIFI_FAILOVER, _i16RssiX16 / 16, _u8Network, pBest->u8Network);
+      _u32Failovers++;
+      _LeaveConnected(ulNowMs);
+      _TryCandidate(0, ulNowMs);
     }
+    return;
+  }
 
-    // If iNumTimesToTry is non-zero, decrement it.  If it reaches 0, stop trying
-    if (iNumTimesToTry > 0 && --iNumTimesToTry < 1)  bKeepTrying = false;
+  _i16RssiX16 += (WiFi.RSSI() * 16 - _i16RssiX16) / 8;
+
+  if (_i16RssiX16 >= WIFI_WEAK_RSSI_DBM * 16) {
+    _bWeak = false;
+  }
+  else if (!_bWeak) {
+    _bWeak         = true;
+    _ulWeakSinceMs = ulNowMs;
+  }
+  else if (ulNowMs - _ulWeakSinceMs >= WIFI_WEAK_MS) {
+    WiFi.scanNetworks(true);
+    _ulScanStartMs = ulNowMs;
+    _bFailoverScan = true;
   }
+}
+
+
+/***************************************
+* tWiFiConnection::_Penalize
+*
+*/
+
+void tWiFiConnection::_Penalize(uint8_t u8Network)
+{
+  tWiFiQuality &Quality = _Quality[u8Network];
 
-  Serial.println(F("\n*** Connected to wifi ***\n"));
-  PrintInfo();
+  Quality.u8PenaltyDb = min(Quality.u8PenaltyDb + WIFI_PENALTY_STEP_DB, WIFI_PENALTY_MAX_DB);
+}
+
+
+/***************************************
+* tWiFiConnection::_NetworkCrc
+*
+* Identifies the network the cache was made for, so new credentials don't try
+* the old router
+*/
+
+uint32_t tWiFiConnection::_NetworkCrc(uint8_t u8Network) const
+{
+  const tWiFiCredential &Network = _pNetworks[u8Network];
+
+  return Crc32(Network.sPassword, strlen(Network.sPassword), Crc32(Network.sSsid, strlen(Network.sSsid)));
+}
+
+
+/***************************************
+* tWiFiConnection::_LoadCache
+*
+*/
+
+void tWiFiConnection::_LoadCache()
+{
+  _bCacheValid = false;
+
+  if (!ESP.rtcUserMemoryRead(WIFI_RTC_BLOCK, (uint32_t *) &_Cache, sizeof(_Cache)))  return;
+
+  _bCacheValid = _Cache.u32Magic == WIFI_CACHE_MAGIC  &&
+                 _Cache.u32Crc == Crc32(&_Cache.u32NetworkCrc, sizeof(_Cache) - offsetof(tWiFiCache, u32NetworkCrc))  &&
+                 _Cache.u8Network < _u8NumNetworks  &&
+                 _Cache.u32NetworkCrc == _NetworkCrc(_Cache.u8Network)  &&
+                 _Cache.u32Ip != 0;
+}
+
+
+/***************************************
+* tWiFiConnection::_SaveCache
+*
+* Call when connected by DHCP
+*/
+
+void tWiFiConnection::_SaveCache()
+{
+  memset(&_Cache, 0, sizeof(_Cache));
+  _Cache.u32Magic      = WIFI_CACHE_MAGIC;
+  _Cache.u32NetworkCrc = _NetworkCrc(_u8Network);
+  _Cache.u32Ip         = WiFi.localIP();
+  _Cache.u32Gateway    = WiFi.gatewayIP();
+  _Cache.u32Subnet     = WiFi.subnetMask();
+  _Cache.u32Dns        = WiFi.dnsIP();
+  memcpy(_Cache.u8Bssid, WiFi.BSSID(), sizeof(_Cache.u8Bssid));
+  _Cache.u8Channel     = WiFi.channel();
+  _Cache.u8Network     = _u8Network;
+  _Cache.u32Crc        = Crc32(&_Cache.u32NetworkCrc, sizeof(_Cache) - offsetof(tWiFiCache, u32NetworkCrc));
+
+  _bCacheValid = ESP.rtcUserMemoryWrite(WIFI_RTC_BLOCK, (uint32_t *) &_Cache, sizeof(_Cache));
+}
+
+
+/***************************************
+* tWiFiConnection::_DropCache
+*
+*/
+
+void tWiFiConnection::_DropCache()
+{
+  _bCacheValid    = false;
+  _Cache.u32Magic = 0;
+  ESP.rtcUserMemoryWrite(WIFI_RTC_BLOCK, (uint32_t *) &_Cache, sizeof(_Cache));
 }
 
 
@@ -135,7 +607,7 @@ void tWiFiConnection::PrintStatus()
     case WL_NO_SHIELD:       Serial.println(F("No Shield"));         break;
     case WL_NO_SSID_AVAIL:   Serial.println(F("No SSID Available")); break;
     case WL_SCAN_COMPLETED:  Serial.println(F("Scan completed"));    break;
-    case WL_CONNECT_FAILED:  Serial.println(F("Scan completed"));    break;
+    case WL_CONNECT_FAILED:  Serial.println(F("Connect failed"));    break;
     case WL_CONNECTION_LOST: Serial.println(F("Connection lost"));   break;
     case WL_DISCONNECTED:    Serial.println(F("Disconnected"));      break;
     default:                 Serial.println(F("Unknown"));           break;
@@ -166,3 +638,41 @@ void tWiFiConnection::PrintInfo()
   Serial.print(rssi);
   Serial.println(F(" dBm"));
 }
+
+
+/***************************************
+* tWiFiConnection::PrintReport
+*
+* The connected time and average signal include the connection in progress
+*/
+
+void tWiFiConnection::PrintReport(Print &Out) const
+{
+  char     sLine[100];
+  uint32_t u32UpSec;
+  int8_t   i8Rssi;
+  uint8_t  i;
+  bool     bCurrent;
+
+  Out.println(F("  Network              Conns  Fails  Drops    Up s  RSSI  Penalty"));
+  for (i=0; i<_u8NumNetworks; i++) {
+    const tWiFiQuality &Quality = _Quality[i];
+
+    if (_pNetworks[i].sSsid[0] == '\0')  continue;
+
+    // Worked out here rather than booked, so looking doesn't change anything
+    bCurrent = i == _u8Network  &&  _u8State == WIFI_STATE_CONNECTED;
+    u32UpSec = Quality.u32ConnectedSec + (bCurrent ? (millis() - _ulStateMs) / 1000 : 0);
+    i8Rssi   = bCurrent ? _i16RssiX16 / 16 : Quality.i8RssiAvg;
+
+    snprintf(sLine, sizeof(sLine), "%c %-20.20s %5lu  %5lu  %5lu  %6lu  %4d  %4u dB",
+             bCurrent ? '*' : ' ',
+             _pNetworks[i].sSsid,
+             (unsigned long) Quality.u32Connects, (unsigned long) Quality.u32Failures,
+             (unsigned long) Quality.u32Drops, (unsigned long) u32UpSec,
+             i8Rssi, Quality.u8PenaltyDb);
+    Out.println(sLine);
+  }
+  Out.print(F("Failovers: "));
+  Out.println(_u32Failovers);
+}
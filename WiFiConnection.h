@@ -1,6 +1,40 @@
 /***************
 * tWifiConnection - Manages connection to the DHCP server
-* 
+*
+* A state machine run from the loop, so nothing waits on the router:
+*
+*   scanning -> connecting -> connected -> (link lost) -> connecting ...
+*       ^            |                                       |
+*       +-- backoff <+-- (failed or timed out, no more to try) +
+*
+* It is given a list of networks.  A scan finds which of them are in range, and
+* they're tried strongest first, each as a directed connect to the strongest
+* access point with that SSID.  Networks the scan didn't see (hidden ones, say)
+* are tried last, the ordinary way.  A network that fails or drops us is marked
+* down by a penalty, in dB, that halves each time it connects, so a flaky access
+* point sinks down the list without being given up on.
+*
+* When all of them have failed, it waits before scanning again, doubling the wait
+* each time up to WIFI_BACKOFF_MAX_MS, plus a random bit so a room full of clocks
+* doesn't hammer a router that's just rebooted all at the same moment.  A link
+* that drops after being up is retried right away.
+*
+* While connected, it keeps a running average of the signal.  If that stays below
+* WIFI_WEAK_RSSI_DBM for WIFI_WEAK_MS, it scans in the background, and moves to
+* the best network (or access point) if that is WIFI_FAILOVER_MARGIN_DB better.
+*
+* Meanwhile the clock keeps running from TimeLib's millis()-based time; callers
+* should just not use the network unless IsConnected().
+*
+* A normal connect scans every channel for the router and then waits for DHCP,
+* which takes a few seconds.  So once connected, we keep the network, the router's
+* BSSID and channel and our DHCP lease (IP, gateway, subnet, DNS) in RTC memory,
+* which survives a reset (though not a power cut), and try those first next time:
+* a directed connect on one channel with a static IP, which is usually up in a few
+* hundred ms.  If that doesn't work quickly, the cache is dropped and we scan.  The
+* cached IP is reused as is, so give the clock a DHCP reservation if the router
+* might hand its address to someone else while it's off.
+*
 * Brad Hines
 * Feb 2020
 */
@@ -10,22 +44,163 @@
 
 #include <ESP8266WiFi.h>
 
-#define WIFI_SECONDS_BETWEEN_CONNECTION_TRIES (10)
+#define WIFI_CONNECT_TIMEOUT_MS  (10000)
+#define WIFI_BACKOFF_MIN_MS      (1000)
+#define WIFI_BACKOFF_MAX_MS      (60000)
+#define WIFI_FAST_TIMEOUT_MS     (3000)      // For a connect from the cache
+#define WIFI_SCAN_TIMEOUT_MS     (10000)
+
+#define WIFI_MAX_NETWORKS        (4)
+#define WIFI_RSSI_UNSEEN         (-127)      // A network the scan didn't find
+#define WIFI_PENALTY_STEP_DB     (10)        // Per failure or drop
+#define WIFI_PENALTY_MAX_DB      (40)
+
+// When to look for something better than the network we're on
+#define WIFI_WEAK_RSSI_DBM       (-80)
+#define WIFI_WEAK_MS             (60000UL)
+#define WIFI_FAILOVER_MARGIN_DB  (10)
+
+// Where the cache lives in RTC user memory, in 4-byte blocks
+#define WIFI_RTC_BLOCK           (0)
+#define WIFI_CACHE_MAGIC         (0x57694669)
+
+struct tWiFiCache {
+  uint32_t u32Magic;
+  uint32_t u32Crc;          // Of everything below
+  uint32_t u32NetworkCrc;   // Of the SSID and password of u8Network
+  uint32_t u32Ip;
+  uint32_t u32Gateway;
+  uint32_t u32Subnet;
+  uint32_t u32Dns;
+  uint8_t  u8Bssid[6];
+  uint8_t  u8Channel;
+  uint8_t  u8Network;       // Index into the network list
+};
+
+struct tWiFiCredential {
+  const char *sSsid;
+  const char *sPassword;
+};
+
+// How each network has served us.  The RSSI is the average while connected.
+struct tWiFiQuality {
+  uint32_t u32Connects;
+  uint32_t u32Failures;
+  uint32_t u32Drops;
+  uint32_t u32ConnectedSec;
+  int8_t   i8RssiAvg;
+  uint8_t  u8PenaltyDb;
+};
+
+typedef enum {
+  WIFI_STATE_DISABLED,      // Not started, or switched off with SetEnabled()
+  WIFI_STATE_SCANNING,
+  WIFI_STATE_CONNECTING,
+  WIFI_STATE_CONNECTED,
+  WIFI_STATE_BACKOFF,
+  WIFI_STATE_NO_HARDWARE
+} WIFI_STATE;
 
 class tWiFiConnection {
 public:
-  tWiFiConnection(const char *sSsid, const char *sPassword, int iLedPin);
-  bool ConnectToRouter(int iNumTimesToTry = 0);
+  // pNetworks must stay valid.  Up to WIFI_MAX_NETWORKS are used.  One with an
+  // empty SSID is an unused slot, which can be filled in later.
+  tWiFiConnection(const tWiFiCredential *pNetworks, uint8_t u8NumNetworks, int iLedPin);
+
+  // Starts the first connection attempt
+  void Begin(uint32_t ulNowMs);
+
+  // Moves the state machine along.  Returns true if connected.
+  bool Service(uint32_t ulNowMs);
+
+  // While disabled (e.g. the power manager has the radio off) no attempts are made
+  void SetEnabled(bool bEnabled, uint32_t ulNowMs);
+
+  bool       IsConnected() const { return _u8State == WIFI_STATE_CONNECTED; }
+  WIFI_STATE State()       const { return (WIFI_STATE) _u8State; }
+
+  // Times the link has come up (Reconnects() leaves out the first) and times it's
+  // dropped.  A radio the power manager wakes up reconnects, but doesn't drop.
+  uint32_t Connects()   const { return _u32Connects; }
+  uint32_t Reconnects() const { return _u32Connects ? _u32Connects - 1 : 0; }
+  uint32_t Drops()      const { return _u32Drops; }
+  uint32_t Failovers()  const { return _u32Failovers; }
+
+  // The network we're on (or trying), as an index into the list
+  uint8_t  Network()    const { return _u8Network; }
+  const tWiFiQuality &Quality(uint8_t u8Network) const { return _Quality[u8Network]; }
+
+  // How long the last successful attempt took, and whether it was from the cache
+  uint32_t LastConnectMs()     const { return _u32LastConnectMs; }
+  bool     LastConnectCached() const { return _bLastConnectCached; }
+
   int  GetStatus();
   void PrintStatus();
   void PrintInfo();
-  
+
+  // One line per network: how it's served us
+  void PrintReport(Print &Out) const;
+
 protected:
-  const char *_sSsid;
-  const char *_sPassword;
-  int         _iLedPin;
-  int         _status;
+  void _Start(uint32_t ulNowMs);
+  void _StartScan(uint32_t ulNowMs);
+  int  _ScanResult(uint32_t ulNowMs);
+  void _RankCandidates(int iFound);
+  int  _Score(uint8_t u8Candidate) const;
+  void _TryCandidate(uint8_t u8Candidate, uint32_t ulNowMs);
+  void _Failed(int iStatus, uint32_t ulNowMs);
+  void _Backoff(uint32_t ulNowMs);
+
+  void _Connected(uint32_t ulNowMs);
+  void _LeaveConnected(uint32_t ulNowMs);
+  void _CheckSignal(uint32_t ulNowMs);
+  void _Penalize(uint8_t u8Network);
+
+  uint32_t _NetworkCrc(uint8_t u8Network) const;
+  void     _LoadCache();
+  void     _SaveCache();
+  void     _DropCache();
+
+  const tWiFiCredential *_pNetworks;
+  uint8_t                _u8NumNetworks;
+  int                    _iLedPin;
+  int                    _status;
+
+  uint8_t       _u8State;
+  bool          _bEnabled;
+  uint32_t      _ulStateMs;         // When we entered the current state
+  uint32_t      _u32BackoffMs;      // The current wait, before the random bit
+  uint32_t      _u32WaitMs;         // The wait in progress
+  uint32_t      _u32Connects;
+  uint32_t      _u32Drops;
+  uint32_t      _u32Failovers;
+
+  // What the last scan found, best first, and which one we're on
+  struct tCandidate {
+    uint8_t u8Network;
+    int8_t  i8Rssi;
+    uint8_t u8Channel;              // 0 if the scan didn't see it
+    uint8_t u8Bssid[6];
+  };
+  tCandidate    _Candidates[WIFI_MAX_NETWORKS];
+  uint8_t       _u8NumCandidates;
+  uint8_t       _u8Candidate;
+  uint8_t       _u8Network;
+
+  tWiFiQuality  _Quality[WIFI_MAX_NETWORKS];
+
+  // Signal average while connected, in 1/16 dB, and since when it's been weak
+  int16_t       _i16RssiX16;
+  uint32_t      _ulWeakSinceMs;
+  uint32_t      _ulScanStartMs;
+  bool          _bWeak;
+  bool          _bFailoverScan;
 
+  tWiFiCache    _Cache;
+  bool          _bCacheValid;
+  bool          _bCachedAttempt;    // The attempt in progress is from the cache
+  uint32_t      _u32LastConnectMs;
+  bool          _bLastConnectCached;
 };
 
 #endif /* INC_WIFICONNECTION_H */
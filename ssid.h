@@ -13,6 +13,11 @@
 // You need to create your own ssidPrivate.h file that defines these values
 // NTP_SSID   -  a text string that is the SSID of your network, like "MyWifiNet"
 // NTP_PASSWD - the WPA2 password for your Wifi network.
+//
+// Optionally, up to two more networks to fall back on, e.g. a second access point or
+// a phone's hotspot: NTP_SSID2 and NTP_PASSWD2, NTP_SSID3 and NTP_PASSWD3.  Whichever
+// is strongest is used, and the clock moves if the signal gets poor.  One more can be
+// given at the serial port with "set wifi", and is kept in flash.
 
 // Note that the SSID must be a 2.4 Ghz network to work with the ESP8266.  Newer "5G" networks
 // are not supported by the device.
@@ -27,5 +32,7 @@
 
 //#define NTP_SSID   "TheNameOfMyHomeWifi"
 //#define NTP_PASSWD "TheSuperSecretWifiPassword"
+//#define NTP_SSID2   "TheNameOfMyUpstairsWifi"
+//#define NTP_PASSWD2 "TheOtherSecretWifiPassword"
 
 #endif  /* SSID_H */
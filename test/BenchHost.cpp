@@ -0,0 +1,86 @@
+/***************
+* NTP Clock
+*
+* tBench on the host.  The same benchmarks as the "bench" command, run against the
+* stand-in core: the display and SPI code drive a tHostMax6954 through the pin
+* shim, and the cycle counter is the host's own clock (at the ESP8266's 80 per
+* microsecond), so the numbers compare with other host runs, not with the device.
+*
+* Alongside the cycles, each benchmark reports the pin writes per run, counted by
+* the pin shim.  Those don't depend on the host and must match the device exactly:
+* a 16-bit write is 52 of them, and an Update() with nothing changed is none.  This
+* checks both, so it fails (and ctest with it) if the bus traffic grows.
+*
+*   BenchHost           CSV
+*   BenchHost --json    one JSON object, for a script to keep and compare
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "Host.h"
+#include "HostMax6954.h"
+#include "Bench.h"
+
+#include <TimeLib.h>
+
+// 2020-06-15 12:00:00 UTC
+#define BENCH_UTC_S           (1592222400UL)
+
+// CLK low, CS low, DIN/CLK high/CLK low for each of the 16 bits, CS high, CLK high
+#define BENCH_WRITE16_PINS    (2 + 16 * 3 + 2)
+
+
+/*********************************************
+* Results to stdout
+*/
+
+class tStdoutPrint : public Print {
+public:
+  virtual size_t write(uint8_t u8Char) { return fputc(u8Char, stdout) == EOF ? 0 : 1; }
+  using Print::write;
+};
+
+
+int main(int argc, char **argv)
+{
+  tHostMax6954  Chip;
+  tMax6954      Max;
+  tClockDisplay Display(Max, DisplayGeometryLiteOn637);
+  tTimebase     Timebase;
+  tNtp          Ntp(Timebase, "pool.ntp.org", 2390, 300);
+  tTimeZoneSet  TimeZoneSet;
+  tBench        Bench(Display, Max, Ntp);
+  tStdoutPrint  Out;
+  uint32_t      u32Before, u32Write16, u32Update;
+  bool          bJson = argc > 1  &&  strcmp(argv[1], "--json") == 0;
+
+  Max.Init(DisplayGeometryLiteOn637.u8ScanLimit, DisplayGeometryLiteOn637.u8DigitType);
+  setTime(BENCH_UTC_S);
+
+  memcpy(Display.Digit, "1234", 4);
+  Display.Annunciator[CLOCK_ANNUNCIATOR_PM]    = true;
+  Display.Annunciator[CLOCK_ANNUNCIATOR_COLON] = true;
+  Display.Update();
+
+  HostUseRealCycles(true);
+  Bench.SetCounter("pin_writes", HostTotalPinWrites);
+  Bench.Run(Out, TimeZoneSet.TimeZone(3), bJson);
+  HostUseRealCycles(false);
+
+  // The counts the device would see too
+  u32Before = HostTotalPinWrites();
+  Max.NoOp();
+  u32Write16 = HostTotalPinWrites() - u32Before;
+
+  u32Before = HostTotalPinWrites();
+  Display.Update();
+  u32Update = HostTotalPinWrites() - u32Before;
+
+  if (u32Write16 != BENCH_WRITE16_PINS  ||  u32Update != 0  ||  Chip.ProtocolErrors() != 0) {
+    fprintf(stderr, "BenchHost: %u pin writes per Write16 (expected %u), %u for an unchanged Update(), %u protocol errors\n",
+            (unsigned) u32Write16, (unsigned) BENCH_WRITE16_PINS, (unsigned) u32Update, (unsigned) Chip.ProtocolErrors());
+    return 1;
+  }
+  return 0;
+}
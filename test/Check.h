@@ -0,0 +1,46 @@
+/***************
+* NTP Clock
+*
+* The host tests' checks.  CHECK() and CHECK_EQ() note a failure (file, line and
+* what was wrong) and carry on, so one run shows everything that broke; a test's
+* main() returns CheckResult(), which ctest takes as pass or fail.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+
+static int _iCheckFailures;
+static int _iChecks;
+
+#define CHECK(b)  do {                                                        \
+    _iChecks++;                                                               \
+    if (!(b)) {                                                               \
+      _iCheckFailures++;                                                      \
+      printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #b);            \
+    }                                                                         \
+  } while (0)
+
+#define CHECK_EQ(a, b)  do {                                                  \
+    long long _llA = (long long) (a), _llB = (long long) (b);                 \
+    _iChecks++;                                                               \
+    if (_llA != _llB) {                                                       \
+      _iCheckFailures++;                                                      \
+      printf("%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n",                \
+             __FILE__, __LINE__, #a, #b, _llA, _llB);                         \
+    }                                                                         \
+  } while (0)
+
+static inline int CheckResult(const char *sTest)
+{
+  printf("%s: %d checks, %d failed\n", sTest, _iChecks, _iCheckFailures);
+  return _iCheckFailures == 0 ? 0 : 1;
+}
+
+
+#endif   /* CHECK_H */
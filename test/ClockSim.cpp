@@ -0,0 +1,577 @@
+/***************
+* NTP Clock
+*
+* The whole sketch, fast-forwarded.  setup() and loop() run on the host against
+* the virtual clock, with a tHostMax6954 where the chip would be, a simulated
+* access point and a simulated NTP server (HostNet.h).  Nothing is stubbed out of
+* the sketch: the scheduler, the timebase, tNtp, the WiFi state machine, the fader
+* and the display all run as they do on the board, only as fast as the host can
+* go (most of a second per simulated day in an optimised build, two or three times
+* that in a debug one).
+*
+* Every second, SIM_SAMPLE_MS after the true second (time for the cross-fade to
+* finish), the digits and AM/PM the panel is lit with are compared against a
+* reference.  The reference knows only the true time and the US rules for the
+* sketch's zone (Pacific), worked out with plain calendar arithmetic.  While the
+* time is doubtful, the colon has to be blinking too.  Seconds are only skipped
+* before the first sync and while text (the IP address) is showing.
+*
+* The true time runs at the NTP server's rate; the virtual clock is the crystal.
+* A scenario can make the two differ by some ppm, and the timebase has to cope.
+*
+* Each scenario is a separate run (the sketch's globals only start once):
+*
+*   ClockSim wrap         millis() and micros() wrap during a run
+*   ClockSim dst-spring   the clocks go forward
+*   ClockSim dst-fall     and back
+*   ClockSim new-year     the year turns over
+*   ClockSim wifi-drop    the access point goes away for half an hour
+*   ClockSim ntp-outage   the server stops answering for an hour
+*   ClockSim months [n]   n days (default 150) with a 30 ppm crystal from 20 October.
+*                         The default takes in both DST changes and the new year;
+*                         ctest runs 31 days, which only gets through the fall one.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include <Arduino.h>
+#include "Arduino-Esp8266-NtpClock.ino"
+
+#include "Check.h"
+#include "Host.h"
+#include "HostNet.h"
+#include "HostMax6954.h"
+#include "Font.h"
+
+#define SIM_SAMPLE_MS        (700)
+#define SIM_MAX_REPORTS      (10)
+#define SIM_FIRST_SYNC_S     (30)      // From power-up, with the network up
+#define SIM_MAX_TEXT_S       (20)      // Seconds the IP address may take
+#define SIM_MONTHS_DAYS      (150)
+
+// The sketch's zone, as the reference has it
+#define SIM_ZONE_NAME        "Pacific"
+#define SIM_STD_OFFSET_S     (-8 * 3600L)
+#define SIM_DST_OFFSET_S     (-7 * 3600L)
+
+#define SIM_UTC(y, mo, d, h, mi)  ((time_t) (DaysFromCivil(y, mo, d) * SECS_PER_DAY + (h) * SECS_PER_HOUR + (mi) * SECS_PER_MIN))
+
+
+/*********************************************
+* The run
+*/
+
+static tHostMax6954    *_pChip;
+static tVirtualDisplay *_pPanel;
+static int              _iAp;
+
+static int64_t  _i64StartUtcUs;
+static uint64_t _u64StartVirtualUs;
+static int32_t  _i32CrystalPpm;
+
+static time_t   _tNextCheckUtc;
+static time_t   _tCheckFromUtc;      // Nothing's checked before this
+static int      _iLastSyncState;
+static uint32_t _u32StateSeconds;    // Checks it's been in that state for
+static uint32_t _u32Checked;
+static uint32_t _u32Skipped;
+static uint32_t _u32Wrong;
+
+
+/*********************************************
+* The reference
+*/
+
+/***************************************
+* DaysFromCivil
+*
+* Days from 1 Jan 1970 to the given date (the era-based method)
+*/
+
+static long DaysFromCivil(int iYear, unsigned uMonth, unsigned uDay)
+{
+  long     lEra;
+  unsigned uYearOfEra, uDayOfYear, uDayOfEra;
+
+  iYear     -= uMonth <= 2;
+  lEra       = (iYear >= 0 ? iYear : iYear - 399) / 400;
+  uYearOfEra = (unsigned) (iYear - lEra * 400);
+  uDayOfYear = (153 * (uMonth > 2 ? uMonth - 3 : uMonth + 9) + 2) / 5 + uDay - 1;
+  uDayOfEra  = uYearOfEra * 365 + uYearOfEra / 4 - uYearOfEra / 100 + uDayOfYear;
+
+  return lEra * 146097 + (long) uDayOfEra - 719468;
+}
+
+
+// The day of the n'th Sunday of the month.  1 Jan 1970 was a Thursday.
+static long NthSunday(int iYear, unsigned uMonth, int n)
+{
+  long lFirst = DaysFromCivil(iYear, uMonth, 1);
+
+  return lFirst + (7 - (lFirst + 4) % 7) % 7 + 7 * (n - 1);
+}
+
+
+// The year a time is in, near enough for DST: DST is nowhere near the new year
+static int YearOf(time_t tUtc)
+{
+  int iYear = 1970 + (int) (tUtc / (365.2425 * SECS_PER_DAY));
+
+  if (tUtc <  (time_t) DaysFromCivil(iYear,     1, 1) * SECS_PER_DAY)  iYear--;
+  if (tUtc >= (time_t) DaysFromCivil(iYear + 1, 1, 1) * SECS_PER_DAY)  iYear++;
+  return iYear;
+}
+
+
+/***************************************
+* Reference
+*
+* What the clock should show at tUtc: 12 hour, no leading zero, and PM.  DST
+* is from 2:00 standard time on the second Sunday in March to 2:00 daylight time
+* on the first Sunday in November.
+*/
+
+static void Reference(time_t tUtc, char *pDigits, bool &bPm)
+{
+  int    iYear   = YearOf(tUtc);
+  time_t tStart  = NthSunday(iYear, 3,  2) * SECS_PER_DAY + 2 * SECS_PER_HOUR - SIM_STD_OFFSET_S;
+  time_t tEnd    = NthSunday(iYear, 11, 1) * SECS_PER_DAY + 2 * SECS_PER_HOUR - SIM_DST_OFFSET_S;
+  long   lOffset = tUtc >= tStart  &&  tUtc < tEnd ? SIM_DST_OFFSET_S : SIM_STD_OFFSET_S;
+  long   lOfDay  = (long) ((tUtc + lOffset) % SECS_PER_DAY);
+  int    iHour24 = lOfDay / SECS_PER_HOUR;
+  int    iHour12 = iHour24 % 12 == 0 ? 12 : iHour24 % 12;
+  int    iMinute = lOfDay / SECS_PER_MIN % 60;
+  int    iSecond = lOfDay % 60;
+
+  bPm        = iHour24 >= 12;
+  pDigits[0] = iHour12 >= 10 ? '1' : ' ';
+  pDigits[1] = '0' + iHour12 % 10;
+  pDigits[2] = '0' + iMinute / 10;
+  pDigits[3] = '0' + iMinute % 10;
+  pDigits[4] = '0' + iSecond / 10;
+  pDigits[5] = '0' + iSecond % 10;
+}
+
+
+/*********************************************
+* The panel
+*/
+
+// Segments a-g of a digit, lit or just there
+static uint8_t PanelSegments(uint8_t u8Digit, bool bPresent)
+{
+  uint8_t     u8Mask = 0, s;
+  VIRTUAL_SEG Seg;
+
+  for (s=0; s<7; s++) {
+    Seg = _pPanel->Segment(u8Digit, s);
+    if (bPresent ? Seg != VIRTUAL_SEG_ABSENT : Seg == VIRTUAL_SEG_ON)  u8Mask |= 1 << s;
+  }
+  return u8Mask;
+}
+
+
+/***************************************
+* PanelShows
+*
+* True if the panel is lit with pDigits (as many as it has) and AM or PM.  Blink
+* plane P0 has what's steady; only the colon blinks.
+*/
+
+static bool PanelShows(const char *pDigits, bool bPm)
+{
+  uint8_t d;
+
+  _pPanel->SetPlane(0);
+  for (d=0; d<CLOCK_GEOMETRY.u8NumDigits; d++) {
+    if (PanelSegments(d, false) != (FontGlyph7(pDigits[d]) & PanelSegments(d, true)))  return false;
+  }
+
+  return (_pPanel->Annunciator(CLOCK_ANNUNCIATOR_AM) == VIRTUAL_SEG_ON) == !bPm  &&
+         (_pPanel->Annunciator(CLOCK_ANNUNCIATOR_PM) == VIRTUAL_SEG_ON) ==  bPm;
+}
+
+
+// Lit on one blink plane and not the other
+static bool ColonBlinks()
+{
+  bool bPlane0, bPlane1;
+
+  _pPanel->SetPlane(0);
+  bPlane0 = _pPanel->Annunciator(CLOCK_ANNUNCIATOR_COLON) == VIRTUAL_SEG_ON;
+  _pPanel->SetPlane(1);
+  bPlane1 = _pPanel->Annunciator(CLOCK_ANNUNCIATOR_COLON) == VIRTUAL_SEG_ON;
+  _pPanel->SetPlane(0);
+
+  return bPlane0 != bPlane1;
+}
+
+
+// The panel's digits as best they can be read, '?' where they can't
+static void PanelRead(char *sDigits)
+{
+  static const char sCandidates[] = " 1234567890";
+  uint8_t d;
+  size_t  c;
+
+  for (d=0; d<CLOCK_GEOMETRY.u8NumDigits; d++) {
+    sDigits[d] = '?';
+    for (c=0; c<sizeof(sCandidates)-1; c++) {
+      if (PanelSegments(d, false) == (FontGlyph7(sCandidates[c]) & PanelSegments(d, true))) {
+        sDigits[d] = sCandidates[c];
+        break;
+      }
+    }
+  }
+  sDigits[CLOCK_GEOMETRY.u8NumDigits] = '\0';
+}
+
+
+/*********************************************
+* Running the sketch
+*/
+
+static int64_t SimUtcUs(uint64_t u64VirtualUs)
+{
+  int64_t i64ElapsedUs = (int64_t) (u64VirtualUs - _u64StartVirtualUs);
+
+  return _i64StartUtcUs + i64ElapsedUs + i64ElapsedUs / 1000000 * _i32CrystalPpm;
+}
+
+
+/***************************************
+* SimStart
+*
+* Powers the clock up at tStartUtc, with millis() at u32StartMs.  The crystal is
+* i32CrystalPpm slow (the true time gains on it).
+*/
+
+static void SimStart(time_t tStartUtc, uint32_t u32StartMs, int32_t i32CrystalPpm)
+{
+  HostSetMillis(u32StartMs);
+  HostNetReset();
+  _iAp = HostNetAddAp(NTP_SSID, NTP_PASSWD, -60, 6);
+
+  _u64StartVirtualUs = HostMicros64();
+  _i64StartUtcUs     = (int64_t) tStartUtc * 1000000;
+  _i32CrystalPpm     = i32CrystalPpm;
+  HostNtpSetClock(SimUtcUs);
+
+  _tNextCheckUtc = tStartUtc + 1;
+  _tCheckFromUtc = tStartUtc;
+  _iLastSyncState = -1;
+  _u32StateSeconds = 0;
+  _u32Checked    = _u32Skipped = _u32Wrong = 0;
+
+  setup();
+  CHECK(strcmp(TimeZoneSet.Name(iTimeZone), SIM_ZONE_NAME) == 0);
+}
+
+
+/***************************************
+* SimCheck
+*
+* Compares the panel with the reference, once the clock has the time and isn't
+* showing text.  While the time is doubtful, the colon has to be blinking, once
+* the display has caught up: the NTP task notices the change, and the next tick
+* shows it, so that's two seconds on.
+*/
+
+static void SimCheck(time_t tUtc)
+{
+  char sExpected[6], sShown[CLOCK_MAX_DIGITS + 1];
+  bool bPm;
+  int  iState = NtpServer.SyncState();
+  bool bBlinkDue;
+
+  _u32StateSeconds = iState == _iLastSyncState ? _u32StateSeconds + 1 : 0;
+  _iLastSyncState  = iState;
+  bBlinkDue        = iState != NTP_SYNC_SYNCED  &&  _u32StateSeconds >= 2;
+  if (iState == NTP_SYNC_UNSYNCED  ||  Text.IsActive())  _tCheckFromUtc = tUtc + 2;
+  if (tUtc < _tCheckFromUtc) {
+    _u32Skipped++;
+    return;
+  }
+
+  _u32Checked++;
+  if (bBlinkDue  &&  !ColonBlinks()  &&  _u32Wrong++ < SIM_MAX_REPORTS) {
+    printf("%lld UTC: the colon isn't blinking in sync state %d\n", (long long) tUtc, iState);
+  }
+
+  Reference(tUtc, sExpected, bPm);
+  if (PanelShows(sExpected, bPm))  return;
+
+  if (_u32Wrong++ < SIM_MAX_REPORTS) {
+    PanelRead(sShown);
+    printf("%lld UTC: expected \"%.*s\" %s, shown \"%s\" %s%s\n", (long long) tUtc,
+           CLOCK_GEOMETRY.u8NumDigits, sExpected, bPm ? "PM" : "AM", sShown,
+           _pPanel->Annunciator(CLOCK_ANNUNCIATOR_AM) == VIRTUAL_SEG_ON ? "AM" : "",
+           _pPanel->Annunciator(CLOCK_ANNUNCIATOR_PM) == VIRTUAL_SEG_ON ? "PM" : "");
+  }
+}
+
+
+/***************************************
+* SimRun
+*
+* Runs the sketch for u32Seconds of true time, checking every second
+*/
+
+static void SimRun(uint32_t u32Seconds)
+{
+  time_t tEndUtc = _tNextCheckUtc + u32Seconds;
+
+  while (_tNextCheckUtc < tEndUtc) {
+    while (SimUtcUs(HostMicros64()) < (int64_t) _tNextCheckUtc * 1000000 + SIM_SAMPLE_MS * 1000)  loop();
+
+    SimCheck(_tNextCheckUtc);
+    _tNextCheckUtc++;
+
+    // Keep what piles up from growing for months
+    _pChip->ClearLog();
+    HostClearSerialOutput();
+  }
+}
+
+
+/***************************************
+* SimEnd
+*
+* Every second after the first sync was checked and right
+*/
+
+static void SimEnd(const char *sScenario)
+{
+  printf("%s: %lu seconds checked, %lu skipped, %lu wrong; %lu NTP requests, %lu WiFi joins\n", sScenario,
+         (unsigned long) _u32Checked, (unsigned long) _u32Skipped, (unsigned long) _u32Wrong,
+         (unsigned long) HostNtpRequests(), (unsigned long) HostNetJoins());
+
+  CHECK_EQ(_u32Wrong, 0);
+  CHECK(_u32Skipped <= SIM_FIRST_SYNC_S + SIM_MAX_TEXT_S);
+  CHECK_EQ(_pChip->ProtocolErrors(), 0);
+}
+
+
+/***************************************
+* CheckNtpGaps
+*
+* The gaps between NTP requests u32First to u32Last are u32MinS to u32MaxS.  The
+* next query is due on a whole second of UTC, and the NTP task looks once a
+* second, so the gaps are a second either way of what was asked for.
+*/
+
+static void CheckNtpGaps(uint32_t u32First, uint32_t u32Last, uint32_t u32MinS, uint32_t u32MaxS)
+{
+  uint64_t u64GapUs;
+  uint32_t i;
+
+  CHECK(u32First < u32Last);
+  for (i=u32First+1; i<=u32Last; i++) {
+    u64GapUs = HostNtpRequestUs(i) - HostNtpRequestUs(i-1);
+    CHECK(u64GapUs >= (uint64_t) u32MinS * 1000000  &&  u64GapUs <= (uint64_t) u32MaxS * 1000000);
+  }
+}
+
+
+// The first NTP request at or after u32Seconds from power-up
+static uint32_t NtpRequestAfter(uint32_t u32Seconds)
+{
+  uint32_t i;
+
+  for (i=0; i<HostNtpRequests(); i++) {
+    if (HostNtpRequestUs(i) >= _u64StartVirtualUs + (uint64_t) u32Seconds * 1000000)  break;
+  }
+  return i;
+}
+
+
+/*********************************************
+* Scenarios
+*/
+
+// 2021-06-15 12:00 UTC, with millis() ten minutes short of the wrap.  micros()
+// wraps every 71.6 minutes, and tNtp, the timebase and the scheduler all have to
+// keep going through both.
+static void ScenarioWrap(int iArg)
+{
+  uint32_t u32First;
+
+  (void) iArg;
+  SimStart(SIM_UTC(2021, 6, 15, 12, 0), 0xFFFFFFFF - 10 * 60 * 1000UL, 0);
+  SimRun(4 * 3600);
+  SimEnd("wrap");
+
+  // Every NTP_REFRESH_INTERVAL_SECONDS, straight through the wrap
+  u32First = NtpRequestAfter(SIM_FIRST_SYNC_S);
+  CHECK_EQ(HostNtpRequests() - u32First, 4 * 3600 / NTP_REFRESH_INTERVAL_SECONDS - 1);
+  CheckNtpGaps(u32First, HostNtpRequests() - 1, NTP_REFRESH_INTERVAL_SECONDS - 1, NTP_REFRESH_INTERVAL_SECONDS + 1);
+  CHECK_EQ(NtpServer.SyncState(), NTP_SYNC_SYNCED);
+}
+
+
+// 14 March 2021: 1:59:59 PST is followed by 3:00:00 PDT
+static void ScenarioDstSpring(int iArg)
+{
+  (void) iArg;
+  SimStart(SIM_UTC(2021, 3, 14, 6, 0), 0, 0);
+  SimRun(8 * 3600);
+  SimEnd("dst-spring");
+}
+
+
+// 7 November 2021: 1:59:59 PDT is followed by 1:00:00 PST
+static void ScenarioDstFall(int iArg)
+{
+  (void) iArg;
+  SimStart(SIM_UTC(2021, 11, 7, 6, 0), 0, 0);
+  SimRun(8 * 3600);
+  SimEnd("dst-fall");
+}
+
+
+// Noon to noon over 1 January 2022, local midnight being 08:00 UTC
+static void ScenarioNewYear(int iArg)
+{
+  (void) iArg;
+  SimStart(SIM_UTC(2021, 12, 31, 20, 0), 0, 0);
+  SimRun(24 * 3600);
+  SimEnd("new-year");
+}
+
+
+// The access point goes away for half an hour.  The clock keeps time and sends no
+// NTP while it's off.  Each round tries every network and then backs off, and the
+// rounds spread out to WIFI_BACKOFF_MAX_MS (plus the random bit) but never stop;
+// once the access point is back, the next round gets on.
+static void ScenarioWiFiDrop(int iArg)
+{
+  const uint32_t u32Networks = GEOM_NUM_OF(WiFiNetworks);
+  const uint64_t u64MaxGapUs = (WIFI_BACKOFF_MAX_MS * 5 / 4 + WIFI_SCAN_TIMEOUT_MS + u32Networks * WIFI_CONNECT_TIMEOUT_MS) * 1000ULL;
+  uint32_t u32Requests, u32Attempts, u32Joins, i;
+  uint64_t u64GapUs, u64LongestUs = 0;
+
+  (void) iArg;
+  SimStart(SIM_UTC(2021, 7, 1, 18, 0), 0, 0);
+  SimRun(20 * 60);
+  CHECK_EQ(HostNetJoins(), 1);
+
+  u32Requests = HostNtpRequests();
+  u32Attempts = HostNetAttempts();
+  u32Joins    = HostNetJoins();
+  HostNetSetApUp(_iAp, false);
+  SimRun(30 * 60);
+
+  CHECK_EQ(HostNtpRequests(), u32Requests);
+  CHECK_EQ(HostNetJoins(), u32Joins);
+
+  // The backoff doubles up from WIFI_BACKOFF_MIN_MS: seven rounds to reach the top
+  CHECK(HostNetAttempts() - u32Attempts >= 2 * u32Networks);
+  CHECK(HostNetAttempts() - u32Attempts <= u32Networks * (30 * 60 * 1000UL / WIFI_BACKOFF_MAX_MS + 7));
+  for (i=u32Attempts+1; i<HostNetAttempts(); i++) {
+    u64GapUs     = HostNetAttemptUs(i) - HostNetAttemptUs(i-1);
+    u64LongestUs = max(u64LongestUs, u64GapUs);
+    CHECK(u64GapUs <= u64MaxGapUs);
+  }
+  CHECK(u64LongestUs >= WIFI_BACKOFF_MAX_MS * 1000ULL);
+  printf("wifi-drop: %lu attempts in 30 minutes, at most %lu ms apart\n",
+         (unsigned long) (HostNetAttempts() - u32Attempts), (unsigned long) (u64LongestUs / 1000));
+
+  HostNetSetApUp(_iAp, true);
+  SimRun(u64MaxGapUs / 1000000 + NTP_MIN_QUERY_INTERVAL_SECONDS);
+  CHECK_EQ(HostNetJoins(), u32Joins + 1);
+  CHECK(HostNtpRequests() > u32Requests);
+
+  SimRun(30 * 60);
+  CHECK_EQ(NtpServer.SyncState(), NTP_SYNC_SYNCED);
+  SimEnd("wifi-drop");
+}
+
+
+// The server stops answering for an hour.  Queries keep coming, but no faster
+// than NTP_MIN_QUERY_INTERVAL_SECONDS; the clock goes to holdover and keeps the
+// time; once the server's back, it syncs and goes back to the normal interval.
+static void ScenarioNtpOutage(int iArg)
+{
+  uint32_t u32First, u32Last;
+
+  (void) iArg;
+  SimStart(SIM_UTC(2021, 9, 1, 16, 0), 0, 0);
+  SimRun(30 * 60);
+  CHECK_EQ(NtpServer.SyncState(), NTP_SYNC_SYNCED);
+
+  HostNtpSetUp(false);
+  u32First = HostNtpRequests();
+  SimRun(60 * 60);
+  u32Last = HostNtpRequests() - 1;
+  CHECK_EQ(NtpServer.SyncState(), NTP_SYNC_HOLDOVER);
+
+  // The first retry comes at the normal interval after the last reply
+  CheckNtpGaps(u32First + 1, u32Last, NTP_MIN_QUERY_INTERVAL_SECONDS - 1, NTP_MIN_QUERY_INTERVAL_SECONDS + 1);
+  CHECK(u32Last - u32First >= (60 * 60 - NTP_REFRESH_INTERVAL_SECONDS) / (NTP_MIN_QUERY_INTERVAL_SECONDS + 2));
+
+  HostNtpSetUp(true);
+  SimRun(NTP_MIN_QUERY_INTERVAL_SECONDS + 5);
+  CHECK_EQ(NtpServer.SyncState(), NTP_SYNC_SYNCED);
+
+  u32First = HostNtpRequests();
+  SimRun(60 * 60);
+  CheckNtpGaps(u32First, HostNtpRequests() - 1, NTP_REFRESH_INTERVAL_SECONDS - 1, NTP_REFRESH_INTERVAL_SECONDS + 1);
+  SimEnd("ntp-outage");
+}
+
+
+// Months on a crystal 30 ppm out (2.6 s a day): through the fall DST change, the
+// new year and the spring one
+static void ScenarioMonths(int iArg)
+{
+  uint32_t u32Days = iArg > 0 ? iArg : SIM_MONTHS_DAYS;
+  uint32_t d;
+
+  SimStart(SIM_UTC(2021, 10, 20, 0, 0), 0, 30);
+  for (d=0; d<u32Days; d++) {
+    SimRun(SECS_PER_DAY);
+    CHECK_EQ(NtpServer.SyncState(), NTP_SYNC_SYNCED);
+  }
+  SimEnd("months");
+  CHECK(Timebase.ErrorMs() < NTP_STALE_ERROR_MS);
+}
+
+
+struct tSimScenario {
+  const char *sName;
+  void      (*pfnRun)(int iArg);
+};
+
+static const tSimScenario Scenarios[] = {
+  { "wrap",       ScenarioWrap      },
+  { "dst-spring", ScenarioDstSpring },
+  { "dst-fall",   ScenarioDstFall   },
+  { "new-year",   ScenarioNewYear   },
+  { "wifi-drop",  ScenarioWiFiDrop  },
+  { "ntp-outage", ScenarioNtpOutage },
+  { "months",     ScenarioMonths    }
+};
+
+
+int main(int argc, char **argv)
+{
+  tHostMax6954    Chip;
+  tVirtualDisplay Panel(CLOCK_GEOMETRY, Chip.Model());
+  size_t          i;
+
+  _pChip  = &Chip;
+  _pPanel = &Panel;
+
+  for (i=0; argc > 1  &&  i<GEOM_NUM_OF(Scenarios); i++) {
+    if (strcmp(argv[1], Scenarios[i].sName) != 0)  continue;
+
+    Scenarios[i].pfnRun(argc > 2 ? atoi(argv[2]) : 0);
+    return CheckResult(argv[1]);
+  }
+
+  printf("Usage: %s <scenario> [days]\nScenarios:", argv[0]);
+  for (i=0; i<GEOM_NUM_OF(Scenarios); i++)  printf(" %s", Scenarios[i].sName);
+  printf("\n");
+  return 2;
+}
@@ -0,0 +1,208 @@
+/***************
+* NTP Clock
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "HostMax6954.h"
+
+
+/***************************************
+* tHostMax6954 constructor
+*
+* INPUTS:
+*   Pins named from the chip's side: DIN is what the ESP8266 drives
+*/
+
+tHostMax6954::tHostMax6954(uint8_t u8ClkPin, uint8_t u8DinPin, uint8_t u8DoutPin, uint8_t u8CsPin, uint8_t u8IrqPin) :
+  _u8ClkPin(u8ClkPin),
+  _u8DinPin(u8DinPin),
+  _u8DoutPin(u8DoutPin),
+  _u8CsPin(u8CsPin),
+  _u8IrqPin(u8IrqPin)
+{
+  Reset();
+  HostAttachPinDevice(this);
+}
+
+
+tHostMax6954::~tHostMax6954()
+{
+  HostDetachPinDevice(this);
+}
+
+
+/***************************************
+* tHostMax6954::Reset
+*
+*/
+
+void tHostMax6954::Reset()
+{
+  _u8Clk      = LOW;
+  _u8Cs       = HIGH;
+  _u8Din      = LOW;
+  _u16Shift   = 0;
+  _u8Bits     = 0;
+  _u16Out     = 0;
+  _u8OutBit   = 0;
+  _u16NextOut = 0;
+  _u32ProtocolErrors = 0;
+  _Log.clear();
+  _Model.Reset();
+
+  memset(_u8KeysDebounced, 0, sizeof(_u8KeysDebounced));
+  memset(_u8KeysPressed,   0, sizeof(_u8KeysPressed));
+  _bIrq = false;
+}
+
+
+/***************************************
+* tHostMax6954::PinWrite
+*
+*/
+
+void tHostMax6954::PinWrite(uint8_t u8Pin, uint8_t u8Level)
+{
+  if (u8Pin == _u8CsPin) {
+    if (_u8Cs == HIGH  &&  u8Level == LOW) {
+      _u16Shift   = 0;
+      _u8Bits     = 0;
+      _u16Out     = _u16NextOut;
+      _u8OutBit   = 0;
+      _u16NextOut = 0;
+    }
+    else if (_u8Cs == LOW  &&  u8Level == HIGH) {
+      _EndFrame();
+    }
+    _u8Cs = u8Level;
+  }
+  else if (u8Pin == _u8ClkPin) {
+    if (_u8Cs == LOW  &&  _u8Clk == LOW  &&  u8Level == HIGH) {
+      _u16Shift = _u16Shift << 1 | _u8Din;
+      _u8Bits++;
+    }
+    else if (_u8Cs == LOW  &&  _u8Clk == HIGH  &&  u8Level == LOW) {
+      _u8OutBit++;
+    }
+    _u8Clk = u8Level;
+  }
+  else if (u8Pin == _u8DinPin) {
+    _u8Din = u8Level;
+  }
+}
+
+
+/***************************************
+* tHostMax6954::PinRead
+*
+* DOUT is only driven while CS is low
+*/
+
+bool tHostMax6954::PinRead(uint8_t u8Pin, uint8_t &u8Level)
+{
+  if (u8Pin != _u8DoutPin)  return false;
+
+  u8Level = _u8Cs == LOW  &&  _u8OutBit < 16 ? (_u16Out >> (15 - _u8OutBit)) & 0x01 : LOW;
+  return true;
+}
+
+
+/***************************************
+* tHostMax6954::_EndFrame
+*
+* CS has gone high.  A read puts the register's value out in the next frame, with
+* the read command's top byte (D15 set) above it, as the chip's shift register has it.
+*/
+
+void tHostMax6954::_EndFrame()
+{
+  tSpiTransaction Frame;
+  uint8_t         u8Reg;
+
+  Frame.u16Command  = _u16Shift;
+  Frame.u16Response = _u16Out;
+  Frame.u8NumBits   = _u8Bits;
+  _Log.push_back(Frame);
+
+  if (_u8Bits != 16)  _u32ProtocolErrors++;
+  _Model.Apply(Frame);
+  if (_u8Bits != 16)  return;
+
+  if (_u16Shift & 0x8000) {
+    u8Reg       = (_u16Shift >> 8) & 0x7F;
+    _u16NextOut = (_u16Shift & 0xFF00) | _ReadRegister(u8Reg);
+  }
+}
+
+
+/***************************************
+* tHostMax6954::_ReadRegister
+*
+* Reading a debounce register clears it; the IRQ line lets go once they're all
+* clear.  The pressed registers share their addresses with the digit type
+* register, which is write-only.
+*/
+
+uint8_t tHostMax6954::_ReadRegister(uint8_t u8Reg)
+{
+  uint8_t u8Value, i;
+  bool    bAny = false;
+
+  if (u8Reg >= MAX6954_REG_KEY_A_MSK_Deb  &&  u8Reg <= MAX6954_REG_KEY_D_MSK_Deb) {
+    u8Value = _u8KeysDebounced[u8Reg - MAX6954_REG_KEY_A_MSK_Deb];
+    _u8KeysDebounced[u8Reg - MAX6954_REG_KEY_A_MSK_Deb] = 0;
+
+    for (i=0; i<MAX6954_MAX_KEY_LINES; i++)  bAny |= _u8KeysDebounced[i] != 0;
+    if (!bAny)  _SetIrq(false);
+    return u8Value;
+  }
+
+  if (u8Reg >= MAX6954_REG_KEY_A_Pressed  &&  u8Reg <= MAX6954_REG_KEY_D_Pressed) {
+    return _u8KeysPressed[u8Reg - MAX6954_REG_KEY_A_Pressed];
+  }
+
+  return _Model.Register(u8Reg);
+}
+
+
+/***************************************
+* tHostMax6954::PressKey, ReleaseKey
+*
+*/
+
+void tHostMax6954::PressKey(uint8_t u8Key)
+{
+  uint8_t u8Line = u8Key / MAX6954_KEYS_PER_LINE;
+  uint8_t u8Bit  = 1 << (u8Key % MAX6954_KEYS_PER_LINE);
+
+  if (u8Line >= MAX6954_MAX_KEY_LINES)  return;
+
+  _u8KeysPressed[u8Line]   |= u8Bit;
+  _u8KeysDebounced[u8Line] |= u8Bit;
+  _SetIrq(true);
+}
+
+
+void tHostMax6954::ReleaseKey(uint8_t u8Key)
+{
+  uint8_t u8Line = u8Key / MAX6954_KEYS_PER_LINE;
+
+  if (u8Line >= MAX6954_MAX_KEY_LINES)  return;
+
+  _u8KeysPressed[u8Line] &= ~(1 << (u8Key % MAX6954_KEYS_PER_LINE));
+}
+
+
+/***************************************
+* tHostMax6954::_SetIrq
+*
+* Open drain, active low: released, the pull-up takes it high
+*/
+
+void tHostMax6954::_SetIrq(bool bAsserted)
+{
+  _bIrq = bAsserted;
+  HostDriveInput(_u8IrqPin, bAsserted ? LOW : HIGH);
+}
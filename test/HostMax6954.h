@@ -0,0 +1,88 @@
+/***************
+* NTP Clock
+*
+* tHostMax6954 is a MAX6954 on the host's pins, for tests.  It sits on the pin shim
+* (Host.h) where the real chip sits on the GPIOs, and decodes CS, CLK and DIN the
+* way the chip does (p. 7 of the data sheet): bits are sampled on the rising edge
+* of CLK while CS is low, and latched when CS goes high.
+*
+* Every frame is kept, in order, so a test can assert the exact command stream a
+* piece of code sends.  Complete frames go to a tMax6954Model, which keeps the
+* register file.  This works from the pins, not from the driver's tSpiTrace, so it
+* checks the bit-banger as well as what it was asked to send.
+*
+* Reads work as on the chip.  After a frame with D15 set, the register's value is
+* clocked out of DOUT during the next frame, MSB first.  It changes on each
+* falling edge of CLK, so it's there to be sampled after each rising one.  The key
+* scanner's registers come from PressKey() and ReleaseKey().  A press pulls the
+* open-drain IRQ line low until the debounce registers are read.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef HOST_MAX6954_H
+#define HOST_MAX6954_H
+
+#include "Host.h"
+#include "Max6954.h"
+#include "Max6954Model.h"
+
+#include <vector>
+
+
+class tHostMax6954 : public tHostPinDevice {
+public:
+  tHostMax6954(uint8_t u8ClkPin = MAX_SCLK_GPIO, uint8_t u8DinPin = MAX_SDOUT_GPIO,
+               uint8_t u8DoutPin = MAX_SDIN_GPIO, uint8_t u8CsPin = MAX_CS_GPIO, uint8_t u8IrqPin = MAX_IRQ_GPIO);
+  ~tHostMax6954();
+
+  // Power-up state, with an empty log
+  void Reset();
+
+  // The frames seen since the last ClearLog(), oldest first.  u16Response is what
+  // the chip clocked out during the frame.
+  size_t                 NumTransactions() const { return _Log.size(); }
+  const tSpiTransaction &Transaction(size_t Which) const { return _Log[Which]; }
+  void                   ClearLog() { _Log.clear(); }
+
+  // Frames that weren't 16 bits
+  uint32_t ProtocolErrors() const { return _u32ProtocolErrors; }
+
+  const tMax6954Model &Model() const { return _Model; }
+
+  // Key 0-31, KEY_A's eight first
+  void PressKey(uint8_t u8Key);
+  void ReleaseKey(uint8_t u8Key);
+  bool IrqAsserted() const { return _bIrq; }
+
+  virtual void PinWrite(uint8_t u8Pin, uint8_t u8Level);
+  virtual bool PinRead(uint8_t u8Pin, uint8_t &u8Level);
+
+protected:
+  void    _EndFrame();
+  uint8_t _ReadRegister(uint8_t u8Reg);
+  void    _SetIrq(bool bAsserted);
+
+  uint8_t  _u8ClkPin, _u8DinPin, _u8DoutPin, _u8CsPin, _u8IrqPin;
+  uint8_t  _u8Clk, _u8Cs, _u8Din;
+
+  // The frame in progress
+  uint16_t _u16Shift;
+  uint8_t  _u8Bits;
+  uint16_t _u16Out;         // Going out on DOUT
+  uint8_t  _u8OutBit;       // How many bits of it have gone
+  uint16_t _u16NextOut;     // For the next frame
+
+  std::vector<tSpiTransaction> _Log;
+  uint32_t      _u32ProtocolErrors;
+  tMax6954Model _Model;
+
+  uint8_t  _u8KeysDebounced[MAX6954_MAX_KEY_LINES];
+  uint8_t  _u8KeysPressed  [MAX6954_MAX_KEY_LINES];
+  bool     _bIrq;
+};
+
+
+#endif   /* HOST_MAX6954_H */
@@ -0,0 +1,213 @@
+/***************
+* NTP Clock
+*
+* tAlarms in Eastern time: across both of 2020's DST changes, with day-of-week
+* masks, through snooze and dismiss, and when the time jumps past an alarm.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "Check.h"
+#include "Host.h"
+#include "Alarm.h"
+
+// Times in UTC.  Eastern is UTC-5, or UTC-4 in DST.
+#define TEST_FRI_NOON_UTC       ((time_t) 1583514000)   // 2020-03-06 17:00, noon EST
+#define TEST_SAT_7AM_UTC        ((time_t) 1583582400)   // 2020-03-07 12:00
+#define TEST_MON_7AM_UTC        ((time_t) 1583751600)   // 2020-03-09 11:00, after the change
+#define TEST_WED_7AM_UTC        ((time_t) 1583924400)   // 2020-03-11 11:00
+
+#define TEST_SPRING_MIDNIGHT    ((time_t) 1583643600)   // 2020-03-08 05:00, midnight EST
+#define TEST_SPRING_330_EDT     ((time_t) 1583652600)   // 2020-03-08 07:30
+#define TEST_SPRING_NEXT_230    ((time_t) 1583735400)   // 2020-03-09 06:30, 2:30 EDT
+
+#define TEST_FALL_MIDNIGHT      ((time_t) 1604203200)   // 2020-11-01 04:00, midnight EDT
+#define TEST_FALL_NEXT_130      ((time_t) 1604298600)   // 2020-11-02 06:30, 1:30 EST
+
+#define TEST_JUNE_NOON          ((time_t) 1591027200)   // 2020-06-01 16:00, noon EDT
+#define TEST_JUNE_1PM           ((time_t) 1591030800)   // 2020-06-01 17:00
+#define TEST_JUNE_NEXT_1PM      ((time_t) 1591117200)   // 2020-06-02 17:00
+
+
+/***************************************
+* TestDays
+*
+* Set at noon on a Friday, for 7:00
+*/
+
+static void TestDays(tLocalTime *pEastern)
+{
+  tAlarms Alarms;
+
+  Alarms.SetTimeZone(pEastern, TEST_FRI_NOON_UTC);
+
+  CHECK(Alarms.Set(0, 7, 0, ALARM_DAYS_WEEKDAYS, TEST_FRI_NOON_UTC));
+  CHECK(Alarms.Set(1, 7, 0, ALARM_DAYS_WEEKENDS, TEST_FRI_NOON_UTC));
+  CHECK(Alarms.Set(2, 7, 0, 1 << 3,              TEST_FRI_NOON_UTC));   // Wednesdays
+  CHECK(Alarms.Set(3, 7, 0, ALARM_DAYS_DAILY,    TEST_FRI_NOON_UTC));
+
+  CHECK_EQ(Alarms.NextTime(0), TEST_MON_7AM_UTC);
+  CHECK_EQ(Alarms.NextTime(1), TEST_SAT_7AM_UTC);
+  CHECK_EQ(Alarms.NextTime(2), TEST_WED_7AM_UTC);
+  CHECK_EQ(Alarms.NextTime(3), TEST_SAT_7AM_UTC);
+
+  CHECK(!Alarms.Set(ALARM_MAX, 7, 0, ALARM_DAYS_DAILY, TEST_FRI_NOON_UTC));
+  CHECK(!Alarms.Set(0, 24, 0, ALARM_DAYS_DAILY, TEST_FRI_NOON_UTC));
+  CHECK(!Alarms.Set(0, 7, 60, ALARM_DAYS_DAILY, TEST_FRI_NOON_UTC));
+
+  Alarms.Clear(3);
+  CHECK_EQ(Alarms.NextTime(3), 0);
+  CHECK(!Alarms.Alarm(3).bEnabled);
+}
+
+
+/***************************************
+* TestSpringForward
+*
+* 2:30 doesn't happen on 8 March; the alarm goes off at 3:30 EDT instead
+*/
+
+static void TestSpringForward(tLocalTime *pEastern)
+{
+  tAlarms Alarms;
+
+  Alarms.SetTimeZone(pEastern, TEST_SPRING_MIDNIGHT);
+  Alarms.Set(0, 2, 30, ALARM_DAYS_DAILY, TEST_SPRING_MIDNIGHT);
+  CHECK_EQ(Alarms.NextTime(0), TEST_SPRING_330_EDT);
+
+  CHECK(!Alarms.Service(TEST_SPRING_330_EDT - 1));
+  CHECK(Alarms.Service(TEST_SPRING_330_EDT));
+  CHECK_EQ(Alarms.State(), ALARM_STATE_RINGING);
+  CHECK_EQ(Alarms.NextTime(0), TEST_SPRING_NEXT_230);
+}
+
+
+/***************************************
+* TestFallBack
+*
+* 1:30 happens twice on 1 November; the alarm goes off once
+*/
+
+static void TestFallBack(tLocalTime *pEastern)
+{
+  tAlarms Alarms;
+  time_t  t;
+  int     iRings = 0;
+
+  Alarms.SetTimeZone(pEastern, TEST_FALL_MIDNIGHT);
+  Alarms.Set(0, 1, 30, ALARM_DAYS_DAILY, TEST_FALL_MIDNIGHT);
+
+  for (t = TEST_FALL_MIDNIGHT; t < TEST_FALL_MIDNIGHT + 4 * SECS_PER_HOUR; t++) {
+    if (Alarms.Service(t)) {
+      iRings++;
+      Alarms.Dismiss();
+    }
+  }
+
+  CHECK_EQ(iRings, 1);
+  CHECK_EQ(Alarms.NextTime(0), TEST_FALL_NEXT_130);
+}
+
+
+/***************************************
+* TestSnooze
+*
+*/
+
+static void TestSnooze(tLocalTime *pEastern)
+{
+  tAlarms Alarms;
+  time_t  tSnoozed;
+
+  Alarms.SetTimeZone(pEastern, TEST_JUNE_NOON);
+  Alarms.Set(1, 13, 0, ALARM_DAYS_DAILY, TEST_JUNE_NOON);
+
+  // Snooze and dismiss do nothing until it rings
+  Alarms.Snooze(TEST_JUNE_NOON);
+  Alarms.Dismiss();
+  CHECK_EQ(Alarms.State(), ALARM_STATE_IDLE);
+
+  CHECK(Alarms.Service(TEST_JUNE_1PM));
+  CHECK_EQ(Alarms.State(), ALARM_STATE_RINGING);
+  CHECK_EQ(Alarms.Ringing(), 1);
+
+  tSnoozed = TEST_JUNE_1PM + 10;
+  Alarms.Snooze(tSnoozed);
+  CHECK_EQ(Alarms.State(), ALARM_STATE_SNOOZED);
+  CHECK(!Alarms.Service(tSnoozed + ALARM_SNOOZE_SECONDS - 1));
+  CHECK_EQ(Alarms.State(), ALARM_STATE_SNOOZED);
+  CHECK(Alarms.Service(tSnoozed + ALARM_SNOOZE_SECONDS));
+  CHECK_EQ(Alarms.State(), ALARM_STATE_RINGING);
+  CHECK_EQ(Alarms.Ringing(), 1);
+
+  // Dismissing a snoozed alarm drops the snooze
+  Alarms.Snooze(tSnoozed + ALARM_SNOOZE_SECONDS);
+  Alarms.Dismiss();
+  CHECK_EQ(Alarms.State(), ALARM_STATE_IDLE);
+  CHECK(!Alarms.Service(tSnoozed + 2 * ALARM_SNOOZE_SECONDS));
+  CHECK_EQ(Alarms.State(), ALARM_STATE_IDLE);
+  CHECK_EQ(Alarms.NextTime(1), TEST_JUNE_NEXT_1PM);
+
+  // Left alone, it gives up after ALARM_RING_SECONDS
+  CHECK(Alarms.Service(TEST_JUNE_NEXT_1PM));
+  Alarms.Service(TEST_JUNE_NEXT_1PM + ALARM_RING_SECONDS - 1);
+  CHECK_EQ(Alarms.State(), ALARM_STATE_RINGING);
+  Alarms.Service(TEST_JUNE_NEXT_1PM + ALARM_RING_SECONDS);
+  CHECK_EQ(Alarms.State(), ALARM_STATE_IDLE);
+}
+
+
+/***************************************
+* TestOnceAndLate
+*
+* A one-shot alarm turns itself off after it rings, but not when it's skipped
+* because the time jumped past it
+*/
+
+static void TestOnceAndLate(tLocalTime *pEastern)
+{
+  tAlarms Alarms;
+
+  Alarms.SetTimeZone(pEastern, TEST_JUNE_NOON);
+  Alarms.Set(0, 13, 0, ALARM_DAYS_ONCE, TEST_JUNE_NOON);
+  CHECK(Alarms.AnyEnabled());
+
+  CHECK(Alarms.Service(TEST_JUNE_1PM));
+  CHECK(!Alarms.Alarm(0).bEnabled);
+  CHECK_EQ(Alarms.NextTime(0), 0);
+  CHECK(!Alarms.AnyEnabled());
+  Alarms.Dismiss();
+
+  // Up to ALARM_MAX_LATE_SECONDS late still rings
+  Alarms.Set(0, 13, 0, ALARM_DAYS_ONCE, TEST_JUNE_NOON);
+  CHECK(Alarms.Service(TEST_JUNE_1PM + ALARM_MAX_LATE_SECONDS));
+  Alarms.Dismiss();
+
+  // Any later is skipped, and the alarm waits for tomorrow
+  Alarms.Set(0, 13, 0, ALARM_DAYS_ONCE, TEST_JUNE_NOON);
+  CHECK(!Alarms.Service(TEST_JUNE_1PM + ALARM_MAX_LATE_SECONDS + 1));
+  CHECK_EQ(Alarms.State(), ALARM_STATE_IDLE);
+  CHECK(Alarms.Alarm(0).bEnabled);
+  CHECK_EQ(Alarms.NextTime(0), TEST_JUNE_NEXT_1PM);
+
+  Alarms.Set(1, 13, 0, ALARM_DAYS_DAILY, TEST_JUNE_NOON);
+  CHECK(!Alarms.Service(TEST_JUNE_1PM + SECS_PER_HOUR));
+  CHECK_EQ(Alarms.NextTime(1), TEST_JUNE_NEXT_1PM);
+}
+
+
+int main()
+{
+  tTimeZoneSet Zones;
+  tLocalTime  *pEastern = Zones.TimeZone(0);
+
+  HostSetSerialEcho(true);
+  TestDays(pEastern);
+  TestSpringForward(pEastern);
+  TestFallBack(pEastern);
+  TestSnooze(pEastern);
+  TestOnceAndLate(pEastern);
+
+  return CheckResult("TestAlarm");
+}
@@ -0,0 +1,382 @@
+/***************
+* NTP Clock
+*
+* Golden images of the panels.  Each panel is driven through tClockDisplay::Update()
+* into a tHostMax6954 on the pins, and what the chip would light is read back with
+* tVirtualDisplay and compared against the known-good pictures in test/golden:
+*
+*   <panel>-glyphs.txt        every printable character, in every digit
+*   <panel>-annunciators.txt  every combination of the panel's annunciators, steady
+*                             and blinking (both planes)
+*   <panel>-times.txt         24 hours of times as the clock shows them, with AM/PM
+*
+* Glyphs and annunciators are drawn as ASCII art.  Times are one line per frame.
+* Every frame also has the lit segments of each digit in the font's bit order, so
+* 14-segment panels, which the art can't show, are checked to the last segment.
+*
+* A deliberate change to what the panels show needs new pictures.  Run
+*
+*   TestGolden --update <source>/test/golden
+*
+* and look over the diff before committing it.  Without --update, a mismatch
+* prints the first line that differs and writes what the panel showed next to
+* the build, as <file>.new.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "Check.h"
+#include "Host.h"
+#include "HostMax6954.h"
+#include "ClockDisplay.h"
+#include "VirtualDisplay.h"
+#include "Font.h"
+
+#include <TimeLib.h>
+#include <string>
+
+#define GOLDEN_MINUTE_STEP  (60)
+
+
+/*********************************************
+* Collects what's printed
+*/
+
+class tStringPrint : public Print {
+public:
+  virtual size_t write(uint8_t u8Char) { s += (char) u8Char; return 1; }
+  using Print::write;
+
+  std::string s;
+};
+
+
+struct tGoldenPanel {
+  const char             *sName;
+  const tDisplayGeometry *pGeometry;
+  uint32_t                u32TimeStep;     // Seconds between frames of the times suite
+};
+
+// Panels with seconds go through the day in steps that aren't a whole number of
+// minutes, so every seconds digit comes up
+static const tGoldenPanel GoldenPanels[] = {
+  { "liteon637",  &DisplayGeometryLiteOn637,  GOLDEN_MINUTE_STEP },
+  { "sixdigit",   &DisplayGeometrySixDigit,   601 },
+  { "sixdigit14", &DisplayGeometrySixDigit14, 601 }
+};
+
+static const char * const AnnunciatorNames[CLOCK_NUM_ANNUNCIATORS] = {
+  "AM", "PM", "ALARM", "COLON", "COLON2"
+};
+
+
+/*********************************************
+* One panel, from tClockDisplay to the pictures
+*/
+
+class tGoldenRig {
+public:
+  tGoldenRig(const tDisplayGeometry &Geometry);
+
+  void Clear();
+  void Show();
+
+  void PrintSegments(Print &Out, uint8_t u8Plane);
+  void PrintFrame(Print &Out, const char *sLabel, uint8_t u8Plane = 0);
+  void PrintLine(Print &Out, const char *sLabel);
+
+  tHostMax6954    Chip;
+  tMax6954        Max;
+  tClockDisplay   Display;
+  tVirtualDisplay Virtual;
+};
+
+
+tGoldenRig::tGoldenRig(const tDisplayGeometry &Geometry) :
+  Display(Max, Geometry),
+  Virtual(Geometry, Chip.Model())
+{
+  Max.Init(Geometry.u8ScanLimit, Geometry.u8DigitType);
+  Clear();
+}
+
+
+void tGoldenRig::Clear()
+{
+  uint8_t i;
+
+  for (i=0; i<CLOCK_MAX_DIGITS; i++)        Display.Digit[i] = ' ';
+  for (i=0; i<CLOCK_NUM_ANNUNCIATORS; i++)  Display.Annunciator[i] = Display.Blink[i] = false;
+}
+
+
+/***************************************
+* tGoldenRig::Show
+*
+* Updates the panel, which must go out on the bus cleanly
+*/
+
+void tGoldenRig::Show()
+{
+  Display.Update();
+  CHECK_EQ(Chip.ProtocolErrors(), 0);
+  Chip.ClearLog();
+}
+
+
+/***************************************
+* tGoldenRig::PrintSegments
+*
+* "segs" and, for each digit, its lit segments in the font's bit order; then
+* "ann" and a character for each annunciator: '*' lit, '.' dark, '-' the panel
+* hasn't got it
+*/
+
+void tGoldenRig::PrintSegments(Print &Out, uint8_t u8Plane)
+{
+  char     sHex[8];
+  uint16_t u16Lit;
+  uint8_t  d, s, a;
+
+  Virtual.SetPlane(u8Plane);
+
+  Out.print("segs");
+  for (d=0; d<Display.NumDigits(); d++) {
+    u16Lit = 0;
+    for (s=0; s<GEOM_SEGS_PER_DIGIT; s++) {
+      if (Virtual.Segment(d, s) == VIRTUAL_SEG_ON)  u16Lit |= 1 << s;
+    }
+    snprintf(sHex, sizeof(sHex), " %04x", u16Lit);
+    Out.print(sHex);
+  }
+
+  Out.print("  ann ");
+  for (a=0; a<CLOCK_NUM_ANNUNCIATORS; a++) {
+    switch (Virtual.Annunciator(a)) {
+      case VIRTUAL_SEG_ON:   Out.print('*');  break;
+      case VIRTUAL_SEG_OFF:  Out.print('.');  break;
+      default:               Out.print('-');  break;
+    }
+  }
+  Out.println();
+}
+
+
+/***************************************
+* tGoldenRig::PrintFrame, PrintLine
+*
+* A frame drawn out, or on one line
+*/
+
+void tGoldenRig::PrintFrame(Print &Out, const char *sLabel, uint8_t u8Plane)
+{
+  Out.print("== ");
+  Out.println(sLabel);
+
+  Virtual.SetPlane(u8Plane);
+  Virtual.PrintAscii(Out);
+  PrintSegments(Out, u8Plane);
+}
+
+
+void tGoldenRig::PrintLine(Print &Out, const char *sLabel)
+{
+  Out.print(sLabel);
+  Out.print("  ");
+  PrintSegments(Out, 0);
+}
+
+
+/*********************************************
+* The suites
+*/
+
+static void RenderGlyphs(const tGoldenPanel &Panel, Print &Out)
+{
+  tGoldenRig Rig(*Panel.pGeometry);
+  char       sLabel[16];
+  int        c;
+  uint8_t    i;
+
+  for (c=FONT_FIRST_CHAR; c<=FONT_LAST_CHAR; c++) {
+    for (i=0; i<Rig.Display.NumDigits(); i++)  Rig.Display.Digit[i] = (char) c;
+    Rig.Show();
+
+    snprintf(sLabel, sizeof(sLabel), "'%c' %d", c, c);
+    Rig.PrintFrame(Out, sLabel);
+  }
+}
+
+
+static void RenderAnnunciators(const tGoldenPanel &Panel, Print &Out)
+{
+  tGoldenRig  Rig(*Panel.pGeometry);
+  std::string Label;
+  uint8_t     a, u8Plane, u8NumPlanes;
+  uint32_t    u32Combo;
+  int         iBlink;
+
+  for (iBlink=0; iBlink<2; iBlink++) {
+    u8NumPlanes = iBlink ? 2 : 1;
+
+    for (u32Combo=0; u32Combo < (1UL << CLOCK_NUM_ANNUNCIATORS); u32Combo++) {
+      Label = iBlink ? "blinking" : "steady";
+      for (a=0; a<CLOCK_NUM_ANNUNCIATORS; a++) {
+        Rig.Display.Annunciator[a] = (u32Combo >> a) & 1;
+        Rig.Display.Blink[a]       = iBlink;
+        if (Rig.Display.Annunciator[a])  Label += std::string(" ") + AnnunciatorNames[a];
+      }
+
+      // Combinations with annunciators the panel hasn't got would only repeat others
+      for (a=0; a<CLOCK_NUM_ANNUNCIATORS; a++) {
+        if (Rig.Display.Annunciator[a]  &&  Rig.Virtual.Annunciator(a) == VIRTUAL_SEG_ABSENT)  break;
+      }
+      if (a != CLOCK_NUM_ANNUNCIATORS)  continue;
+
+      Rig.Show();
+      for (u8Plane=0; u8Plane<u8NumPlanes; u8Plane++) {
+        Rig.PrintFrame(Out, (Label + (iBlink ? (u8Plane ? ", plane 1" : ", plane 0") : "")).c_str(), u8Plane);
+      }
+    }
+  }
+}
+
+
+// The clock's own format: 12 hour, no leading zero, HHMMSS
+static void RenderTimes(const tGoldenPanel &Panel, Print &Out)
+{
+  tGoldenRig Rig(*Panel.pGeometry);
+  char     sDigits[7], sLabel[16];
+  uint32_t u32Second;
+  int      iHour24, iHour12, iMinute, iSecond;
+
+  for (u32Second=0; u32Second<SECS_PER_DAY; u32Second+=Panel.u32TimeStep) {
+    iHour24 = u32Second / SECS_PER_HOUR;
+    iMinute = u32Second / SECS_PER_MIN % 60;
+    iSecond = u32Second % 60;
+    iHour12 = iHour24 % 12 == 0 ? 12 : iHour24 % 12;
+
+    snprintf(sDigits, sizeof(sDigits), "%2d%02d%02d", iHour12, iMinute, iSecond);
+    memcpy(Rig.Display.Digit, sDigits, Rig.Display.NumDigits());
+    Rig.Display.Annunciator[CLOCK_ANNUNCIATOR_AM]     = iHour24 < 12;
+    Rig.Display.Annunciator[CLOCK_ANNUNCIATOR_PM]     = iHour24 >= 12;
+    Rig.Display.Annunciator[CLOCK_ANNUNCIATOR_COLON]  = true;
+    Rig.Display.Annunciator[CLOCK_ANNUNCIATOR_COLON2] = true;
+    Rig.Show();
+
+    snprintf(sLabel, sizeof(sLabel), "%02d:%02d:%02d", iHour24, iMinute, iSecond);
+    Rig.PrintLine(Out, sLabel);
+  }
+}
+
+
+/*********************************************
+* Comparing with the pictures
+*/
+
+static bool ReadFile(const std::string &Path, std::string &Contents)
+{
+  FILE *pFile = fopen(Path.c_str(), "rb");
+  char  Buf[4096];
+  size_t Len;
+
+  if (pFile == NULL)  return false;
+
+  Contents.clear();
+  while ((Len = fread(Buf, 1, sizeof(Buf), pFile)) != 0)  Contents.append(Buf, Len);
+  fclose(pFile);
+  return true;
+}
+
+
+static bool WriteFile(const std::string &Path, const std::string &Contents)
+{
+  FILE *pFile = fopen(Path.c_str(), "wb");
+  bool  bOk;
+
+  if (pFile == NULL)  return false;
+
+  bOk = fwrite(Contents.data(), 1, Contents.size(), pFile) == Contents.size();
+  return fclose(pFile) == 0  &&  bOk;
+}
+
+
+/***************************************
+* Compare
+*
+* RETURNS:
+*   true if Got matches the golden file.  Otherwise prints the first line that
+*   doesn't and keeps Got as <file>.new.
+*/
+
+static bool Compare(const std::string &Dir, const std::string &File, const std::string &Got, bool bUpdate)
+{
+  std::string Expected;
+  size_t      Pos = 0, End, Line = 1;
+
+  if (bUpdate) {
+    if (!WriteFile(Dir + "/" + File, Got)) {
+      printf("%s: can't write it\n", File.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  if (!ReadFile(Dir + "/" + File, Expected)) {
+    printf("%s: can't read it\n", File.c_str());
+    WriteFile(File + ".new", Got);
+    return false;
+  }
+  if (Expected == Got)  return true;
+
+  // The first line that differs
+  while (Pos < Expected.size()  &&  Pos < Got.size()  &&  Expected[Pos] == Got[Pos]) {
+    if (Expected[Pos] == '\n')  Line++;
+    Pos++;
+  }
+  Pos = Expected.rfind('\n', Pos == 0 ? 0 : Pos - 1);
+  Pos = Pos == std::string::npos ? 0 : Pos + 1;
+
+  End = Expected.find('\n', Pos);
+  printf("%s:%u: expected \"%s\"\n", File.c_str(), (unsigned) Line, Expected.substr(Pos, End - Pos).c_str());
+  End = Got.find('\n', Pos);
+  printf("%s:%u: got      \"%s\"\n", File.c_str(), (unsigned) Line, Got.substr(Pos, End - Pos).c_str());
+
+  WriteFile(File + ".new", Got);
+  return false;
+}
+
+
+int main(int argc, char **argv)
+{
+  typedef void (*tRenderer)(const tGoldenPanel &Panel, Print &Out);
+  static const tRenderer Renderers[] = { RenderGlyphs, RenderAnnunciators, RenderTimes };
+  static const char * const Suites[] = { "glyphs", "annunciators", "times" };
+  std::string Dir;
+  bool        bUpdate = false;
+  size_t      p, s;
+
+  if (argc == 3  &&  strcmp(argv[1], "--update") == 0) {
+    bUpdate = true;
+    Dir     = argv[2];
+  }
+  else if (argc == 2) {
+    Dir = argv[1];
+  }
+  else {
+    printf("Usage: %s [--update] <golden directory>\n", argv[0]);
+    return 2;
+  }
+
+  for (p=0; p<GEOM_NUM_OF(GoldenPanels); p++) {
+    for (s=0; s<GEOM_NUM_OF(Renderers); s++) {
+      tStringPrint Out;
+
+      Renderers[s](GoldenPanels[p], Out);
+      CHECK(Compare(Dir, std::string(GoldenPanels[p].sName) + "-" + Suites[s] + ".txt", Out.s, bUpdate));
+    }
+  }
+
+  return CheckResult("TestGolden");
+}
@@ -0,0 +1,115 @@
+/***************
+* NTP Clock
+*
+* tLocalTime through both of 2020's DST changes, LocalToUtc() on skipped and
+* repeated times, and tTimeCheck across the changes and the new year in every
+* zone.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "Check.h"
+#include "Host.h"
+#include "LocalTime.h"
+#include "TimeCheck.h"
+
+// 2020-03-08 07:00:00 and 2020-11-01 06:00:00 UTC, when Eastern time changed
+#define TEST_DST_START_UTC  ((time_t) 1583650800)
+#define TEST_DST_END_UTC    ((time_t) 1604210400)
+#define TEST_YEAR_2021_UTC  ((time_t) 1609459200)
+
+
+static int SecondOfDay(time_t t)
+{
+  return (int) (t % SECS_PER_DAY);
+}
+
+
+/***************************************
+* FormatTime
+*
+* As ShowTime() lays out the digits: 12-hour, blank leading zero, HHMMSS
+*/
+
+static void FormatTime(time_t tLocal, bool bLeapSecond, char *pDigits, bool &bPm)
+{
+  tmElements_t Tm;
+  int          iHour12;
+
+  (void) bLeapSecond;
+  breakTime(tLocal, Tm);
+  iHour12 = Tm.Hour % 12 == 0 ? 12 : Tm.Hour % 12;
+
+  pDigits[0] = iHour12 >= 10 ? '1' : ' ';
+  pDigits[1] = '0' + iHour12 % 10;
+  pDigits[2] = '0' + Tm.Minute / 10;
+  pDigits[3] = '0' + Tm.Minute % 10;
+  pDigits[4] = '0' + Tm.Second / 10;
+  pDigits[5] = '0' + Tm.Second % 10;
+  bPm        = Tm.Hour >= 12;
+}
+
+
+/***************************************
+* TestChanges
+*
+*/
+
+static void TestChanges()
+{
+  tTimeZoneSet Zones;
+  tLocalTime  *pEastern = Zones.TimeZone(0);
+
+  CHECK_EQ(SecondOfDay(pEastern->UtcToLocal(TEST_DST_START_UTC - 1)), 1 * 3600 + 59 * 60 + 59);
+  CHECK(strcmp(pEastern->CurTimeZoneShortName(), "EST") == 0);
+  CHECK_EQ(SecondOfDay(pEastern->UtcToLocal(TEST_DST_START_UTC)), 3 * 3600);
+  CHECK(strcmp(pEastern->CurTimeZoneShortName(), "EDT") == 0);
+
+  CHECK_EQ(SecondOfDay(pEastern->UtcToLocal(TEST_DST_END_UTC - 1)), 1 * 3600 + 59 * 60 + 59);
+  CHECK(strcmp(pEastern->CurTimeZoneShortName(), "EDT") == 0);
+  CHECK_EQ(SecondOfDay(pEastern->UtcToLocal(TEST_DST_END_UTC)), 1 * 3600);
+  CHECK(strcmp(pEastern->CurTimeZoneShortName(), "EST") == 0);
+
+  // 2:30 on 8 March never happened; it comes out as 3:30 EDT
+  CHECK_EQ(pEastern->LocalToUtc(TEST_DST_START_UTC - 5 * 3600 + 1800), TEST_DST_START_UTC + 1800);
+
+  // 1:30 on 1 November happened twice; either will do, as long as it's 1:30
+  CHECK_EQ(SecondOfDay(pEastern->UtcToLocal(pEastern->LocalToUtc(TEST_DST_END_UTC - 4 * 3600 - 1800))), 1 * 3600 + 1800);
+}
+
+
+/***************************************
+* TestAround
+*
+* Every second of the three days around each of 2020's DST changes and the new
+* year, in each zone, against the reference
+*/
+
+static void TestAround()
+{
+  static const time_t tCentres[] = { TEST_DST_START_UTC, TEST_DST_END_UTC, TEST_YEAR_2021_UTC };
+  tTimeZoneSet Zones;
+  tTimeCheck   Check;
+  unsigned     i, z;
+
+  for (z=0; z<(unsigned) Zones.GetNumItems(); z++) {
+    for (i=0; i<sizeof(tCentres)/sizeof(tCentres[0]); i++) {
+      Check.Start(Zones.TimeZone(z), FormatTime, tCentres[i] - 36 * SECS_PER_HOUR, 3 * SECS_PER_DAY);
+      while (Check.Service(1000000))  ;
+
+      CHECK_EQ(Check.Failures(), 0);
+      if (Check.Failures() != 0)  Check.PrintReport(Serial);
+    }
+  }
+}
+
+
+int main()
+{
+  HostSetSerialEcho(true);
+  TestChanges();
+  TestAround();
+
+  return CheckResult("TestLocalTime");
+}
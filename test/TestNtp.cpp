@@ -0,0 +1,125 @@
+/***************
+* NTP Clock
+*
+* tNtp against the host's NTP server: the first sync, the query interval, retries
+* while the server is down, holdover, going offline, and a leap announcement.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "Check.h"
+#include "Host.h"
+#include "HostNet.h"
+#include "Ntp.h"
+
+// 2020-06-15 12:00:00 UTC, at virtual time 0
+#define TEST_UTC_S      (1592222400LL)
+#define TEST_POLL_MS    (50)
+#define TEST_RTT_US     (40000)
+
+
+static int64_t TrueUtcUs(uint64_t u64VirtualUs)
+{
+  return TEST_UTC_S * 1000000 + (int64_t) u64VirtualUs;
+}
+
+
+/***************************************
+* RunFor
+*
+* The clock's NTP task, every TEST_POLL_MS for u32Ms
+*/
+
+static void RunFor(tTimebase &Timebase, tNtp &Ntp, uint32_t u32Ms)
+{
+  uint32_t i;
+
+  for (i=0; i<u32Ms; i+=TEST_POLL_MS) {
+    HostAdvanceUs(TEST_POLL_MS * 1000);
+    Timebase.Service();
+    Ntp.GetUtcTime();
+  }
+}
+
+
+static int64_t OffByMs(tTimebase &Timebase)
+{
+  return Timebase.UtcMs() - TrueUtcUs(HostMicros64()) / 1000;
+}
+
+
+int main()
+{
+  tTimebase Timebase;
+  tNtp      Ntp(Timebase, "pool.ntp.org", 2390, 300);
+  uint32_t  i, u32Sent, u32Requests;
+
+  HostSetMillis(0);
+  HostNetReset();
+  HostNetAddAp("HostNet", "host-password", -60, 6);
+  HostNtpSetClock(TrueUtcUs);
+  HostNtpSetRoundTripUs(TEST_RTT_US);
+
+  WiFi.begin("HostNet", "host-password");
+  while (WiFi.status() != WL_CONNECTED)  HostAdvanceUs(100000);
+
+  // The first query goes straight away, and its reply sets the time to within half
+  // the round trip
+  CHECK_EQ(Ntp.SyncState(), NTP_SYNC_UNSYNCED);
+  RunFor(Timebase, Ntp, 1000);
+  CHECK_EQ(HostNtpRequests(), 1);
+  CHECK_EQ(Ntp.Stats().u32Received, 1);
+  CHECK_EQ(Ntp.SyncState(), NTP_SYNC_SYNCED);
+  CHECK(llabs(OffByMs(Timebase)) <= Timebase.ErrorMs());
+  CHECK(Timebase.ErrorMs() <= (TEST_RTT_US / 1000 + TEST_POLL_MS) / 2);
+  CHECK(TrueUtcUs(HostMicros64()) / 1000000 - now() <= 1);
+  CHECK(!Ntp.AwaitingResponse());
+
+  // Then one every 300 s
+  RunFor(Timebase, Ntp, 20 * 60 * 1000);
+  CHECK_EQ(HostNtpRequests(), 5);
+  for (i=1; i<HostNtpRequests(); i++) {
+    CHECK(llabs((int64_t) (HostNtpRequestUs(i) - HostNtpRequestUs(i - 1)) - 300000000LL) <= 1000000);
+  }
+  CHECK_EQ(Ntp.Stats().u32Received, 5);
+  CHECK(llabs(OffByMs(Timebase)) <= Timebase.ErrorMs());
+
+  // With the server down, the next query times out and the ones after it go every
+  // 10 s.  After two intervals without a reply, that's holdover.
+  HostNtpSetUp(false);
+  u32Requests = HostNtpRequests();
+  RunFor(Timebase, Ntp, 11 * 60 * 1000);
+  u32Sent = HostNtpRequests() - u32Requests;
+  CHECK(llabs((int64_t) (HostNtpRequestUs(u32Requests) - HostNtpRequestUs(u32Requests - 1)) - 300000000LL) <= 1000000);
+  CHECK_EQ(u32Sent, (HostMicros64() - HostNtpRequestUs(u32Requests)) / 10000000 + 1);
+  for (i=u32Requests+1; i<HostNtpRequests(); i++) {
+    CHECK(llabs((int64_t) (HostNtpRequestUs(i) - HostNtpRequestUs(i - 1)) - 10000000LL) <= 1000000);
+  }
+  CHECK_EQ(Ntp.Stats().u32Lost, u32Sent - (Ntp.AwaitingResponse() ? 1 : 0));
+  CHECK_EQ(Ntp.SyncState(), NTP_SYNC_HOLDOVER);
+
+  // Back up: synced again at the next retry
+  HostNtpSetUp(true);
+  RunFor(Timebase, Ntp, 11 * 1000);
+  CHECK_EQ(Ntp.SyncState(), NTP_SYNC_SYNCED);
+  CHECK(llabs(OffByMs(Timebase)) <= Timebase.ErrorMs());
+
+  // Offline, nothing is sent, and a request in flight is given up on
+  u32Requests = HostNtpRequests();
+  Ntp.SetOnline(false);
+  RunFor(Timebase, Ntp, 10 * 60 * 1000);
+  CHECK_EQ(HostNtpRequests(), u32Requests);
+  CHECK(!Ntp.AwaitingResponse());
+  Ntp.SetOnline(true);
+  RunFor(Timebase, Ntp, 1000);
+  CHECK_EQ(HostNtpRequests(), u32Requests + 1);
+
+  // A leap second announced mid-month is scheduled for the end of it
+  HostNtpSetLeap(NTP_LI_INSERT);
+  RunFor(Timebase, Ntp, 301 * 1000);
+  CHECK_EQ(Timebase.LeapPending(), TIMEBASE_LEAP_INSERT);
+  CHECK_EQ(Timebase.LeapTime(), 1593561600);     // 2020-07-01 00:00:00 UTC
+
+  return CheckResult("TestNtp");
+}
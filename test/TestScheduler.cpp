@@ -0,0 +1,229 @@
+/***************
+* NTP Clock
+*
+* tScheduler on the virtual clock: periods that don't drift, missed runs dropped,
+* one-shot tasks, the table filling up, deadlines either side of the millis()
+* wrap, Idle() sleeping to the next deadline, and a key press cutting it short.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "Check.h"
+#include "Host.h"
+#include "HostMax6954.h"
+#include "Max6954.h"
+#include "Scheduler.h"
+
+extern "C" {
+#include "user_interface.h"
+}
+
+struct tTaskLog {
+  uint32_t u32Runs;
+  uint32_t u32LastMs;
+};
+
+
+static void LogTask(void *pArg)
+{
+  tTaskLog *pLog = (tTaskLog *) pArg;
+
+  pLog->u32Runs++;
+  pLog->u32LastMs = millis();
+}
+
+
+/***************************************
+* RunFor
+*
+* The main loop, for u32Ms of virtual time
+*/
+
+static void RunFor(tScheduler &Scheduler, uint32_t u32Ms)
+{
+  uint64_t u64EndUs = HostMicros64() + (uint64_t) u32Ms * 1000;
+
+  while (HostMicros64() < u64EndUs) {
+    Scheduler.Run();
+    Scheduler.Idle();
+  }
+}
+
+
+/***************************************
+* TestPeriodic
+*
+* Two tasks at 100 and 250 ms run on their deadlines, however long the
+* other one takes
+*/
+
+static void TestPeriodic(uint32_t u32StartMs)
+{
+  tScheduler Scheduler;
+  tTaskLog   Fast = { 0, 0 }, Slow = { 0, 0 };
+  int        iFast, iSlow;
+
+  HostSetMillis(u32StartMs);
+  iFast = Scheduler.AddTask("fast", LogTask, &Fast, 100);
+  iSlow = Scheduler.AddTask("slow", LogTask, &Slow, 250, 50);
+  CHECK(iFast != SCHED_NO_TASK  &&  iSlow != SCHED_NO_TASK);
+
+  RunFor(Scheduler, 10000);
+
+  CHECK_EQ(Fast.u32Runs, 100);
+  CHECK_EQ(Slow.u32Runs, 40);
+  CHECK_EQ(Fast.u32LastMs - u32StartMs, 9900);
+  CHECK_EQ(Slow.u32LastMs - u32StartMs, 9800);
+  CHECK(Scheduler.Stats(iFast).u32MaxLateMs <= 1);
+  CHECK(Scheduler.Stats(iSlow).u32MaxLateMs <= 1);
+}
+
+
+/***************************************
+* TestMissedRuns
+*
+* A task that falls more than a period behind runs once, and starts a fresh
+* period from then
+*/
+
+static void TestMissedRuns()
+{
+  tScheduler Scheduler;
+  tTaskLog   Log = { 0, 0 };
+
+  HostSetMillis(1000);
+  Scheduler.AddTask("task", LogTask, &Log, 100);
+  Scheduler.Run();
+  CHECK_EQ(Log.u32Runs, 1);
+
+  HostAdvanceUs(550000);
+  Scheduler.Run();
+  CHECK_EQ(Log.u32Runs, 2);
+  CHECK_EQ(Scheduler.MsUntilNext(), 100);
+  CHECK_EQ(Scheduler.Stats(0).u32MaxLateMs, 450);
+}
+
+
+/***************************************
+* TestOneShot
+*
+*/
+
+static void TestOneShot()
+{
+  tScheduler Scheduler;
+  tTaskLog   Log = { 0, 0 };
+  int        iTask;
+
+  HostSetMillis(0);
+  iTask = Scheduler.AddTask("once", LogTask, &Log, 0, 30);
+  RunFor(Scheduler, 1000);
+  CHECK_EQ(Log.u32Runs, 1);
+  CHECK_EQ(Log.u32LastMs, 30);
+
+  Scheduler.Reschedule(iTask, 5);
+  RunFor(Scheduler, 1000);
+  CHECK_EQ(Log.u32Runs, 2);
+  CHECK_EQ(Log.u32LastMs, 1035);
+}
+
+
+/***************************************
+* TestFull
+*
+*/
+
+static void TestFull()
+{
+  tScheduler Scheduler;
+  tTaskLog   Log = { 0, 0 };
+  int        i;
+
+  for (i=0; i<SCHED_MAX_TASKS; i++)  CHECK(Scheduler.AddTask("task", LogTask, &Log, 1000) == i);
+  CHECK(Scheduler.AddTask("extra", LogTask, &Log, 1000) == SCHED_NO_TASK);
+}
+
+
+/***************************************
+* TestIdle
+*
+* Idle() is one delay() to the next deadline, however far off it is, so the
+* SDK can light-sleep through all of it.  With nothing due it just yields.
+*/
+
+static void TestIdle()
+{
+  tScheduler Scheduler;
+  tTaskLog   Log = { 0, 0 };
+
+  HostSetMillis(0);
+  Scheduler.AddTask("soon", LogTask, &Log, 1000, 750);
+  Scheduler.AddTask("later", LogTask, &Log, 5000, 2000);
+
+  Scheduler.Idle();
+  CHECK_EQ(millis(), 750);
+  CHECK_EQ(Log.u32Runs, 0);
+
+  Scheduler.Idle();
+  CHECK_EQ(millis(), 750);
+  Scheduler.Run();
+  CHECK_EQ(Log.u32Runs, 1);
+
+  Scheduler.Idle();
+  CHECK_EQ(millis(), 1750);
+}
+
+
+/***************************************
+* TestWake
+*
+* A key press ends Idle()'s delay() there and then: the MAX6954's IRQ handler
+* calls esp_schedule()
+*/
+
+static void PressKey(void *pArg)
+{
+  ((tHostMax6954 *) pArg)->PressKey(3);
+}
+
+
+static void TestWake()
+{
+  tHostMax6954 Chip;
+  tMax6954     Max;
+  tScheduler   Scheduler;
+  tTaskLog     Log = { 0, 0 };
+  os_timer_t   Timer;
+  uint32_t     u32StartMs;
+
+  HostResetPins();
+  Max.Init(4);
+  Max.EnableKeyScan(1);
+  Scheduler.AddTask("slow", LogTask, &Log, 1000, 1000);
+
+  // The key goes down 7 ms into the sleep
+  u32StartMs = millis();
+  os_timer_setfn(&Timer, PressKey, &Chip);
+  os_timer_arm(&Timer, 7, false);
+  Scheduler.Idle();
+  CHECK(Max.KeyIrqPending());
+  CHECK_EQ(millis() - u32StartMs, 7);
+  CHECK_EQ(Log.u32Runs, 0);
+
+  detachInterrupt(MAX_IRQ_GPIO);
+}
+
+
+int main()
+{
+  TestPeriodic(0);
+  TestPeriodic(0xFFFFFFFFUL - 4321);     // Across the millis() wrap
+  TestMissedRuns();
+  TestOneShot();
+  TestFull();
+  TestIdle();
+  TestWake();
+
+  return CheckResult("TestScheduler");
+}
@@ -0,0 +1,145 @@
+/***************
+* NTP Clock
+*
+* tSettingsStore on the host's flash: values kept across a reboot, compaction
+* when a sector fills, and a record torn by a power cut.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "Check.h"
+#include "Host.h"
+#include "Settings.h"
+
+// Where the store's two sectors are, for the flash layout CMakeLists.txt links with
+#define TEST_SECTOR_0  ((uint32_t) (uintptr_t) &_FS_end - 0x40200000UL - 2 * SETTINGS_SECTOR_SIZE)
+
+
+/***************************************
+* TestFresh
+*
+*/
+
+static void TestFresh()
+{
+  tSettingsStore Store;
+  char           sValue[SETTINGS_MAX_LEN];
+  uint32_t       u32Value = 0x12345678;
+
+  HostEraseFlash();
+  CHECK(Store.Begin());
+  CHECK(Store.IsReady());
+  CHECK_EQ(Store.Get(0, sValue, sizeof(sValue)), -1);
+
+  CHECK(Store.Set(0, "pool.ntp.org", 13));
+  CHECK(Store.Set(3, &u32Value, sizeof(u32Value)));
+  CHECK_EQ(Store.Get(0, sValue, sizeof(sValue)), 13);
+  CHECK(strcmp(sValue, "pool.ntp.org") == 0);
+
+  // Out of range, or too long
+  CHECK(!Store.Set(SETTINGS_MAX_KEYS, "x", 1));
+  CHECK(!Store.Set(1, sValue, SETTINGS_MAX_LEN + 1));
+}
+
+
+/***************************************
+* TestReboot
+*
+* A new store, on the flash the last one left
+*/
+
+static void TestReboot()
+{
+  tSettingsStore Store;
+  char           sValue[SETTINGS_MAX_LEN];
+  uint32_t       u32Value = 0;
+  uint16_t       u16Used;
+
+  CHECK(Store.Begin());
+  CHECK_EQ(Store.Get(0, sValue, sizeof(sValue)), 13);
+  CHECK(strcmp(sValue, "pool.ntp.org") == 0);
+  CHECK_EQ(Store.Get(3, &u32Value, sizeof(u32Value)), 4);
+  CHECK_EQ(u32Value, 0x12345678);
+
+  // The same value again writes nothing
+  u16Used = Store.BytesUsed();
+  CHECK(Store.Set(3, &u32Value, sizeof(u32Value)));
+  CHECK_EQ(Store.BytesUsed(), u16Used);
+
+  CHECK(Store.Remove(3));
+  CHECK_EQ(Store.Get(3, &u32Value, sizeof(u32Value)), -1);
+}
+
+
+/***************************************
+* TestCompaction
+*
+* Enough changes to fill a sector several times over keep only the latest values
+*/
+
+static void TestCompaction()
+{
+  tSettingsStore Store, Rebooted;
+  uint32_t       i, u32Value;
+
+  HostEraseFlash();
+  CHECK(Store.Begin());
+  for (i=0; i<2000; i++)  CHECK(Store.Set(i % 4, &i, sizeof(i)));
+  CHECK(Store.Compactions() >= 3);
+
+  CHECK(Rebooted.Begin());
+  CHECK_EQ(Rebooted.Generation(), Store.Generation());
+  for (i=0; i<4; i++) {
+    CHECK_EQ(Rebooted.Get(i, &u32Value, sizeof(u32Value)), 4);
+    CHECK_EQ(u32Value, 1996 + i);
+  }
+}
+
+
+/***************************************
+* TestTornRecord
+*
+* The power goes while the last record is being written.  After the reboot the key
+* has its value from before, and the store carries on.
+*/
+
+static void TestTornRecord()
+{
+  tSettingsStore Store, Rebooted;
+  char           sValue[SETTINGS_MAX_LEN];
+  uint32_t       u32Zero = 0;
+  uint8_t        i;
+
+  HostEraseFlash();
+  CHECK(Store.Begin());
+  CHECK(Store.Set(1, "first", 6));
+  CHECK(Store.Set(2, "other", 6));
+  CHECK(Store.Set(1, "second", 7));
+
+  // Clear the last word of the value in whichever sector is live (the other is
+  // older, so it doesn't matter there)
+  for (i=0; i<2; i++)  ESP.flashWrite(TEST_SECTOR_0 + i * SETTINGS_SECTOR_SIZE + Store.BytesUsed() - 4, &u32Zero, 4);
+
+  CHECK(Rebooted.Begin());
+  CHECK(Rebooted.BytesUsed() < Store.BytesUsed());
+  CHECK_EQ(Rebooted.Get(1, sValue, sizeof(sValue)), 6);
+  CHECK(strcmp(sValue, "first") == 0);
+  CHECK_EQ(Rebooted.Get(2, sValue, sizeof(sValue)), 6);
+  CHECK(strcmp(sValue, "other") == 0);
+
+  CHECK(Rebooted.Set(1, "third", 6));
+  CHECK_EQ(Rebooted.Get(1, sValue, sizeof(sValue)), 6);
+  CHECK(strcmp(sValue, "third") == 0);
+}
+
+
+int main()
+{
+  TestFresh();
+  TestReboot();
+  TestCompaction();
+  TestTornRecord();
+
+  return CheckResult("TestSettings");
+}
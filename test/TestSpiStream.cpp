@@ -0,0 +1,291 @@
+/***************
+* NTP Clock
+*
+* The MAX6954's command streams, as they appear on the pins: the bit-banger's
+* exact pin sequence for one frame, the frames Init() sends, digit writes, the
+* register read protocol, and key scanning from the IRQ to the events.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "Check.h"
+#include "Host.h"
+#include "HostMax6954.h"
+#include "Max6954.h"
+
+#include <vector>
+
+
+/*********************************************
+* Records every pin write, in order
+*/
+
+struct tPinWrite {
+  uint8_t u8Pin;
+  uint8_t u8Level;
+};
+
+class tPinRecorder : public tHostPinDevice {
+public:
+  tPinRecorder()  { HostAttachPinDevice(this); }
+  ~tPinRecorder() { HostDetachPinDevice(this); }
+
+  virtual void PinWrite(uint8_t u8Pin, uint8_t u8Level)
+  {
+    tPinWrite Write = { u8Pin, u8Level };
+    Writes.push_back(Write);
+  }
+
+  std::vector<tPinWrite> Writes;
+};
+
+
+/***************************************
+* CheckStream
+*
+* The fake chip saw exactly these commands, and nothing else
+*/
+
+static void CheckStream(const tHostMax6954 &Chip, const uint16_t *pu16Expected, size_t Num)
+{
+  size_t i;
+
+  CHECK_EQ(Chip.NumTransactions(), Num);
+  for (i=0; i<Num  &&  i<Chip.NumTransactions(); i++) {
+    CHECK_EQ(Chip.Transaction(i).u16Command, pu16Expected[i]);
+    CHECK_EQ(Chip.Transaction(i).u8NumBits,  16);
+  }
+  CHECK_EQ(Chip.ProtocolErrors(), 0);
+}
+
+
+/***************************************
+* TestWrite16Pins
+*
+* One frame, pin by pin: CLK low, CS low, then for each bit DIN, CLK high and
+* CLK low, except that CS goes high before the last CLK low; then CLK back high.
+* DOUT is sampled after each rising edge and makes up the return value.
+*/
+
+static void TestWrite16Pins()
+{
+  tMaximBitBangSpi Spi(MAX_SCLK_GPIO, MAX_SDIN_GPIO, MAX_SDOUT_GPIO, MAX_CS_GPIO);
+  tPinRecorder     Recorder;
+  std::vector<tPinWrite> Expected;
+  uint16_t u16Command = 0x0123;
+  int      i;
+
+  Expected.push_back((tPinWrite) { MAX_SCLK_GPIO, LOW });
+  Expected.push_back((tPinWrite) { MAX_CS_GPIO,   LOW });
+  for (i=15; i>=0; i--) {
+    Expected.push_back((tPinWrite) { MAX_SDOUT_GPIO, (uint8_t) ((u16Command >> i) & 0x01) });
+    Expected.push_back((tPinWrite) { MAX_SCLK_GPIO,  HIGH });
+    if (i == 0)  Expected.push_back((tPinWrite) { MAX_CS_GPIO, HIGH });
+    Expected.push_back((tPinWrite) { MAX_SCLK_GPIO,  LOW });
+  }
+  Expected.push_back((tPinWrite) { MAX_SCLK_GPIO, HIGH });
+
+  // Nothing on DOUT, so it reads back low
+  CHECK_EQ(Spi.Write16(u16Command), 0);
+
+  CHECK_EQ(Recorder.Writes.size(), 52);
+  CHECK_EQ(Recorder.Writes.size(), Expected.size());
+  for (i=0; i<(int) Expected.size()  &&  i<(int) Recorder.Writes.size(); i++) {
+    CHECK_EQ(Recorder.Writes[i].u8Pin,   Expected[i].u8Pin);
+    CHECK_EQ(Recorder.Writes[i].u8Level, Expected[i].u8Level);
+  }
+
+  // DOUT is never driven; every data bit is on GPIO13
+  CHECK_EQ(HostPinMode(MAX_SDIN_GPIO),  INPUT);
+  CHECK_EQ(HostPinMode(MAX_SDOUT_GPIO), OUTPUT);
+}
+
+
+/***************************************
+* TestReadProtocol
+*
+* A read is the address with D15 set, then a no-op during which the chip clocks
+* that command's top byte back out, with the value in the bottom one
+*/
+
+static void TestReadProtocol()
+{
+  tHostMax6954     Chip;
+  tMaximBitBangSpi Spi(MAX_SCLK_GPIO, MAX_SDIN_GPIO, MAX_SDOUT_GPIO, MAX_CS_GPIO);
+  const uint16_t   u16Expected[] = { 0x0217, 0x8200, 0x0000 };
+
+  CHECK_EQ(Spi.Write16(0x0217), 0);
+  CHECK_EQ(Spi.ReadReg(MAX6954_REG_GlobalIntensity), 0x17);
+  CheckStream(Chip, u16Expected, 3);
+  CHECK_EQ(Chip.Transaction(2).u16Response, 0x8217);
+  CHECK_EQ(Chip.Model().ReadMismatches(), 0);
+}
+
+
+/***************************************
+* TestInit
+*
+* Init() for the four-digit LiteOn, frame by frame.  Nothing goes out before
+* Init().
+*/
+
+static void TestInit()
+{
+  tHostMax6954 Chip;
+  tMax6954     Max;
+  tSpiTrace    Trace;
+  int          i;
+  const uint16_t u16Expected[] = {
+    0x0421,     // Configuration: leave shutdown, clear digit data
+    0x0701,     // Display test on
+    0x0700,     //   and off
+    0x020A,     // Global intensity 10
+    0x0303,     // Scan limit, four digits
+    0x0C00,     // Digit types, 16_AND_16 for every pair
+    0x0100,     // No decoding
+    0x8200,     // Read global intensity...
+    0x0000      //   ...clocked out with a no-op
+  };
+
+  Max.SetBrightness(3);
+  CHECK_EQ(Chip.NumTransactions(), 0);
+
+  Max.SetSpiTrace(&Trace);
+  Max.Init(4);
+  CheckStream(Chip, u16Expected, sizeof(u16Expected) / sizeof(u16Expected[0]));
+  CHECK_EQ(Chip.Transaction(8).u16Response, 0x820A);
+
+  CHECK_EQ(Chip.Model().Register(MAX6954_REG_Configuration),   0x21);
+  CHECK_EQ(Chip.Model().Register(MAX6954_REG_GlobalIntensity), 10);
+  CHECK_EQ(Chip.Model().Register(MAX6954_REG_ScanLimit),       3);
+
+  // The driver's own trace decodes the same frames from the edges it drove
+  CHECK_EQ(Trace.NumTransactions(), (int) Chip.NumTransactions());
+  for (i=0; i<Trace.NumTransactions()  &&  i<(int) Chip.NumTransactions(); i++) {
+    CHECK_EQ(Trace.Transaction(i).u16Command,  Chip.Transaction(i).u16Command);
+    CHECK_EQ(Trace.Transaction(i).u16Response, Chip.Transaction(i).u16Response);
+  }
+  CHECK_EQ(Trace.ProtocolErrors(), 0);
+  Max.SetSpiTrace(NULL);
+}
+
+
+/***************************************
+* TestDigitsAndConfig
+*
+* Digit writes go to one plane or, at 0x60, to both at once.  Blink and
+* individual intensities are bits in the configuration register, which keeps
+* what was there.
+*/
+
+static void TestDigitsAndConfig()
+{
+  tHostMax6954 Chip;
+  tMax6954     Max;
+  const uint16_t u16Expected[] = {
+    0x627F,     // Digit 2, both planes
+    0x2301,     // Digit 3, plane 0
+    0x4380,     // Digit 3, plane 1
+    0x0409,     // Blink, slow
+    0x0449,     //   plus individual intensities
+    0x0441,     // Blink off
+    0x020F      // Brightest
+  };
+
+  Max.Init(4);
+  Chip.ClearLog();
+
+  Max.WriteDigit(2, MAX6954_REG_PLANE0 | MAX6954_REG_PLANE1, 0x7F);
+  Max.WriteDigit(3, MAX6954_REG_PLANE0, 0x01);
+  Max.WriteDigit(3, MAX6954_REG_PLANE1, 0x80);
+  Max.SetBlink(true);
+  Max.SetIndividualIntensities(true);
+  Max.SetBlink(false);
+  Max.SetBrightness(15);
+  CheckStream(Chip, u16Expected, sizeof(u16Expected) / sizeof(u16Expected[0]));
+
+  CHECK_EQ(Chip.Model().DigitPlane(2, 0), 0x7F);
+  CHECK_EQ(Chip.Model().DigitPlane(2, 1), 0x7F);
+  CHECK_EQ(Chip.Model().DigitPlane(3, 0), 0x01);
+  CHECK_EQ(Chip.Model().DigitPlane(3, 1), 0x80);
+}
+
+
+/***************************************
+* TestKeyScan
+*
+* Enabling the scanner reads the debounce register to clear it.  A press pulls
+* IRQ low; ServiceKeys() then reads the debounce register (which lets IRQ go) and
+* polls the pressed register every MAX6954_KEY_POLL_MS until the key comes up.
+*/
+
+static void TestKeyScan()
+{
+  tHostMax6954 Chip;
+  tMax6954     Max;
+  tKeyEvent    Event;
+  uint32_t     u32StartMs;
+  const uint16_t u16Enable[] = { 0x0620, 0x8800, 0x0000 };
+  const uint16_t u16Press[]  = { 0x8800, 0x0000 };
+  const uint16_t u16Poll[]   = { 0x8C00, 0x0000 };
+
+  Max.Init(4);
+  Chip.ClearLog();
+
+  Max.EnableKeyScan(1);
+  CheckStream(Chip, u16Enable, 3);
+  CHECK_EQ(HostPinMode(MAX_IRQ_GPIO), INPUT_PULLUP);
+  CHECK(!Max.KeysActive());
+
+  // Nothing down: no bus traffic at all
+  Chip.ClearLog();
+  u32StartMs = millis();
+  Max.ServiceKeys(u32StartMs);
+  Max.ServiceKeys(u32StartMs + 100);
+  CHECK_EQ(Chip.NumTransactions(), 0);
+
+  Chip.PressKey(3);
+  CHECK(Chip.IrqAsserted());
+  CHECK(Max.KeyIrqPending());
+
+  Max.ServiceKeys(u32StartMs + 200);
+  CheckStream(Chip, u16Press, 2);
+  CHECK_EQ(Chip.Transaction(1).u16Response, 0x8808);
+  CHECK(!Chip.IrqAsserted());
+  CHECK(Max.GetKeyEvent(Event));
+  CHECK_EQ(Event.u8Key,  3);
+  CHECK_EQ(Event.u8Type, KEY_EVENT_PRESS);
+  CHECK(!Max.GetKeyEvent(Event));
+
+  // Still down at the next poll; up at the one after
+  Chip.ClearLog();
+  Max.ServiceKeys(u32StartMs + 200 + MAX6954_KEY_POLL_MS - 1);
+  CHECK_EQ(Chip.NumTransactions(), 0);
+  Max.ServiceKeys(u32StartMs + 200 + MAX6954_KEY_POLL_MS);
+  CheckStream(Chip, u16Poll, 2);
+  CHECK(!Max.GetKeyEvent(Event));
+
+  Chip.ReleaseKey(3);
+  Chip.ClearLog();
+  Max.ServiceKeys(u32StartMs + 200 + 2 * MAX6954_KEY_POLL_MS);
+  CheckStream(Chip, u16Poll, 2);
+  CHECK(Max.GetKeyEvent(Event));
+  CHECK_EQ(Event.u8Key,  3);
+  CHECK_EQ(Event.u8Type, KEY_EVENT_RELEASE);
+  CHECK(!Max.KeysActive());
+
+  detachInterrupt(MAX_IRQ_GPIO);
+}
+
+
+int main()
+{
+  TestWrite16Pins();
+  TestReadProtocol();
+  TestInit();
+  TestDigitsAndConfig();
+  TestKeyScan();
+
+  return CheckResult("TestSpiStream");
+}
@@ -0,0 +1,158 @@
+/***************
+* NTP Clock
+*
+* tTimebase on the virtual clock: the micros() wrap, measuring a crystal that
+* runs fast, holdover error, and an inserted leap second.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "Check.h"
+#include "Host.h"
+#include "Timebase.h"
+
+// 2016-12-31 23:00:00 UTC, an hour before a real leap second
+#define TEST_UTC_MS    (1483225200000LL)
+
+// The crystal runs this fast
+#define TEST_FAST_PPM  (100)
+
+
+/***************************************
+* Advance
+*
+* Moves the virtual clock on, looking at the timebase often enough for it to
+* see every micros() wrap, as the clock's loop does
+*/
+
+static void Advance(tTimebase &Timebase, uint64_t u64Us)
+{
+  uint64_t u64Step;
+
+  while (u64Us != 0) {
+    u64Step = min(u64Us, (uint64_t) 10000000);
+    HostAdvanceUs(u64Step);
+    Timebase.Service();
+    u64Us -= u64Step;
+  }
+}
+
+
+/***************************************
+* TrueUtcMs
+*
+* The true time, with the virtual clock TEST_FAST_PPM fast from u64StartUs
+*/
+
+static int64_t TrueUtcMs(uint64_t u64StartUs)
+{
+  uint64_t u64ElapsedUs = HostMicros64() - u64StartUs;
+
+  return TEST_UTC_MS + (int64_t) (u64ElapsedUs - u64ElapsedUs * TEST_FAST_PPM / 1000000) / 1000;
+}
+
+
+/***************************************
+* TestWrap
+*
+*/
+
+static void TestWrap()
+{
+  tTimebase Timebase;
+  uint64_t  u64StartUs;
+
+  // Half a second before micros() wraps
+  HostSetMillis(4294467);
+  u64StartUs = Timebase.MonotonicUs();
+  CHECK(u64StartUs < 0x100000000ULL);
+
+  Advance(Timebase, 2000000);
+  CHECK_EQ(Timebase.MonotonicUs() - u64StartUs, 2000000);
+  CHECK(Timebase.MonotonicUs() > 0x100000000ULL);
+}
+
+
+/***************************************
+* TestFrequency
+*
+* Two syncs ten minutes apart measure the crystal.  After that it keeps time to a
+* few milliseconds over an hour on its own.
+*/
+
+static void TestFrequency()
+{
+  tTimebase Timebase;
+  uint64_t  u64StartUs;
+
+  HostSetMillis(1000);
+  u64StartUs = HostMicros64();
+  CHECK(!Timebase.IsSet());
+  CHECK_EQ(Timebase.ErrorMs(), TIMEBASE_ERROR_UNKNOWN);
+
+  Timebase.Sync(TrueUtcMs(u64StartUs), 10);
+  CHECK(Timebase.IsSet());
+  CHECK(!Timebase.FreqKnown());
+  CHECK_EQ(Timebase.UtcMs(), TEST_UTC_MS);
+
+  // Before the frequency is known, the error grows at the crystal's tolerance
+  Advance(Timebase, 600000000);
+  CHECK_EQ(Timebase.ErrorMs(), 10 + 600000 * TIMEBASE_WANDER_UNKNOWN_PPB / 1000000000);
+  CHECK_EQ(Timebase.UtcMs() - TrueUtcMs(u64StartUs), 60);
+
+  Timebase.Sync(TrueUtcMs(u64StartUs), 10);
+  CHECK(Timebase.FreqKnown());
+  CHECK(abs(Timebase.FreqPpb() + TEST_FAST_PPM * 1000) <= 2000);
+
+  Advance(Timebase, 3600000000ULL);
+  CHECK(llabs(Timebase.UtcMs() - TrueUtcMs(u64StartUs)) <= 8);
+  CHECK_EQ(Timebase.HoldoverMs(), 3600000);
+  CHECK(Timebase.ErrorMs() >= 10 + 8);
+}
+
+
+/***************************************
+* TestLeapInsert
+*
+* The server announces a leap an hour ahead.  23:59:59 comes round twice, the
+* second time as the leap second.
+*/
+
+static void TestLeapInsert()
+{
+  tTimebase Timebase;
+  int64_t   i64MidnightMs = TEST_UTC_MS + 3600000;
+
+  HostSetMillis(1000);
+  Timebase.Sync(TEST_UTC_MS, 10, TIMEBASE_LEAP_INSERT);
+  CHECK_EQ(Timebase.LeapPending(), TIMEBASE_LEAP_INSERT);
+  CHECK_EQ(Timebase.LeapTime(), i64MidnightMs / 1000);
+
+  Advance(Timebase, 3600000000ULL - 500000);
+  CHECK_EQ(Timebase.UtcMs(), i64MidnightMs - 500);
+  CHECK(!Timebase.InLeapSecond());
+
+  Advance(Timebase, 1000000);
+  CHECK_EQ(Timebase.UtcMs(), i64MidnightMs - 500);
+  CHECK(Timebase.InLeapSecond());
+
+  Advance(Timebase, 1000000);
+  CHECK_EQ(Timebase.UtcMs(), i64MidnightMs + 500);
+  CHECK(!Timebase.InLeapSecond());
+
+  // A sync after the leap, still announcing it, leaves it done with
+  Timebase.Sync(i64MidnightMs + 500, 10, TIMEBASE_LEAP_INSERT);
+  CHECK_EQ(Timebase.LeapPending(), TIMEBASE_LEAP_NONE);
+  CHECK_EQ(Timebase.UtcMs(), i64MidnightMs + 500);
+}
+
+
+int main()
+{
+  TestWrap();
+  TestFrequency();
+  TestLeapInsert();
+
+  return CheckResult("TestTimebase");
+}
@@ -0,0 +1,623 @@
+/***************
+* NTP Clock
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "Host.h"
+#include "coredecls.h"
+#include "user_interface.h"
+
+#include <chrono>
+#include <map>
+#include <vector>
+#include <deque>
+
+
+HardwareSerial Serial;
+EspClass       ESP;
+tHostGpioReg   GPOS(HIGH);
+tHostGpioReg   GPOC(LOW);
+
+#define HOST_FLASH_SECTOR_SIZE  (4096)
+#define HOST_RTC_BYTES          (512)
+
+static uint64_t _u64NowUs;
+static bool     _bRealCycles;
+static bool     _bInDelay;
+static bool     _bScheduled;     // esp_schedule() since the last delay() or yield()
+
+static uint8_t        _u8PinMode[HOST_NUM_PINS];
+static uint8_t        _u8PinLevel[HOST_NUM_PINS];
+static uint32_t       _u32PinWrites[HOST_NUM_PINS];
+static uint32_t       _u32TotalPinWrites;
+static void         (*_pfnIsr[HOST_NUM_PINS])(void);
+static int            _iIsrMode[HOST_NUM_PINS];
+static tHostPinDevice *_pDevices[HOST_MAX_PIN_DEVICES];
+static uint16_t       _u16Analog;
+
+// Built on first use, since global objects elsewhere may print from their
+// constructors before this file's have run
+static std::string      &_SerialOut() { static std::string sOut; return sOut; }
+static std::deque<char> &_SerialIn()  { static std::deque<char> In; return In; }
+static bool             _bSerialEcho;
+
+static std::map<uint32_t, std::vector<uint8_t> > &_FlashSectors() { static std::map<uint32_t, std::vector<uint8_t> > Sectors; return Sectors; }
+static uint8_t _u8Rtc[HOST_RTC_BYTES];
+static bool    _bRestart;
+
+static os_timer_t *_pTimers;
+
+static timercallback _pfnTimer1;
+static bool          _bTimer1Enabled;
+static bool          _bTimer1Loop;
+static uint8_t       _u8Timer1Divider;
+static uint32_t      _u32Timer1Ticks;
+static uint64_t      _u64Timer1DueUs;
+
+static uint32_t _u32RandomState = 1;
+
+
+/*********************************************
+* Virtual time
+*/
+
+uint64_t HostMicros64()
+{
+  return _u64NowUs;
+}
+
+
+void HostSetMillis(uint32_t u32Ms)
+{
+  _u64NowUs = (uint64_t) u32Ms * 1000;
+}
+
+
+void HostUseRealCycles(bool bReal)
+{
+  _bRealCycles = bReal;
+}
+
+
+/***************************************
+* _Timer1PeriodUs
+*
+* Timer1 counts the 80 MHz clock, divided by 1, 16 or 256
+*/
+
+static uint64_t _Timer1PeriodUs()
+{
+  uint32_t u32Div = _u8Timer1Divider == TIM_DIV256 ? 256 : _u8Timer1Divider == TIM_DIV16 ? 16 : 1;
+  uint64_t u64Us  = (uint64_t) _u32Timer1Ticks * u32Div / 80;
+
+  return u64Us ? u64Us : 1;
+}
+
+
+/***************************************
+* HostAdvanceUs
+*
+* Moves time on to each timer that falls due in turn, and runs it, so a timer
+* sees the time it was due at
+*/
+
+void HostAdvanceUs(uint64_t u64Us)
+{
+  uint64_t    u64EndUs = _u64NowUs + u64Us;
+  os_timer_t *pTimer, *pNext;
+  uint64_t    u64NextUs;
+
+  for (;;) {
+    pNext     = NULL;
+    u64NextUs = u64EndUs;
+    for (pTimer = _pTimers; pTimer != NULL; pTimer = pTimer->pNext) {
+      if (pTimer->u64DueUs <= u64NextUs) {
+        pNext     = pTimer;
+        u64NextUs = pTimer->u64DueUs;
+      }
+    }
+    if (_bTimer1Enabled  &&  _pfnTimer1 != NULL  &&  _u64Timer1DueUs <= u64NextUs) {
+      if (_u64Timer1DueUs > _u64NowUs)  _u64NowUs = _u64Timer1DueUs;
+      if (_bTimer1Loop)  _u64Timer1DueUs += _Timer1PeriodUs();
+      else               _bTimer1Enabled  = false;
+      _pfnTimer1();
+      continue;
+    }
+    if (pNext == NULL)  break;
+
+    if (pNext->u64DueUs > _u64NowUs)  _u64NowUs = pNext->u64DueUs;
+    if (pNext->bRepeat)  pNext->u64DueUs += (uint64_t) pNext->u32PeriodMs * 1000;
+    else                 os_timer_disarm(pNext);
+    pNext->pfnTimer(pNext->pArg);
+
+    // A timer that pressed a key, say, ends a delay() here
+    if (_bInDelay  &&  _bScheduled)  u64EndUs = _u64NowUs;
+  }
+
+  _u64NowUs = u64EndUs;
+}
+
+
+uint32_t millis()
+{
+  return (uint32_t) (_u64NowUs / 1000);
+}
+
+
+uint32_t micros()
+{
+  return (uint32_t) _u64NowUs;
+}
+
+
+/***************************************
+* delay
+*
+* On the chip, delay() arms a timer and yields to the SDK, and anything posted to
+* the loop task in the meantime (esp_schedule(), from an interrupt) resumes it
+* before the timer is up.  One posted before the delay() started resumes it at
+* once.
+*/
+
+void delay(unsigned long ulMs)
+{
+  if (!_bScheduled) {
+    _bInDelay = true;
+    HostAdvanceUs((uint64_t) ulMs * 1000);
+    _bInDelay = false;
+  }
+  _bScheduled = false;
+}
+
+
+void delayMicroseconds(unsigned int uUs)
+{
+  HostAdvanceUs(uUs);
+}
+
+
+void yield()
+{
+  HostAdvanceUs(HOST_YIELD_US);
+  _bScheduled = false;
+}
+
+
+extern "C" void esp_schedule()
+{
+  _bScheduled = true;
+}
+
+
+extern "C" void esp_yield()
+{
+  yield();
+}
+
+
+/*********************************************
+* os_timer
+*/
+
+extern "C" void os_timer_setfn(os_timer_t *pTimer, os_timer_func_t pfnTimer, void *pArg)
+{
+  os_timer_disarm(pTimer);
+  pTimer->pfnTimer = pfnTimer;
+  pTimer->pArg     = pArg;
+}
+
+
+extern "C" void os_timer_arm(os_timer_t *pTimer, uint32_t u32Ms, bool bRepeat)
+{
+  os_timer_disarm(pTimer);
+  pTimer->u32PeriodMs = u32Ms ? u32Ms : 1;
+  pTimer->bRepeat     = bRepeat;
+  pTimer->u64DueUs    = _u64NowUs + (uint64_t) pTimer->u32PeriodMs * 1000;
+  pTimer->bArmed      = true;
+  pTimer->pNext       = _pTimers;
+  _pTimers            = pTimer;
+}
+
+
+extern "C" void os_timer_disarm(os_timer_t *pTimer)
+{
+  os_timer_t **ppLink;
+
+  for (ppLink = &_pTimers; *ppLink != NULL; ppLink = &(*ppLink)->pNext) {
+    if (*ppLink == pTimer) {
+      *ppLink = pTimer->pNext;
+      break;
+    }
+  }
+  pTimer->bArmed = false;
+  pTimer->pNext  = NULL;
+}
+
+
+/*********************************************
+* Timer1
+*/
+
+void timer1_isr_init()                          { }
+void timer1_attachInterrupt(timercallback pfn)  { _pfnTimer1 = pfn; }
+void timer1_detachInterrupt()                   { _pfnTimer1 = NULL; }
+void timer1_disable()                           { _bTimer1Enabled = false; }
+
+void timer1_enable(uint8_t u8Divider, uint8_t u8Int, uint8_t u8Reload)
+{
+  (void) u8Int;
+  _u8Timer1Divider = u8Divider;
+  _bTimer1Loop     = u8Reload == TIM_LOOP;
+  _bTimer1Enabled  = true;
+}
+
+void timer1_write(uint32_t u32Ticks)
+{
+  _u32Timer1Ticks = u32Ticks;
+  _u64Timer1DueUs = _u64NowUs + _Timer1PeriodUs();
+}
+
+
+/*********************************************
+* Pins
+*/
+
+void pinMode(uint8_t u8Pin, uint8_t u8Mode)
+{
+  if (u8Pin >= HOST_NUM_PINS)  return;
+
+  _u8PinMode[u8Pin] = u8Mode;
+  if (u8Mode == INPUT_PULLUP)  _u8PinLevel[u8Pin] = HIGH;
+}
+
+
+void digitalWrite(uint8_t u8Pin, uint8_t u8Level)
+{
+  uint8_t i;
+
+  if (u8Pin >= HOST_NUM_PINS)  return;
+
+  _u8PinLevel[u8Pin] = u8Level ? HIGH : LOW;
+  _u32PinWrites[u8Pin]++;
+  _u32TotalPinWrites++;
+
+  for (i=0; i<HOST_MAX_PIN_DEVICES; i++) {
+    if (_pDevices[i] != NULL)  _pDevices[i]->PinWrite(u8Pin, _u8PinLevel[u8Pin]);
+  }
+}
+
+
+int digitalRead(uint8_t u8Pin)
+{
+  uint8_t u8Level, i;
+
+  if (u8Pin >= HOST_NUM_PINS)  return LOW;
+
+  for (i=0; i<HOST_MAX_PIN_DEVICES; i++) {
+    if (_pDevices[i] != NULL  &&  _pDevices[i]->PinRead(u8Pin, u8Level))  return u8Level ? HIGH : LOW;
+  }
+  return _u8PinLevel[u8Pin];
+}
+
+
+int analogRead(uint8_t u8Pin)
+{
+  (void) u8Pin;
+  return _u16Analog;
+}
+
+
+void attachInterrupt(uint8_t u8Pin, void (*pfnIsr)(void), int iMode)
+{
+  if (u8Pin >= HOST_NUM_PINS)  return;
+  _pfnIsr[u8Pin]   = pfnIsr;
+  _iIsrMode[u8Pin] = iMode;
+}
+
+
+void detachInterrupt(uint8_t u8Pin)
+{
+  if (u8Pin < HOST_NUM_PINS)  _pfnIsr[u8Pin] = NULL;
+}
+
+
+void tHostGpioReg::operator=(uint32_t u32Mask)
+{
+  uint8_t i;
+
+  for (i=0; i<16; i++) {
+    if (u32Mask & (1UL << i))  digitalWrite(i, _u8Level);
+  }
+}
+
+
+bool HostAttachPinDevice(tHostPinDevice *pDevice)
+{
+  uint8_t i;
+
+  for (i=0; i<HOST_MAX_PIN_DEVICES; i++) {
+    if (_pDevices[i] == NULL) {
+      _pDevices[i] = pDevice;
+      return true;
+    }
+  }
+  return false;
+}
+
+
+void HostDetachPinDevice(tHostPinDevice *pDevice)
+{
+  uint8_t i;
+
+  for (i=0; i<HOST_MAX_PIN_DEVICES; i++) {
+    if (_pDevices[i] == pDevice)  _pDevices[i] = NULL;
+  }
+}
+
+
+uint8_t  HostPinMode(uint8_t u8Pin)   { return u8Pin < HOST_NUM_PINS ? _u8PinMode[u8Pin]    : 0; }
+uint8_t  HostPinLevel(uint8_t u8Pin)  { return u8Pin < HOST_NUM_PINS ? _u8PinLevel[u8Pin]   : 0; }
+uint32_t HostPinWrites(uint8_t u8Pin) { return u8Pin < HOST_NUM_PINS ? _u32PinWrites[u8Pin] : 0; }
+uint32_t HostTotalPinWrites()         { return _u32TotalPinWrites; }
+void     HostSetAnalog(uint16_t u16)  { _u16Analog = u16; }
+
+
+void HostDriveInput(uint8_t u8Pin, uint8_t u8Level)
+{
+  uint8_t u8Old;
+
+  if (u8Pin >= HOST_NUM_PINS)  return;
+
+  u8Old              = _u8PinLevel[u8Pin];
+  _u8PinLevel[u8Pin] = u8Level ? HIGH : LOW;
+  if (_pfnIsr[u8Pin] == NULL  ||  u8Old == _u8PinLevel[u8Pin])  return;
+
+  if (_iIsrMode[u8Pin] == CHANGE  ||
+      (_iIsrMode[u8Pin] == RISING  &&  _u8PinLevel[u8Pin] == HIGH)  ||
+      (_iIsrMode[u8Pin] == FALLING &&  _u8PinLevel[u8Pin] == LOW)) {
+    _pfnIsr[u8Pin]();
+  }
+}
+
+
+void HostResetPins()
+{
+  memset(_u8PinMode,    0, sizeof(_u8PinMode));
+  memset(_u8PinLevel,   0, sizeof(_u8PinLevel));
+  memset(_u32PinWrites, 0, sizeof(_u32PinWrites));
+  memset(_pfnIsr,       0, sizeof(_pfnIsr));
+  _u32TotalPinWrites = 0;
+}
+
+
+/*********************************************
+* Random numbers
+*/
+
+void randomSeed(unsigned long ulSeed)
+{
+  _u32RandomState = ulSeed ? ulSeed : 1;
+}
+
+
+long random(long lMax)
+{
+  if (lMax <= 0)  return 0;
+
+  // xorshift32
+  _u32RandomState ^= _u32RandomState << 13;
+  _u32RandomState ^= _u32RandomState >> 17;
+  _u32RandomState ^= _u32RandomState << 5;
+  return (long) (_u32RandomState % (uint32_t) lMax);
+}
+
+
+long random(long lMin, long lMax)
+{
+  return lMax <= lMin ? lMin : lMin + random(lMax - lMin);
+}
+
+
+/*********************************************
+* Print
+*/
+
+size_t Print::write(const uint8_t *pu8Buf, size_t Len)
+{
+  size_t n = 0;
+
+  while (Len--)  n += write(*pu8Buf++);
+  return n;
+}
+
+
+size_t Print::printf(const char *sFormat, ...)
+{
+  char    sBuf[256];
+  va_list Args;
+
+  va_start(Args, sFormat);
+  vsnprintf(sBuf, sizeof(sBuf), sFormat, Args);
+  va_end(Args);
+  return write(sBuf);
+}
+
+
+size_t Print::print(unsigned long ul, int iBase)
+{
+  char  sBuf[8 * sizeof(long) + 1];
+  char *p = &sBuf[sizeof(sBuf) - 1];
+
+  if (iBase < 2)  iBase = 10;
+
+  *p = '\0';
+  do {
+    int iDigit = ul % iBase;
+    *--p = iDigit < 10 ? '0' + iDigit : 'A' + iDigit - 10;
+    ul  /= iBase;
+  } while (ul != 0);
+
+  return write(p);
+}
+
+
+size_t Print::print(long l, int iBase)
+{
+  if (iBase == 10  &&  l < 0)  return print('-') + print((unsigned long) -l, 10);
+  return print((unsigned long) l, iBase);
+}
+
+
+size_t Print::print(double d, int iDigits)
+{
+  char sBuf[40];
+
+  snprintf(sBuf, sizeof(sBuf), "%.*f", iDigits, d);
+  return write(sBuf);
+}
+
+
+/*********************************************
+* Serial port
+*/
+
+size_t HardwareSerial::write(uint8_t u8Char)
+{
+  _SerialOut() += (char) u8Char;
+  if (_bSerialEcho)  putchar(u8Char);
+  return 1;
+}
+
+
+int HardwareSerial::available()
+{
+  return (int) _SerialIn().size();
+}
+
+
+int HardwareSerial::read()
+{
+  int c;
+
+  if (_SerialIn().empty())  return -1;
+  c = (uint8_t) _SerialIn().front();
+  _SerialIn().pop_front();
+  return c;
+}
+
+
+int HardwareSerial::peek()
+{
+  return _SerialIn().empty() ? -1 : (uint8_t) _SerialIn().front();
+}
+
+
+const std::string &HostSerialOutput()     { return _SerialOut(); }
+void HostClearSerialOutput()              { _SerialOut().clear(); }
+void HostSetSerialEcho(bool bEcho)        { _bSerialEcho = bEcho; }
+
+void HostSerialInput(const char *sText)
+{
+  while (*sText)  _SerialIn().push_back(*sText++);
+}
+
+
+/*********************************************
+* ESP
+*/
+
+uint32_t EspClass::getCycleCount()
+{
+  if (_bRealCycles) {
+    uint64_t u64Ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch()).count();
+    return (uint32_t) (u64Ns * 80 / 1000);
+  }
+  return (uint32_t) (_u64NowUs * 80);
+}
+
+
+void EspClass::restart()
+{
+  _bRestart = true;
+}
+
+
+bool HostRestartRequested()
+{
+  return _bRestart;
+}
+
+
+/***************************************
+* _FlashSector
+*
+* Sectors come into being erased
+*/
+
+static std::vector<uint8_t> &_FlashSector(uint32_t u32Sector)
+{
+  std::vector<uint8_t> &Sector = _FlashSectors()[u32Sector];
+
+  if (Sector.empty())  Sector.assign(HOST_FLASH_SECTOR_SIZE, 0xFF);
+  return Sector;
+}
+
+
+bool EspClass::flashEraseSector(uint32_t u32Sector)
+{
+  _FlashSector(u32Sector).assign(HOST_FLASH_SECTOR_SIZE, 0xFF);
+  return true;
+}
+
+
+bool EspClass::flashWrite(uint32_t u32Addr, uint32_t *pu32Data, size_t Size)
+{
+  const uint8_t *pu8Data = (const uint8_t *) pu32Data;
+  size_t         i;
+
+  if ((u32Addr & 3)  ||  (Size & 3))  return false;
+
+  for (i=0; i<Size; i++, u32Addr++) {
+    _FlashSector(u32Addr / HOST_FLASH_SECTOR_SIZE)[u32Addr % HOST_FLASH_SECTOR_SIZE] &= pu8Data[i];
+  }
+  return true;
+}
+
+
+bool EspClass::flashRead(uint32_t u32Addr, uint32_t *pu32Data, size_t Size)
+{
+  uint8_t *pu8Data = (uint8_t *) pu32Data;
+  size_t   i;
+
+  if (u32Addr & 3)  return false;
+
+  for (i=0; i<Size; i++, u32Addr++) {
+    pu8Data[i] = _FlashSector(u32Addr / HOST_FLASH_SECTOR_SIZE)[u32Addr % HOST_FLASH_SECTOR_SIZE];
+  }
+  return true;
+}
+
+
+void HostEraseFlash()
+{
+  _FlashSectors().clear();
+}
+
+
+bool EspClass::rtcUserMemoryRead(uint32_t u32Offset, uint32_t *pu32Data, size_t Size)
+{
+  if (u32Offset * 4 + Size > HOST_RTC_BYTES)  return false;
+  memcpy(pu32Data, &_u8Rtc[u32Offset * 4], Size);
+  return true;
+}
+
+
+bool EspClass::rtcUserMemoryWrite(uint32_t u32Offset, uint32_t *pu32Data, size_t Size)
+{
+  if (u32Offset * 4 + Size > HOST_RTC_BYTES)  return false;
+  memcpy(&_u8Rtc[u32Offset * 4], pu32Data, Size);
+  return true;
+}
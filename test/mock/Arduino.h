@@ -0,0 +1,288 @@
+/***************
+* NTP Clock
+*
+* Just enough of the ESP8266 Arduino core to build the clock's classes on a PC.
+*
+* Time is virtual: millis() and micros() only move when something waits (delay(),
+* delayMicroseconds(), yield()) or a test moves them with HostAdvanceUs().  Pins go
+* through the host pin shim (Host.h), which counts writes and lets a test stand in
+* for whatever is wired to them.  Serial output is kept for tests to look at.
+*
+* What's here follows the core (2.6.3) closely enough for the code that uses it; it
+* isn't a general emulator.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef __cplusplus
+#include <algorithm>
+#include <string>
+#endif
+
+typedef uint8_t byte;
+typedef bool    boolean;
+
+#define HIGH          (1)
+#define LOW           (0)
+
+#define INPUT         (0x00)
+#define OUTPUT        (0x01)
+#define INPUT_PULLUP  (0x02)
+
+#define RISING        (0x01)
+#define FALLING       (0x02)
+#define CHANGE        (0x03)
+
+#define A0            (17)
+
+#define DEC           (10)
+#define HEX           (16)
+#define OCT           (8)
+#define BIN           (2)
+
+#define ICACHE_RAM_ATTR
+#define IRAM_ATTR
+#define PROGMEM
+#define PGM_P         const char *
+#define PSTR(s)       (s)
+
+#define pgm_read_byte(p)   (*(const uint8_t *) (p))
+#define pgm_read_word(p)   (*(const uint16_t *) (p))
+#define pgm_read_dword(p)  (*(const uint32_t *) (p))
+#define pgm_read_ptr(p)    (*(void * const *) (p))
+
+#define digitalPinToInterrupt(p)  (p)
+
+#define word(h, l)    ((uint16_t) (((h) << 8) | (l)))
+
+#define vsnprintf_P   vsnprintf
+#define snprintf_P    snprintf
+#define strcpy_P      strcpy
+#define strlen_P      strlen
+#define memcpy_P      memcpy
+
+// The core has strlcpy; glibc only from 2.38
+#if defined(__GLIBC__)  &&  (__GLIBC__ < 2  ||  (__GLIBC__ == 2  &&  __GLIBC_MINOR__ < 38))
+inline size_t strlcpy(char *sDest, const char *sSrc, size_t Size)
+{
+  size_t Len = strlen(sSrc);
+
+  if (Size != 0) {
+    size_t Copy = Len < Size - 1 ? Len : Size - 1;
+    memcpy(sDest, sSrc, Copy);
+    sDest[Copy] = '\0';
+  }
+  return Len;
+}
+#endif
+
+#ifdef __cplusplus
+
+using std::min;
+using std::max;
+
+template <typename T, typename L, typename H>
+inline T constrain(T x, L Low, H High) { return x < Low ? Low : x > High ? High : x; }
+
+class __FlashStringHelper;
+#define F(s)  ((const __FlashStringHelper *) (s))
+
+
+/*********************************************
+* Pins and interrupts
+*/
+
+void pinMode(uint8_t u8Pin, uint8_t u8Mode);
+void digitalWrite(uint8_t u8Pin, uint8_t u8Level);
+int  digitalRead(uint8_t u8Pin);
+int  analogRead(uint8_t u8Pin);
+
+void attachInterrupt(uint8_t u8Pin, void (*pfnIsr)(void), int iMode);
+void detachInterrupt(uint8_t u8Pin);
+
+// The interrupt level is all the core gives; nothing on the host interrupts
+inline uint32_t xt_rsil(int iLevel)      { (void) iLevel; return 0; }
+inline void     xt_wsr_ps(uint32_t u32Ps) { (void) u32Ps; }
+inline void     noInterrupts()           { }
+inline void     interrupts()             { }
+
+// GPIO 0-15 set and clear registers.  A write drives every pin in the mask.
+class tHostGpioReg {
+public:
+  tHostGpioReg(uint8_t u8Level) : _u8Level(u8Level) {}
+  void operator=(uint32_t u32Mask);
+protected:
+  uint8_t _u8Level;
+};
+
+extern tHostGpioReg GPOS;
+extern tHostGpioReg GPOC;
+
+// Timer1, as SoftMux uses it.  It runs off the virtual clock.
+#define TIM_DIV1     (0)
+#define TIM_DIV16    (1)
+#define TIM_DIV256   (3)
+#define TIM_EDGE     (0)
+#define TIM_LEVEL    (1)
+#define TIM_SINGLE   (0)
+#define TIM_LOOP     (1)
+
+typedef void (*timercallback)(void);
+
+void timer1_isr_init();
+void timer1_attachInterrupt(timercallback pfnIsr);
+void timer1_detachInterrupt();
+void timer1_enable(uint8_t u8Divider, uint8_t u8Int, uint8_t u8Reload);
+void timer1_disable();
+void timer1_write(uint32_t u32Ticks);
+
+
+/*********************************************
+* Time
+*/
+
+// The core returns unsigned long, which is 32 bits there.  Here it would be 64, and
+// sums and differences of times wouldn't wrap as the code expects them to.
+uint32_t millis();
+uint32_t micros();
+void delay(unsigned long ulMs);
+void delayMicroseconds(unsigned int uUs);
+void yield();
+
+
+/*********************************************
+* Random numbers, the same sequence every run
+*/
+
+long random(long lMax);
+long random(long lMin, long lMax);
+void randomSeed(unsigned long ulSeed);
+
+
+/*********************************************
+* String, as far as WiFi.SSID() needs it
+*/
+
+class String {
+public:
+  String(const char *s = "") : _s(s) {}
+  const char  *c_str()  const { return _s.c_str(); }
+  unsigned int length() const { return _s.length(); }
+  bool operator==(const char *s) const { return _s == s; }
+  bool operator==(const String &Other) const { return _s == Other._s; }
+protected:
+  std::string _s;
+};
+
+
+/*********************************************
+* Print, Stream and the serial port
+*/
+
+class Print {
+public:
+  virtual ~Print() {}
+
+  virtual size_t write(uint8_t u8Char) = 0;
+  virtual size_t write(const uint8_t *pu8Buf, size_t Len);
+  size_t write(const char *s) { return s == NULL ? 0 : write((const uint8_t *) s, strlen(s)); }
+  size_t write(const char *pBuf, size_t Len) { return write((const uint8_t *) pBuf, Len); }
+  virtual int availableForWrite() { return 0; }
+
+  size_t printf(const char *sFormat, ...) __attribute__ ((format (printf, 2, 3)));
+
+  size_t print(const __FlashStringHelper *s) { return write((const char *) s); }
+  size_t print(const String &s)              { return write(s.c_str()); }
+  size_t print(const char *s)                { return write(s); }
+  size_t print(char c)                       { return write((uint8_t) c); }
+  size_t print(unsigned char u, int iBase = DEC)  { return print((unsigned long) u, iBase); }
+  size_t print(int i, int iBase = DEC)            { return print((long) i, iBase); }
+  size_t print(unsigned int u, int iBase = DEC)   { return print((unsigned long) u, iBase); }
+  size_t print(long l, int iBase = DEC);
+  size_t print(unsigned long ul, int iBase = DEC);
+  size_t print(double d, int iDigits = 2);
+
+  size_t println() { return write("\r\n"); }
+  template <typename T> size_t println(T Value)              { size_t n = print(Value);        return n + println(); }
+  template <typename T> size_t println(T Value, int iFormat) { size_t n = print(Value, iFormat); return n + println(); }
+};
+
+class Stream : public Print {
+public:
+  virtual int available() { return 0; }
+  virtual int read()      { return -1; }
+  virtual int peek()      { return -1; }
+};
+
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long ulBaud) { (void) ulBaud; }
+  operator bool() const { return true; }
+
+  size_t write(uint8_t u8Char);
+  using Print::write;
+  int availableForWrite() { return 128; }
+  void flush() {}
+
+  int available();
+  int read();
+  int peek();
+};
+
+extern HardwareSerial Serial;
+
+
+/*********************************************
+* The ESP object
+*/
+
+class EspClass {
+public:
+  uint32_t getCycleCount();
+  uint8_t  getCpuFreqMHz() { return 80; }
+  uint32_t getChipId()     { return 0x00C10C4; }
+
+  uint32_t getFreeHeap()           { return 40000; }
+  uint16_t getMaxFreeBlockSize()   { return 30000; }
+  uint8_t  getHeapFragmentation()  { return 5; }
+
+  void wdtDisable() {}
+  void wdtEnable(uint32_t u32TimeoutMs) { (void) u32TimeoutMs; }
+  void wdtFeed() {}
+  void restart();
+
+  // Flash is RAM, erased to 0xFF; writes can only clear bits, as on the chip
+  bool flashEraseSector(uint32_t u32Sector);
+  bool flashWrite(uint32_t u32Addr, uint32_t *pu32Data, size_t Size);
+  bool flashRead(uint32_t u32Addr, uint32_t *pu32Data, size_t Size);
+
+  // 512 bytes, in 4-byte blocks, kept across HostRestart() as on the chip
+  bool rtcUserMemoryRead(uint32_t u32Offset, uint32_t *pu32Data, size_t Size);
+  bool rtcUserMemoryWrite(uint32_t u32Offset, uint32_t *pu32Data, size_t Size);
+};
+
+extern EspClass ESP;
+
+// The filesystem area from the linker script.  The host build places it with
+// --defsym, at the same addresses as a 4M (1M SPIFFS) board.
+extern "C" uint32_t _FS_start;
+extern "C" uint32_t _FS_end;
+
+#include "IPAddress.h"
+
+#endif   /* __cplusplus */
+
+#endif   /* ARDUINO_H */
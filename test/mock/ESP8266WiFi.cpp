@@ -0,0 +1,563 @@
+/***************
+* NTP Clock
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "HostNet.h"
+#include "Host.h"
+#include <ESP8266WiFi.h>
+#include <WiFiUdp.h>
+
+#include <vector>
+
+ESP8266WiFiClass WiFi;
+
+#define HOST_NTP_PORT  (123)
+
+struct tHostAp {
+  char     sSsid[33];
+  char     sPassword[65];
+  int8_t   i8Rssi;
+  uint8_t  u8Channel;
+  uint8_t  u8Bssid[6];
+  bool     bUp;
+};
+
+static tHostAp  _Aps[HOST_NET_MAX_APS];
+static int      _iNumAps;
+static uint32_t _u32ConnectMs = 3000;
+static uint32_t _u32ScanMs    = 2000;
+static uint32_t _u32Joins;
+static std::vector<uint64_t> _JoinAttempts;
+static uint32_t _u32UdpDropped;
+
+// The station
+static wl_status_t _Status = WL_DISCONNECTED;
+static bool     _bConnecting;
+static uint64_t _u64ConnectDueUs;
+static char     _sJoinSsid[33];
+static char     _sJoinPassword[65];
+static uint8_t  _u8JoinBssid[6];
+static bool     _bJoinBssid;
+static int      _iAp = -1;
+static bool     _bAsleep;
+static IPAddress _StaticIp;
+
+// The scan
+static bool     _bScanning;
+static uint64_t _u64ScanDueUs;
+static std::vector<int> _ScanResults;
+static bool     _bScanDone;
+
+// The NTP server
+static tHostUtcSource _pfnUtcUs;
+static bool     _bNtpUp = true;
+static uint32_t _u32NtpRoundTripUs = 20000;
+static uint8_t  _u8NtpLi;
+static std::vector<uint64_t> _NtpRequests;
+
+
+/*********************************************
+* Test controls
+*/
+
+void HostNetReset()
+{
+  _iNumAps       = 0;
+  _u32ConnectMs  = 3000;
+  _u32ScanMs     = 2000;
+  _u32Joins      = 0;
+  _u32UdpDropped = 0;
+  _JoinAttempts.clear();
+  _Status        = WL_DISCONNECTED;
+  _bConnecting   = false;
+  _iAp           = -1;
+  _bAsleep       = false;
+  _StaticIp      = IPAddress();
+  _bScanning     = false;
+  _bScanDone     = false;
+  _ScanResults.clear();
+
+  _pfnUtcUs          = NULL;
+  _bNtpUp            = true;
+  _u32NtpRoundTripUs = 20000;
+  _u8NtpLi           = 0;
+  _NtpRequests.clear();
+}
+
+
+int HostNetAddAp(const char *sSsid, const char *sPassword, int8_t i8Rssi, uint8_t u8Channel)
+{
+  if (_iNumAps >= HOST_NET_MAX_APS)  return -1;
+
+  tHostAp &Ap = _Aps[_iNumAps];
+
+  strlcpy(Ap.sSsid,     sSsid,     sizeof(Ap.sSsid));
+  strlcpy(Ap.sPassword, sPassword, sizeof(Ap.sPassword));
+  Ap.i8Rssi     = i8Rssi;
+  Ap.u8Channel  = u8Channel;
+  Ap.bUp        = true;
+  Ap.u8Bssid[0] = 0x02;
+  Ap.u8Bssid[1] = 0x00;
+  Ap.u8Bssid[2] = 0x5E;
+  Ap.u8Bssid[3] = 0x10;
+  Ap.u8Bssid[4] = 0x00;
+  Ap.u8Bssid[5] = (uint8_t) _iNumAps;
+
+  return _iNumAps++;
+}
+
+
+void HostNetSetApUp(int iAp, bool bUp)             { if (iAp >= 0  &&  iAp < _iNumAps)  _Aps[iAp].bUp    = bUp; }
+void HostNetSetApRssi(int iAp, int8_t i8Rssi)      { if (iAp >= 0  &&  iAp < _iNumAps)  _Aps[iAp].i8Rssi = i8Rssi; }
+uint32_t HostNetJoins()                            { return _u32Joins; }
+uint32_t HostNetUdpDropped()                       { return _u32UdpDropped; }
+uint32_t HostNetAttempts()                         { return _JoinAttempts.size(); }
+
+uint64_t HostNetAttemptUs(uint32_t u32Which)
+{
+  return u32Which < _JoinAttempts.size() ? _JoinAttempts[u32Which] : 0;
+}
+
+void HostNetSetTimings(uint32_t u32ConnectMs, uint32_t u32ScanMs)
+{
+  _u32ConnectMs = u32ConnectMs;
+  _u32ScanMs    = u32ScanMs;
+}
+
+void HostNtpSetClock(tHostUtcSource pfnUtcUs)      { _pfnUtcUs = pfnUtcUs; }
+void HostNtpSetUp(bool bUp)                        { _bNtpUp = bUp; }
+void HostNtpSetRoundTripUs(uint32_t u32Us)         { _u32NtpRoundTripUs = u32Us; }
+void HostNtpSetLeap(uint8_t u8Li)                  { _u8NtpLi = u8Li; }
+uint32_t HostNtpRequests()                         { return _NtpRequests.size(); }
+
+uint64_t HostNtpRequestUs(uint32_t u32Which)
+{
+  return u32Which < _NtpRequests.size() ? _NtpRequests[u32Which] : 0;
+}
+
+
+/***************************************
+* _FindAp
+*
+* RETURNS:
+*   The up access point with the SSID (and BSSID, if given), or -1
+*/
+
+static int _FindAp(const char *sSsid, const uint8_t *pu8Bssid)
+{
+  int i;
+
+  for (i=0; i<_iNumAps; i++) {
+    if (!_Aps[i].bUp  ||  strcmp(_Aps[i].sSsid, sSsid) != 0)             continue;
+    if (pu8Bssid != NULL  &&  memcmp(_Aps[i].u8Bssid, pu8Bssid, 6) != 0)  continue;
+    return i;
+  }
+  return -1;
+}
+
+
+/***************************************
+* _UpdateStation
+*
+* Moves the station on to wherever virtual time has got it
+*/
+
+static void _UpdateStation()
+{
+  int iAp;
+
+  if (_bConnecting  &&  HostMicros64() >= _u64ConnectDueUs) {
+    _bConnecting = false;
+    iAp = _FindAp(_sJoinSsid, _bJoinBssid ? _u8JoinBssid : NULL);
+    if (iAp < 0) {
+      _Status = WL_NO_SSID_AVAIL;
+    } else if (strcmp(_Aps[iAp].sPassword, _sJoinPassword) != 0) {
+      _Status = WL_CONNECT_FAILED;
+    } else {
+      _Status = WL_CONNECTED;
+      _iAp    = iAp;
+      _u32Joins++;
+    }
+  }
+
+  if (_Status == WL_CONNECTED  &&  !_Aps[_iAp].bUp) {
+    _Status = WL_CONNECTION_LOST;
+    _iAp    = -1;
+  }
+
+  if (_bScanning  &&  HostMicros64() >= _u64ScanDueUs) {
+    _bScanning = false;
+    _bScanDone = true;
+    _ScanResults.clear();
+    for (iAp=0; iAp<_iNumAps; iAp++) {
+      if (_Aps[iAp].bUp)  _ScanResults.push_back(iAp);
+    }
+  }
+}
+
+
+/*********************************************
+* The station
+*/
+
+bool ESP8266WiFiClass::mode(WiFiMode_t Mode)
+{
+  if (Mode == WIFI_OFF)  disconnect();
+  return true;
+}
+
+
+bool ESP8266WiFiClass::forceSleepBegin(uint32_t u32Us)
+{
+  (void) u32Us;
+  disconnect();
+  _bAsleep = true;
+  return true;
+}
+
+
+bool ESP8266WiFiClass::forceSleepWake()
+{
+  _bAsleep = false;
+  return true;
+}
+
+
+bool ESP8266WiFiClass::config(IPAddress Ip, IPAddress Gateway, IPAddress Subnet, IPAddress Dns)
+{
+  (void) Gateway;
+  (void) Subnet;
+  (void) Dns;
+  _StaticIp = Ip;
+  return true;
+}
+
+
+wl_status_t ESP8266WiFiClass::begin(const char *sSsid, const char *sPassword, int32_t i32Channel,
+                                    const uint8_t *pu8Bssid, bool bConnect)
+{
+  (void) i32Channel;
+
+  _iAp    = -1;
+  _Status = WL_DISCONNECTED;
+  if (_bAsleep  ||  !bConnect)  return _Status;
+
+  strlcpy(_sJoinSsid,     sSsid,                             sizeof(_sJoinSsid));
+  strlcpy(_sJoinPassword, sPassword != NULL ? sPassword : "", sizeof(_sJoinPassword));
+  _bJoinBssid = pu8Bssid != NULL;
+  if (_bJoinBssid)  memcpy(_u8JoinBssid, pu8Bssid, sizeof(_u8JoinBssid));
+
+  _JoinAttempts.push_back(HostMicros64());
+
+  // Joining on a known channel and BSSID skips the scan, and is quicker
+  _bConnecting     = true;
+  _u64ConnectDueUs = HostMicros64() + (uint64_t) (_bJoinBssid ? _u32ConnectMs / 3 : _u32ConnectMs) * 1000;
+  return _Status;
+}
+
+
+bool ESP8266WiFiClass::disconnect(bool bWifiOff)
+{
+  (void) bWifiOff;
+  _bConnecting = false;
+  _iAp         = -1;
+  _Status      = WL_DISCONNECTED;
+  return true;
+}
+
+
+wl_status_t ESP8266WiFiClass::status()
+{
+  _UpdateStation();
+  return _Status;
+}
+
+
+String ESP8266WiFiClass::SSID()
+{
+  return status() == WL_CONNECTED ? String(_Aps[_iAp].sSsid) : String();
+}
+
+
+uint8_t *ESP8266WiFiClass::BSSID()
+{
+  static uint8_t u8None[6];
+
+  return status() == WL_CONNECTED ? _Aps[_iAp].u8Bssid : u8None;
+}
+
+
+int32_t ESP8266WiFiClass::RSSI()
+{
+  return status() == WL_CONNECTED ? _Aps[_iAp].i8Rssi : 31;
+}
+
+
+int32_t ESP8266WiFiClass::channel()
+{
+  return status() == WL_CONNECTED ? _Aps[_iAp].u8Channel : 0;
+}
+
+
+IPAddress ESP8266WiFiClass::localIP()
+{
+  if (status() != WL_CONNECTED)  return IPAddress();
+  if (_StaticIp.isSet())         return _StaticIp;
+
+  return IPAddress(192, 168, 1, 100 + _iAp);
+}
+
+
+IPAddress ESP8266WiFiClass::gatewayIP()          { return status() == WL_CONNECTED ? IPAddress(192, 168, 1, 1)     : IPAddress(); }
+IPAddress ESP8266WiFiClass::subnetMask()         { return status() == WL_CONNECTED ? IPAddress(255, 255, 255, 0)   : IPAddress(); }
+IPAddress ESP8266WiFiClass::dnsIP(uint8_t u8)    { (void) u8; return status() == WL_CONNECTED ? IPAddress(192, 168, 1, 1) : IPAddress(); }
+
+
+/*********************************************
+* Scanning
+*/
+
+int8_t ESP8266WiFiClass::scanNetworks(bool bAsync, bool bShowHidden)
+{
+  (void) bShowHidden;
+
+  if (_bScanning)  return WIFI_SCAN_RUNNING;
+
+  _bScanning    = true;
+  _bScanDone    = false;
+  _u64ScanDueUs = HostMicros64() + (uint64_t) _u32ScanMs * 1000;
+  if (bAsync)  return WIFI_SCAN_RUNNING;
+
+  _u64ScanDueUs = HostMicros64();
+  return scanComplete();
+}
+
+
+int8_t ESP8266WiFiClass::scanComplete()
+{
+  _UpdateStation();
+  if (_bScanning)   return WIFI_SCAN_RUNNING;
+  if (!_bScanDone)  return WIFI_SCAN_FAILED;
+
+  return (int8_t) _ScanResults.size();
+}
+
+
+void ESP8266WiFiClass::scanDelete()
+{
+  _bScanDone = false;
+  _ScanResults.clear();
+}
+
+
+String ESP8266WiFiClass::SSID(uint8_t u8Which)
+{
+  return u8Which < _ScanResults.size() ? String(_Aps[_ScanResults[u8Which]].sSsid) : String();
+}
+
+
+uint8_t *ESP8266WiFiClass::BSSID(uint8_t u8Which)
+{
+  return u8Which < _ScanResults.size() ? _Aps[_ScanResults[u8Which]].u8Bssid : NULL;
+}
+
+
+int32_t ESP8266WiFiClass::RSSI(uint8_t u8Which)
+{
+  return u8Which < _ScanResults.size() ? _Aps[_ScanResults[u8Which]].i8Rssi : 0;
+}
+
+
+int32_t ESP8266WiFiClass::channel(uint8_t u8Which)
+{
+  return u8Which < _ScanResults.size() ? _Aps[_ScanResults[u8Which]].u8Channel : 0;
+}
+
+
+/*********************************************
+* UDP
+*/
+
+WiFiUDP::WiFiUDP()
+{
+  _u16LocalPort  = 0;
+  _u16DestPort   = 0;
+  _TxLen         = 0;
+  _PendingLen    = 0;
+  _u64PendingDueUs = 0;
+  _bPending      = false;
+  _RxLen         = 0;
+  _RxPos         = 0;
+  _u16RemotePort = 0;
+}
+
+
+WiFiUDP::~WiFiUDP()
+{
+}
+
+
+uint8_t WiFiUDP::begin(uint16_t u16Port)
+{
+  _u16LocalPort = u16Port;
+  return 1;
+}
+
+
+void WiFiUDP::stop()
+{
+  _u16LocalPort = 0;
+  _bPending     = false;
+  _RxLen        = 0;
+}
+
+
+int WiFiUDP::beginPacket(const char *sHost, uint16_t u16Port)
+{
+  (void) sHost;
+  return beginPacket(IPAddress(10, 0, 0, 123), u16Port);
+}
+
+
+int WiFiUDP::beginPacket(IPAddress Ip, uint16_t u16Port)
+{
+  (void) Ip;
+  _u16DestPort = u16Port;
+  _TxLen       = 0;
+  return 1;
+}
+
+
+size_t WiFiUDP::write(uint8_t u8Char)
+{
+  if (_TxLen >= sizeof(_u8Tx))  return 0;
+
+  _u8Tx[_TxLen++] = u8Char;
+  return 1;
+}
+
+
+size_t WiFiUDP::write(const uint8_t *pu8Buf, size_t Len)
+{
+  size_t i;
+
+  for (i=0; i<Len; i++) {
+    if (write(pu8Buf[i]) == 0)  break;
+  }
+  return i;
+}
+
+
+/***************************************
+* _WriteNtpStamp
+*
+* Microseconds since 1970 as a NTP timestamp (seconds since 1900, and a 32-bit
+* fraction)
+*/
+
+static void _WriteNtpStamp(uint8_t *pu8Dest, int64_t i64UtcUs)
+{
+  uint32_t u32Seconds  = (uint32_t) (i64UtcUs / 1000000 + 2208988800LL);
+  uint32_t u32Fraction = (uint32_t) (((uint64_t) (i64UtcUs % 1000000) << 32) / 1000000);
+  uint8_t  i;
+
+  for (i=0; i<4; i++) {
+    pu8Dest[i]     = u32Seconds  >> (24 - 8*i);
+    pu8Dest[4 + i] = u32Fraction >> (24 - 8*i);
+  }
+}
+
+
+/***************************************
+* WiFiUDP::endPacket
+*
+* A request to the NTP server, while we're on the network and it's up, is
+* answered half a round trip after it gets there.  The server's receive and
+* transmit times are the same, taken from the true time at that point.
+*/
+
+int WiFiUDP::endPacket()
+{
+  uint8_t  u8Reply[48];
+  uint64_t u64NowUs = HostMicros64();
+
+  if (_u16DestPort != HOST_NTP_PORT) {
+    _u32UdpDropped++;
+    return 1;
+  }
+
+  _NtpRequests.push_back(u64NowUs);
+  if (!_bNtpUp  ||  _pfnUtcUs == NULL  ||  _TxLen < sizeof(u8Reply)  ||  WiFi.status() != WL_CONNECTED)  return 1;
+
+  memset(u8Reply, 0, sizeof(u8Reply));
+  u8Reply[0] = (_u8NtpLi << 6) | (4 << 3) | 4;     // LI, version 4, server
+  u8Reply[1] = 2;                                  // Stratum
+  u8Reply[2] = _u8Tx[2];
+  u8Reply[3] = 0xE9;                               // About 2 us
+  u8Reply[12] = 10;                                // Reference ID, 10.0.0.1
+  u8Reply[15] = 1;
+  _WriteNtpStamp(&u8Reply[16], _pfnUtcUs(u64NowUs) - 60000000);
+  memcpy(&u8Reply[24], &_u8Tx[40], 8);
+  _WriteNtpStamp(&u8Reply[32], _pfnUtcUs(u64NowUs + _u32NtpRoundTripUs / 2));
+  memcpy(&u8Reply[40], &u8Reply[32], 8);
+
+  HostDeliver(u8Reply, sizeof(u8Reply), u64NowUs + _u32NtpRoundTripUs, IPAddress(10, 0, 0, 123), HOST_NTP_PORT);
+  return 1;
+}
+
+
+void WiFiUDP::HostDeliver(const uint8_t *pu8Data, size_t Len, uint64_t u64DueUs, IPAddress From, uint16_t u16FromPort)
+{
+  if (Len > sizeof(_u8Pending))  Len = sizeof(_u8Pending);
+
+  memcpy(_u8Pending, pu8Data, Len);
+  _PendingLen      = Len;
+  _u64PendingDueUs = u64DueUs;
+  _bPending        = true;
+  _RemoteIp        = From;
+  _u16RemotePort   = u16FromPort;
+}
+
+
+int WiFiUDP::parsePacket()
+{
+  _RxLen = 0;
+  _RxPos = 0;
+  if (!_bPending  ||  HostMicros64() < _u64PendingDueUs)  return 0;
+
+  memcpy(_u8Rx, _u8Pending, _PendingLen);
+  _RxLen    = _PendingLen;
+  _bPending = false;
+  return (int) _RxLen;
+}
+
+
+int WiFiUDP::available()
+{
+  return (int) (_RxLen - _RxPos);
+}
+
+
+int WiFiUDP::read()
+{
+  return _RxPos < _RxLen ? _u8Rx[_RxPos++] : -1;
+}
+
+
+int WiFiUDP::read(unsigned char *pu8Buf, size_t Len)
+{
+  size_t Copy = min(Len, _RxLen - _RxPos);
+
+  memcpy(pu8Buf, &_u8Rx[_RxPos], Copy);
+  _RxPos += Copy;
+  return (int) Copy;
+}
+
+
+int WiFiUDP::peek()
+{
+  return _RxPos < _RxLen ? _u8Rx[_RxPos] : -1;
+}
@@ -0,0 +1,95 @@
+/***************
+* NTP Clock
+*
+* The core's WiFi station, for the host build.  It connects to, scans for and
+* loses the simulated access points in HostNet.h, on the virtual clock.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef ESP8266_WIFI_H
+#define ESP8266_WIFI_H
+
+#include <Arduino.h>
+
+typedef enum {
+  WL_IDLE_STATUS     = 0,
+  WL_NO_SSID_AVAIL   = 1,
+  WL_SCAN_COMPLETED  = 2,
+  WL_CONNECTED       = 3,
+  WL_CONNECT_FAILED  = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED    = 6,
+  WL_NO_SHIELD       = 255
+} wl_status_t;
+
+#define WIFI_SCAN_RUNNING  (-1)
+#define WIFI_SCAN_FAILED   (-2)
+
+typedef enum { WIFI_OFF, WIFI_STA, WIFI_AP, WIFI_AP_STA } WiFiMode_t;
+typedef enum { WIFI_NONE_SLEEP, WIFI_LIGHT_SLEEP, WIFI_MODEM_SLEEP } WiFiSleepType_t;
+
+
+// Nothing ever connects to the host's servers
+class WiFiClient : public Stream {
+public:
+  operator bool() const { return false; }
+  bool   connected() { return false; }
+  size_t write(uint8_t u8Char) { (void) u8Char; return 0; }
+  size_t write(const uint8_t *pu8Buf, size_t Len) { (void) pu8Buf; (void) Len; return 0; }
+  using Print::write;
+  int    availableForWrite() { return 0; }
+  void   setNoDelay(bool b) { (void) b; }
+  void   setSync(bool b)    { (void) b; }
+  bool   stop(unsigned int uMaxWaitMs = 0) { (void) uMaxWaitMs; return true; }
+};
+
+class WiFiServer {
+public:
+  WiFiServer(uint16_t u16Port) { (void) u16Port; }
+  void       begin() {}
+  WiFiClient available() { return WiFiClient(); }
+};
+
+
+class ESP8266WiFiClass {
+public:
+  bool mode(WiFiMode_t Mode);
+  bool persistent(bool b)                  { (void) b; return true; }
+  bool setAutoReconnect(bool b)            { (void) b; return true; }
+  bool setSleepMode(WiFiSleepType_t Type)  { (void) Type; return true; }
+  bool forceSleepBegin(uint32_t u32Us = 0);
+  bool forceSleepWake();
+
+  bool config(IPAddress Ip, IPAddress Gateway, IPAddress Subnet, IPAddress Dns = IPAddress());
+  wl_status_t begin(const char *sSsid, const char *sPassword = NULL, int32_t i32Channel = 0,
+                    const uint8_t *pu8Bssid = NULL, bool bConnect = true);
+  bool disconnect(bool bWifiOff = false);
+
+  wl_status_t status();
+  bool        isConnected() { return status() == WL_CONNECTED; }
+
+  String    SSID();
+  uint8_t  *BSSID();
+  int32_t   RSSI();
+  int32_t   channel();
+  IPAddress localIP();
+  IPAddress gatewayIP();
+  IPAddress subnetMask();
+  IPAddress dnsIP(uint8_t u8Which = 0);
+
+  int8_t    scanNetworks(bool bAsync = false, bool bShowHidden = false);
+  int8_t    scanComplete();
+  void      scanDelete();
+  String    SSID(uint8_t u8Which);
+  uint8_t  *BSSID(uint8_t u8Which);
+  int32_t   RSSI(uint8_t u8Which);
+  int32_t   channel(uint8_t u8Which);
+};
+
+extern ESP8266WiFiClass WiFi;
+
+
+#endif   /* ESP8266_WIFI_H */
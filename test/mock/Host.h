@@ -0,0 +1,87 @@
+/***************
+* NTP Clock
+*
+* The host build's controls: what a test uses to move the virtual clock, stand in
+* for the hardware on the pins, and look at what the code wrote to the serial port.
+*
+* The clock.  Virtual time is a 64-bit count of microseconds.  millis() and
+* micros() are its low 32 bits (in ms and us), as on the chip, so HostSetMillis()
+* just short of 0xFFFFFFFF tests the wrap.  Time moves only in HostAdvanceUs(),
+* which delay(), delayMicroseconds() and yield() call; os_timers and timer1 run
+* from there when they fall due.
+*
+* The pins.  Every pinMode()/digitalWrite() is recorded and counted per pin.  A
+* tHostPinDevice attached with HostAttachPinDevice() sees each write and can drive
+* what digitalRead() returns, the way the MAX6954 drives DOUT.  HostDriveInput()
+* changes an input from outside and runs its interrupt if the edge matches.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef HOST_H
+#define HOST_H
+
+#include <Arduino.h>
+#include <string>
+
+#define HOST_NUM_PINS         (17)     // GPIO 0-16
+#define HOST_MAX_PIN_DEVICES  (4)
+#define HOST_YIELD_US         (10)     // yield() isn't free on the chip either
+
+
+/*********************************************
+* Virtual time
+*/
+
+uint64_t HostMicros64();
+void     HostSetMillis(uint32_t u32Ms);
+void     HostAdvanceUs(uint64_t u64Us);
+
+// ESP.getCycleCount() counts 80 per virtual microsecond, so it's the same every
+// run.  Benchmarks want it from the host's own clock instead.
+void     HostUseRealCycles(bool bReal);
+
+
+/*********************************************
+* Pins
+*/
+
+class tHostPinDevice {
+public:
+  virtual ~tHostPinDevice() {}
+
+  // Called after every digitalWrite()
+  virtual void PinWrite(uint8_t u8Pin, uint8_t u8Level) { (void) u8Pin; (void) u8Level; }
+
+  // Return true, with the level in u8Level, for a pin this device drives
+  virtual bool PinRead(uint8_t u8Pin, uint8_t &u8Level) { (void) u8Pin; (void) u8Level; return false; }
+};
+
+bool     HostAttachPinDevice(tHostPinDevice *pDevice);
+void     HostDetachPinDevice(tHostPinDevice *pDevice);
+
+uint8_t  HostPinMode(uint8_t u8Pin);
+uint8_t  HostPinLevel(uint8_t u8Pin);
+uint32_t HostPinWrites(uint8_t u8Pin);
+uint32_t HostTotalPinWrites();
+void     HostDriveInput(uint8_t u8Pin, uint8_t u8Level);
+void     HostSetAnalog(uint16_t u16Reading);
+void     HostResetPins();
+
+
+/*********************************************
+* Serial port, flash and restarts
+*/
+
+const std::string &HostSerialOutput();
+void     HostClearSerialOutput();
+void     HostSetSerialEcho(bool bEcho);          // Copies output to stdout as well
+void     HostSerialInput(const char *sText);
+
+void     HostEraseFlash();
+bool     HostRestartRequested();
+
+
+#endif   /* HOST_H */
@@ -0,0 +1,51 @@
+/***************
+* NTP Clock
+*
+* The host build's network: access points for the WiFi station to find and join,
+* and an NTP server for the UDP socket to ask.
+*
+* An access point can be taken down (the station loses it, and scans stop finding
+* it) or have its signal changed.  Joining takes HostNetSetTimings()' connect time,
+* and fails if the SSID isn't up or the password is wrong.  Every attempt to join
+* is logged by virtual time, so a test can check the station's backoff.
+*
+* The NTP server answers with the true time from the test's clock source, after
+* the set round trip (split evenly each way).  It can be taken down, so requests
+* go unanswered, or made to announce a leap second.  Every request it sees is
+* logged by virtual time, so a test can check the client's polling.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef HOST_NET_H
+#define HOST_NET_H
+
+#include <Arduino.h>
+
+#define HOST_NET_MAX_APS        (4)
+#define HOST_NTP_MAX_REQUESTS   (4096)
+
+// The true time, in microseconds since 1970, at a virtual time
+typedef int64_t (*tHostUtcSource)(uint64_t u64VirtualUs);
+
+void     HostNetReset();
+int      HostNetAddAp(const char *sSsid, const char *sPassword, int8_t i8Rssi, uint8_t u8Channel);
+void     HostNetSetApUp(int iAp, bool bUp);
+void     HostNetSetApRssi(int iAp, int8_t i8Rssi);
+void     HostNetSetTimings(uint32_t u32ConnectMs, uint32_t u32ScanMs);
+uint32_t HostNetJoins();           // Successful connects
+uint32_t HostNetAttempts();        // Calls to WiFi.begin() that tried to connect
+uint64_t HostNetAttemptUs(uint32_t u32Which);
+uint32_t HostNetUdpDropped();      // Packets to anything but the NTP server
+
+void     HostNtpSetClock(tHostUtcSource pfnUtcUs);
+void     HostNtpSetUp(bool bUp);
+void     HostNtpSetRoundTripUs(uint32_t u32Us);
+void     HostNtpSetLeap(uint8_t u8Li);
+uint32_t HostNtpRequests();
+uint64_t HostNtpRequestUs(uint32_t u32Which);
+
+
+#endif   /* HOST_NET_H */
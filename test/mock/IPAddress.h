@@ -0,0 +1,33 @@
+/***************
+* NTP Clock
+*
+* The core's IPAddress, for the host build.  Stored as the core stores it: the
+* first octet in the low byte.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef IP_ADDRESS_H
+#define IP_ADDRESS_H
+
+#include <stdint.h>
+
+class IPAddress {
+public:
+  IPAddress() : _u32Addr(0) {}
+  IPAddress(uint32_t u32Addr) : _u32Addr(u32Addr) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) :
+    _u32Addr((uint32_t) a | (uint32_t) b << 8 | (uint32_t) c << 16 | (uint32_t) d << 24) {}
+
+  operator uint32_t() const { return _u32Addr; }
+  uint8_t operator[](int i) const { return (uint8_t) (_u32Addr >> (8 * i)); }
+  bool isSet() const { return _u32Addr != 0; }
+
+protected:
+  uint32_t _u32Addr;
+};
+
+
+#endif   /* IP_ADDRESS_H */
@@ -0,0 +1,17 @@
+/***************
+* NTP Clock
+*
+* The MAX6954 is bit-banged, so nothing of the core's SPI library is used.  This is
+* here so the includes resolve on the host.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef SPI_H
+#define SPI_H
+
+#include <Arduino.h>
+
+#endif   /* SPI_H */
@@ -0,0 +1,146 @@
+/***************
+* NTP Clock
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "TimeLib.h"
+
+static time_t        _tSysTime;
+static uint32_t      _u32PrevMillis;   // 32 bits, as on the chip, or the wrap breaks it
+static timeStatus_t  _Status = timeNotSet;
+
+// Days in each month of a non-leap year
+static const uint8_t _u8MonthDays[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+#define LEAP_YEAR(Y)  (((1970 + (Y)) > 0)  &&  !((1970 + (Y)) % 4)  &&  (((1970 + (Y)) % 100)  ||  !((1970 + (Y)) % 400)))
+
+
+/***************************************
+* now
+*
+* The system time goes on a second for each 1000 ms of millis(), which the
+* unsigned subtraction keeps right across the wrap
+*/
+
+time_t now()
+{
+  while (millis() - _u32PrevMillis >= 1000) {
+    _tSysTime++;
+    _u32PrevMillis += 1000;
+  }
+  return _tSysTime;
+}
+
+
+void setTime(time_t t)
+{
+  _tSysTime      = t;
+  _Status        = timeSet;
+  _u32PrevMillis = millis();
+}
+
+
+timeStatus_t timeStatus()
+{
+  return _Status;
+}
+
+
+/***************************************
+* breakTime
+*
+*/
+
+void breakTime(time_t tTime, tmElements_t &Tm)
+{
+  uint32_t u32Time = (uint32_t) tTime;
+  uint32_t u32Days;
+  uint8_t  u8Year, u8Month, u8MonthLength;
+
+  Tm.Second = u32Time % 60;
+  u32Time  /= 60;
+  Tm.Minute = u32Time % 60;
+  u32Time  /= 60;
+  Tm.Hour   = u32Time % 24;
+  u32Time  /= 24;
+  Tm.Wday   = ((u32Time + 4) % 7) + 1;
+
+  u8Year  = 0;
+  u32Days = 0;
+  while ((unsigned) (u32Days += (LEAP_YEAR(u8Year) ? 366 : 365)) <= u32Time)  u8Year++;
+  Tm.Year = u8Year;
+
+  u32Days -= LEAP_YEAR(u8Year) ? 366 : 365;
+  u32Time -= u32Days;
+
+  for (u8Month=0; u8Month<12; u8Month++) {
+    u8MonthLength = (u8Month == 1  &&  LEAP_YEAR(u8Year)) ? 29 : _u8MonthDays[u8Month];
+    if (u32Time < u8MonthLength)  break;
+    u32Time -= u8MonthLength;
+  }
+  Tm.Month = u8Month + 1;
+  Tm.Day   = u32Time + 1;
+}
+
+
+/***************************************
+* makeTime
+*
+*/
+
+time_t makeTime(const tmElements_t &Tm)
+{
+  uint32_t u32Seconds;
+  int      i;
+
+  u32Seconds = Tm.Year * (SECS_PER_DAY * 365);
+  for (i=0; i<Tm.Year; i++) {
+    if (LEAP_YEAR(i))  u32Seconds += SECS_PER_DAY;
+  }
+
+  for (i=1; i<Tm.Month; i++) {
+    if (i == 2  &&  LEAP_YEAR(Tm.Year))  u32Seconds += SECS_PER_DAY * 29;
+    else                                 u32Seconds += SECS_PER_DAY * _u8MonthDays[i-1];
+  }
+  u32Seconds += (Tm.Day - 1) * SECS_PER_DAY;
+  u32Seconds += Tm.Hour * SECS_PER_HOUR;
+  u32Seconds += Tm.Minute * SECS_PER_MIN;
+  u32Seconds += Tm.Second;
+  return (time_t) u32Seconds;
+}
+
+
+static tmElements_t _Tm(time_t t)
+{
+  tmElements_t Tm;
+
+  breakTime(t, Tm);
+  return Tm;
+}
+
+int hour(time_t t)    { return _Tm(t).Hour; }
+int minute(time_t t)  { return _Tm(t).Minute; }
+int second(time_t t)  { return _Tm(t).Second; }
+int day(time_t t)     { return _Tm(t).Day; }
+int weekday(time_t t) { return _Tm(t).Wday; }
+int month(time_t t)   { return _Tm(t).Month; }
+int year(time_t t)    { return tmYearToCalendar(_Tm(t).Year); }
+bool isAM(time_t t)   { return hour(t) < 12; }
+bool isPM(time_t t)   { return hour(t) >= 12; }
+
+int hourFormat12(time_t t)
+{
+  int iHour = hour(t) % 12;
+
+  return iHour == 0 ? 12 : iHour;
+}
+
+int hour()    { return hour(now()); }
+int minute()  { return minute(now()); }
+int second()  { return second(now()); }
+int day()     { return day(now()); }
+int weekday() { return weekday(now()); }
+int month()   { return month(now()); }
+int year()    { return year(now()); }
@@ -0,0 +1,67 @@
+/***************
+* NTP Clock
+*
+* Paul Stoffregen's TimeLib, as far as the clock uses it, for the host build: the
+* system time that now() counts on from setTime() using millis(), and the
+* calendar conversions.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef TIME_LIB_H
+#define TIME_LIB_H
+
+#include <Arduino.h>
+#include <time.h>
+
+typedef struct {
+  uint8_t Second;
+  uint8_t Minute;
+  uint8_t Hour;
+  uint8_t Wday;     // Day of week, Sunday is day 1
+  uint8_t Day;
+  uint8_t Month;
+  uint8_t Year;     // Offset from 1970
+} tmElements_t;
+
+typedef enum { timeNotSet, timeNeedsSync, timeSet } timeStatus_t;
+
+#define tmYearToCalendar(Y)  ((Y) + 1970)
+#define CalendarYrToTm(Y)    ((Y) - 1970)
+
+#define SECS_PER_MIN   ((time_t) (60UL))
+#define SECS_PER_HOUR  ((time_t) (3600UL))
+#define SECS_PER_DAY   ((time_t) (SECS_PER_HOUR * 24UL))
+#define DAYS_PER_WEEK  ((time_t) (7UL))
+#define SECS_PER_WEEK  ((time_t) (SECS_PER_DAY * DAYS_PER_WEEK))
+
+time_t now();
+void   setTime(time_t t);
+timeStatus_t timeStatus();
+
+int hour(time_t t);
+int minute(time_t t);
+int second(time_t t);
+int day(time_t t);
+int weekday(time_t t);
+int month(time_t t);
+int year(time_t t);
+int hourFormat12(time_t t);
+bool isAM(time_t t);
+bool isPM(time_t t);
+
+int hour();
+int minute();
+int second();
+int day();
+int weekday();
+int month();
+int year();
+
+void   breakTime(time_t t, tmElements_t &Tm);
+time_t makeTime(const tmElements_t &Tm);
+
+
+#endif   /* TIME_LIB_H */
@@ -0,0 +1,129 @@
+/***************
+* NTP Clock
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#include "Timezone.h"
+
+
+/***************************************
+* Timezone constructor
+*
+*/
+
+Timezone::Timezone(TimeChangeRule DstStart, TimeChangeRule StdStart) :
+  _Dst(DstStart),
+  _Std(StdStart),
+  _tDstUtc(0),
+  _tStdUtc(0),
+  _tDstLoc(0),
+  _tStdLoc(0)
+{
+}
+
+
+/***************************************
+* Timezone::_ToTime
+*
+* The local time a rule fires in the given year.  A "Last" week is found as the
+* first week of the next month, less a week.
+*/
+
+time_t Timezone::_ToTime(const TimeChangeRule &Rule, int iYear)
+{
+  tmElements_t Tm;
+  uint8_t      u8Month = Rule.month;
+  uint8_t      u8Week  = Rule.week;
+  time_t       t;
+
+  if (u8Week == Last) {
+    if (++u8Month > 12) {
+      u8Month = 1;
+      iYear++;
+    }
+    u8Week = First;
+  }
+
+  Tm.Hour   = Rule.hour;
+  Tm.Minute = 0;
+  Tm.Second = 0;
+  Tm.Day    = 1;
+  Tm.Month  = u8Month;
+  Tm.Year   = CalendarYrToTm(iYear);
+  t = makeTime(Tm);
+
+  t += ((Rule.dow - weekday(t) + 7) % 7 + (u8Week - 1) * 7) * SECS_PER_DAY;
+  if (Rule.week == Last)  t -= 7 * SECS_PER_DAY;
+  return t;
+}
+
+
+/***************************************
+* Timezone::_CalcTimeChanges
+*
+*/
+
+void Timezone::_CalcTimeChanges(int iYear)
+{
+  _tDstLoc = _ToTime(_Dst, iYear);
+  _tStdLoc = _ToTime(_Std, iYear);
+  _tDstUtc = _tDstLoc - _Std.offset * SECS_PER_MIN;
+  _tStdUtc = _tStdLoc - _Dst.offset * SECS_PER_MIN;
+}
+
+
+/***************************************
+* Timezone::utcIsDST, locIsDST
+*
+* With the same offset in both rules there's no daylight time.  South of the
+* equator, standard time starts first in the year.
+*/
+
+bool Timezone::utcIsDST(time_t tUtc)
+{
+  if (year(tUtc) != year(_tDstUtc))  _CalcTimeChanges(year(tUtc));
+
+  if (_tStdUtc == _tDstUtc)  return false;
+  if (_tStdUtc > _tDstUtc)   return tUtc >= _tDstUtc  &&  tUtc < _tStdUtc;
+  return !(tUtc >= _tStdUtc  &&  tUtc < _tDstUtc);
+}
+
+
+bool Timezone::locIsDST(time_t tLocal)
+{
+  if (year(tLocal) != year(_tDstLoc))  _CalcTimeChanges(year(tLocal));
+
+  if (_tStdUtc == _tDstUtc)  return false;
+  if (_tStdLoc > _tDstLoc)   return tLocal >= _tDstLoc  &&  tLocal < _tStdLoc;
+  return !(tLocal >= _tStdLoc  &&  tLocal < _tDstLoc);
+}
+
+
+/***************************************
+* Timezone::toLocal, toUTC
+*
+*/
+
+time_t Timezone::toLocal(time_t tUtc)
+{
+  return tUtc + (utcIsDST(tUtc) ? _Dst.offset : _Std.offset) * SECS_PER_MIN;
+}
+
+
+time_t Timezone::toLocal(time_t tUtc, TimeChangeRule **ppTcr)
+{
+  bool bDst = utcIsDST(tUtc);
+
+  *ppTcr = bDst ? &_Dst : &_Std;
+  return tUtc + (bDst ? _Dst.offset : _Std.offset) * SECS_PER_MIN;
+}
+
+
+time_t Timezone::toUTC(time_t tLocal)
+{
+  if (year(tLocal) != year(_tDstLoc))  _CalcTimeChanges(year(tLocal));
+
+  return tLocal - (locIsDST(tLocal) ? _Dst.offset : _Std.offset) * SECS_PER_MIN;
+}
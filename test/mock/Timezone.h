@@ -0,0 +1,56 @@
+/***************
+* NTP Clock
+*
+* Jack Christensen's Timezone library, as far as the clock uses it, for the host
+* build.  A zone is two rules, one for the start of daylight time and one for the
+* start of standard time; the year's change times are worked out from them when
+* a time in a different year comes along.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef TIMEZONE_H
+#define TIMEZONE_H
+
+#include <TimeLib.h>
+
+enum week_t  { Last, First, Second, Third, Fourth };
+enum dow_t   { Sun = 1, Mon, Tue, Wed, Thu, Fri, Sat };
+enum month_t { Jan = 1, Feb, Mar, Apr, May, Jun, Jul, Aug, Sep, Oct, Nov, Dec };
+
+struct TimeChangeRule {
+  char    abbrev[6];
+  uint8_t week;        // week_t
+  uint8_t dow;         // dow_t
+  uint8_t month;       // month_t
+  uint8_t hour;        // 0-23, local time the change happens at
+  int     offset;      // From UTC, in minutes
+};
+
+
+class Timezone {
+public:
+  Timezone(TimeChangeRule DstStart, TimeChangeRule StdStart);
+
+  time_t toLocal(time_t tUtc);
+  time_t toLocal(time_t tUtc, TimeChangeRule **ppTcr);
+  time_t toUTC(time_t tLocal);
+  bool   utcIsDST(time_t tUtc);
+  bool   locIsDST(time_t tLocal);
+
+protected:
+  void   _CalcTimeChanges(int iYear);
+  time_t _ToTime(const TimeChangeRule &Rule, int iYear);
+
+  TimeChangeRule _Dst;
+  TimeChangeRule _Std;
+  time_t         _tDstUtc;     // When daylight and standard time start, this year
+  time_t         _tStdUtc;
+  time_t         _tDstLoc;
+  time_t         _tStdLoc;
+};
+
+
+#endif   /* TIMEZONE_H */
@@ -0,0 +1,68 @@
+/***************
+* NTP Clock
+*
+* The core's UDP socket, for the host build.  Packets to port 123 go to the
+* simulated NTP server in HostNet.h, whose replies come back after its network
+* delay; anything else is counted and dropped.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef WIFI_UDP_H
+#define WIFI_UDP_H
+
+#include <ESP8266WiFi.h>
+
+#define HOST_UDP_MAX_PACKET  (1500)
+
+
+class WiFiUDP : public Stream {
+public:
+  WiFiUDP();
+  ~WiFiUDP();
+
+  uint8_t begin(uint16_t u16Port);
+  void    stop();
+
+  int    beginPacket(const char *sHost, uint16_t u16Port);
+  int    beginPacket(IPAddress Ip, uint16_t u16Port);
+  size_t write(uint8_t u8Char);
+  size_t write(const uint8_t *pu8Buf, size_t Len);
+  using Print::write;
+  int    endPacket();
+
+  int    parsePacket();
+  int    available();
+  int    read();
+  int    read(unsigned char *pu8Buf, size_t Len);
+  int    read(char *pBuf, size_t Len) { return read((unsigned char *) pBuf, Len); }
+  int    peek();
+  void   flush() {}
+  IPAddress remoteIP()   { return _RemoteIp; }
+  uint16_t  remotePort() { return _u16RemotePort; }
+
+  // For the simulated network: queues a packet to arrive at u64DueUs
+  void   HostDeliver(const uint8_t *pu8Data, size_t Len, uint64_t u64DueUs, IPAddress From, uint16_t u16FromPort);
+
+protected:
+  uint16_t  _u16LocalPort;
+  uint16_t  _u16DestPort;
+  uint8_t   _u8Tx[HOST_UDP_MAX_PACKET];
+  size_t    _TxLen;
+
+  // One packet in flight and one being read is all the clock ever has
+  uint8_t   _u8Pending[HOST_UDP_MAX_PACKET];
+  size_t    _PendingLen;
+  uint64_t  _u64PendingDueUs;
+  bool      _bPending;
+  uint8_t   _u8Rx[HOST_UDP_MAX_PACKET];
+  size_t    _RxLen;
+  size_t    _RxPos;
+  IPAddress _RemoteIp;
+  uint16_t  _u16RemotePort;
+};
+
+
+#endif   /* WIFI_UDP_H */
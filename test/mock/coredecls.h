@@ -0,0 +1,27 @@
+/***************
+* NTP Clock
+*
+* The core's scheduling hooks, for the host build.  esp_schedule() ends the
+* delay() in progress (or the next one) early, as it does on the chip.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef COREDECLS_H
+#define COREDECLS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void esp_yield();
+void esp_schedule();
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif   /* COREDECLS_H */
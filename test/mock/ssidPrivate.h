@@ -0,0 +1,13 @@
+/***************
+* NTP Clock
+*
+* The networks the host build's simulated access points answer to.  See ssid.h.
+*
+* Brad Hines
+* Feb 2020
+*/
+
+#define NTP_SSID    "HostNet"
+#define NTP_PASSWD  "host-password"
+#define NTP_SSID2   "HostNet2"
+#define NTP_PASSWD2 "host-password2"
@@ -0,0 +1,43 @@
+/***************
+* NTP Clock
+*
+* The SDK's software timers, for the host build.  They run off the virtual clock,
+* from inside whatever waits (see Host.h).
+*
+* Brad Hines
+* Feb 2020
+*/
+
+
+#ifndef USER_INTERFACE_H
+#define USER_INTERFACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*os_timer_func_t)(void *pArg);
+
+typedef struct _os_timer_t {
+  os_timer_func_t pfnTimer;
+  void           *pArg;
+  uint32_t        u32PeriodMs;
+  bool            bRepeat;
+  bool            bArmed;
+  uint64_t        u64DueUs;
+  struct _os_timer_t *pNext;   // In the list of armed timers
+} os_timer_t;
+
+void os_timer_setfn(os_timer_t *pTimer, os_timer_func_t pfnTimer, void *pArg);
+void os_timer_arm(os_timer_t *pTimer, uint32_t u32Ms, bool bRepeat);
+void os_timer_disarm(os_timer_t *pTimer);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif   /* USER_INTERFACE_H */
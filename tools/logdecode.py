@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+#
+# NTP Clock
+#
+# Decodes the binary log frames written by tLog (see Log.h) back into text.  The
+# message formats come from LogMessages.h, so the two can't get out of step.
+#
+# Anything on the port that isn't a valid frame (boot messages, Serial.print
+# output from setup()) is passed through as-is.
+#
+#   logdecode.py capture.bin
+#   logdecode.py /dev/ttyUSB0 --baud 115200      (needs pyserial)
+#
+# Brad Hines
+# Feb 2020
+#
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+SYNC       = b'\xA5\x5A'
+FRAME_SIZE = 22
+LEVELS     = 'DIWE'
+
+
+def load_catalog(path):
+    """Returns the list of formats, indexed by message ID."""
+    with open(path) as f:
+        text = f.read()
+    formats = re.findall(r'LOG_MSG\(\s*\w+\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)', text)
+    # The catalog only allows %ld, which Python spells %d
+    return [re.sub(r'(%[-+ #0]*\d*)l', r'\1', fmt) for fmt in formats]
+
+
+def format_record(formats, time_ms, msg_id, level, args):
+    level_letter = LEVELS[level] if level < len(LEVELS) else '?'
+    if msg_id < len(formats):
+        fmt  = formats[msg_id]
+        text = fmt % tuple(args[:len(re.findall(r'%[^%]', fmt.replace('%%', '')))])
+    else:
+        text = 'message %d %d %d %d' % ((msg_id,) + tuple(args))
+    return '%d.%03d %s %s' % (time_ms // 1000, time_ms % 1000, level_letter, text)
+
+
+def decode(stream, formats, out):
+    buf = b''
+    while True:
+        chunk = stream.read(256)
+        if not chunk:
+            break
+        buf += chunk
+
+        while True:
+            pos = buf.find(SYNC)
+            if pos < 0:
+                # Keep a trailing 0xA5 in case it's the start of a frame
+                keep = 1 if buf.endswith(SYNC[:1]) else 0
+                out.write(buf[:len(buf) - keep].decode('latin-1'))
+                buf = buf[len(buf) - keep:]
+                break
+
+            out.write(buf[:pos].decode('latin-1'))
+            buf = buf[pos:]
+            if len(buf) < FRAME_SIZE:
+                break
+
+            body = buf[2:FRAME_SIZE - 1]
+            if sum(body) & 0xFF != buf[FRAME_SIZE - 1]:
+                # Not a frame after all; emit the first byte and look again
+                out.write(buf[:1].decode('latin-1'))
+                buf = buf[1:]
+                continue
+
+            time_ms, msg_id, level = struct.unpack_from('<IHB', body, 0)
+            args = list(struct.unpack_from('<3i', body, 7))
+            out.write(format_record(formats, time_ms, msg_id, level, args) + '\n')
+            buf = buf[FRAME_SIZE:]
+        out.flush()
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description='Decode NTP Clock binary logs')
+    parser.add_argument('source', help='capture file, or serial port')
+    parser.add_argument('--baud', type=int, default=115200)
+    parser.add_argument('--catalog', default=os.path.join(here, '..', 'LogMessages.h'))
+    args = parser.parse_args()
+
+    formats = load_catalog(args.catalog)
+
+    if os.path.isfile(args.source):
+        with open(args.source, 'rb') as stream:
+            decode(stream, formats, sys.stdout)
+    else:
+        import serial
+        with serial.Serial(args.source, args.baud, timeout=1) as port:
+            class Reader:
+                def read(self, n):
+                    data = b''
+                    while not data:
+                        data = port.read(n)
+                    return data
+            decode(Reader(), formats, sys.stdout)
+
+
+if __name__ == '__main__':
+    main()